@@ -0,0 +1,132 @@
+// Checks the device memory allocator without a window. Works on a CPU
+// implementation such as lavapipe, e.g.
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./Allocator_Check
+// Fills three blocks with movable buffers, frees most of them and compacts
+// the pool with defragment. The live bytes and buffer contents must survive
+// the moves, and the block that was emptied must be released once its source
+// spans are freed. The exit code is nonzero when a check fails.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Routines/VulkanSetup.hpp>
+#include <VulkanTools/Structures/VulkanInstance.hpp>
+#include <NetworkViewport/Render/Memory_Allocator.hpp>
+
+// Small blocks, so a few buffers spread over several of them
+const VkDeviceSize blockSize = 1024 * 1024;
+const VkDeviceSize bufferSize = 64 * 1024;
+const uint32_t buffersPerBlock = static_cast<uint32_t>(blockSize / bufferSize);
+
+struct PoolTotals
+{
+    VkDeviceSize liveBytes = 0;
+    uint32_t blockCount = 0;
+};
+
+PoolTotals poolTotals(render::DeviceMemoryAllocator &allocator)
+{
+    PoolTotals totals;
+    for (const render::HeapStats &heap : render::memoryHeapStats(allocator))
+    {
+        totals.liveBytes += heap.liveBytes;
+        totals.blockCount += heap.blockCount;
+    }
+    return totals;
+}
+
+bool check(bool condition, const char *what)
+{
+    printf("%s: %s\n", condition ? "ok" : "FAILED", what);
+    return condition;
+}
+
+int main(int argc, char **argv)
+{
+    bool validation = argc > 1 && std::string(argv[1]) == "--validation";
+
+    VulkanInstance vulkanInstance;
+    createVulkanInstance(validation, "Network Viewport Allocator Check", vulkanInstance.instance, vulkanInstance.supportedInstanceExtensions, vulkanInstance.enabledInstanceExtensions, VK_API_VERSION_1_0);
+    setupVulkanPhysicalDevice(vulkanInstance, validation);
+    VulkanDevice *vulkanDevice = vulkanInstance.vulkanDevice;
+    printf("Device: %s\n", vulkanDevice->properties.deviceName);
+
+    render::DeviceMemoryAllocator allocator;
+    render::createDeviceMemoryAllocator(allocator, vulkanDevice, blockSize);
+
+    // Host-visible, so the contents can be copied and checked without a queue
+    int mover = 0;
+    std::vector<render::AllocatedBuffer> buffers(3 * buffersPerBlock);
+    for (uint32_t i = 0; i < buffers.size(); i++)
+    {
+        VK_CHECK_RESULT(render::createMovableBuffer(allocator, &mover, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferSize, buffers[i]));
+        memset(buffers[i].mapped, static_cast<int>(i), bufferSize);
+    }
+    bool valid = check(poolTotals(allocator).blockCount == 3, "buffers fill three blocks");
+
+    // Keep 2 buffers of the first block, 3 of the second and 12 of the third. The first block fits into the
+    // second, the second does not fit into the third afterwards
+    std::vector<uint32_t> kept = {2, 3, 12};
+    for (uint32_t block = 0; block < kept.size(); block++)
+    {
+        for (uint32_t i = kept[block]; i < buffersPerBlock; i++)
+        {
+            render::destroyBuffer(allocator, buffers[block * buffersPerBlock + i]);
+        }
+    }
+    PoolTotals before = poolTotals(allocator);
+    VkDeviceSize keptBytes = 0;
+    for (const render::AllocatedBuffer &buffer : buffers)
+    {
+        keptBytes += buffer.allocation ? buffer.allocation->size : 0;
+    }
+    valid = check(before.blockCount == 3 && before.liveBytes == keptBytes, "freed buffers leave three sparse blocks") && valid;
+
+    int otherMover = 0;
+    valid = check(render::defragment(allocator, &otherMover).empty(), "buffers of another owner are not moved") && valid;
+
+    std::vector<render::DefragmentationMove> moves = render::defragment(allocator, &mover);
+    valid = check(moves.size() == kept[0], "the least occupied block is emptied") && valid;
+    for (const render::DefragmentationMove &move : moves)
+    {
+        for (uint32_t i = 0; i < buffers.size(); i++)
+        {
+            render::AllocatedBuffer &buffer = buffers[i];
+            if (buffer.allocation != move.allocation)
+            {
+                continue;
+            }
+            VkBuffer oldBuffer = render::rebindMovedBuffer(allocator, buffer);
+            memcpy(move.allocation->mapped, move.source->mapped, move.allocation->size);
+            vkDestroyBuffer(vulkanDevice->logicalDevice, oldBuffer, nullptr);
+            render::freeMemory(allocator, move.source);
+        }
+    }
+
+    PoolTotals after = poolTotals(allocator);
+    valid = check(after.liveBytes == before.liveBytes, "live bytes survive the compaction") && valid;
+    valid = check(after.blockCount == before.blockCount - 1, "the emptied block is released") && valid;
+
+    bool contentsKept = true;
+    for (uint32_t i = 0; i < buffers.size(); i++)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(buffers[i].mapped);
+        for (VkDeviceSize byte = 0; data && byte < bufferSize; byte++)
+        {
+            contentsKept = contentsKept && data[byte] == static_cast<uint8_t>(i);
+        }
+    }
+    valid = check(contentsKept, "moved buffers keep their contents") && valid;
+
+    for (render::AllocatedBuffer &buffer : buffers)
+    {
+        render::destroyBuffer(allocator, buffer);
+    }
+    valid = check(poolTotals(allocator).liveBytes == 0, "all memory is returned") && valid;
+    render::destroyDeviceMemoryAllocator(allocator);
+
+    printf("%s\n", valid ? "All checks passed" : "Checks failed");
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// Writes a generated graph as an octree chunk file for streaming, e.g.
+//   ./Chunk_Builder --nodes 10000000 --degree 4 --output graph.nvchunks
+//   ./ER_Clusters_2D graph.nvchunks
+// The graph is built in memory here, the viewer only maps the file. The file
+// stores the instance layout this build was compiled with (NV_PACKED_INSTANCES).
+// With --communities the nodes are grouped and colored by their Louvain
+// community before chunking.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <igraph/igraph.h>
+#include <NetworkViewport/Graph/Graph_Communities.hpp>
+#include <NetworkViewport/Graph/Graph_Layout.hpp>
+#include <NetworkViewport/Render/Chunk_File.hpp>
+
+struct BuilderOptions
+{
+    size_t nodes = 1000000;
+    double degree = 4.;
+    // Kamada-Kawai is only feasible for small graphs
+    bool kamadaKawai = false;
+    // Side length of the cube random layouts are spread over
+    float extent = 1000.f;
+    // Group and color the layout by Louvain community
+    bool communities = false;
+    double resolution = 1.;
+    render::ChunkBuildSettings settings;
+    std::string output = "graph.nvchunks";
+};
+
+void printUsage(const char *executable)
+{
+    printf("Usage: %s [--nodes N] [--degree D] [--layout random|kk] [--extent E]\n"
+           "          [--communities] [--resolution R] [--chunk-nodes N] [--max-depth N] [--output FILE]\n",
+           executable);
+}
+
+bool parseOptions(int argc, char **argv, BuilderOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--nodes" && hasValue)
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--degree" && hasValue)
+            options.degree = std::atof(argv[++i]);
+        else if (arg == "--extent" && hasValue)
+            options.extent = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--communities")
+            options.communities = true;
+        else if (arg == "--resolution" && hasValue)
+            options.resolution = std::atof(argv[++i]);
+        else if (arg == "--chunk-nodes" && hasValue)
+            options.settings.maxChunkNodes = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--max-depth" && hasValue)
+            options.settings.maxDepth = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--layout" && hasValue)
+        {
+            std::string layout = argv[++i];
+            if (layout == "random")
+                options.kamadaKawai = false;
+            else if (layout == "kk")
+                options.kamadaKawai = true;
+            else
+                return false;
+        }
+        else
+            return false;
+    }
+    return options.nodes > 0 && options.settings.maxChunkNodes > 0;
+}
+
+std::vector<NodeInstanceData> randomLayout3D(const igraph_t &graph, float extent)
+{
+    size_t N_nodes = igraph_vcount(&graph);
+    igraph_matrix_t pos;
+    igraph_matrix_init(&pos, N_nodes, 3);
+    igraph_layout_random_3d(&graph, &pos);
+
+    // igraph places the nodes in [-1, 1]
+    std::vector<NodeInstanceData> node_data;
+    node_data.reserve(N_nodes);
+    for (size_t i = 0; i < N_nodes; i++)
+    {
+        glm::vec3 position(MATRIX(pos, i, 0), MATRIX(pos, i, 1), MATRIX(pos, i, 2));
+        node_data.push_back({position * (.5f * extent), {1.f, 1.f, 1.f, .8f}, 1.f});
+    }
+    igraph_matrix_destroy(&pos);
+    return node_data;
+}
+
+// Places every community on its own spot in the extent and colors it with one of the community palette colors
+void groupCommunities(const igraph_t &graph, std::vector<NodeInstanceData> &node_data, const BuilderOptions &options)
+{
+    constexpr uint32_t N_colors = 16;
+    graph::CSRGraph csr = graph::build_csr(graph);
+    graph::community::LouvainParams params;
+    params.resolution = options.resolution;
+    graph::community::LouvainResult result = graph::community::louvain(csr, params);
+    printf("Louvain found %u communities, modularity %.4f, %u levels %u sweeps in %.1f s\n", result.N_communities, result.modularity,
+           result.levels, result.sweeps, result.seconds);
+
+    // The spiral of anchors reaches spacing * cbrt(N_communities) from the center
+    float spacing = .5f * options.extent / std::max(std::cbrt(static_cast<float>(result.N_communities)), 1.f);
+    graph::layout::group_by_community(node_data, result.community, result.N_communities, spacing);
+    std::vector<uint8_t> colors = graph::community::color_communities(csr, result.community, result.N_communities, N_colors);
+    for (size_t i = 0; i < node_data.size(); i++)
+    {
+        glm::vec4 color = graph::community::community_color(colors[result.community[i]], N_colors);
+        node_data[i].color = {color.r, color.g, color.b, .8f};
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BuilderOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+    igraph_t graph;
+    igraph_integer_t N_edges = static_cast<igraph_integer_t>(options.nodes * options.degree / 2);
+    igraph_erdos_renyi_game(&graph, IGRAPH_ERDOS_RENYI_GNM, options.nodes, N_edges, 0, 0);
+
+    auto nodeInstanceData = options.kamadaKawai ? graph::layout::kamada_kawai_3D(graph, 500, 0) : randomLayout3D(graph, options.extent);
+    if (options.communities)
+        groupCommunities(graph, nodeInstanceData, options);
+    auto edgeInstanceData = graph::layout::get_edge_positions(nodeInstanceData, graph);
+    igraph_destroy(&graph);
+    auto tGraph = std::chrono::high_resolution_clock::now();
+
+    if (!render::writeChunkFile(options.output, nodeInstanceData, edgeInstanceData, options.settings))
+    {
+        printf("Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    auto tEnd = std::chrono::high_resolution_clock::now();
+
+    render::ChunkFile chunkFile;
+    if (!render::openChunkFile(chunkFile, options.output))
+    {
+        printf("Could not read back %s\n", options.output.c_str());
+        return 1;
+    }
+    printf("Wrote %zu nodes and %zu edges as %u chunks (%zu bytes) to %s, graph %.1f s, chunks %.1f s\n",
+           nodeInstanceData.size(), edgeInstanceData.size(), chunkFile.header->chunkCount, chunkFile.file.size, options.output.c_str(),
+           std::chrono::duration<double>(tGraph - tStart).count(),
+           std::chrono::duration<double>(tEnd - tGraph).count());
+    render::closeChunkFile(chunkFile);
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <random>
 #include <chrono>
 #include <memory>
+#include <future>
 #include <vulkan/vulkan.hpp>
 #include <imgui/imgui.h>
 #include <GLFW/glfw3.h>
@@ -14,45 +15,34 @@
 #include <VulkanTools/Interactive/VulkanProjectionBuffer.hpp>
 #include <NetworkViewport/ImGui/ImGuiUI.hpp>
 #include <NetworkViewport/Graph/Graph_Layout.hpp>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
 #include <VulkanTools/gltf/VulkanglTFModel.hpp>
 #include <NetworkViewport/Menu/UISettings.hpp>
+#include <NetworkViewport/Render/Pipeline_Cache.hpp>
+#include <NetworkViewport/Utils/Trace.hpp>
 #include "SetupRoutines.hpp"
 #include <random>
 
 #ifdef WIN32
 const std::string assetPath = "C:\\Users\\jonas\\Documents\\NetworkViewport\\data\\";
-const std::string shadersPath = assetPath + "shaders\\";
-const std::string computeShadersPath = assetPath + "computeShaders\\";
 const std::string modelPath = assetPath + "models\\";
 const std::string texturePath = assetPath + "textures\\";
 #else
 const std::string assetPath = "/home/deb/Documents/NetworkViewport/data/";
-const std::string shadersPath = assetPath + "shaders/";
-const std::string computeShadersPath = assetPath + "computeShaders/";
 const std::string modelPath = assetPath + "models/";
 const std::string texturePath = assetPath + "textures/";
 #endif
-
-void setupDescriptorPool(VkDevice logicalDevice, VkDescriptorPool& descriptorPool)
-{
-    // Example uses one ubo
-    std::vector<VkDescriptorPoolSize> poolSizes =
-    {
-        initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),
-        initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2),
-    };
-
-    VkDescriptorPoolCreateInfo descriptorPoolInfo =
-        initializers::descriptorPoolCreateInfo(
-            poolSizes.size(),
-            poolSizes.data(),
-            2);
-
-    VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
-}
-
-int main()
+const std::string shadersPath = NV_SHADER_DIR;
+const std::string computeShadersPath = NV_COMPUTE_SHADER_DIR;
+const std::string pipelineCachePath = assetPath + "pipeline_cache.bin";
+// Written on F9 when built with NV_ENABLE_TRACING
+const std::string tracePath = "nv_trace.json";
+
+// An optional chunk file written by Chunk_Builder is streamed in place of the generated graph
+int main(int argc, char** argv)
 {
+    auto tLaunch = std::chrono::high_resolution_clock::now();
+    NV_TRACE_THREAD("Main");
 
     VulkanInstance vulkanInstance;
 
@@ -103,48 +93,120 @@ int main()
     float nodePosOffset[3] = {0.f, 0.f, 0.f};
     
     igraph_t graph;
-    igraph_erdos_renyi_game(&graph, IGRAPH_ERDOS_RENYI_GNP, N_nodes, 0.5, 0, 0);
+    {
+        NV_TRACE_ZONE("Generate graph");
+        igraph_erdos_renyi_game(&graph, IGRAPH_ERDOS_RENYI_GNP, N_nodes, 0.5, 0, 0);
+    }
 
     auto nodeInstanceData = graph::layout::kamada_kawai_2D(graph, 500, 0);
     auto edgeInstanceData = graph::layout::get_edge_positions(nodeInstanceData, graph);
+    graph::CSRGraph csr = graph::build_csr(graph);
 
 
     prepareProjectionBuffer(vulkanDevice, vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera);
 
-    using namespace glTFBasicInstance;
+    // Seeded from disk, a warm cache turns pipeline compilation into lookups
+    auto tPipelinesStart = std::chrono::high_resolution_clock::now();
+    render::PipelineCacheLoadInfo pipelineCacheInfo;
+    VkPipelineCache pipelineCache = render::loadPipelineCache(vulkanDevice, pipelineCachePath, &pipelineCacheInfo);
 
-    VkDescriptorPool renderDescriptorPool;
-    setupDescriptorPool(vulkanDevice->logicalDevice, renderDescriptorPool);
+    // Backs the viewport's buffers and images
+    render::DeviceMemoryAllocator memoryAllocator;
+    render::createDeviceMemoryAllocator(memoryAllocator, vulkanDevice);
 
-    VkDeviceSize offset[1] = {0};
+    // Initial uploads are batched into one submission on the transfer queue
+    render::TransferService transferService;
+    render::createTransferService(transferService, &memoryAllocator, vulkanInstance.queue);
 
-    InstanceRenderingParams nodeParams;
-    nodeParams.vertexShaderPath = shadersPath + "node.vert.spv";
+    // Frames in flight each update the camera block in their own command buffer
+    ScenePipelines scenePipelines;
+    render::createProjectionUniform(scenePipelines.projection, &memoryAllocator, sizeof(vulkanInstance.projection.data));
+
+    // Instance buffers use the layout selected by NV_PACKED_INSTANCES, the vertex shaders have to match
+    render::InstancePipelineParams nodeParams;
+    nodeParams.vertexShaderPath = shadersPath + "node" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
     nodeParams.fragmentShaderPath = shadersPath + "node.frag.spv";
-    nodeParams.modelPath = modelPath + "ico_node.gltf";
     nodeParams.vulkanDevice = vulkanInstance.vulkanDevice;
-    nodeParams.uniformProjectionBuffer = &vulkanInstance.projection.buffer;
-    nodeParams.queue = vulkanInstance.queue;
+    nodeParams.allocator = &memoryAllocator;
+    nodeParams.uniformProjectionBuffer = scenePipelines.projection.buffer.descriptor;
+    nodeParams.transferService = &transferService;
     nodeParams.renderPass = vulkanInstance.renderPass;
-    nodeParams.pipelineCache = vulkanInstance.pipelineCache;
-    nodeParams.descriptorPool = renderDescriptorPool;
-    nodeParams.offset = offset;
+    nodeParams.pipelineCache = pipelineCache;
 
-    InstanceRenderingParams edgeParams;
-    edgeParams.vertexShaderPath = shadersPath + "edge.vert.spv";
+    render::InstancePipelineParams edgeParams = nodeParams;
+    edgeParams.vertexShaderPath = shadersPath + "edge" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
     edgeParams.fragmentShaderPath = shadersPath + "edge.frag.spv";
-    edgeParams.modelPath = modelPath + "bezier.gltf";
-    edgeParams.vulkanDevice = vulkanInstance.vulkanDevice;
-    edgeParams.uniformProjectionBuffer = &vulkanInstance.projection.buffer;
-    edgeParams.queue = vulkanInstance.queue;
-    edgeParams.renderPass = vulkanInstance.renderPass;
-    edgeParams.pipelineCache = vulkanInstance.pipelineCache;
-    edgeParams.descriptorPool = renderDescriptorPool;
-    edgeParams.offset = offset;
 
-    std::vector<std::unique_ptr<InstancePipelineData>> instancePipelines;
-    instancePipelines.push_back(prepareInstanceRendering<NodeInstanceData>(nodeParams, nodeInstanceData));
-    instancePipelines.push_back(prepareInstanceRendering<EdgeInstanceData>(edgeParams, edgeInstanceData));    
+    // Line edges and the density splat share the instance buffers and are created when first selected
+    render::LineEdgeParams& lineParams = scenePipelines.lineParams;
+    lineParams.vertexShaderPath = shadersPath + "line" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+    lineParams.fragmentShaderPath = shadersPath + "line.frag.spv";
+    lineParams.vulkanDevice = vulkanInstance.vulkanDevice;
+    lineParams.uniformProjectionBuffer = scenePipelines.projection.buffer.descriptor;
+    lineParams.renderPass = vulkanInstance.renderPass;
+    lineParams.pipelineCache = pipelineCache;
+
+    render::DensitySplatParams& splatParams = scenePipelines.splatParams;
+    splatParams.shadersPath = shadersPath;
+    splatParams.vulkanDevice = vulkanInstance.vulkanDevice;
+    splatParams.allocator = &memoryAllocator;
+    splatParams.uniformProjectionBuffer = scenePipelines.projection.buffer.descriptor;
+    splatParams.renderPass = vulkanInstance.renderPass;
+    splatParams.pipelineCache = pipelineCache;
+
+    // Per-frame staging for streamed instance updates
+    const VkDeviceSize uploadFrameSize = 16 * 1024 * 1024;
+    render::UploadRing uploadRing;
+    render::createUploadRing(uploadRing, &memoryAllocator, uploadFrameSize, vulkanInstance.swapChain.imageCount);
+    FrameSemaphores frameSemaphores;
+    createFrameSemaphores(frameSemaphores, vulkanDevice->logicalDevice, vulkanInstance.swapChain.imageCount, vulkanInstance.swapChain.imageCount);
+
+    render::createGpuProfiler(scenePipelines.gpuProfiler, vulkanDevice, vulkanInstance.swapChain.imageCount);
+
+    // Node states and their palette read by the node pipeline, written by the CPU engines through the upload ring
+    // and stepped in place by the compute shader epidemic
+    render::EpidemicColoring epidemic;
+    render::createNodeStateBuffer(epidemic.stateBuffer, &memoryAllocator, csr.N_nodes);
+    render::GpuEpidemicParams gpuEpidemicParams;
+    gpuEpidemicParams.computeShadersPath = computeShadersPath;
+    gpuEpidemicParams.vulkanDevice = vulkanInstance.vulkanDevice;
+    gpuEpidemicParams.allocator = &memoryAllocator;
+    gpuEpidemicParams.transferService = &transferService;
+    gpuEpidemicParams.pipelineCache = pipelineCache;
+    gpuEpidemicParams.stateBuffer = &epidemic.stateBuffer.stateStream.deviceBuffer;
+    scenePipelines.gpuEpidemic = render::prepareGpuEpidemic(gpuEpidemicParams, csr, uiSettings.epidemic.params);
+    // Core numbers and components the node and edge shaders filter by, the edge ends go up with the pipelines' transfer batch
+    render::NodeFiltering filtering;
+    filtering.csr = &csr;
+    render::createNodeFilterBuffer(filtering.buffer, &memoryAllocator, transferService, csr.N_nodes, graph::get_edge_list(graph));
+    // Flags of the picked nodes and of the path or neighborhood found for them
+    render::NodeQuery query;
+    query.csr = &csr;
+    render::createNodeHighlightBuffer(query.buffer, &memoryAllocator, csr.N_nodes);
+    render::InstancePipelineParams stateNodeParams = nodeParams;
+    stateNodeParams.vertexShaderPath = shadersPath + "node" + render::INSTANCE_SHADER_VARIANT + "_state_filter_highlight.vert.spv";
+    stateNodeParams.nodeStateBuffer = epidemic.stateBuffer.stateStream.deviceBuffer.descriptor;
+    stateNodeParams.nodePaletteBuffer = epidemic.stateBuffer.paletteStream.deviceBuffer.descriptor;
+    stateNodeParams.nodeFilterBuffer = filtering.buffer.keyStream.deviceBuffer.descriptor;
+    stateNodeParams.nodeHighlightBuffer = query.buffer.flagStream.deviceBuffer.descriptor;
+    render::InstancePipelineParams filterEdgeParams = edgeParams;
+    filterEdgeParams.vertexShaderPath = shadersPath + "edge" + render::INSTANCE_SHADER_VARIANT + "_filter_highlight.vert.spv";
+    filterEdgeParams.nodeFilterBuffer = filtering.buffer.keyStream.deviceBuffer.descriptor;
+    filterEdgeParams.edgeEndBuffer = filtering.buffer.edgeEndBuffer.descriptor;
+    filterEdgeParams.nodeHighlightBuffer = query.buffer.flagStream.deviceBuffer.descriptor;
+
+    // Scene pipelines only record into the transfer batch and are built on worker threads while the UI is set up
+    auto nodesFuture = std::async(std::launch::async, render::prepareNodeInstancePipeline, std::cref(stateNodeParams), std::cref(nodeInstanceData));
+    auto edgesFuture = std::async(std::launch::async, render::prepareEdgeInstancePipeline, std::cref(filterEdgeParams), std::cref(edgeInstanceData));
+    if (argc > 1)
+    {
+        render::ChunkedSceneParams chunkedParams;
+        chunkedParams.chunkFilePath = argv[1];
+        chunkedParams.nodeParams = nodeParams;
+        chunkedParams.edgeParams = edgeParams;
+        chunkedParams.framesInFlight = vulkanInstance.swapChain.imageCount;
+        scenePipelines.chunkedScene = render::prepareChunkedScene(chunkedParams);
+    }
 
 
     /* ImGUI App Initialization */
@@ -159,24 +221,70 @@ int main()
 
     // camera.setWindowID(ImGui::GetCurrentWindow());
 
-    ImGUI_UI::ImGuiVulkanData ivData(vulkanInstance.vulkanDevice);
+    ImGUI_UI::ImGuiVulkanData ivData(vulkanInstance.vulkanDevice, &memoryAllocator, vulkanInstance.swapChain.imageCount);
+    ivData.pipelineCache = pipelineCache;
 
     ImGUI_UI::setupImGuiVisuals(width, height, uiSettings);
 
-    ImGUI_UI::initializeImGuiVulkanResources(ivData, vulkanInstance.renderPass, vulkanInstance.queue, assetPath + "shaders/");
+    ImGUI_UI::initializeImGuiVulkanResources(ivData, vulkanInstance.renderPass, transferService, shadersPath);
+
+    scenePipelines.instancePipelines.push_back(nodesFuture.get());
+    scenePipelines.instancePipelines.push_back(edgesFuture.get());
+
+    simulation::createEpidemicEngine(epidemic.engine, csr, uiSettings.epidemic.params);
+    simulation::createGillespieEngine(epidemic.events, csr, uiSettings.epidemic.params);
+    epidemic.nodes = scenePipelines.instancePipelines[INSTANCE_PIPELINE_NODES].get();
+    render::CommunityColoring communities;
+    communities.csr = &csr;
+    uiSettings.communities.available = !scenePipelines.chunkedScene;
+    render::NodeAnalytics analytics;
+    render::createNodeAnalytics(analytics, csr, *epidemic.nodes, nodeInstanceData);
+    uiSettings.analytics.available = !scenePipelines.chunkedScene;
+    uiSettings.filter.available = !scenePipelines.chunkedScene;
+    uiSettings.query.available = !scenePipelines.chunkedScene;
+    auto tPipelinesEnd = std::chrono::high_resolution_clock::now();
+    if (!render::savePipelineCache(vulkanDevice, pipelineCache, pipelineCachePath))
+    {
+        printf("Could not write pipeline cache to %s\n", pipelineCachePath.c_str());
+    }
+
+    // The first frame needs the uploaded data, its acquire barriers are picked up in the render loop
+    render::waitTransfer(transferService, render::submitTransfers(transferService));
+
+    auto tStartupEnd = std::chrono::high_resolution_clock::now();
+    printf("Startup: %.1f ms, pipelines %.1f ms (%s pipeline cache, %zu bytes%s)\n",
+           std::chrono::duration<double, std::milli>(tStartupEnd - tLaunch).count(),
+           std::chrono::duration<double, std::milli>(tPipelinesEnd - tPipelinesStart).count(),
+           pipelineCacheInfo.loadedBytes > 0 ? "warm" : "cold",
+           pipelineCacheInfo.loadedBytes,
+           pipelineCacheInfo.rejected ? ", stale file rejected" : "");
 
 
 
 
     /* Render-loop variables */
     bool rebuildSwapChain = false;
-    uint32_t currentBufferIdx;
+    uint32_t imageIndex;
     float frameTimer;
     auto tStart = std::chrono::high_resolution_clock::now();
 
+    bool traceKeyDown = false;
+    // Graphs generated from the menus are prepared and uploaded while the current one is drawn
+    render::GraphLoad graphLoad;
+
     while (!glfwWindowShouldClose(vulkanInstance.glfwWindow))
     {
-        glfwPollEvents();
+        NV_TRACE_ZONE("Frame");
+        {
+            NV_TRACE_ZONE("Poll events");
+            glfwPollEvents();
+        }
+        bool traceKey = glfwGetKey(vulkanInstance.glfwWindow, GLFW_KEY_F9) == GLFW_PRESS;
+        if (traceKey && !traceKeyDown)
+        {
+            printf(utils::writeChromeTrace(tracePath) ? "Trace written to %s\n" : "Could not write trace %s, tracing needs NV_ENABLE_TRACING\n", tracePath.c_str());
+        }
+        traceKeyDown = traceKey;
 
         // Start the Dear ImGui frame
         ImGui_ImplVulkan_NewFrame();
@@ -187,20 +295,125 @@ int main()
         frameTimer = (float)tDiff / 1000.0f;
         tStart = tEnd;
 
-        igraph_t newGraph;
-        ImGUI_UI::newFrame(uiSettings, frameTimer, camera, &newGraph);
-
-        ImGUI_UI::updateBuffers(vulkanInstance.vulkanDevice, ivData.vertexBuffer, ivData.indexBuffer, ivData.indexCount, ivData.vertexCount);
-
-        updateProjectionBuffer(vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera, true);
+        // Frame partitions of the upload ring, the UI buffers, the command buffer and the profiler slot of a frame
+        // share the same fence, once it has signaled the frame's results can be read
+        render::beginUploadFrame(uploadRing);
+        uint32_t frameSlot = uploadRing.frameIndex;
+        render::collectGpuProfilerResults(scenePipelines.gpuProfiler);
+        render::completeGpuEpidemicFrame(*scenePipelines.gpuEpidemic, frameSlot);
+        render::collectRetiredGraphScenes(scenePipelines.retiredScenes);
+        scenePipelines.uploadBatch = {};
 
-        updateWindowSize(vulkanInstance, ivData, camera, instancePipelines, width, height);
+        igraph_t newGraph;
+        bool graphCreated = ImGUI_UI::newFrame(uiSettings, frameTimer, camera, &newGraph, &memoryAllocator, &scenePipelines.gpuProfiler,
+                                               scenePipelines.chunkedScene || scenePipelines.graphReplaced ? nullptr : &epidemic.engine,
+                                               &epidemic.events, scenePipelines.gpuEpidemic.get());
+        if (graphCreated)
+        {
+            // Chunked scenes are not replaced, and a graph created while another one loads is dropped
+            if (scenePipelines.chunkedScene || render::graphLoadActive(graphLoad))
+            {
+                igraph_destroy(&newGraph);
+            }
+            else
+            {
+                render::startGraphLoad(graphLoad, std::async(std::launch::async, prepareGraphScene, newGraph, nodeParams, edgeParams));
+            }
+        }
+        // The swapped in buffers' ownership acquires are taken with this frame's transfer acquires below
+        if (render::updateGraphLoad(graphLoad, transferService))
+        {
+            swapGraphScene(scenePipelines, graphLoad.scene, uiSettings, vulkanInstance.swapChain.imageCount);
+            epidemic.nodes = nullptr;
+        }
+
+        if (scenePipelines.chunkedScene)
+        {
+            render::updateChunkedScene(*scenePipelines.chunkedScene, camera.matrices.perspective, camera.matrices.view);
+        }
+        else if (!scenePipelines.graphReplaced)
+        {
+            bool communitiesShown = render::updateCommunityColoring(communities, epidemic, uiSettings, uploadRing, scenePipelines.uploadBatch);
+            bool analyticsShown = render::updateNodeAnalytics(analytics, epidemic, uiSettings, !communitiesShown, uploadRing, scenePipelines.uploadBatch);
+            if (!communitiesShown && !analyticsShown)
+            {
+                render::updateEpidemicColoring(epidemic, uiSettings, uploadRing, scenePipelines.uploadBatch, scenePipelines.gpuEpidemic.get());
+            }
+            render::updateNodeFiltering(filtering, scenePipelines.instancePipelines, uiSettings, uploadRing, scenePipelines.uploadBatch);
+            // Ctrl+click picks, plain dragging still moves the camera
+            uint32_t pickedNode = render::NODE_PICK_NONE;
+            if (uiSettings.query.available && !io.WantCaptureMouse && io.KeyCtrl && ImGui::IsMouseClicked(0))
+            {
+                pickedNode = render::pickNode(nodeInstanceData, camera.matrices.perspective * camera.matrices.view, {io.MousePos.x, io.MousePos.y},
+                                              width, height, render::NODE_PICK_RADIUS);
+            }
+            render::updateNodeQuery(query, scenePipelines.instancePipelines, uiSettings, pickedNode, uploadRing, scenePipelines.uploadBatch);
+        }
+        scenePipelines.transferAcquires = render::takeTransferAcquires(transferService);
+
+        ImGUI_UI::updateBuffers(ivData, frameSlot);
+
+        {
+            NV_TRACE_ZONE("Update projection");
+            updateProjectionBuffer(vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera, true);
+        }
+
+        updateWindowSize(vulkanInstance, camera, scenePipelines, width, height);
+
+        prepareEdgeModes(scenePipelines, uiSettings, camera.matrices.perspective * camera.matrices.view, width, height);
+
+        acquireFrameImage(vulkanInstance, frameSemaphores, frameSlot, imageIndex);
+        buildCommandBuffer(vulkanInstance.drawCmdBuffers[frameSlot], frameSlot, vulkanInstance.frameBuffers[imageIndex], vulkanInstance.renderPass,
+                           ivData, scenePipelines, &vulkanInstance.projection.data, uiSettings, width, height);
+
+        submitFrame(vulkanInstance, frameSemaphores, frameSlot, imageIndex, render::uploadFrameFence(uploadRing));
+        render::submitGpuProfilerFrame(scenePipelines.gpuProfiler, frameSlot);
+        render::submitGpuEpidemicFrame(*scenePipelines.gpuEpidemic, frameSlot);
 
-        buildCommandBuffers(vulkanInstance.drawCmdBuffers, vulkanInstance.frameBuffers, vulkanInstance.renderPass, ivData, instancePipelines, width, height);
+    }
 
-        submitBuffers(vulkanInstance, currentBufferIdx);
+    utils::FrameTimePercentiles percentiles = utils::allTimePercentiles(uiSettings.frameStats);
+    printf("Frame times over %llu frames: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, %llu hitches\n",
+           static_cast<unsigned long long>(percentiles.frames), percentiles.p50, percentiles.p95, percentiles.p99, percentiles.p999,
+           static_cast<unsigned long long>(uiSettings.frameStats.hitchCount));
 
+    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+    if (graphLoad.prepared.valid())
+    {
+        graphLoad.scene = graphLoad.prepared.get();
+    }
+    render::destroyGraphScene(graphLoad.scene);
+    render::destroyRetiredGraphScenes(scenePipelines.retiredScenes);
+    render::destroyNodeAnalytics(analytics);
+    simulation::stopStateRecorder(epidemic.recorder);
+    simulation::closeStatePlayback(epidemic.playback);
+    render::destroyGpuEpidemic(*scenePipelines.gpuEpidemic);
+    render::destroyNodeStateBuffer(epidemic.stateBuffer);
+    render::destroyNodeFilterBuffer(filtering.buffer);
+    render::destroyNodeQuery(query);
+    for (auto &instancePipeline : scenePipelines.instancePipelines)
+    {
+        render::destroyInstancePipeline(*instancePipeline);
+    }
+    if (scenePipelines.chunkedScene)
+    {
+        render::destroyChunkedScene(*scenePipelines.chunkedScene);
+    }
+    if (scenePipelines.lineEdges)
+    {
+        render::destroyLineEdgePipeline(*scenePipelines.lineEdges);
+    }
+    if (scenePipelines.densitySplat)
+    {
+        render::destroyDensitySplat(*scenePipelines.densitySplat);
     }
+    render::destroyGpuProfiler(scenePipelines.gpuProfiler);
+    render::destroyProjectionUniform(scenePipelines.projection);
+    destroyFrameSemaphores(frameSemaphores, vulkanDevice->logicalDevice);
+    render::destroyUploadRing(uploadRing);
+    render::destroyTransferService(transferService);
+    vkDestroyPipelineCache(vulkanDevice->logicalDevice, pipelineCache, nullptr);
+    render::destroyDeviceMemoryAllocator(memoryAllocator);
 
     ImGui_ImplVulkanH_DestroyWindow(vulkanInstance.instance, vulkanDevice->logicalDevice, &vulkanInstance.ImGuiWindow, NULL);
     vkDestroyDescriptorPool(vulkanDevice->logicalDevice, vulkanInstance.descriptorPool, NULL);
@@ -0,0 +1,218 @@
+// Monte Carlo epidemic ensembles over an (alpha, beta) grid without a window,
+// alpha being the transmission and beta the recovery parameter, e.g.
+//   ./Epidemic_Ensemble --family ba --nodes 100000 --alpha 0.01:0.1:10 --beta 0.1,0.2 --realizations 1000 --output sweep.csv
+// Grid values are a comma separated list or start:stop:count. Every grid point
+// runs --realizations independent outbreaks on all OpenMP threads and writes
+// mean and quantiles of the infected and recovered counts per sample, of the
+// peak, the attack size and the extinction sample, as CSV or binary (see
+// simulation::writeEnsembleBinary). Results repeat for the same --seed on any
+// thread count.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <igraph/igraph.h>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include <NetworkViewport/Graph/Graph_Generation.hpp>
+#include <NetworkViewport/Simulation/Ensemble.hpp>
+
+struct EnsembleOptions
+{
+    // Edge list file, a generated graph if empty
+    std::string graphFile;
+    graph::generate::GraphFamily family = graph::generate::GRAPH_FAMILY_ERDOS_RENYI;
+    size_t nodes = 100000;
+    double degree = 8.;
+    unsigned long graphSeed = 42;
+    simulation::EnsembleParams params;
+    bool binary = false;
+    std::string output = "epidemic_ensemble.csv";
+};
+
+void printUsage(const char *executable)
+{
+    printf("Usage: %s [--graph FILE | --family er|ba|ws|lattice --nodes N --degree D] [--graph-seed S]\n"
+           "          [--model sir|sis] [--engine stepped|events] [--alpha LIST] [--beta LIST] [--infected N] [--seed S]\n"
+           "          [--realizations N] [--samples N] [--interval T] [--quantiles LIST] [--bins N] [--threads N]\n"
+           "          [--format csv|binary] [--output FILE]\n"
+           "LIST is v1,v2,... or start:stop:count\n",
+           executable);
+}
+
+std::vector<std::string> splitList(const std::string &list, char separator)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, separator))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+template <typename T>
+bool parseValues(const std::string &list, std::vector<T> &values)
+{
+    values.clear();
+    std::vector<std::string> range = splitList(list, ':');
+    if (range.size() == 3)
+    {
+        double start = std::atof(range[0].c_str());
+        double stop = std::atof(range[1].c_str());
+        int count = std::atoi(range[2].c_str());
+        for (int i = 0; i < count; i++)
+            values.push_back(static_cast<T>(count > 1 ? start + (stop - start) * i / (count - 1) : start));
+    }
+    else
+    {
+        for (const std::string &value : splitList(list, ','))
+            values.push_back(static_cast<T>(std::atof(value.c_str())));
+    }
+    return !values.empty();
+}
+
+bool parseOptions(int argc, char **argv, EnsembleOptions &options)
+{
+    simulation::EnsembleParams &params = options.params;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--graph" && hasValue)
+            options.graphFile = argv[++i];
+        else if (arg == "--family" && hasValue)
+        {
+            if (!graph::generate::parse_family(argv[++i], options.family))
+                return false;
+        }
+        else if (arg == "--nodes" && hasValue)
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--degree" && hasValue)
+            options.degree = std::atof(argv[++i]);
+        else if (arg == "--graph-seed" && hasValue)
+            options.graphSeed = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--model" && hasValue)
+        {
+            std::string model = argv[++i];
+            if (model == "sir")
+                params.epidemic.model = simulation::EPIDEMIC_MODEL_SIR;
+            else if (model == "sis")
+                params.epidemic.model = simulation::EPIDEMIC_MODEL_SIS;
+            else
+                return false;
+        }
+        else if (arg == "--engine" && hasValue)
+        {
+            std::string engine = argv[++i];
+            if (engine == "stepped")
+                params.engine = simulation::ENSEMBLE_ENGINE_STEPPED;
+            else if (engine == "events")
+                params.engine = simulation::ENSEMBLE_ENGINE_EVENTS;
+            else
+                return false;
+        }
+        else if (arg == "--alpha" && hasValue)
+        {
+            if (!parseValues(argv[++i], params.alphas))
+                return false;
+        }
+        else if (arg == "--beta" && hasValue)
+        {
+            if (!parseValues(argv[++i], params.betas))
+                return false;
+        }
+        else if (arg == "--infected" && hasValue)
+            params.epidemic.initialInfected = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--seed" && hasValue)
+            params.epidemic.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--realizations" && hasValue)
+            params.realizations = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--samples" && hasValue)
+            params.samples = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--interval" && hasValue)
+            params.sampleInterval = std::max(1e-6, std::atof(argv[++i]));
+        else if (arg == "--quantiles" && hasValue)
+        {
+            if (!parseValues(argv[++i], params.quantiles))
+                return false;
+        }
+        else if (arg == "--bins" && hasValue)
+            params.quantileBins = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--threads" && hasValue)
+            params.threads = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+        else if (arg == "--format" && hasValue)
+        {
+            std::string format = argv[++i];
+            if (format != "csv" && format != "binary")
+                return false;
+            options.binary = format == "binary";
+        }
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+
+bool loadGraph(const EnsembleOptions &options, igraph_t &graph)
+{
+    if (options.graphFile.empty())
+    {
+        graph::generate::generate(&graph, options.family, options.nodes, options.degree);
+        return true;
+    }
+    FILE *file = fopen(options.graphFile.c_str(), "r");
+    if (!file)
+    {
+        return false;
+    }
+    igraph_error_t result = igraph_read_graph_edgelist(&graph, file, 0, IGRAPH_UNDIRECTED);
+    fclose(file);
+    return result == IGRAPH_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    EnsembleOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    igraph_rng_seed(igraph_rng_default(), options.graphSeed);
+    igraph_t graph;
+    if (!loadGraph(options, graph))
+    {
+        printf("Could not read %s\n", options.graphFile.c_str());
+        return 1;
+    }
+    graph::CSRGraph csr = graph::build_csr(graph);
+    igraph_destroy(&graph);
+    const simulation::EnsembleParams &params = options.params;
+    printf("Graph: %llu nodes, %llu arcs\n", static_cast<unsigned long long>(csr.N_nodes), static_cast<unsigned long long>(graph::arc_count(csr)));
+    printf("Grid: %zu x %zu points, %u realizations each, %u samples every %g %s\n", params.alphas.size(), params.betas.size(),
+           params.realizations, params.samples, params.sampleInterval, params.engine == simulation::ENSEMBLE_ENGINE_EVENTS ? "time units" : "steps");
+
+    simulation::EnsembleResult result = simulation::runEnsemble(csr, params);
+    double runs = static_cast<double>(result.points.size()) * params.realizations;
+    printf("%.0f realizations in %.3f s (%.3f ms each)\n", runs, result.seconds, runs > 0. ? 1000. * result.seconds / runs : 0.);
+    for (const simulation::EnsemblePoint &point : result.points)
+    {
+        printf("alpha %.4f beta %.4f: mean peak %.1f, mean attack size %.1f\n", point.alpha, point.beta, point.peakInfected.mean, point.attackSize.mean);
+    }
+
+    bool written = options.binary ? simulation::writeEnsembleBinary(result, options.output) : simulation::writeEnsembleCsv(result, options.output);
+    if (!written)
+    {
+        printf("Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    printf("Summaries written to %s\n", options.output.c_str());
+    return 0;
+}
@@ -0,0 +1,336 @@
+#define KTX_OPENGL_ES3 1
+
+// Runs the compute shader epidemic without a window and writes the state
+// counts of every step as CSV. Works on a CPU implementation such as lavapipe, e.g.
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./Gpu_Epidemic --family ba --nodes 100000 --verify
+// Every step is checked for a constant population and, for SIR, monotone
+// susceptible and recovered counts. --verify also reads the state buffer back
+// once at the end and compares it against the reduced counts, --compare-cpu
+// runs the CPU engine with the same parameters for reference. The exit code
+// is nonzero when a check fails.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Routines/VulkanSetup.hpp>
+#include <VulkanTools/Structures/VulkanInstance.hpp>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include <NetworkViewport/Graph/Graph_Generation.hpp>
+#include <NetworkViewport/Render/Memory_Allocator.hpp>
+#include <NetworkViewport/Render/Transfer_Service.hpp>
+#include <NetworkViewport/Render/Pipeline_Cache.hpp>
+#include <NetworkViewport/Render/Gpu_Epidemic.hpp>
+#include <NetworkViewport/Simulation/Epidemic.hpp>
+
+#ifdef WIN32
+const std::string assetPath = "C:\\Users\\jonas\\Documents\\NetworkViewport\\data\\";
+#else
+const std::string assetPath = "/home/deb/Documents/NetworkViewport/data/";
+#endif
+const std::string computeShadersPath = NV_COMPUTE_SHADER_DIR;
+const std::string pipelineCachePath = assetPath + "pipeline_cache.bin";
+
+struct GpuEpidemicOptions
+{
+    // Edge list file, a generated graph if empty
+    std::string graphFile;
+    graph::generate::GraphFamily family = graph::generate::GRAPH_FAMILY_ERDOS_RENYI;
+    size_t nodes = 100000;
+    double degree = 8.;
+    unsigned long graphSeed = 42;
+    simulation::EpidemicParams params;
+    // Upper bound, SIR runs end earlier once no node is infected
+    uint32_t steps = 1000;
+    // Steps recorded per submission
+    uint32_t batch = 64;
+    bool verify = false;
+    bool compareCpu = false;
+    bool validation = false;
+    std::string output = "gpu_epidemic.csv";
+};
+
+void printUsage(const char *executable)
+{
+    printf("Usage: %s [--graph FILE | --family er|ba|ws|lattice --nodes N --degree D] [--graph-seed S]\n"
+           "          [--model sir|sis] [--beta B] [--gamma G] [--infected N] [--seed S] [--steps N] [--batch N]\n"
+           "          [--verify] [--compare-cpu] [--validation] [--output FILE]\n",
+           executable);
+}
+
+bool parseOptions(int argc, char **argv, GpuEpidemicOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--graph" && hasValue)
+            options.graphFile = argv[++i];
+        else if (arg == "--family" && hasValue)
+        {
+            if (!graph::generate::parse_family(argv[++i], options.family))
+                return false;
+        }
+        else if (arg == "--nodes" && hasValue)
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--degree" && hasValue)
+            options.degree = std::atof(argv[++i]);
+        else if (arg == "--graph-seed" && hasValue)
+            options.graphSeed = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--model" && hasValue)
+        {
+            std::string model = argv[++i];
+            if (model == "sir")
+                options.params.model = simulation::EPIDEMIC_MODEL_SIR;
+            else if (model == "sis")
+                options.params.model = simulation::EPIDEMIC_MODEL_SIS;
+            else
+                return false;
+        }
+        else if (arg == "--beta" && hasValue)
+            options.params.beta = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--gamma" && hasValue)
+            options.params.gamma = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--infected" && hasValue)
+            options.params.initialInfected = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--seed" && hasValue)
+            options.params.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--steps" && hasValue)
+            options.steps = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--batch" && hasValue)
+            options.batch = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--verify")
+            options.verify = true;
+        else if (arg == "--compare-cpu")
+            options.compareCpu = true;
+        else if (arg == "--validation")
+            options.validation = true;
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+
+bool loadGraph(const GpuEpidemicOptions &options, igraph_t &graph)
+{
+    if (options.graphFile.empty())
+    {
+        graph::generate::generate(&graph, options.family, options.nodes, options.degree);
+        return true;
+    }
+    FILE *file = fopen(options.graphFile.c_str(), "r");
+    if (!file)
+    {
+        return false;
+    }
+    igraph_error_t result = igraph_read_graph_edgelist(&graph, file, 0, IGRAPH_UNDIRECTED);
+    fclose(file);
+    return result == IGRAPH_SUCCESS;
+}
+
+// Population and, for SIR, monotonicity of the counts from one step to the next
+bool checkStep(const uint64_t *previous, const uint64_t *counts, uint64_t N_nodes, simulation::EpidemicModel model)
+{
+    uint64_t total = 0;
+    for (uint32_t nodeState = 0; nodeState < simulation::NODE_STATE_COUNT; nodeState++)
+    {
+        total += counts[nodeState];
+    }
+    if (total != N_nodes)
+    {
+        return false;
+    }
+    if (model == simulation::EPIDEMIC_MODEL_SIR)
+    {
+        return counts[simulation::NODE_STATE_SUSCEPTIBLE] <= previous[simulation::NODE_STATE_SUSCEPTIBLE] &&
+               counts[simulation::NODE_STATE_RECOVERED] >= previous[simulation::NODE_STATE_RECOVERED];
+    }
+    return counts[simulation::NODE_STATE_RECOVERED] == 0;
+}
+
+// Copy the state buffer to the host and histogram it, only done for verification
+bool readStateCounts(render::GpuEpidemic &epidemic, VulkanDevice *vulkanDevice, VkQueue queue, uint64_t *counts)
+{
+    render::AllocatedBuffer readback;
+    VK_CHECK_RESULT(render::createBuffer(*epidemic.allocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                         epidemic.stateBuffer.size, readback));
+    VkCommandBuffer commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    VkBufferCopy copyRegion = {0, 0, epidemic.stateBuffer.size};
+    vkCmdCopyBuffer(commandBuffer, epidemic.stateBuffer.buffer, readback.buffer, 1, &copyRegion);
+    VkBufferMemoryBarrier barrier = initializers::bufferMemoryBarrier();
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = readback.buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    vulkanDevice->flushCommandBuffer(commandBuffer, queue, true);
+
+    bool valid = true;
+    std::fill(counts, counts + simulation::NODE_STATE_COUNT, 0);
+    // Packed four to a word, lowest byte first, which is the byte order of the little-endian hosts this runs on
+    const uint8_t *states = static_cast<const uint8_t *>(readback.mapped);
+    for (uint32_t node = 0; node < epidemic.nodeCount; node++)
+    {
+        if (states[node] >= simulation::NODE_STATE_COUNT)
+        {
+            valid = false;
+            continue;
+        }
+        counts[states[node]]++;
+    }
+    render::destroyBuffer(*epidemic.allocator, readback);
+    return valid;
+}
+
+int main(int argc, char **argv)
+{
+    GpuEpidemicOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    igraph_rng_seed(igraph_rng_default(), options.graphSeed);
+    igraph_t graph;
+    if (!loadGraph(options, graph))
+    {
+        printf("Could not read %s\n", options.graphFile.c_str());
+        return 1;
+    }
+    graph::CSRGraph csr = graph::build_csr(graph);
+    igraph_destroy(&graph);
+    uint64_t N_nodes = csr.N_nodes;
+    printf("Graph: %llu nodes, %llu arcs\n", static_cast<unsigned long long>(N_nodes), static_cast<unsigned long long>(graph::arc_count(csr)));
+
+    /* Vulkan without surface or swapchain */
+
+    VulkanInstance vulkanInstance;
+    createVulkanInstance(options.validation, "Network Viewport GPU Epidemic", vulkanInstance.instance, vulkanInstance.supportedInstanceExtensions, vulkanInstance.enabledInstanceExtensions, VK_API_VERSION_1_0);
+    setupVulkanPhysicalDevice(vulkanInstance, options.validation);
+    VulkanDevice *vulkanDevice = vulkanInstance.vulkanDevice;
+    printf("Device: %s\n", vulkanDevice->properties.deviceName);
+
+    VkQueue queue;
+    vkGetDeviceQueue(vulkanDevice->logicalDevice, vulkanDevice->queueFamilyIndices.graphics, 0, &queue);
+
+    render::DeviceMemoryAllocator memoryAllocator;
+    render::createDeviceMemoryAllocator(memoryAllocator, vulkanDevice);
+    render::TransferService transferService;
+    render::createTransferService(transferService, &memoryAllocator, queue);
+    VkPipelineCache pipelineCache = render::loadPipelineCache(vulkanDevice, pipelineCachePath);
+
+    render::GpuEpidemicParams epidemicParams;
+    epidemicParams.computeShadersPath = computeShadersPath;
+    epidemicParams.vulkanDevice = vulkanDevice;
+    epidemicParams.allocator = &memoryAllocator;
+    epidemicParams.transferService = &transferService;
+    epidemicParams.pipelineCache = pipelineCache;
+    epidemicParams.countSlots = options.batch;
+    auto epidemic = render::prepareGpuEpidemic(epidemicParams, csr, options.params);
+    render::savePipelineCache(vulkanDevice, pipelineCache, pipelineCachePath);
+
+    render::waitTransfer(transferService, render::submitTransfers(transferService));
+    render::TransferAcquireBatch transferAcquires = render::takeTransferAcquires(transferService);
+
+    /* Batches of steps, one submission each */
+
+    std::ofstream csv(options.output, std::ios::trunc);
+    if (!csv)
+    {
+        printf("Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    csv << "step,susceptible,infected,recovered\n";
+    csv << 0 << ',' << epidemic->counts[0] << ',' << epidemic->counts[1] << ',' << epidemic->counts[2] << '\n';
+
+    bool valid = true;
+    uint64_t previous[simulation::NODE_STATE_COUNT];
+    std::copy(epidemic->counts, epidemic->counts + simulation::NODE_STATE_COUNT, previous);
+    uint64_t peakInfected = previous[simulation::NODE_STATE_INFECTED];
+    auto tStart = std::chrono::steady_clock::now();
+    while (true)
+    {
+        uint32_t remaining = static_cast<uint32_t>(std::min<uint64_t>(options.steps - epidemic->step, options.batch));
+        bool reset = epidemic->frame.reset;
+        if (render::scheduleGpuEpidemicSteps(*epidemic, remaining) == 0 && !reset)
+        {
+            break;
+        }
+        VkCommandBuffer commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+        render::recordTransferAcquires(transferAcquires, commandBuffer);
+        transferAcquires = {};
+        render::recordGpuEpidemic(*epidemic, commandBuffer);
+        vulkanDevice->flushCommandBuffer(commandBuffer, queue, true);
+        // One submission at a time, it has completed once flushed
+        render::submitGpuEpidemicFrame(*epidemic, 0);
+        render::completeGpuEpidemicFrame(*epidemic, 0);
+
+        for (const render::GpuEpidemicStepCounts &step : epidemic->completedSteps)
+        {
+            if (!checkStep(previous, step.counts, N_nodes, options.params.model))
+            {
+                printf("Step %llu: inconsistent counts %llu/%llu/%llu\n", static_cast<unsigned long long>(step.step),
+                       static_cast<unsigned long long>(step.counts[0]), static_cast<unsigned long long>(step.counts[1]), static_cast<unsigned long long>(step.counts[2]));
+                valid = false;
+            }
+            csv << step.step << ',' << step.counts[0] << ',' << step.counts[1] << ',' << step.counts[2] << '\n';
+            std::copy(step.counts, step.counts + simulation::NODE_STATE_COUNT, previous);
+            peakInfected = std::max(peakInfected, step.counts[simulation::NODE_STATE_INFECTED]);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+    printf("GPU: %llu steps in %.3f s (%.3f ms/step), peak infected %llu, final %llu/%llu/%llu\n",
+           static_cast<unsigned long long>(epidemic->step), seconds, epidemic->step > 0 ? 1000. * seconds / epidemic->step : 0.,
+           static_cast<unsigned long long>(peakInfected), static_cast<unsigned long long>(epidemic->counts[0]),
+           static_cast<unsigned long long>(epidemic->counts[1]), static_cast<unsigned long long>(epidemic->counts[2]));
+
+    if (options.verify)
+    {
+        uint64_t stateCounts[simulation::NODE_STATE_COUNT];
+        bool statesValid = readStateCounts(*epidemic, vulkanDevice, queue, stateCounts);
+        bool countsMatch = std::equal(stateCounts, stateCounts + simulation::NODE_STATE_COUNT, epidemic->counts);
+        printf("State buffer: %llu/%llu/%llu, %s\n", static_cast<unsigned long long>(stateCounts[0]),
+               static_cast<unsigned long long>(stateCounts[1]), static_cast<unsigned long long>(stateCounts[2]),
+               !statesValid ? "invalid states" : (countsMatch ? "matches the step counts" : "differs from the step counts"));
+        valid &= statesValid && countsMatch;
+    }
+
+    if (options.compareCpu)
+    {
+        // Different random streams, the outbreaks agree in distribution only
+        simulation::EpidemicEngine engine;
+        simulation::createEpidemicEngine(engine, csr, options.params);
+        uint64_t cpuPeakInfected = engine.counts[simulation::NODE_STATE_INFECTED];
+        auto tCpuStart = std::chrono::steady_clock::now();
+        while (engine.step < epidemic->step && simulation::epidemicActive(engine))
+        {
+            simulation::stepEpidemic(engine);
+            cpuPeakInfected = std::max(cpuPeakInfected, engine.counts[simulation::NODE_STATE_INFECTED]);
+        }
+        double cpuSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tCpuStart).count();
+        printf("CPU: %llu steps in %.3f s (%.3f ms/step), peak infected %llu, final %llu/%llu/%llu\n",
+               static_cast<unsigned long long>(engine.step), cpuSeconds, engine.step > 0 ? 1000. * cpuSeconds / engine.step : 0.,
+               static_cast<unsigned long long>(cpuPeakInfected), static_cast<unsigned long long>(engine.counts[0]),
+               static_cast<unsigned long long>(engine.counts[1]), static_cast<unsigned long long>(engine.counts[2]));
+    }
+
+    render::destroyGpuEpidemic(*epidemic);
+    render::destroyTransferService(transferService);
+    vkDestroyPipelineCache(vulkanDevice->logicalDevice, pipelineCache, nullptr);
+    render::destroyDeviceMemoryAllocator(memoryAllocator);
+
+    printf("%s, counts written to %s\n", valid ? "All checks passed" : "Checks failed", options.output.c_str());
+    return valid ? 0 : 1;
+}
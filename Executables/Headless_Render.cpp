@@ -0,0 +1,254 @@
+#define KTX_OPENGL_ES3 1
+
+// Renders graph snapshots without a window or swapchain. Frames are drawn into an
+// offscreen target, read back through a ring of host-visible buffers and written
+// by a worker thread. Runs on a CPU implementation such as lavapipe, e.g.
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./Headless_Render --frames 120
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Routines/VulkanSetup.hpp>
+#include <VulkanTools/Structures/VulkanInstance.hpp>
+#include <VulkanTools/Interactive/VulkanCamera.hpp>
+#include <VulkanTools/Interactive/VulkanProjectionBuffer.hpp>
+#include <NetworkViewport/Graph/Graph_Layout.hpp>
+#include <NetworkViewport/Render/Memory_Allocator.hpp>
+#include <NetworkViewport/Render/Transfer_Service.hpp>
+#include <NetworkViewport/Render/Pipeline_Cache.hpp>
+#include <NetworkViewport/Render/Instance_Pipeline.hpp>
+#include <NetworkViewport/Render/Line_Edges.hpp>
+#include <NetworkViewport/Render/Offscreen_Target.hpp>
+#include <NetworkViewport/Render/Frame_Readback.hpp>
+#include <NetworkViewport/Render/Projection_Uniform.hpp>
+#include <NetworkViewport/Utils/Frame_Stats.hpp>
+
+#ifdef WIN32
+const std::string assetPath = "C:\\Users\\jonas\\Documents\\NetworkViewport\\data\\";
+#else
+const std::string assetPath = "/home/deb/Documents/NetworkViewport/data/";
+#endif
+const std::string shadersPath = NV_SHADER_DIR;
+const std::string pipelineCachePath = assetPath + "pipeline_cache.bin";
+
+struct HeadlessOptions
+{
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t frames = 120;
+    // Readback buffers in the ring
+    uint32_t slots = 3;
+    size_t nodes = 100;
+    double edgeProbability = .05;
+    render::FrameOutputFormat format = render::FRAME_OUTPUT_FORMAT_PNG;
+    std::string outputDirectory = ".";
+    bool lineEdges = false;
+    bool validation = false;
+};
+
+void printUsage(const char *executable)
+{
+    printf("Usage: %s [--width W] [--height H] [--frames N] [--slots N] [--nodes N] [--p P]\n"
+           "          [--format png|raw|none] [--output DIR] [--lines] [--validation]\n",
+           executable);
+}
+
+bool parseOptions(int argc, char **argv, HeadlessOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue)
+            options.width = std::atoi(argv[++i]);
+        else if (arg == "--height" && hasValue)
+            options.height = std::atoi(argv[++i]);
+        else if (arg == "--frames" && hasValue)
+            options.frames = std::atoi(argv[++i]);
+        else if (arg == "--slots" && hasValue)
+            options.slots = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--nodes" && hasValue)
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--p" && hasValue)
+            options.edgeProbability = std::atof(argv[++i]);
+        else if (arg == "--output" && hasValue)
+            options.outputDirectory = argv[++i];
+        else if (arg == "--format" && hasValue)
+        {
+            std::string format = argv[++i];
+            if (format == "png")
+                options.format = render::FRAME_OUTPUT_FORMAT_PNG;
+            else if (format == "raw")
+                options.format = render::FRAME_OUTPUT_FORMAT_RAW;
+            else if (format == "none")
+                options.format = render::FRAME_OUTPUT_FORMAT_NONE;
+            else
+                return false;
+        }
+        else if (arg == "--lines")
+            options.lineEdges = true;
+        else if (arg == "--validation")
+            options.validation = true;
+        else
+            return false;
+    }
+    return options.width > 0 && options.height > 0;
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* Vulkan without surface or swapchain */
+
+    VulkanInstance vulkanInstance;
+    createVulkanInstance(options.validation, "Network Viewport Headless", vulkanInstance.instance, vulkanInstance.supportedInstanceExtensions, vulkanInstance.enabledInstanceExtensions, VK_API_VERSION_1_0);
+    setupVulkanPhysicalDevice(vulkanInstance, options.validation);
+    VulkanDevice *vulkanDevice = vulkanInstance.vulkanDevice;
+    printf("Device: %s\n", vulkanDevice->properties.deviceName);
+
+    VkQueue queue;
+    vkGetDeviceQueue(vulkanDevice->logicalDevice, vulkanDevice->queueFamilyIndices.graphics, 0, &queue);
+
+    Camera camera;
+    camera.type = camera.firstperson;
+    camera.setPosition(glm::vec3(0.0f, 0.0f, -10.0f));
+    camera.setRotation(glm::vec3(-45.0f, 0.0f, 0.0f));
+    camera.setPerspective(60.0f, (float)options.width / (float)options.height, 0.1f, 1000.0f);
+
+    igraph_t graph;
+    igraph_erdos_renyi_game(&graph, IGRAPH_ERDOS_RENYI_GNP, options.nodes, options.edgeProbability, 0, 0);
+    auto nodeInstanceData = graph::layout::kamada_kawai_2D(graph, 500, 0);
+    auto edgeInstanceData = graph::layout::get_edge_positions(nodeInstanceData, graph);
+
+    prepareProjectionBuffer(vulkanDevice, vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera);
+
+    render::DeviceMemoryAllocator memoryAllocator;
+    render::createDeviceMemoryAllocator(memoryAllocator, vulkanDevice);
+    render::TransferService transferService;
+    render::createTransferService(transferService, &memoryAllocator, queue);
+    VkPipelineCache pipelineCache = render::loadPipelineCache(vulkanDevice, pipelineCachePath);
+
+    render::OffscreenTarget target;
+    render::createOffscreenTarget(target, &memoryAllocator, options.width, options.height);
+    // Frames in flight each update the camera block in their own command buffer
+    render::ProjectionUniform projection;
+    render::createProjectionUniform(projection, &memoryAllocator, sizeof(vulkanInstance.projection.data));
+
+    render::InstancePipelineParams nodeParams;
+    nodeParams.vertexShaderPath = shadersPath + "node" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+    nodeParams.fragmentShaderPath = shadersPath + "node.frag.spv";
+    nodeParams.vulkanDevice = vulkanDevice;
+    nodeParams.allocator = &memoryAllocator;
+    nodeParams.uniformProjectionBuffer = projection.buffer.descriptor;
+    nodeParams.transferService = &transferService;
+    nodeParams.renderPass = target.renderPass;
+    nodeParams.pipelineCache = pipelineCache;
+
+    render::InstancePipelineParams edgeParams = nodeParams;
+    edgeParams.vertexShaderPath = shadersPath + "edge" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+    edgeParams.fragmentShaderPath = shadersPath + "edge.frag.spv";
+
+    auto nodePipeline = render::prepareNodeInstancePipeline(nodeParams, nodeInstanceData);
+    auto edgePipeline = render::prepareEdgeInstancePipeline(edgeParams, edgeInstanceData);
+    // Lines draw from the edge pipeline's instance buffer
+    std::unique_ptr<render::LineEdgePipeline> lineEdges;
+    if (options.lineEdges)
+    {
+        render::LineEdgeParams lineParams;
+        lineParams.vertexShaderPath = shadersPath + "line" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+        lineParams.fragmentShaderPath = shadersPath + "line.frag.spv";
+        lineParams.vulkanDevice = vulkanDevice;
+        lineParams.uniformProjectionBuffer = projection.buffer.descriptor;
+        lineParams.renderPass = target.renderPass;
+        lineParams.pipelineCache = pipelineCache;
+        lineEdges = render::prepareLineEdgeRendering(lineParams, render::instanceBufferView(*edgePipeline));
+    }
+    render::savePipelineCache(vulkanDevice, pipelineCache, pipelineCachePath);
+
+    render::waitTransfer(transferService, render::submitTransfers(transferService));
+    render::TransferAcquireBatch transferAcquires = render::takeTransferAcquires(transferService);
+
+    render::FrameReadback readback;
+    render::createFrameReadback(readback, &memoryAllocator, vulkanDevice->queueFamilyIndices.graphics, options.width, options.height,
+                                options.slots, options.format, options.outputDirectory);
+
+    /* Render loop */
+
+    utils::FrameStats frameStats;
+    auto tStart = std::chrono::high_resolution_clock::now();
+    auto tFrame = tStart;
+    for (uint32_t frame = 0; frame < options.frames; frame++)
+    {
+        // Waits only if the slot's previous frame is still on the GPU or being written
+        VkCommandBuffer commandBuffer = render::beginReadbackFrame(readback);
+
+        // One orbit over the whole sequence
+        camera.setRotation(glm::vec3(-45.0f, 360.0f * frame / std::max(options.frames, 1u), 0.0f));
+        updateProjectionBuffer(vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera, true);
+
+        render::recordTransferAcquires(transferAcquires, commandBuffer);
+        transferAcquires = {};
+        render::recordProjectionUpdate(projection, commandBuffer, &vulkanInstance.projection.data);
+
+        render::beginOffscreenRenderPass(target, commandBuffer);
+        render::buildInstanceCommandBuffer(*nodePipeline, commandBuffer);
+        if (lineEdges)
+        {
+            render::buildLineEdgeCommandBuffer(*lineEdges, commandBuffer, options.width, options.height, 1.f, 1.f);
+        }
+        else
+        {
+            render::buildInstanceCommandBuffer(*edgePipeline, commandBuffer);
+        }
+        vkCmdEndRenderPass(commandBuffer);
+
+        render::submitReadbackFrame(readback, queue, target.colorImage);
+
+        auto tNow = std::chrono::high_resolution_clock::now();
+        utils::recordFrameTime(frameStats, std::chrono::duration<float, std::milli>(tNow - tFrame).count());
+        tFrame = tNow;
+    }
+    render::flushFrameReadback(readback);
+    auto tEnd = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration<double>(tEnd - tStart).count();
+    printf("Rendered %u frames at %ux%u in %.2f s: %.1f FPS, %llu written",
+           options.frames, options.width, options.height, seconds, seconds > 0 ? options.frames / seconds : 0.0,
+           static_cast<unsigned long long>(readback.framesWritten.load()));
+    if (readback.writeFailures > 0)
+    {
+        printf(", %llu failed", static_cast<unsigned long long>(readback.writeFailures.load()));
+    }
+    printf("\n");
+    utils::FrameTimePercentiles percentiles = utils::allTimePercentiles(frameStats);
+    printf("Frame times: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms, %llu hitches\n",
+           percentiles.p50, percentiles.p95, percentiles.p99, percentiles.p999, percentiles.max,
+           static_cast<unsigned long long>(frameStats.hitchCount));
+
+    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+    render::destroyFrameReadback(readback);
+    render::destroyInstancePipeline(*nodePipeline);
+    if (lineEdges)
+    {
+        render::destroyLineEdgePipeline(*lineEdges);
+    }
+    render::destroyInstancePipeline(*edgePipeline);
+    render::destroyProjectionUniform(projection);
+    render::destroyOffscreenTarget(target);
+    render::destroyTransferService(transferService);
+    vkDestroyPipelineCache(vulkanDevice->logicalDevice, pipelineCache, nullptr);
+    render::destroyDeviceMemoryAllocator(memoryAllocator);
+    igraph_destroy(&graph);
+
+    return readback.writeFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,495 @@
+#define KTX_OPENGL_ES3 1
+
+// Reproducible render benchmark. A graph generated from a fixed seed or read
+// from an edge list is laid out, then a scripted camera path is replayed over a
+// fixed number of offscreen frames. CPU frame and recording times and GPU pass
+// times are summarized as JSON, e.g. on lavapipe:
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./Render_Bench --family ba --nodes 100000 --output render.json
+// The camera advances by frame index instead of wall time, so every run
+// renders the same sequence of views.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Routines/VulkanSetup.hpp>
+#include <VulkanTools/Structures/VulkanInstance.hpp>
+#include <VulkanTools/Interactive/VulkanCamera.hpp>
+#include <VulkanTools/Interactive/VulkanProjectionBuffer.hpp>
+#include <NetworkViewport/Graph/Graph_Generation.hpp>
+#include <NetworkViewport/Graph/Graph_Layout.hpp>
+#include <NetworkViewport/Render/Memory_Allocator.hpp>
+#include <NetworkViewport/Render/Transfer_Service.hpp>
+#include <NetworkViewport/Render/Pipeline_Cache.hpp>
+#include <NetworkViewport/Render/Instance_Pipeline.hpp>
+#include <NetworkViewport/Render/Line_Edges.hpp>
+#include <NetworkViewport/Render/Offscreen_Target.hpp>
+#include <NetworkViewport/Render/Frame_Readback.hpp>
+#include <NetworkViewport/Render/Projection_Uniform.hpp>
+#include <NetworkViewport/Render/Gpu_Profiler.hpp>
+#include <NetworkViewport/Render/Packed_Instances.hpp>
+#include <NetworkViewport/Utils/Camera_Path.hpp>
+#include <NetworkViewport/Utils/Frame_Stats.hpp>
+#include <NetworkViewport/Utils/Memory_Usage.hpp>
+
+#ifdef WIN32
+const std::string assetPath = "C:\\Users\\jonas\\Documents\\NetworkViewport\\data\\";
+#else
+const std::string assetPath = "/home/deb/Documents/NetworkViewport/data/";
+#endif
+const std::string shadersPath = NV_SHADER_DIR;
+const std::string pipelineCachePath = assetPath + "pipeline_cache.bin";
+
+struct RenderBenchOptions
+{
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t frames = 600;
+    // Rendered at the start of the path and not measured
+    uint32_t warmup = 30;
+    uint32_t slots = 3;
+    // Edge list file, a generated graph if empty
+    std::string graphFile;
+    graph::generate::GraphFamily family = graph::generate::GRAPH_FAMILY_ERDOS_RENYI;
+    size_t nodes = 10000;
+    double degree = 8.;
+    unsigned long seed = 42;
+    // Kamada-Kawai 3D up to this node count, a seeded random layout above
+    size_t kkMaxNodes = 2000;
+    float extent = 100.f;
+    // Camera path file, an orbit around the graph if empty
+    std::string cameraPathFile;
+    bool lineEdges = false;
+    bool validation = false;
+    std::string output = "render_bench.json";
+};
+
+void printUsage(const char *executable)
+{
+    printf("Usage: %s [--graph FILE | --family er|ba|ws|lattice --nodes N --degree D] [--seed S]\n"
+           "          [--kk-max-nodes N] [--extent E] [--path FILE] [--frames N] [--warmup N]\n"
+           "          [--width W] [--height H] [--slots N] [--lines] [--validation] [--output FILE]\n",
+           executable);
+}
+
+bool parseOptions(int argc, char **argv, RenderBenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--graph" && hasValue)
+            options.graphFile = argv[++i];
+        else if (arg == "--family" && hasValue)
+        {
+            if (!graph::generate::parse_family(argv[++i], options.family))
+                return false;
+        }
+        else if (arg == "--nodes" && hasValue)
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--degree" && hasValue)
+            options.degree = std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue)
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--kk-max-nodes" && hasValue)
+            options.kkMaxNodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--extent" && hasValue)
+            options.extent = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--path" && hasValue)
+            options.cameraPathFile = argv[++i];
+        else if (arg == "--frames" && hasValue)
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--width" && hasValue)
+            options.width = std::atoi(argv[++i]);
+        else if (arg == "--height" && hasValue)
+            options.height = std::atoi(argv[++i]);
+        else if (arg == "--slots" && hasValue)
+            options.slots = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--lines")
+            options.lineEdges = true;
+        else if (arg == "--validation")
+            options.validation = true;
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else
+            return false;
+    }
+    return options.width > 0 && options.height > 0;
+}
+
+bool loadGraph(const RenderBenchOptions &options, igraph_t &graph)
+{
+    if (options.graphFile.empty())
+    {
+        graph::generate::generate(&graph, options.family, options.nodes, options.degree);
+        return true;
+    }
+    FILE *file = fopen(options.graphFile.c_str(), "r");
+    if (!file)
+    {
+        return false;
+    }
+    igraph_error_t result = igraph_read_graph_edgelist(&graph, file, 0, IGRAPH_UNDIRECTED);
+    fclose(file);
+    return result == IGRAPH_SUCCESS;
+}
+
+std::vector<NodeInstanceData> randomLayout3D(const igraph_t &graph, float extent)
+{
+    size_t N_nodes = igraph_vcount(&graph);
+    igraph_matrix_t pos;
+    igraph_matrix_init(&pos, N_nodes, 3);
+    igraph_layout_random_3d(&graph, &pos);
+
+    // igraph places the nodes in [-1, 1]
+    std::vector<NodeInstanceData> node_data;
+    node_data.reserve(N_nodes);
+    for (size_t i = 0; i < N_nodes; i++)
+    {
+        glm::vec3 position(MATRIX(pos, i, 0), MATRIX(pos, i, 1), MATRIX(pos, i, 2));
+        node_data.push_back({position * (.5f * extent), {1.f, 1.f, 1.f, .8f}, 1.f});
+    }
+    igraph_matrix_destroy(&pos);
+    return node_data;
+}
+
+float boundingRadius(const std::vector<NodeInstanceData> &nodeInstanceData)
+{
+    float radius = 1.f;
+    for (const NodeInstanceData &node : nodeInstanceData)
+    {
+        radius = std::max(radius, glm::length(node.pos));
+    }
+    return radius;
+}
+
+// Accumulated over the measured frames, unlike the GPU profiler history which only keeps the last few hundred
+struct GpuPassTotals
+{
+    double sum = 0.;
+    double min = 0.;
+    double max = 0.;
+    uint64_t samples = 0;
+};
+
+struct GpuBenchTotals
+{
+    utils::FrameStats frameStats;
+    std::vector<std::string> passOrder;
+    std::map<std::string, GpuPassTotals> passes;
+    // Next profiler frame to take from the history
+    uint64_t nextFrame = 0;
+};
+
+void takeGpuTimings(const render::GpuProfiler &profiler, uint64_t firstMeasuredFrame, GpuBenchTotals &totals)
+{
+    for (const render::GpuFrameTiming &timing : profiler.history)
+    {
+        if (timing.frame < totals.nextFrame)
+        {
+            continue;
+        }
+        totals.nextFrame = timing.frame + 1;
+        if (timing.frame < firstMeasuredFrame)
+        {
+            continue;
+        }
+        utils::recordFrameTime(totals.frameStats, static_cast<float>(timing.milliseconds));
+        for (const render::GpuPassTiming &pass : timing.passes)
+        {
+            if (totals.passes.find(pass.name) == totals.passes.end())
+            {
+                totals.passOrder.push_back(pass.name);
+            }
+            GpuPassTotals &passTotals = totals.passes[pass.name];
+            passTotals.min = passTotals.samples == 0 ? pass.milliseconds : std::min(passTotals.min, pass.milliseconds);
+            passTotals.max = std::max(passTotals.max, pass.milliseconds);
+            passTotals.sum += pass.milliseconds;
+            passTotals.samples++;
+        }
+    }
+}
+
+void writeJsonString(std::ofstream &file, const std::string &text)
+{
+    file << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            file << '\\';
+        file << c;
+    }
+    file << '"';
+}
+
+void writePercentiles(std::ofstream &file, const char *name, const utils::FrameTimePercentiles &percentiles)
+{
+    file << "  \"" << name << "\": {\"frames\": " << percentiles.frames << ", \"mean\": " << percentiles.mean << ", \"min\": " << percentiles.min
+         << ", \"p50\": " << percentiles.p50 << ", \"p95\": " << percentiles.p95 << ", \"p99\": " << percentiles.p99 << ", \"p999\": " << percentiles.p999
+         << ", \"max\": " << percentiles.max << "},\n";
+}
+
+int main(int argc, char **argv)
+{
+    RenderBenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* Workload, fixed by the seed or the input file */
+
+    igraph_rng_seed(igraph_rng_default(), options.seed);
+    igraph_t graph;
+    if (!loadGraph(options, graph))
+    {
+        printf("Could not read %s\n", options.graphFile.c_str());
+        return 1;
+    }
+    size_t N_nodes = igraph_vcount(&graph);
+    size_t N_edges = igraph_ecount(&graph);
+    bool kamadaKawai = N_nodes <= options.kkMaxNodes;
+    auto nodeInstanceData = kamadaKawai ? graph::layout::kamada_kawai_3D(graph, 500, 0) : randomLayout3D(graph, options.extent);
+    auto edgeInstanceData = graph::layout::get_edge_positions(nodeInstanceData, graph);
+    igraph_destroy(&graph);
+    float radius = boundingRadius(nodeInstanceData);
+    printf("Graph: %zu nodes, %zu edges, %s layout\n", N_nodes, N_edges, kamadaKawai ? "kamada-kawai" : "random");
+
+    utils::CameraPath cameraPath;
+    if (options.cameraPathFile.empty())
+    {
+        cameraPath = utils::orbitCameraPath(2.5f * radius, -30.f, options.frames / 60.f);
+    }
+    else if (!utils::loadCameraPath(cameraPath, options.cameraPathFile))
+    {
+        printf("Could not read camera path %s\n", options.cameraPathFile.c_str());
+        return 1;
+    }
+    float pathStart = cameraPath.keyframes.front().time;
+    float pathDuration = utils::cameraPathDuration(cameraPath);
+
+    /* Vulkan without surface or swapchain */
+
+    VulkanInstance vulkanInstance;
+    createVulkanInstance(options.validation, "Network Viewport Render Bench", vulkanInstance.instance, vulkanInstance.supportedInstanceExtensions, vulkanInstance.enabledInstanceExtensions, VK_API_VERSION_1_0);
+    setupVulkanPhysicalDevice(vulkanInstance, options.validation);
+    VulkanDevice *vulkanDevice = vulkanInstance.vulkanDevice;
+    printf("Device: %s\n", vulkanDevice->properties.deviceName);
+
+    VkQueue queue;
+    vkGetDeviceQueue(vulkanDevice->logicalDevice, vulkanDevice->queueFamilyIndices.graphics, 0, &queue);
+
+    // Path rotations turn the scene about the origin, as for the lookat camera
+    Camera camera;
+    camera.type = camera.lookat;
+    camera.setPerspective(60.0f, (float)options.width / (float)options.height, 0.1f, std::max(1000.0f, 8.f * radius));
+    glm::vec3 position;
+    glm::vec3 rotation;
+    utils::sampleCameraPath(cameraPath, pathStart, position, rotation);
+    camera.setPosition(position);
+    camera.setRotation(rotation);
+    prepareProjectionBuffer(vulkanDevice, vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera);
+
+    render::DeviceMemoryAllocator memoryAllocator;
+    render::createDeviceMemoryAllocator(memoryAllocator, vulkanDevice);
+    render::TransferService transferService;
+    render::createTransferService(transferService, &memoryAllocator, queue);
+    VkPipelineCache pipelineCache = render::loadPipelineCache(vulkanDevice, pipelineCachePath);
+
+    render::OffscreenTarget target;
+    render::createOffscreenTarget(target, &memoryAllocator, options.width, options.height);
+    // Frames in flight each update the camera block in their own command buffer
+    render::ProjectionUniform projection;
+    render::createProjectionUniform(projection, &memoryAllocator, sizeof(vulkanInstance.projection.data));
+
+    render::InstancePipelineParams nodeParams;
+    nodeParams.vertexShaderPath = shadersPath + "node" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+    nodeParams.fragmentShaderPath = shadersPath + "node.frag.spv";
+    nodeParams.vulkanDevice = vulkanDevice;
+    nodeParams.allocator = &memoryAllocator;
+    nodeParams.uniformProjectionBuffer = projection.buffer.descriptor;
+    nodeParams.transferService = &transferService;
+    nodeParams.renderPass = target.renderPass;
+    nodeParams.pipelineCache = pipelineCache;
+
+    render::InstancePipelineParams edgeParams = nodeParams;
+    edgeParams.vertexShaderPath = shadersPath + "edge" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+    edgeParams.fragmentShaderPath = shadersPath + "edge.frag.spv";
+
+    auto nodePipeline = render::prepareNodeInstancePipeline(nodeParams, nodeInstanceData);
+    auto edgePipeline = render::prepareEdgeInstancePipeline(edgeParams, edgeInstanceData);
+    // Lines draw from the edge pipeline's instance buffer
+    std::unique_ptr<render::LineEdgePipeline> lineEdges;
+    if (options.lineEdges)
+    {
+        render::LineEdgeParams lineParams;
+        lineParams.vertexShaderPath = shadersPath + "line" + render::INSTANCE_SHADER_VARIANT + ".vert.spv";
+        lineParams.fragmentShaderPath = shadersPath + "line.frag.spv";
+        lineParams.vulkanDevice = vulkanDevice;
+        lineParams.uniformProjectionBuffer = projection.buffer.descriptor;
+        lineParams.renderPass = target.renderPass;
+        lineParams.pipelineCache = pipelineCache;
+        lineEdges = render::prepareLineEdgeRendering(lineParams, render::instanceBufferView(*edgePipeline));
+    }
+    render::savePipelineCache(vulkanDevice, pipelineCache, pipelineCachePath);
+
+    render::waitTransfer(transferService, render::submitTransfers(transferService));
+    render::TransferAcquireBatch transferAcquires = render::takeTransferAcquires(transferService);
+
+    // Frames are not written, the readback ring only paces the submissions
+    render::FrameReadback readback;
+    render::createFrameReadback(readback, &memoryAllocator, vulkanDevice->queueFamilyIndices.graphics, options.width, options.height,
+                                options.slots, render::FRAME_OUTPUT_FORMAT_NONE, ".");
+    render::GpuProfiler gpuProfiler;
+    render::createGpuProfiler(gpuProfiler, vulkanDevice, options.slots);
+
+    /* Scripted frames */
+
+    utils::FrameStats frameStats;
+    utils::FrameStats recordStats;
+    GpuBenchTotals gpuTotals;
+    uint32_t totalFrames = options.warmup + options.frames;
+    auto tStart = std::chrono::steady_clock::now();
+    auto tFrame = tStart;
+    for (uint32_t frame = 0; frame < totalFrames; frame++)
+    {
+        bool measured = frame >= options.warmup;
+        VkCommandBuffer commandBuffer = render::beginReadbackFrame(readback);
+        uint32_t slot = static_cast<uint32_t>(readback.recordingSlot);
+        auto tRecord = std::chrono::steady_clock::now();
+
+        uint32_t pathFrame = measured ? frame - options.warmup : 0;
+        float time = pathStart + (options.frames > 1 ? pathDuration * pathFrame / (options.frames - 1) : 0.f);
+        utils::sampleCameraPath(cameraPath, time, position, rotation);
+        camera.setPosition(position);
+        camera.setRotation(rotation);
+        updateProjectionBuffer(vulkanInstance.projection.buffer, vulkanInstance.projection.data, camera, true);
+
+        render::recordTransferAcquires(transferAcquires, commandBuffer);
+        transferAcquires = {};
+        render::recordProjectionUpdate(projection, commandBuffer, &vulkanInstance.projection.data);
+
+        render::beginGpuProfilerFrame(gpuProfiler, commandBuffer, slot);
+        render::beginOffscreenRenderPass(target, commandBuffer);
+        render::beginGpuScope(gpuProfiler, commandBuffer, "Nodes");
+        render::buildInstanceCommandBuffer(*nodePipeline, commandBuffer);
+        render::endGpuScope(gpuProfiler, commandBuffer);
+        render::beginGpuScope(gpuProfiler, commandBuffer, "Edges");
+        if (lineEdges)
+        {
+            render::buildLineEdgeCommandBuffer(*lineEdges, commandBuffer, options.width, options.height, 1.f, 1.f);
+        }
+        else
+        {
+            render::buildInstanceCommandBuffer(*edgePipeline, commandBuffer);
+        }
+        render::endGpuScope(gpuProfiler, commandBuffer);
+        vkCmdEndRenderPass(commandBuffer);
+
+        render::submitReadbackFrame(readback, queue, target.colorImage);
+        render::submitGpuProfilerFrame(gpuProfiler, slot);
+        render::collectGpuProfilerResults(gpuProfiler);
+        takeGpuTimings(gpuProfiler, options.warmup, gpuTotals);
+
+        auto tNow = std::chrono::steady_clock::now();
+        if (measured)
+        {
+            utils::recordFrameTime(frameStats, std::chrono::duration<float, std::milli>(tNow - tFrame).count());
+            utils::recordFrameTime(recordStats, std::chrono::duration<float, std::milli>(tNow - tRecord).count());
+        }
+        tFrame = tNow;
+    }
+    render::flushFrameReadback(readback);
+    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+    render::collectGpuProfilerResults(gpuProfiler);
+    takeGpuTimings(gpuProfiler, options.warmup, gpuTotals);
+    auto tEnd = std::chrono::steady_clock::now();
+
+    /* Summary */
+
+    double seconds = std::chrono::duration<double>(tEnd - tStart).count();
+    utils::FrameTimePercentiles framePercentiles = utils::allTimePercentiles(frameStats);
+    utils::FrameTimePercentiles recordPercentiles = utils::allTimePercentiles(recordStats);
+    utils::FrameTimePercentiles gpuPercentiles = utils::allTimePercentiles(gpuTotals.frameStats);
+    printf("Rendered %u frames at %ux%u in %.2f s\n", totalFrames, options.width, options.height, seconds);
+    printf("CPU frame: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           framePercentiles.p50, framePercentiles.p95, framePercentiles.p99, framePercentiles.max);
+    if (render::gpuProfilerEnabled(gpuProfiler))
+    {
+        printf("GPU frame: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms, %llu frames dropped\n",
+               gpuPercentiles.p50, gpuPercentiles.p95, gpuPercentiles.p99, gpuPercentiles.max,
+               static_cast<unsigned long long>(gpuProfiler.droppedFrames));
+    }
+    else
+    {
+        printf("GPU timings not available, the graphics queue has no timestamp support\n");
+    }
+
+    bool written = false;
+    {
+        std::ofstream file(options.output, std::ios::trunc);
+        if (file)
+        {
+            file << "{\n  \"config\": {\"device\": ";
+            writeJsonString(file, vulkanDevice->properties.deviceName);
+            file << ", \"width\": " << options.width << ", \"height\": " << options.height << ", \"frames\": " << options.frames
+                 << ", \"warmup\": " << options.warmup << ", \"slots\": " << options.slots << ", \"graph\": ";
+            writeJsonString(file, options.graphFile.empty() ? graph::generate::family_name(options.family) : options.graphFile);
+            file << ", \"seed\": " << options.seed << ", \"nodes\": " << N_nodes << ", \"edges\": " << N_edges
+                 << ", \"layout\": \"" << (kamadaKawai ? "kamada_kawai" : "random") << "\", \"camera_path\": ";
+            writeJsonString(file, options.cameraPathFile.empty() ? "orbit" : options.cameraPathFile);
+            file << ", \"edge_mode\": \"" << (options.lineEdges ? "lines" : "instances") << "\""
+                 << ", \"instance_layout\": \"" << (render::INSTANCE_SHADER_VARIANT[0] ? "packed" : "float") << "\"},\n";
+            file << "  \"seconds\": " << seconds << ",\n";
+            writePercentiles(file, "cpu_frame_ms", framePercentiles);
+            writePercentiles(file, "cpu_record_ms", recordPercentiles);
+            file << "  \"gpu_available\": " << (render::gpuProfilerEnabled(gpuProfiler) ? "true" : "false") << ",\n";
+            writePercentiles(file, "gpu_frame_ms", gpuPercentiles);
+            file << "  \"gpu_passes_ms\": [";
+            for (size_t pass = 0; pass < gpuTotals.passOrder.size(); pass++)
+            {
+                const GpuPassTotals &totals = gpuTotals.passes[gpuTotals.passOrder[pass]];
+                file << (pass > 0 ? ", " : "") << "{\"name\": ";
+                writeJsonString(file, gpuTotals.passOrder[pass]);
+                file << ", \"mean\": " << (totals.samples > 0 ? totals.sum / totals.samples : 0.) << ", \"min\": " << totals.min
+                     << ", \"max\": " << totals.max << ", \"samples\": " << totals.samples << "}";
+            }
+            file << "],\n  \"gpu_dropped_frames\": " << gpuProfiler.droppedFrames << ",\n";
+            file << "  \"hitches\": " << frameStats.hitchCount << ",\n";
+            file << "  \"peak_rss_bytes\": " << utils::peakResidentBytes() << "\n}\n";
+            written = static_cast<bool>(file);
+        }
+    }
+    if (written)
+    {
+        printf("Results written to %s\n", options.output.c_str());
+    }
+    else
+    {
+        printf("Could not write %s\n", options.output.c_str());
+    }
+
+    render::destroyGpuProfiler(gpuProfiler);
+    render::destroyFrameReadback(readback);
+    render::destroyInstancePipeline(*nodePipeline);
+    if (lineEdges)
+    {
+        render::destroyLineEdgePipeline(*lineEdges);
+    }
+    render::destroyInstancePipeline(*edgePipeline);
+    render::destroyProjectionUniform(projection);
+    render::destroyOffscreenTarget(target);
+    render::destroyTransferService(transferService);
+    vkDestroyPipelineCache(vulkanDevice->logicalDevice, pipelineCache, nullptr);
+    render::destroyDeviceMemoryAllocator(memoryAllocator);
+
+    return written ? 0 : 1;
+}
@@ -1,11 +1,103 @@
 #ifndef SETUP_ROUTINES_HPP
 #define SETUP_ROUTINES_HPP
+#include <memory>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include <VulkanTools/Utilities/VulkanTools.hpp>
 #include <VulkanTools/Structures/VulkanInstance.hpp>
-#include <VulkanTools/InstanceGraphics/GLTF_BasicInstance.hpp>
 #include <NetworkViewport/ImGui/ImGuiUI.hpp>
+#include <NetworkViewport/Graph/Graph_Layout.hpp>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include <NetworkViewport/Render/Instance_Pipeline.hpp>
+#include <NetworkViewport/Render/Chunked_Scene.hpp>
+#include <NetworkViewport/Render/Line_Edges.hpp>
+#include <NetworkViewport/Render/Density_Splat.hpp>
+#include <NetworkViewport/Render/Graph_Load.hpp>
+#include <NetworkViewport/Render/Upload_Ring.hpp>
+#include <NetworkViewport/Render/Projection_Uniform.hpp>
+#include <NetworkViewport/Render/Transfer_Service.hpp>
+#include <NetworkViewport/Render/Gpu_Profiler.hpp>
+#include <NetworkViewport/Render/Node_State_Buffer.hpp>
+#include <NetworkViewport/Render/Node_Filter.hpp>
+#include <NetworkViewport/Render/Node_Highlight.hpp>
+#include <NetworkViewport/Render/Gpu_Epidemic.hpp>
+#include <NetworkViewport/Render/Epidemic_Coloring.hpp>
+#include <NetworkViewport/Render/Community_Coloring.hpp>
+#include <NetworkViewport/Render/Node_Analytics.hpp>
+#include <NetworkViewport/Render/Node_Filtering.hpp>
+#include <NetworkViewport/Render/Node_Query.hpp>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+enum InstancePipelineIndex
+{
+    INSTANCE_PIPELINE_NODES,
+    INSTANCE_PIPELINE_EDGES
+};
+
+struct ScenePipelines
+{
+    // Indexed by InstancePipelineIndex
+    std::vector<std::unique_ptr<render::InstancePipeline>> instancePipelines;
+    // Streamed from a chunk file, drawn in place of the instance pipelines when set
+    std::unique_ptr<render::ChunkedScene> chunkedScene;
+    // Created on first use by prepareEdgeModes, from the params below
+    std::unique_ptr<render::LineEdgePipeline> lineEdges;
+    std::unique_ptr<render::DensitySplat> densitySplat;
+    render::LineEdgeParams lineParams;
+    render::DensitySplatParams splatParams;
+    // Pipelines of graphs replaced by a load, destroyed once no frame in flight draws them
+    std::vector<render::RetiredGraphScene> retiredScenes;
+    // Set once a graph from the menus replaced the startup graph, the per node buffers of the state, filter and
+    // query features only cover the startup graph
+    bool graphReplaced = false;
+    // Compute shader epidemic, its state buffer is read by the node pipeline
+    std::unique_ptr<render::GpuEpidemic> gpuEpidemic;
+    // Instance updates staged this frame
+    render::UploadBatch uploadBatch;
+    // Ownership acquires of transfer batches that completed since the last frame
+    render::TransferAcquireBatch transferAcquires;
+    // Pass timings, one query slot per frame in flight
+    render::GpuProfiler gpuProfiler;
+    // Camera block read by every scene pipeline, updated by each frame's command buffer
+    render::ProjectionUniform projection;
+};
+
+// A frame in flight acquires its swapchain image with the semaphore of its upload ring partition, the image is
+// presented once the semaphore of that image has been signaled
+struct FrameSemaphores
+{
+    std::vector<VkSemaphore> imageAcquired;
+    std::vector<VkSemaphore> renderComplete;
+};
+
+void createFrameSemaphores(FrameSemaphores& semaphores, VkDevice logicalDevice, uint32_t framesInFlight, uint32_t imageCount)
+{
+    VkSemaphoreCreateInfo semaphoreInfo = initializers::semaphoreCreateInfo();
+    semaphores.imageAcquired.resize(framesInFlight);
+    for (VkSemaphore& semaphore : semaphores.imageAcquired)
+    {
+        VK_CHECK_RESULT(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore));
+    }
+    semaphores.renderComplete.resize(imageCount);
+    for (VkSemaphore& semaphore : semaphores.renderComplete)
+    {
+        VK_CHECK_RESULT(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore));
+    }
+}
+
+void destroyFrameSemaphores(FrameSemaphores& semaphores, VkDevice logicalDevice)
+{
+    for (VkSemaphore semaphore : semaphores.imageAcquired)
+    {
+        vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+    }
+    for (VkSemaphore semaphore : semaphores.renderComplete)
+    {
+        vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+    }
+    semaphores.imageAcquired.clear();
+    semaphores.renderComplete.clear();
+}
 
 void beginCommandBuffer(VkCommandBuffer commandBuffer)
 {
@@ -38,35 +130,96 @@ void beginRenderPass(VkRenderPass renderPass, VkCommandBuffer commandBuffer, VkF
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
-void buildCommandBuffers(std::vector<VkCommandBuffer>& commandBuffers, 
-std::vector<VkFramebuffer>& frameBuffers,
+void drawScene(ScenePipelines& scenePipelines, const UISettings& uiSettings, VkCommandBuffer commandBuffer, bool splatting, int width, int height)
+{
+    render::GpuProfiler& profiler = scenePipelines.gpuProfiler;
+    if (splatting)
+    {
+        render::beginGpuScope(profiler, commandBuffer, "Heatmap");
+        render::drawDensityHeatmap(*scenePipelines.densitySplat, commandBuffer, uiSettings.display.splatExposure);
+        render::endGpuScope(profiler, commandBuffer);
+        return;
+    }
+    if (scenePipelines.chunkedScene)
+    {
+        render::beginGpuScope(profiler, commandBuffer, "Chunks");
+        render::buildChunkedSceneCommandBuffer(*scenePipelines.chunkedScene, commandBuffer, uiSettings.display.nodes, uiSettings.display.edges);
+        render::endGpuScope(profiler, commandBuffer);
+        return;
+    }
+    if (uiSettings.display.nodes)
+    {
+        render::beginGpuScope(profiler, commandBuffer, "Nodes");
+        render::buildInstanceCommandBuffer(*scenePipelines.instancePipelines[INSTANCE_PIPELINE_NODES], commandBuffer);
+        render::endGpuScope(profiler, commandBuffer);
+    }
+    if (uiSettings.display.edges)
+    {
+        render::beginGpuScope(profiler, commandBuffer, "Edges");
+        if (uiSettings.display.edgeMode == EDGE_RENDER_MODE_LINES && scenePipelines.lineEdges)
+        {
+            render::buildLineEdgeCommandBuffer(*scenePipelines.lineEdges, commandBuffer, width, height, uiSettings.display.lineWidth, uiSettings.display.lineDensity);
+        }
+        else
+        {
+            render::buildInstanceCommandBuffer(*scenePipelines.instancePipelines[INSTANCE_PIPELINE_EDGES], commandBuffer);
+        }
+        render::endGpuScope(profiler, commandBuffer);
+    }
+}
+
+// Record the frame of the given upload ring partition into its command buffer, which the partition's fence guards
+void buildCommandBuffer(VkCommandBuffer commandBuffer,
+uint32_t frameSlot,
+VkFramebuffer frameBuffer,
 VkRenderPass renderPass,
 ImGUI_UI::ImGuiVulkanData& ivData,
-const std::vector<std::unique_ptr<glTFBasicInstance::InstancePipelineData>>& instancePipelines,
+ScenePipelines& scenePipelines,
+const void* projectionData,
+const UISettings& uiSettings,
 int width, int height)
 {
-    // VkCommandBufferBeginInfo cmdBufInfo = initializers::commandBufferBeginInfo();
-    for (int32_t i = 0; i < commandBuffers.size(); ++i)
+    NV_TRACE_ZONE("Build command buffer");
+    beginCommandBuffer(commandBuffer);
+    render::beginGpuProfilerFrame(scenePipelines.gpuProfiler, commandBuffer, frameSlot);
+
+    render::beginGpuScope(scenePipelines.gpuProfiler, commandBuffer, "Uploads");
+    render::recordTransferAcquires(scenePipelines.transferAcquires, commandBuffer);
+    render::recordUploadBatch(scenePipelines.uploadBatch, commandBuffer);
+    if (scenePipelines.chunkedScene)
     {
+        render::recordChunkedSceneMoves(*scenePipelines.chunkedScene, commandBuffer);
+    }
+    render::recordProjectionUpdate(scenePipelines.projection, commandBuffer, projectionData);
+    render::endGpuScope(scenePipelines.gpuProfiler, commandBuffer);
 
-        // VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer[i], &cmdBufInfo));
-        beginCommandBuffer(commandBuffers[i]);
+    if (scenePipelines.gpuEpidemic)
+    {
+        render::beginGpuScope(scenePipelines.gpuProfiler, commandBuffer, "Epidemic");
+        render::recordGpuEpidemic(*scenePipelines.gpuEpidemic, commandBuffer);
+        render::endGpuScope(scenePipelines.gpuProfiler, commandBuffer);
+    }
 
-        beginRenderPass(renderPass, commandBuffers[i], frameBuffers[i], width, height);
-        for (auto& instancePipeline : instancePipelines)
-        {
-            buildCommandBuffer(*instancePipeline, commandBuffers[i]);
-        }
-        ImGUI_UI::drawFrame(ivData, commandBuffers[i]);
+    bool splatting = scenePipelines.densitySplat && scenePipelines.densitySplat->active;
+    if (splatting)
+    {
+        render::beginGpuScope(scenePipelines.gpuProfiler, commandBuffer, "Density splat");
+        render::buildDensitySplatPass(*scenePipelines.densitySplat, commandBuffer, uiSettings.display.edges && uiSettings.display.splatEdges);
+        render::endGpuScope(scenePipelines.gpuProfiler, commandBuffer);
+    }
 
+    beginRenderPass(renderPass, commandBuffer, frameBuffer, width, height);
+    drawScene(scenePipelines, uiSettings, commandBuffer, splatting, width, height);
+    render::beginGpuScope(scenePipelines.gpuProfiler, commandBuffer, "ImGui");
+    ImGUI_UI::drawFrame(ivData, commandBuffer);
+    render::endGpuScope(scenePipelines.gpuProfiler, commandBuffer);
 
-        vkCmdEndRenderPass(commandBuffers[i]);
+    vkCmdEndRenderPass(commandBuffer);
 
-        VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
-    }
+    VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 }
 
-void rebuildBuffers(VulkanInstance &vulkanInstance, const std::vector<std::unique_ptr<glTFBasicInstance::InstancePipelineData>>& instancePipelines, ImGUI_UI::ImGuiVulkanData& ivData, Camera &camera, int width, int height)
+void rebuildBuffers(VulkanInstance &vulkanInstance, ScenePipelines& scenePipelines, Camera &camera, int width, int height)
 {
     VkDevice logicalDevice = vulkanInstance.vulkanDevice->logicalDevice;
     // Ensure all operations on the device have been finished before destroying resources
@@ -91,13 +244,14 @@ void rebuildBuffers(VulkanInstance &vulkanInstance, const std::vector<std::uniqu
                                    vulkanInstance.frameBuffers);
 
     // Command buffers need to be recreated as they may store
-    // references to the recreated frame buffer
+    // references to the recreated frame buffer, they are recorded again by the next frames
     initializers::destroyCommandBuffers(logicalDevice, vulkanInstance.vulkanDevice->commandPool, vulkanInstance.drawCmdBuffers);
     initializers::createCommandBuffers(logicalDevice, vulkanInstance.drawCmdBuffers, vulkanInstance.swapChain, vulkanInstance.vulkanDevice->commandPool);
 
-    buildCommandBuffers(vulkanInstance.drawCmdBuffers, vulkanInstance.frameBuffers, vulkanInstance.renderPass, ivData, instancePipelines, width, height);
-
-    vkDeviceWaitIdle(logicalDevice);
+    if (scenePipelines.densitySplat)
+    {
+        render::resizeDensitySplat(*scenePipelines.densitySplat, width, height);
+    }
 
     if ((width > 0.0f) && (height > 0.0f))
     {
@@ -105,19 +259,94 @@ void rebuildBuffers(VulkanInstance &vulkanInstance, const std::vector<std::uniqu
     }
 }
 
-void submitBuffers(VulkanInstance &vulkanInstance, uint32_t& currentBufferIdx)
+// Line edges and the density splat draw from the instance pipelines' buffers, their pipelines and the splat target
+// are only created once the display settings first select them. The splat is then updated for this frame
+void prepareEdgeModes(ScenePipelines& scenePipelines, const UISettings& uiSettings, const glm::mat4& viewProjection, int width, int height)
 {
-    VK_CHECK_RESULT(vulkanInstance.swapChain.acquireNextImage(vulkanInstance.semaphores.presentComplete, &currentBufferIdx));
-    vulkanInstance.submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    vulkanInstance.submitInfo.commandBufferCount = 1;
-    vulkanInstance.submitInfo.pCommandBuffers = &vulkanInstance.drawCmdBuffers[currentBufferIdx];
-    vulkanInstance.submitInfo.pNext = NULL;
-    VK_CHECK_RESULT(vkQueueSubmit(vulkanInstance.queue, 1, &vulkanInstance.submitInfo, VK_NULL_HANDLE));
-    VK_CHECK_RESULT(vulkanInstance.swapChain.queuePresent(vulkanInstance.queue, currentBufferIdx, vulkanInstance.semaphores.renderComplete));
-    VK_CHECK_RESULT(vkQueueWaitIdle(vulkanInstance.queue));
+    if (scenePipelines.instancePipelines.empty())
+    {
+        return;
+    }
+    render::InstanceBufferView nodes = render::instanceBufferView(*scenePipelines.instancePipelines[INSTANCE_PIPELINE_NODES]);
+    render::InstanceBufferView edges = render::instanceBufferView(*scenePipelines.instancePipelines[INSTANCE_PIPELINE_EDGES]);
+    if (!scenePipelines.lineEdges && uiSettings.display.edges && uiSettings.display.edgeMode == EDGE_RENDER_MODE_LINES)
+    {
+        scenePipelines.lineEdges = render::prepareLineEdgeRendering(scenePipelines.lineParams, edges);
+    }
+    if (!scenePipelines.densitySplat)
+    {
+        glm::vec3 boundsMin(nodes.bounds.origin);
+        glm::vec3 boundsMax(nodes.bounds.origin + nodes.bounds.extent);
+        float density = render::projectedNodeDensity(viewProjection, boundsMin, boundsMax, nodes.instanceCount, width, height);
+        if (!render::chooseDensitySplat(uiSettings.display.splatMode, density, uiSettings.display.splatThreshold, false))
+        {
+            return;
+        }
+        scenePipelines.splatParams.width = width;
+        scenePipelines.splatParams.height = height;
+        scenePipelines.densitySplat = render::prepareDensitySplat(scenePipelines.splatParams, nodes, edges);
+    }
+    render::updateDensitySplatState(*scenePipelines.densitySplat, uiSettings.display.splatMode, viewProjection, uiSettings.display.splatThreshold);
 }
 
-void updateWindowSize(VulkanInstance &vulkanInstance, ImGUI_UI::ImGuiVulkanData& ivData, Camera& camera, const std::vector<std::unique_ptr<glTFBasicInstance::InstancePipelineData>>& instancePipelines, int& width, int& height)
+// Runs on a worker thread while the current graph is drawn, the pipelines record their uploads into the transfer batch
+render::GraphScene prepareGraphScene(igraph_t graph, const render::InstancePipelineParams& nodeParams, const render::InstancePipelineParams& edgeParams)
+{
+    NV_TRACE_ZONE("Prepare graph scene");
+    render::GraphScene scene;
+    auto nodeInstanceData = graph::layout::kamada_kawai_2D(graph, 500, 0);
+    auto edgeInstanceData = graph::layout::get_edge_positions(nodeInstanceData, graph);
+    igraph_destroy(&graph);
+    scene.nodes = render::prepareNodeInstancePipeline(nodeParams, nodeInstanceData);
+    scene.edges = render::prepareEdgeInstancePipeline(edgeParams, edgeInstanceData);
+    return scene;
+}
+
+// Draw a loaded graph from this frame on, the replaced pipelines are destroyed once the frames in flight completed.
+// The node state, filter and query features stay with the startup graph and are switched off as for chunked scenes
+void swapGraphScene(ScenePipelines& scenePipelines, render::GraphScene& loaded, UISettings& uiSettings, uint32_t framesInFlight)
+{
+    render::GraphScene replaced;
+    replaced.nodes = std::move(scenePipelines.instancePipelines[INSTANCE_PIPELINE_NODES]);
+    replaced.edges = std::move(scenePipelines.instancePipelines[INSTANCE_PIPELINE_EDGES]);
+    replaced.lineEdges = std::move(scenePipelines.lineEdges);
+    replaced.densitySplat = std::move(scenePipelines.densitySplat);
+    render::retireGraphScene(scenePipelines.retiredScenes, std::move(replaced), framesInFlight);
+
+    scenePipelines.instancePipelines[INSTANCE_PIPELINE_NODES] = std::move(loaded.nodes);
+    scenePipelines.instancePipelines[INSTANCE_PIPELINE_EDGES] = std::move(loaded.edges);
+    scenePipelines.graphReplaced = true;
+    uiSettings.communities.available = false;
+    uiSettings.analytics.available = false;
+    uiSettings.filter.available = false;
+    uiSettings.query.available = false;
+}
+
+void acquireFrameImage(VulkanInstance &vulkanInstance, const FrameSemaphores& semaphores, uint32_t frameSlot, uint32_t& imageIndex)
+{
+    NV_TRACE_ZONE("Acquire image");
+    VK_CHECK_RESULT(vulkanInstance.swapChain.acquireNextImage(semaphores.imageAcquired[frameSlot], &imageIndex));
+}
+
+// Submit the command buffer of frameSlot and present its image. Nothing waits for the GPU here, the fence of the
+// frame's upload ring partition is waited for once the partition comes around again
+void submitFrame(VulkanInstance &vulkanInstance, const FrameSemaphores& semaphores, uint32_t frameSlot, uint32_t imageIndex, VkFence fence)
+{
+    NV_TRACE_ZONE("Submit");
+    VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkSubmitInfo submitInfo = initializers::submitInfo();
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &semaphores.imageAcquired[frameSlot];
+    submitInfo.pWaitDstStageMask = &waitStageMask;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &vulkanInstance.drawCmdBuffers[frameSlot];
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &semaphores.renderComplete[imageIndex];
+    VK_CHECK_RESULT(vkQueueSubmit(vulkanInstance.queue, 1, &submitInfo, fence));
+    VK_CHECK_RESULT(vulkanInstance.swapChain.queuePresent(vulkanInstance.queue, imageIndex, semaphores.renderComplete[imageIndex]));
+}
+
+void updateWindowSize(VulkanInstance &vulkanInstance, Camera& camera, ScenePipelines& scenePipelines, int& width, int& height)
 {
     static int width_old, height_old;
     // glfwGetWindowSize(vulkanInstance.glfwWindow, &width, &height);
@@ -129,11 +358,10 @@ void updateWindowSize(VulkanInstance &vulkanInstance, ImGUI_UI::ImGuiVulkanData&
         vulkanInstance.vulkanDevice->logicalDevice, &vulkanInstance.ImGuiWindow, 
         vulkanInstance.vulkanDevice->queueFamilyIndices.graphics, NULL, width, height, vulkanInstance.swapChain.imageCount);
         vulkanInstance.ImGuiWindow.FrameIndex = 0;
-        rebuildBuffers(vulkanInstance, instancePipelines, ivData, camera, width, height);
+        rebuildBuffers(vulkanInstance, scenePipelines, camera, width, height);
     }
     width_old = width;
     height_old = height;
 }
 
-
 #endif
\ No newline at end of file
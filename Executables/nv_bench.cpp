@@ -0,0 +1,477 @@
+// CPU benchmarks of graph generation, CSR construction, community detection,
+// node analytics, k-core and component decomposition, shortest path and
+// neighborhood queries, layout and instance building. Needs no Vulkan device, e.g. for CI:
+//   ./nv_bench --families er,ba,ws --sizes 1000,10000,100000 --reps 5 --output bench.json
+// Every stage is run warmup + reps times, reported are the median and variance
+// of the repetitions, edges per second at the median and the peak RSS after
+// the stage. Before any timing the graph stages are checked against igraph on a
+// small seeded graph of every family, a mismatch fails the run.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <igraph/igraph.h>
+#include <NetworkViewport/Graph/Graph_Analytics.hpp>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include <NetworkViewport/Graph/Graph_Communities.hpp>
+#include <NetworkViewport/Graph/Graph_Decomposition.hpp>
+#include <NetworkViewport/Graph/Graph_Generation.hpp>
+#include <NetworkViewport/Graph/Graph_Layout.hpp>
+#include <NetworkViewport/Graph/Graph_Search.hpp>
+#include <NetworkViewport/Render/Packed_Instances.hpp>
+#include <NetworkViewport/Utils/Memory_Usage.hpp>
+
+struct BenchOptions
+{
+    std::vector<graph::generate::GraphFamily> families = {graph::generate::GRAPH_FAMILY_ERDOS_RENYI, graph::generate::GRAPH_FAMILY_BARABASI_ALBERT,
+                                                          graph::generate::GRAPH_FAMILY_WATTS_STROGATZ};
+    std::vector<size_t> sizes = {1000, 10000, 100000};
+    double degree = 8.;
+    uint32_t reps = 5;
+    uint32_t warmup = 1;
+    // Kamada-Kawai is quadratic in the node count and skipped above this
+    size_t kkMaxNodes = 2000;
+    size_t kkIterations = 500;
+    std::string output = "nv_bench.json";
+};
+
+struct BenchResult
+{
+    std::string family;
+    std::string stage;
+    size_t nodes = 0;
+    size_t edges = 0;
+    uint32_t reps = 0;
+    double median = 0.;
+    double mean = 0.;
+    double variance = 0.;
+    double min = 0.;
+    double max = 0.;
+    double edgesPerSecond = 0.;
+    size_t peakResidentBytes = 0;
+};
+
+void printUsage(const char *executable)
+{
+    printf("Usage: %s [--families er,ba,ws,lattice] [--sizes N,N,...] [--degree D] [--reps N] [--warmup N]\n"
+           "          [--kk-max-nodes N] [--kk-iterations N] [--output FILE]\n",
+           executable);
+}
+
+std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--families" && hasValue)
+        {
+            options.families.clear();
+            for (const std::string &name : splitList(argv[++i]))
+            {
+                graph::generate::GraphFamily family;
+                if (!graph::generate::parse_family(name, family))
+                    return false;
+                options.families.push_back(family);
+            }
+        }
+        else if (arg == "--sizes" && hasValue)
+        {
+            options.sizes.clear();
+            for (const std::string &size : splitList(argv[++i]))
+                options.sizes.push_back(std::strtoull(size.c_str(), nullptr, 10));
+        }
+        else if (arg == "--degree" && hasValue)
+            options.degree = std::atof(argv[++i]);
+        else if (arg == "--reps" && hasValue)
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--kk-max-nodes" && hasValue)
+            options.kkMaxNodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--kk-iterations" && hasValue)
+            options.kkIterations = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else
+            return false;
+    }
+    return !options.families.empty() && !options.sizes.empty();
+}
+
+// Times run over the repetitions, setup runs untimed before every call
+BenchResult runStage(const BenchOptions &options, const std::function<void()> &setup, const std::function<void()> &run)
+{
+    std::vector<double> times;
+    for (uint32_t rep = 0; rep < options.warmup + options.reps; rep++)
+    {
+        setup();
+        auto tStart = std::chrono::steady_clock::now();
+        run();
+        auto tEnd = std::chrono::steady_clock::now();
+        if (rep >= options.warmup)
+            times.push_back(std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+    }
+
+    BenchResult result;
+    result.reps = static_cast<uint32_t>(times.size());
+    std::sort(times.begin(), times.end());
+    size_t middle = times.size() / 2;
+    result.median = times.size() % 2 ? times[middle] : .5 * (times[middle - 1] + times[middle]);
+    result.min = times.front();
+    result.max = times.back();
+    for (double time : times)
+        result.mean += time;
+    result.mean /= times.size();
+    for (double time : times)
+        result.variance += (time - result.mean) * (time - result.mean);
+    result.variance = times.size() > 1 ? result.variance / (times.size() - 1) : 0.;
+    result.peakResidentBytes = utils::peakResidentBytes();
+    return result;
+}
+
+std::vector<NodeInstanceData> randomPositions(size_t N_nodes)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> position(-100.f, 100.f);
+    std::vector<NodeInstanceData> node_data;
+    node_data.reserve(N_nodes);
+    for (size_t i = 0; i < N_nodes; i++)
+    {
+        node_data.push_back({{position(generator), position(generator), position(generator)}, {1.f, 1.f, 1.f, .8f}, 1.f});
+    }
+    return node_data;
+}
+
+// Node count and igraph seed of the graphs the stages are checked on
+constexpr size_t CHECK_NODES = 2000;
+constexpr unsigned long CHECK_SEED = 1;
+
+bool reportCheck(const char *family, const char *stage, size_t mismatches, size_t total, const char *unit)
+{
+    if (mismatches > 0)
+        printf("Check failed: %s %s, %zu of %zu %s differ from igraph\n", family, stage, mismatches, total, unit);
+    return mismatches == 0;
+}
+
+bool checkCores(const char *family, const igraph_t &graph, const graph::CSRGraph &csr)
+{
+    igraph_vector_int_t cores;
+    igraph_vector_int_init(&cores, 0);
+    igraph_coreness(&graph, &cores, IGRAPH_ALL);
+    graph::decomposition::CoreDecomposition decomposition = graph::decomposition::core_decomposition(csr);
+    size_t mismatches = 0;
+    for (uint32_t node = 0; node < csr.N_nodes; node++)
+    {
+        if (decomposition.core[node] != static_cast<uint32_t>(VECTOR(cores)[node]))
+            mismatches++;
+    }
+    igraph_vector_int_destroy(&cores);
+    return reportCheck(family, "k_core", mismatches, csr.N_nodes, "core numbers");
+}
+
+// The numbering of the components differs, they match if every igraph component maps to exactly one of ours
+bool checkComponents(const char *family, const igraph_t &graph, const graph::CSRGraph &csr)
+{
+    igraph_vector_int_t membership;
+    igraph_vector_int_init(&membership, 0);
+    igraph_integer_t N_components = 0;
+    igraph_connected_components(&graph, &membership, nullptr, &N_components, IGRAPH_WEAK);
+    graph::decomposition::ComponentDecomposition decomposition = graph::decomposition::connected_components(csr);
+    std::vector<uint32_t> mapped(N_components, UINT32_MAX);
+    std::vector<bool> taken(decomposition.N_components, false);
+    size_t mismatches = 0;
+    for (uint32_t node = 0; node < csr.N_nodes; node++)
+    {
+        uint32_t &component = mapped[VECTOR(membership)[node]];
+        if (component == UINT32_MAX)
+        {
+            component = decomposition.component[node];
+            if (taken[component])
+                mismatches++;
+            taken[component] = true;
+        }
+        else if (component != decomposition.component[node])
+            mismatches++;
+    }
+    igraph_vector_int_destroy(&membership);
+    return reportCheck(family, "components", mismatches, csr.N_nodes, "component assignments");
+}
+
+// Louvain partitions depend on the visiting order, so ours only has to score within this much of igraph's multilevel
+constexpr double CHECK_MODULARITY_TOLERANCE = .02;
+
+double igraphModularity(const igraph_t &graph, const igraph_vector_int_t &membership)
+{
+    igraph_real_t modularity = 0.;
+    igraph_modularity(&graph, &membership, nullptr, 1., false, &modularity);
+    return modularity;
+}
+
+// The modularity we report has to be igraph's for our partition, and not fall short of igraph's multilevel
+bool checkLouvain(const char *family, const igraph_t &graph, const graph::CSRGraph &csr)
+{
+    graph::community::LouvainResult communities = graph::community::louvain(csr);
+    igraph_vector_int_t membership;
+    igraph_vector_int_init(&membership, csr.N_nodes);
+    for (uint32_t node = 0; node < csr.N_nodes; node++)
+        VECTOR(membership)[node] = communities.community[node];
+    double ours = igraphModularity(graph, membership);
+    igraph_community_multilevel(&graph, nullptr, 1., &membership, nullptr, nullptr);
+    double reference = igraphModularity(graph, membership);
+    igraph_vector_int_destroy(&membership);
+
+    bool passed = true;
+    if (std::abs(communities.modularity - ours) > 1e-6)
+    {
+        printf("Check failed: %s louvain, reported modularity %.6f but igraph scores the partition %.6f\n", family, communities.modularity, ours);
+        passed = false;
+    }
+    if (ours < reference - CHECK_MODULARITY_TOLERANCE)
+    {
+        printf("Check failed: %s louvain, modularity %.6f below igraph multilevel's %.6f\n", family, ours, reference);
+        passed = false;
+    }
+    return passed;
+}
+
+// Paths may differ between equally short ones, so ours must be as long as igraph's and follow edges
+bool checkSearch(const char *family, const igraph_t &graph, const graph::CSRGraph &csr)
+{
+    const uint32_t N_queries = 16;
+    std::mt19937 queryRng(7);
+    graph::search::SearchWorkspace workspace;
+    size_t pathMismatches = 0;
+    size_t neighborhoodMismatches = 0;
+    igraph_vector_int_t vertices;
+    igraph_vector_int_init(&vertices, 0);
+    igraph_vector_int_t sizes;
+    igraph_vector_int_init(&sizes, 0);
+    for (uint32_t q = 0; q < N_queries; q++)
+    {
+        uint32_t source = static_cast<uint32_t>(queryRng() % csr.N_nodes);
+        uint32_t target = static_cast<uint32_t>(queryRng() % csr.N_nodes);
+        igraph_get_shortest_path(&graph, &vertices, nullptr, source, target, IGRAPH_ALL);
+        graph::search::PathResult path = graph::search::shortest_path(csr, source, target, workspace);
+        bool valid = path.path.size() == static_cast<size_t>(igraph_vector_int_size(&vertices));
+        if (valid && !path.path.empty())
+            valid = path.path.front() == source && path.path.back() == target;
+        for (size_t i = 0; valid && i + 1 < path.path.size(); i++)
+        {
+            uint32_t node = path.path[i];
+            valid = std::binary_search(csr.neighbors.begin() + csr.offsets[node], csr.neighbors.begin() + csr.offsets[node + 1], path.path[i + 1]);
+        }
+        if (!valid)
+            pathMismatches++;
+
+        igraph_neighborhood_size(&graph, &sizes, igraph_vss_1(source), 2, IGRAPH_ALL, 0);
+        if (graph::search::neighborhood(csr, source, 2, workspace).nodes.size() != static_cast<size_t>(VECTOR(sizes)[0]))
+            neighborhoodMismatches++;
+    }
+    igraph_vector_int_destroy(&vertices);
+    igraph_vector_int_destroy(&sizes);
+    bool passed = reportCheck(family, "shortest_path", pathMismatches, N_queries, "paths");
+    return reportCheck(family, "neighborhood", neighborhoodMismatches, N_queries, "2-hop neighborhoods") && passed;
+}
+
+// Run the graph stages on a small seeded graph of the family and compare them against igraph
+bool checkStages(const BenchOptions &options, graph::generate::GraphFamily family)
+{
+    igraph_rng_seed(igraph_rng_default(), CHECK_SEED);
+    igraph_t graph;
+    graph::generate::generate(&graph, family, CHECK_NODES, options.degree);
+    graph::CSRGraph csr = graph::build_csr(graph);
+    const char *name = graph::generate::family_name(family);
+    bool passed = checkLouvain(name, graph, csr);
+    passed &= checkCores(name, graph, csr);
+    passed &= checkComponents(name, graph, csr);
+    passed &= checkSearch(name, graph, csr);
+    igraph_destroy(&graph);
+    return passed;
+}
+
+void benchGraph(const BenchOptions &options, graph::generate::GraphFamily family, size_t N_nodes, std::vector<BenchResult> &results)
+{
+    igraph_t graph;
+    bool hasGraph = false;
+    auto releaseGraph = [&]()
+    {
+        if (hasGraph)
+            igraph_destroy(&graph);
+        hasGraph = false;
+    };
+    auto addResult = [&](BenchResult result, const char *stage)
+    {
+        result.family = graph::generate::family_name(family);
+        result.stage = stage;
+        result.nodes = igraph_vcount(&graph);
+        result.edges = igraph_ecount(&graph);
+        result.edgesPerSecond = result.median > 0. ? result.edges / (result.median * 1e-3) : 0.;
+        printf("%-16s %9zu nodes %10zu edges  %-20s median %10.3f ms  sd %8.3f ms  %12.0f edges/s  peak RSS %7.1f MiB\n",
+               result.family.c_str(), result.nodes, result.edges, stage, result.median, std::sqrt(result.variance), result.edgesPerSecond,
+               result.peakResidentBytes / (1024. * 1024.));
+        fflush(stdout);
+        results.push_back(result);
+    };
+
+    BenchResult generation = runStage(options, releaseGraph, [&]()
+                                      { graph::generate::generate(&graph, family, N_nodes, options.degree); hasGraph = true; });
+    addResult(generation, "generate");
+
+    graph::CSRGraph csr;
+    addResult(runStage(options, [&]() { csr = graph::CSRGraph(); }, [&]() { csr = graph::build_csr(graph); }), "csr_build");
+
+    graph::community::LouvainResult communities;
+    addResult(runStage(options, [] {}, [&]() { communities = graph::community::louvain(csr); }), "louvain");
+
+    // Fixed work per repetition, the iteration count would otherwise depend on the tolerance
+    graph::analytics::PageRankParams pagerankParams;
+    pagerankParams.maxIterations = 20;
+    pagerankParams.tolerance = 0.;
+    addResult(runStage(options, [] {}, [&]() { graph::analytics::pagerank(csr, pagerankParams); }), "pagerank");
+    graph::analytics::BetweennessParams betweennessParams;
+    betweennessParams.samples = 32;
+    addResult(runStage(options, [] {}, [&]() { graph::analytics::betweenness(csr, betweennessParams); }), "betweenness");
+    addResult(runStage(options, [] {}, [&]() { graph::decomposition::core_decomposition(csr); }), "k_core");
+    addResult(runStage(options, [] {}, [&]() { graph::decomposition::connected_components(csr); }), "components");
+    // The same random queries every repetition, answered from one reused workspace as in the viewer
+    const uint32_t N_queries = 16;
+    std::vector<uint32_t> queryNodes(2 * N_queries);
+    std::mt19937 queryRng(7);
+    for (uint32_t &node : queryNodes)
+    {
+        node = csr.N_nodes > 0 ? static_cast<uint32_t>(queryRng() % csr.N_nodes) : 0;
+    }
+    graph::search::SearchWorkspace searchWorkspace;
+    addResult(runStage(options, [] {}, [&]()
+                       { for (uint32_t q = 0; q < N_queries; q++) graph::search::shortest_path(csr, queryNodes[2 * q], queryNodes[2 * q + 1], searchWorkspace); }),
+              "shortest_path");
+    addResult(runStage(options, [] {}, [&]()
+                       { for (uint32_t q = 0; q < N_queries; q++) graph::search::neighborhood(csr, queryNodes[q], 2, searchWorkspace); }),
+              "neighborhood");
+
+    std::vector<NodeInstanceData> nodeInstanceData;
+    if (static_cast<size_t>(igraph_vcount(&graph)) <= options.kkMaxNodes)
+    {
+        addResult(runStage(options, [] {}, [&]()
+                           { nodeInstanceData = graph::layout::kamada_kawai_2D(graph, options.kkIterations, 0); }),
+                  "kamada_kawai_2d");
+        addResult(runStage(options, [] {}, [&]()
+                           { nodeInstanceData = graph::layout::kamada_kawai_3D(graph, options.kkIterations, 0); }),
+                  "kamada_kawai_3d");
+    }
+    else
+    {
+        nodeInstanceData = randomPositions(igraph_vcount(&graph));
+    }
+
+    std::vector<EdgeInstanceData> edgeInstanceData;
+    addResult(runStage(options, [&]() { edgeInstanceData.clear(); }, [&]()
+                       { edgeInstanceData = graph::layout::get_edge_positions(nodeInstanceData, graph); }),
+              "edge_positions");
+
+    // Conversion to the GPU layout selected by NV_PACKED_INSTANCES, as done before every upload
+    addResult(runStage(options, [] {}, [&]()
+                       {
+                           auto nodes = render::toGpuNodeInstances(nodeInstanceData, render::computeInstanceBounds(nodeInstanceData));
+                           auto edges = render::toGpuEdgeInstances(edgeInstanceData, render::computeInstanceBounds(edgeInstanceData));
+                       }),
+              "instance_build");
+
+    releaseGraph();
+}
+
+void writeJsonString(std::ofstream &file, const std::string &text)
+{
+    file << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            file << '\\';
+        file << c;
+    }
+    file << '"';
+}
+
+bool writeResults(const BenchOptions &options, const std::vector<BenchResult> &results)
+{
+    std::ofstream file(options.output, std::ios::trunc);
+    if (!file)
+        return false;
+    file << "{\n  \"config\": {\"degree\": " << options.degree << ", \"reps\": " << options.reps << ", \"warmup\": " << options.warmup
+         << ", \"kk_max_nodes\": " << options.kkMaxNodes << ", \"kk_iterations\": " << options.kkIterations
+         << ", \"instance_layout\": \"" << (render::INSTANCE_SHADER_VARIANT[0] ? "packed" : "float") << "\"},\n";
+    file << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &result = results[i];
+        file << "    {\"family\": ";
+        writeJsonString(file, result.family);
+        file << ", \"stage\": ";
+        writeJsonString(file, result.stage);
+        file << ", \"nodes\": " << result.nodes << ", \"edges\": " << result.edges << ", \"reps\": " << result.reps
+             << ", \"median_ms\": " << result.median << ", \"mean_ms\": " << result.mean << ", \"variance_ms2\": " << result.variance
+             << ", \"min_ms\": " << result.min << ", \"max_ms\": " << result.max << ", \"edges_per_second\": " << result.edgesPerSecond
+             << ", \"peak_rss_bytes\": " << result.peakResidentBytes << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ],\n  \"peak_rss_bytes\": " << utils::peakResidentBytes() << "\n}\n";
+    return static_cast<bool>(file);
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Wrong results are not worth timing
+    bool passed = true;
+    for (graph::generate::GraphFamily family : options.families)
+    {
+        passed &= checkStages(options, family);
+    }
+    if (!passed)
+        return 1;
+    printf("Graph stages match igraph on %zu node graphs\n", CHECK_NODES);
+    igraph_rng_seed(igraph_rng_default(), 42);
+
+    std::vector<BenchResult> results;
+    for (graph::generate::GraphFamily family : options.families)
+    {
+        for (size_t N_nodes : options.sizes)
+        {
+            benchGraph(options, family, N_nodes, results);
+        }
+    }
+
+    if (!writeResults(options, results))
+    {
+        printf("Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    printf("Results written to %s\n", options.output.c_str());
+    return 0;
+}
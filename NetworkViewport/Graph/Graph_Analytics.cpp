@@ -0,0 +1,427 @@
+#include "Graph_Analytics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <omp.h>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace graph::analytics
+{
+    // Degrees below this are counted in thread-local histograms, the rare larger ones atomically in the shared one
+    static constexpr uint32_t LOCAL_DEGREE_BINS = 1024;
+    // Dynamic range of logarithmic normalization, the column maximum is this many times its smallest resolved step
+    static constexpr float LOG_RANGE = 1000.f;
+
+    static int thread_count(uint32_t threads)
+    {
+        return threads > 0 ? static_cast<int>(threads) : std::max(1, omp_get_max_threads());
+    }
+
+    DegreeHistogram degree_histogram(const CSRGraph& csr, uint32_t threads)
+    {
+        NV_TRACE_ZONE("Degree histogram");
+        int threadCount = thread_count(threads);
+        const int64_t N_nodes = csr.N_nodes;
+        uint32_t maxDegree = 0;
+#pragma omp parallel for schedule(static) reduction(max : maxDegree) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            maxDegree = std::max(maxDegree, degree(csr, static_cast<uint32_t>(node)));
+        }
+
+        DegreeHistogram histogram;
+        histogram.maxDegree = maxDegree;
+        histogram.counts.assign(static_cast<size_t>(maxDegree) + 1, 0);
+        const uint32_t localBins = std::min(maxDegree + 1, LOCAL_DEGREE_BINS);
+        std::vector<std::vector<uint64_t>> localCounts(threadCount);
+#pragma omp parallel num_threads(threadCount)
+        {
+            std::vector<uint64_t>& counts = localCounts[omp_get_thread_num()];
+            counts.assign(localBins, 0);
+#pragma omp for schedule(static)
+            for (int64_t node = 0; node < N_nodes; node++)
+            {
+                uint32_t nodeDegree = degree(csr, static_cast<uint32_t>(node));
+                if (nodeDegree < localBins)
+                {
+                    counts[nodeDegree]++;
+                }
+                else
+                {
+#pragma omp atomic
+                    histogram.counts[nodeDegree]++;
+                }
+            }
+        }
+        for (const std::vector<uint64_t>& counts : localCounts)
+        {
+            for (uint32_t bin = 0; bin < counts.size(); bin++)
+            {
+                histogram.counts[bin] += counts[bin];
+            }
+        }
+        histogram.meanDegree = N_nodes > 0 ? static_cast<double>(arc_count(csr)) / N_nodes : 0.;
+        return histogram;
+    }
+
+    std::vector<float> degrees(const CSRGraph& csr)
+    {
+        std::vector<float> values(csr.N_nodes);
+        const int64_t N_nodes = csr.N_nodes;
+#pragma omp parallel for simd schedule(static)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            values[node] = static_cast<float>(csr.offsets[node + 1] - csr.offsets[node]);
+        }
+        return values;
+    }
+
+    PageRankResult pagerank(const CSRGraph& csr, const PageRankParams& params, Progress* progress)
+    {
+        NV_TRACE_ZONE("PageRank");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(params.threads);
+        PageRankResult result;
+        const int64_t N_nodes = csr.N_nodes;
+        if (N_nodes == 0)
+        {
+            return result;
+        }
+        const double damping = params.damping;
+        std::vector<double> rank(N_nodes, 1. / N_nodes);
+        std::vector<double> next(N_nodes);
+        // Share of rank[u] passed along each arc of u
+        std::vector<double> contribution(N_nodes);
+        const uint64_t* offsets = csr.offsets.data();
+        const uint32_t* neighbors = csr.neighbors.data();
+
+        for (uint32_t iteration = 0; iteration < params.maxIterations; iteration++)
+        {
+            if (progress && progress->cancel.load(std::memory_order_relaxed))
+            {
+                break;
+            }
+            // Rank of nodes without arcs is spread over all nodes
+            double dangling = 0.;
+#pragma omp parallel for simd schedule(static) reduction(+ : dangling) num_threads(threadCount)
+            for (int64_t node = 0; node < N_nodes; node++)
+            {
+                uint64_t nodeDegree = offsets[node + 1] - offsets[node];
+                dangling += nodeDegree == 0 ? rank[node] : 0.;
+                contribution[node] = nodeDegree == 0 ? 0. : rank[node] / nodeDegree;
+            }
+
+            // Pull: every node sums the contributions of its neighbors and is written by one thread
+            const double base = (1. - damping) / N_nodes + damping * dangling / N_nodes;
+            double residual = 0.;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : residual) num_threads(threadCount)
+            for (int64_t node = 0; node < N_nodes; node++)
+            {
+                const uint32_t* nodeNeighbors = neighbors + offsets[node];
+                const int64_t nodeDegree = offsets[node + 1] - offsets[node];
+                double sum = 0.;
+#pragma omp simd reduction(+ : sum)
+                for (int64_t i = 0; i < nodeDegree; i++)
+                {
+                    sum += contribution[nodeNeighbors[i]];
+                }
+                next[node] = base + damping * sum;
+                residual += std::abs(next[node] - rank[node]);
+            }
+            rank.swap(next);
+            result.iterations++;
+            result.residual = residual;
+            if (progress)
+            {
+                progress->fraction.store(static_cast<float>(iteration + 1) / params.maxIterations, std::memory_order_relaxed);
+            }
+            if (residual < params.tolerance)
+            {
+                break;
+            }
+        }
+
+        result.rank.resize(N_nodes);
+#pragma omp parallel for simd schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            result.rank[node] = static_cast<float>(rank[node]);
+        }
+        if (progress)
+        {
+            progress->fraction.store(1.f, std::memory_order_relaxed);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    // Brandes state of one node, kept together so the BFS and the accumulation touch one cache line per neighbor
+    struct BrandesNode
+    {
+        // Number of shortest paths from the source
+        double paths = 0.;
+        double dependency = 0.;
+        int32_t distance = -1;
+    };
+
+    // Per-thread state of Brandes' algorithm, reset after every source for the visited nodes only
+    struct BrandesWorkspace
+    {
+        std::vector<BrandesNode> nodes;
+        // Nodes in BFS order, walked backwards to accumulate the dependencies
+        std::vector<uint32_t> order;
+        std::vector<double> centrality;
+    };
+
+    static void accumulate_source(const CSRGraph& csr, uint32_t source, BrandesWorkspace& workspace)
+    {
+        std::vector<BrandesNode>& nodes = workspace.nodes;
+        std::vector<uint32_t>& order = workspace.order;
+        order.clear();
+        nodes[source].distance = 0;
+        nodes[source].paths = 1.;
+        order.push_back(source);
+        for (size_t head = 0; head < order.size(); head++)
+        {
+            uint32_t node = order[head];
+            const BrandesNode current = nodes[node];
+            for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+            {
+                BrandesNode& neighbor = nodes[csr.neighbors[arc]];
+                if (neighbor.distance < 0)
+                {
+                    neighbor.distance = current.distance + 1;
+                    order.push_back(csr.neighbors[arc]);
+                }
+                if (neighbor.distance == current.distance + 1)
+                {
+                    neighbor.paths += current.paths;
+                }
+            }
+        }
+
+        // Predecessors are the neighbors one step closer, found again instead of stored
+        for (size_t i = order.size(); i-- > 0;)
+        {
+            uint32_t node = order[i];
+            const BrandesNode current = nodes[node];
+            double share = (1. + current.dependency) / current.paths;
+            for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+            {
+                BrandesNode& neighbor = nodes[csr.neighbors[arc]];
+                if (neighbor.distance == current.distance - 1)
+                {
+                    neighbor.dependency += neighbor.paths * share;
+                }
+            }
+            if (node != source)
+            {
+                workspace.centrality[node] += current.dependency;
+            }
+        }
+        for (uint32_t node : order)
+        {
+            nodes[node] = BrandesNode();
+        }
+    }
+
+    BetweennessResult betweenness(const CSRGraph& csr, const BetweennessParams& params, Progress* progress)
+    {
+        NV_TRACE_ZONE("Betweenness");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(params.threads);
+        BetweennessResult result;
+        const uint32_t N_nodes = csr.N_nodes;
+        result.centrality.assign(N_nodes, 0.f);
+        if (N_nodes == 0)
+        {
+            return result;
+        }
+
+        // The first sources of a seeded shuffle, all nodes when there are not more than samples
+        std::vector<uint32_t> sources(N_nodes);
+        std::iota(sources.begin(), sources.end(), 0u);
+        uint32_t sourceCount = std::min(std::max(params.samples, 1u), N_nodes);
+        if (sourceCount < N_nodes)
+        {
+            std::mt19937_64 generator(params.seed);
+            for (uint32_t i = 0; i < sourceCount; i++)
+            {
+                std::uniform_int_distribution<uint32_t> pick(i, N_nodes - 1);
+                std::swap(sources[i], sources[pick(generator)]);
+            }
+            sources.resize(sourceCount);
+        }
+
+        std::vector<BrandesWorkspace> workspaces(threadCount);
+        std::atomic<uint32_t> completed{0};
+        const int64_t sampleCount = sourceCount;
+#pragma omp parallel num_threads(threadCount)
+        {
+            // Allocated by the thread using it
+            BrandesWorkspace& workspace = workspaces[omp_get_thread_num()];
+            workspace.nodes.assign(N_nodes, BrandesNode());
+            workspace.order.reserve(N_nodes);
+            workspace.centrality.assign(N_nodes, 0.);
+#pragma omp for schedule(dynamic, 1)
+            for (int64_t i = 0; i < sampleCount; i++)
+            {
+                if (progress && progress->cancel.load(std::memory_order_relaxed))
+                {
+                    continue;
+                }
+                accumulate_source(csr, sources[i], workspace);
+                uint32_t done = completed.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (progress)
+                {
+                    progress->fraction.store(static_cast<float>(done) / sourceCount, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Every unordered pair is reached from both ends when all nodes are sources
+        result.samples = completed.load();
+        double scale = result.samples > 0 ? .5 * N_nodes / result.samples : 0.;
+        const int64_t N = N_nodes;
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            double sum = 0.;
+            for (const BrandesWorkspace& workspace : workspaces)
+            {
+                sum += workspace.centrality[node];
+            }
+            result.centrality[node] = static_cast<float>(sum * scale);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    size_t set_column(AttributeTable& table, const std::string& name, std::vector<float> values)
+    {
+        int index = find_column(table, name);
+        if (index < 0)
+        {
+            index = static_cast<int>(table.columns.size());
+            table.columns.emplace_back();
+            table.columns.back().name = name;
+        }
+        AttributeColumn& column = table.columns[index];
+        column.values = std::move(values);
+        column.min = 0.f;
+        column.max = 0.f;
+        if (!column.values.empty())
+        {
+            auto range = std::minmax_element(column.values.begin(), column.values.end());
+            column.min = *range.first;
+            column.max = *range.second;
+        }
+        return static_cast<size_t>(index);
+    }
+
+    int find_column(const AttributeTable& table, const std::string& name)
+    {
+        for (size_t i = 0; i < table.columns.size(); i++)
+        {
+            if (table.columns[i].name == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    float normalized_value(const AttributeColumn& column, uint32_t node, bool logarithmic)
+    {
+        float range = column.max - column.min;
+        float t = range > 0.f ? (column.values[node] - column.min) / range : 0.f;
+        return logarithmic ? std::log1p(t * LOG_RANGE) / std::log1p(LOG_RANGE) : t;
+    }
+
+    std::vector<uint8_t> column_bins(const AttributeColumn& column, uint32_t N_bins, bool logarithmic, uint32_t threads)
+    {
+        int threadCount = thread_count(threads);
+        std::vector<uint8_t> bins(column.values.size());
+        const int64_t N_nodes = column.values.size();
+        const uint32_t lastBin = std::min(std::max(N_bins, 1u), 256u) - 1;
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            float t = normalized_value(column, static_cast<uint32_t>(node), logarithmic);
+            bins[node] = static_cast<uint8_t>(std::min(static_cast<uint32_t>(t * (lastBin + 1)), lastBin));
+        }
+        return bins;
+    }
+
+    std::vector<float> column_scales(const AttributeColumn& column, const std::vector<float>& base, float minFactor, float maxFactor, bool logarithmic,
+                                     uint32_t threads)
+    {
+        int threadCount = thread_count(threads);
+        std::vector<float> scales(base.size());
+        const int64_t N_nodes = base.size();
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            float t = normalized_value(column, static_cast<uint32_t>(node), logarithmic);
+            scales[node] = base[node] * (minFactor + (maxFactor - minFactor) * t);
+        }
+        return scales;
+    }
+
+    glm::vec4 ramp_color(uint32_t bin, uint32_t N_bins)
+    {
+        // Stops of a perceptually ordered ramp, interpolated linearly
+        static const glm::vec3 stops[] = {{.27f, .00f, .33f}, {.23f, .32f, .55f}, {.13f, .57f, .55f}, {.37f, .79f, .38f}, {.99f, .91f, .14f}};
+        const uint32_t N_segments = sizeof(stops) / sizeof(stops[0]) - 1;
+        float t = N_bins > 1 ? static_cast<float>(bin) / (N_bins - 1) : 0.f;
+        float position = std::min(t, 1.f) * N_segments;
+        uint32_t segment = std::min(static_cast<uint32_t>(position), N_segments - 1);
+        glm::vec3 color = glm::mix(stops[segment], stops[segment + 1], position - segment);
+        return glm::vec4(color, 1.f);
+    }
+
+    AnalyticsJobResult run_analytics_job(const CSRGraph& csr, AnalyticsJob job, double damping, uint32_t samples, Progress* progress)
+    {
+        NV_TRACE_ZONE("Analytics job");
+        AnalyticsJobResult result;
+        result.job = job;
+        char summary[128];
+        if (job == ANALYTICS_JOB_DEGREE)
+        {
+            auto tStart = std::chrono::steady_clock::now();
+            result.histogram = degree_histogram(csr);
+            result.column = "Degree";
+            result.values = degrees(csr);
+            snprintf(summary, sizeof(summary), "Degrees in %.3f s", std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+        }
+        else if (job == ANALYTICS_JOB_PAGERANK)
+        {
+            PageRankParams params;
+            params.damping = damping;
+            PageRankResult ranks = pagerank(csr, params, progress);
+            result.column = "PageRank";
+            result.values = std::move(ranks.rank);
+            snprintf(summary, sizeof(summary), "PageRank: %u iterations, residual %.2e, %.2f s", ranks.iterations, ranks.residual, ranks.seconds);
+        }
+        else
+        {
+            BetweennessParams params;
+            params.samples = samples;
+            BetweennessResult sampled = betweenness(csr, params, progress);
+            result.column = "Betweenness";
+            result.values = std::move(sampled.centrality);
+            snprintf(summary, sizeof(summary), "Betweenness: %u sources, %.2f s", sampled.samples, sampled.seconds);
+        }
+        result.summary = summary;
+        if (progress->cancel)
+        {
+            result.column.clear();
+            result.values.clear();
+            result.summary = "Canceled";
+        }
+        return result;
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef GRAPH_ANALYTICS_HPP
+#define GRAPH_ANALYTICS_HPP
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Graph_CSR.hpp"
+
+// Node statistics over the CSR adjacency of an undirected graph, parallel with
+// OpenMP. PageRank pulls the rank of the neighbors of every node, so nodes are
+// written by one thread only and no atomics are needed. Betweenness runs
+// Brandes' algorithm from a sample of sources, one BFS per source on its
+// thread's workspace, and extrapolates to all sources. The long kernels
+// report their progress and can be canceled from another thread, e.g. the
+// render loop they run beside.
+//
+// Results go into attribute columns, one float per node, from which the
+// viewer picks the drivers of node color and scale.
+namespace graph::analytics
+{
+    enum AnalyticsJob
+    {
+        ANALYTICS_JOB_NONE,
+        // Degree histogram and degree column
+        ANALYTICS_JOB_DEGREE,
+        ANALYTICS_JOB_PAGERANK,
+        // Sampled Brandes, the slowest by far
+        ANALYTICS_JOB_BETWEENNESS
+    };
+
+    // Shared between a kernel and the thread waiting for it
+    struct Progress
+    {
+        // Done fraction in [0, 1]
+        std::atomic<float> fraction{0.f};
+        // Set to stop early, the result is then partial
+        std::atomic<bool> cancel{false};
+    };
+
+    struct DegreeHistogram
+    {
+        // counts[d] nodes of degree d
+        std::vector<uint64_t> counts;
+        uint32_t maxDegree = 0;
+        double meanDegree = 0.;
+    };
+
+    struct PageRankParams
+    {
+        double damping = .85;
+        uint32_t maxIterations = 100;
+        // Stops once the L1 change of the ranks falls below this
+        double tolerance = 1e-7;
+        // 0 uses all OpenMP threads
+        uint32_t threads = 0;
+    };
+
+    struct PageRankResult
+    {
+        // Sums to 1 over the nodes
+        std::vector<float> rank;
+        uint32_t iterations = 0;
+        double residual = 0.;
+        double seconds = 0.;
+    };
+
+    struct BetweennessParams
+    {
+        // Sources of the shortest paths, all nodes when the graph is not larger
+        uint32_t samples = 256;
+        uint64_t seed = 1;
+        uint32_t threads = 0;
+    };
+
+    struct BetweennessResult
+    {
+        // Estimated number of shortest paths through each node, over unordered pairs of other nodes
+        std::vector<float> centrality;
+        uint32_t samples = 0;
+        double seconds = 0.;
+    };
+
+    struct AttributeColumn
+    {
+        std::string name;
+        std::vector<float> values;
+        float min = 0.f;
+        float max = 0.f;
+    };
+
+    // Per-node attributes by name
+    struct AttributeTable
+    {
+        std::vector<AttributeColumn> columns;
+    };
+
+    DegreeHistogram degree_histogram(const CSRGraph& csr, uint32_t threads = 0);
+    std::vector<float> degrees(const CSRGraph& csr);
+    PageRankResult pagerank(const CSRGraph& csr, const PageRankParams& params = {}, Progress* progress = nullptr);
+    BetweennessResult betweenness(const CSRGraph& csr, const BetweennessParams& params = {}, Progress* progress = nullptr);
+
+    // Replace the column of that name or append it, returns its index
+    size_t set_column(AttributeTable& table, const std::string& name, std::vector<float> values);
+    // Index of the named column, or -1
+    int find_column(const AttributeTable& table, const std::string& name);
+    // Value of a node mapped to [0, 1] over the column's range, compressed logarithmically for heavy tailed columns
+    float normalized_value(const AttributeColumn& column, uint32_t node, bool logarithmic);
+    // Normalized value of every node quantized to N_bins, e.g. the colors of a palette
+    std::vector<uint8_t> column_bins(const AttributeColumn& column, uint32_t N_bins, bool logarithmic, uint32_t threads = 0);
+    // base[node] times a factor from minFactor at the column's smallest normalized value to maxFactor at its largest
+    std::vector<float> column_scales(const AttributeColumn& column, const std::vector<float>& base, float minFactor, float maxFactor, bool logarithmic,
+                                     uint32_t threads = 0);
+    // Opaque RGB of a bin of column_bins, from dark blue for the smallest values through teal and green to yellow
+    glm::vec4 ramp_color(uint32_t bin, uint32_t N_bins);
+
+    struct AnalyticsJobResult
+    {
+        AnalyticsJob job = ANALYTICS_JOB_NONE;
+        // Column written by the job, empty when it was canceled
+        std::string column;
+        std::vector<float> values;
+        DegreeHistogram histogram;
+        std::string summary;
+    };
+
+    // One job with a summary line for the UI, e.g. on a worker thread beside the render loop. progress must not be null
+    AnalyticsJobResult run_analytics_job(const CSRGraph& csr, AnalyticsJob job, double damping, uint32_t samples, Progress* progress);
+}
+
+#endif
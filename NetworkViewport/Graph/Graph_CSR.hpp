@@ -0,0 +1,89 @@
+#ifndef GRAPH_CSR_HPP
+#define GRAPH_CSR_HPP
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <igraph/igraph.h>
+
+// Compressed sparse row adjacency: the neighbors of node v are
+// neighbors[offsets[v] .. offsets[v + 1]), sorted ascending. Undirected edges
+// are stored in both directions. Arcs are bucketed by a counting sort in
+// O(n + m), sorting every adjacency list then makes the build O(n + m log d)
+// for maximum degree d.
+namespace graph
+{
+    struct CSRGraph
+    {
+        uint32_t N_nodes = 0;
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> neighbors;
+    };
+
+    inline uint32_t degree(const CSRGraph& csr, uint32_t node)
+    {
+        return static_cast<uint32_t>(csr.offsets[node + 1] - csr.offsets[node]);
+    }
+
+    // Stored arcs, twice the edge count for undirected graphs
+    inline uint64_t arc_count(const CSRGraph& csr)
+    {
+        return csr.neighbors.size();
+    }
+
+    inline CSRGraph build_csr(uint32_t N_nodes, const std::vector<std::pair<uint32_t, uint32_t>>& edges, bool directed = false)
+    {
+        CSRGraph csr;
+        csr.N_nodes = N_nodes;
+        csr.offsets.assign(N_nodes + 1, 0);
+        for (const auto& edge : edges)
+        {
+            csr.offsets[edge.first + 1]++;
+            if (!directed)
+            {
+                csr.offsets[edge.second + 1]++;
+            }
+        }
+        for (uint32_t node = 0; node < N_nodes; node++)
+        {
+            csr.offsets[node + 1] += csr.offsets[node];
+        }
+
+        csr.neighbors.resize(csr.offsets[N_nodes]);
+        std::vector<uint64_t> head(csr.offsets.begin(), csr.offsets.end() - 1);
+        for (const auto& edge : edges)
+        {
+            csr.neighbors[head[edge.first]++] = edge.second;
+            if (!directed)
+            {
+                csr.neighbors[head[edge.second]++] = edge.first;
+            }
+        }
+        for (uint32_t node = 0; node < N_nodes; node++)
+        {
+            std::sort(csr.neighbors.begin() + csr.offsets[node], csr.neighbors.begin() + csr.offsets[node + 1]);
+        }
+        return csr;
+    }
+
+    inline std::vector<std::pair<uint32_t, uint32_t>> get_edge_list(const igraph_t& graph)
+    {
+        igraph_vector_int_t edgeList;
+        igraph_vector_int_init(&edgeList, 0);
+        igraph_get_edgelist(&graph, &edgeList, 0);
+        std::vector<std::pair<uint32_t, uint32_t>> edges(igraph_ecount(&graph));
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            edges[i] = {static_cast<uint32_t>(VECTOR(edgeList)[2 * i]), static_cast<uint32_t>(VECTOR(edgeList)[2 * i + 1])};
+        }
+        igraph_vector_int_destroy(&edgeList);
+        return edges;
+    }
+
+    inline CSRGraph build_csr(const igraph_t& graph)
+    {
+        return build_csr(static_cast<uint32_t>(igraph_vcount(&graph)), get_edge_list(graph), igraph_is_directed(&graph));
+    }
+}
+
+#endif
@@ -0,0 +1,609 @@
+#include "Graph_Communities.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <omp.h>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace graph::community
+{
+    // Weighted graph of one level. Arcs are stored in both directions, self-loops are kept apart in loops
+    struct LevelGraph
+    {
+        uint32_t N_nodes = 0;
+        const uint64_t* offsets = nullptr;
+        const uint32_t* neighbors = nullptr;
+        // nullptr for unit weights
+        const uint64_t* weights = nullptr;
+        std::vector<uint64_t> loops;
+        // Weighted degree including the self-loops
+        std::vector<uint64_t> strength;
+        // Twice the edge weight
+        uint64_t totalWeight = 0;
+
+        // Backing of contracted levels
+        std::vector<uint64_t> offsetStorage;
+        std::vector<uint32_t> neighborStorage;
+        std::vector<uint64_t> weightStorage;
+    };
+
+    static constexpr uint32_t EMPTY_KEY = UINT32_MAX;
+    // Communities per block of the sum of squared totals, fixed so the sum does not depend on the thread count
+    static constexpr uint32_t SQUARE_SUM_BLOCK = 4096;
+    // A sweep moves the nodes in this many batches, each deciding on the assignment left by the previous one
+    static constexpr uint32_t MOVE_BATCHES = 16;
+
+    // Open addressing map from community to weight, cleared in O(entries)
+    struct WeightAccumulator
+    {
+        std::vector<uint32_t> keys;
+        std::vector<uint64_t> values;
+        // Filled slots in insertion order
+        std::vector<uint32_t> used;
+        uint32_t mask = 0;
+    };
+
+    static void reset_accumulator(WeightAccumulator& accumulator, uint64_t entries)
+    {
+        for (uint32_t slot : accumulator.used)
+        {
+            accumulator.keys[slot] = EMPTY_KEY;
+        }
+        accumulator.used.clear();
+        uint64_t capacity = 16;
+        while (capacity < 2 * entries)
+        {
+            capacity *= 2;
+        }
+        if (capacity > accumulator.keys.size())
+        {
+            accumulator.keys.assign(capacity, EMPTY_KEY);
+            accumulator.values.resize(capacity);
+        }
+        // Only the front of the table is probed, a hub seen earlier must not spread small nodes over all of it
+        accumulator.mask = static_cast<uint32_t>(capacity - 1);
+    }
+
+    static inline void accumulate(WeightAccumulator& accumulator, uint32_t key, uint64_t weight)
+    {
+        uint32_t slot = (key * 0x9e3779b1u) & accumulator.mask;
+        while (accumulator.keys[slot] != key)
+        {
+            if (accumulator.keys[slot] == EMPTY_KEY)
+            {
+                accumulator.keys[slot] = key;
+                accumulator.values[slot] = 0;
+                accumulator.used.push_back(slot);
+                break;
+            }
+            slot = (slot + 1) & accumulator.mask;
+        }
+        accumulator.values[slot] += weight;
+    }
+
+    static inline uint64_t arc_weight(const LevelGraph& level, uint64_t arc)
+    {
+        return level.weights ? level.weights[arc] : 1;
+    }
+
+    static int thread_count(uint32_t threads)
+    {
+        return threads > 0 ? static_cast<int>(threads) : std::max(1, omp_get_max_threads());
+    }
+
+    static void level_from_csr(const CSRGraph& csr, LevelGraph& level, int threadCount)
+    {
+        level.N_nodes = csr.N_nodes;
+        level.offsets = csr.offsets.data();
+        level.neighbors = csr.neighbors.data();
+        level.weights = nullptr;
+        level.loops.assign(csr.N_nodes, 0);
+        level.strength.resize(csr.N_nodes);
+        level.totalWeight = arc_count(csr);
+        const int64_t N_nodes = csr.N_nodes;
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            uint64_t loops = 0;
+            for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+            {
+                loops += csr.neighbors[arc] == node ? 1 : 0;
+            }
+            level.loops[node] = loops;
+            level.strength[node] = csr.offsets[node + 1] - csr.offsets[node];
+        }
+    }
+
+    static void community_totals(const LevelGraph& level, const std::vector<uint32_t>& community, uint32_t N_communities,
+                                 std::vector<uint64_t>& totals, int threadCount)
+    {
+        totals.assign(N_communities, 0);
+        const int64_t N_nodes = level.N_nodes;
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            uint32_t c = community[node];
+#pragma omp atomic
+            totals[c] += level.strength[node];
+        }
+    }
+
+    static double level_modularity(const LevelGraph& level, const std::vector<uint32_t>& community, const std::vector<uint64_t>& totals,
+                                   double resolution, int threadCount)
+    {
+        if (level.totalWeight == 0)
+        {
+            return 0.;
+        }
+        uint64_t internal = 0;
+        const int64_t N_nodes = level.N_nodes;
+#pragma omp parallel for schedule(dynamic, 4096) reduction(+ : internal) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            uint64_t weight = level.loops[node];
+            uint32_t c = community[node];
+            for (uint64_t arc = level.offsets[node]; arc < level.offsets[node + 1]; arc++)
+            {
+                uint32_t neighbor = level.neighbors[arc];
+                if (neighbor != node && community[neighbor] == c)
+                {
+                    weight += arc_weight(level, arc);
+                }
+            }
+            internal += weight;
+        }
+
+        const int64_t blocks = (static_cast<int64_t>(totals.size()) + SQUARE_SUM_BLOCK - 1) / SQUARE_SUM_BLOCK;
+        std::vector<double> blockSums(blocks, 0.);
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t block = 0; block < blocks; block++)
+        {
+            size_t end = std::min<size_t>((block + 1) * SQUARE_SUM_BLOCK, totals.size());
+            double sum = 0.;
+            for (size_t c = block * SQUARE_SUM_BLOCK; c < end; c++)
+            {
+                double total = static_cast<double>(totals[c]);
+                sum += total * total;
+            }
+            blockSums[block] = sum;
+        }
+        double squares = 0.;
+        for (double sum : blockSums)
+        {
+            squares += sum;
+        }
+        double totalWeight = static_cast<double>(level.totalWeight);
+        return internal / totalWeight - resolution * squares / (totalWeight * totalWeight);
+    }
+
+    // Integer avalanche hash (lowbias32), scatters the nodes over the move batches
+    static inline uint32_t node_hash(uint32_t node)
+    {
+        node ^= node >> 16;
+        node *= 0x7feb352du;
+        node ^= node >> 15;
+        node *= 0x846ca68bu;
+        node ^= node >> 16;
+        return node;
+    }
+
+    // Nodes grouped by batch, in id order inside a batch
+    static void move_batches(const LevelGraph& level, std::vector<uint64_t>& batchOffsets, std::vector<uint32_t>& batchNodes)
+    {
+        batchOffsets.assign(MOVE_BATCHES + 1, 0);
+        for (uint32_t node = 0; node < level.N_nodes; node++)
+        {
+            batchOffsets[node_hash(node) % MOVE_BATCHES + 1]++;
+        }
+        std::partial_sum(batchOffsets.begin(), batchOffsets.end(), batchOffsets.begin());
+        batchNodes.resize(level.N_nodes);
+        std::vector<uint64_t> head(batchOffsets.begin(), batchOffsets.end() - 1);
+        for (uint32_t node = 0; node < level.N_nodes; node++)
+        {
+            batchNodes[head[node_hash(node) % MOVE_BATCHES]++] = node;
+        }
+    }
+
+    // Local moving phase of one level, community starts as singletons and ends with the best assignment found
+    static double move_nodes(const LevelGraph& level, std::vector<uint32_t>& community, const LouvainParams& params,
+                             std::vector<WeightAccumulator>& accumulators, int threadCount, uint32_t& sweeps, bool& moved)
+    {
+        NV_TRACE_ZONE("Louvain moves");
+        community.resize(level.N_nodes);
+        std::iota(community.begin(), community.end(), 0u);
+        std::vector<uint64_t> totals(level.strength);
+        double quality = level_modularity(level, community, totals, params.resolution, threadCount);
+        moved = false;
+        if (level.totalWeight == 0)
+        {
+            return quality;
+        }
+        const double totalWeight = static_cast<double>(level.totalWeight);
+        std::vector<uint64_t> batchOffsets;
+        std::vector<uint32_t> batchNodes;
+        move_batches(level, batchOffsets, batchNodes);
+        std::vector<uint32_t> target(level.N_nodes);
+        std::vector<uint32_t> nextCommunity;
+        std::vector<uint64_t> nextTotals;
+
+        for (uint32_t sweep = 0; sweep < params.maxSweeps; sweep++)
+        {
+            nextCommunity = community;
+            nextTotals = totals;
+            uint64_t moves = 0;
+            for (size_t batch = 0; batch + 1 < batchOffsets.size(); batch++)
+            {
+                const int64_t batchBegin = batchOffsets[batch];
+                const int64_t batchEnd = batchOffsets[batch + 1];
+                // Small batches are not worth waking the threads
+                const bool parallel = batchEnd - batchBegin >= 1024;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+ : moves) num_threads(threadCount) if (parallel)
+                for (int64_t i = batchBegin; i < batchEnd; i++)
+                {
+                    uint32_t node = batchNodes[i];
+                    WeightAccumulator& accumulator = accumulators[omp_get_thread_num()];
+                    uint64_t arcBegin = level.offsets[node];
+                    uint64_t arcEnd = level.offsets[node + 1];
+                    uint32_t own = nextCommunity[node];
+                    reset_accumulator(accumulator, arcEnd - arcBegin + 1);
+                    // The own community is a candidate even without neighbors in it
+                    accumulate(accumulator, own, 0);
+                    for (uint64_t arc = arcBegin; arc < arcEnd; arc++)
+                    {
+                        uint32_t neighbor = level.neighbors[arc];
+                        if (neighbor != node)
+                        {
+                            accumulate(accumulator, nextCommunity[neighbor], arc_weight(level, arc));
+                        }
+                    }
+
+                    // Gain of joining c up to a common term: k_i,c - resolution * k_i * tot_c / 2m, without node in tot_c
+                    uint64_t strength = level.strength[node];
+                    double scale = params.resolution * strength / totalWeight;
+                    double stayGain = 0.;
+                    double bestGain = 0.;
+                    uint32_t best = EMPTY_KEY;
+                    for (uint32_t slot : accumulator.used)
+                    {
+                        uint32_t c = accumulator.keys[slot];
+                        double weight = static_cast<double>(accumulator.values[slot]);
+                        if (c == own)
+                        {
+                            stayGain = weight - scale * static_cast<double>(nextTotals[own] - strength);
+                            continue;
+                        }
+                        double gain = weight - scale * static_cast<double>(nextTotals[c]);
+                        if (best == EMPTY_KEY || gain > bestGain || (gain == bestGain && c < best))
+                        {
+                            best = c;
+                            bestGain = gain;
+                        }
+                    }
+                    target[node] = best != EMPTY_KEY && bestGain > stayGain ? best : own;
+                    moves += target[node] != own ? 1 : 0;
+                }
+                // Moves of a batch are applied together, every node of the batch decided on the same assignment
+#pragma omp parallel for schedule(static) num_threads(threadCount) if (parallel)
+                for (int64_t i = batchBegin; i < batchEnd; i++)
+                {
+                    uint32_t node = batchNodes[i];
+                    uint32_t own = nextCommunity[node];
+                    if (target[node] == own)
+                    {
+                        continue;
+                    }
+                    uint64_t strength = level.strength[node];
+                    nextCommunity[node] = target[node];
+#pragma omp atomic
+                    nextTotals[own] -= strength;
+#pragma omp atomic
+                    nextTotals[target[node]] += strength;
+                }
+            }
+            if (moves == 0)
+            {
+                break;
+            }
+            sweeps++;
+
+            // Neighbors deciding in the same batch can move past each other, a sweep that loses modularity is dropped
+            double nextQuality = level_modularity(level, nextCommunity, nextTotals, params.resolution, threadCount);
+            if (nextQuality <= quality)
+            {
+                break;
+            }
+            community.swap(nextCommunity);
+            totals.swap(nextTotals);
+            moved = true;
+            bool converged = nextQuality - quality < params.minGain;
+            quality = nextQuality;
+            if (converged)
+            {
+                break;
+            }
+        }
+        return quality;
+    }
+
+    // Number the used communities densely in order of their old ids, returns the count
+    static uint32_t renumber(std::vector<uint32_t>& community, uint32_t idCount, int threadCount)
+    {
+        std::vector<uint32_t> ids(idCount, EMPTY_KEY);
+        for (uint32_t c : community)
+        {
+            ids[c] = 0;
+        }
+        uint32_t N_communities = 0;
+        for (uint32_t& id : ids)
+        {
+            if (id != EMPTY_KEY)
+            {
+                id = N_communities++;
+            }
+        }
+        const int64_t N_nodes = community.size();
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N_nodes; node++)
+        {
+            community[node] = ids[community[node]];
+        }
+        return N_communities;
+    }
+
+    // One node per community, arcs between communities summed, arcs inside a community become its self-loops
+    static void contract(const LevelGraph& level, const std::vector<uint32_t>& community, uint32_t N_communities,
+                         std::vector<WeightAccumulator>& accumulators, int threadCount, LevelGraph& coarse)
+    {
+        NV_TRACE_ZONE("Louvain contraction");
+        // Members of every community, counting sort by community
+        std::vector<uint64_t> memberOffsets(N_communities + 1, 0);
+        for (uint32_t c : community)
+        {
+            memberOffsets[c + 1]++;
+        }
+        std::partial_sum(memberOffsets.begin(), memberOffsets.end(), memberOffsets.begin());
+        std::vector<uint32_t> members(level.N_nodes);
+        {
+            std::vector<uint64_t> head(memberOffsets.begin(), memberOffsets.end() - 1);
+            for (uint32_t node = 0; node < level.N_nodes; node++)
+            {
+                members[head[community[node]]++] = node;
+            }
+        }
+
+        coarse.N_nodes = N_communities;
+        coarse.loops.assign(N_communities, 0);
+        coarse.strength.assign(N_communities, 0);
+        coarse.totalWeight = level.totalWeight;
+        coarse.offsetStorage.assign(N_communities + 1, 0);
+        const int64_t communities = N_communities;
+
+        // First pass counts the distinct neighboring communities, the second writes them in the same order
+        for (int pass = 0; pass < 2; pass++)
+        {
+#pragma omp parallel for schedule(dynamic, 64) num_threads(threadCount)
+            for (int64_t c = 0; c < communities; c++)
+            {
+                WeightAccumulator& accumulator = accumulators[omp_get_thread_num()];
+                uint64_t arcs = 0;
+                for (uint64_t member = memberOffsets[c]; member < memberOffsets[c + 1]; member++)
+                {
+                    uint32_t node = members[member];
+                    arcs += level.offsets[node + 1] - level.offsets[node];
+                }
+                reset_accumulator(accumulator, std::min<uint64_t>(arcs, N_communities));
+                uint64_t loops = 0;
+                for (uint64_t member = memberOffsets[c]; member < memberOffsets[c + 1]; member++)
+                {
+                    uint32_t node = members[member];
+                    loops += level.loops[node];
+                    for (uint64_t arc = level.offsets[node]; arc < level.offsets[node + 1]; arc++)
+                    {
+                        uint32_t neighbor = level.neighbors[arc];
+                        if (neighbor == node)
+                        {
+                            continue;
+                        }
+                        uint32_t target = community[neighbor];
+                        if (target == c)
+                        {
+                            loops += arc_weight(level, arc);
+                        }
+                        else
+                        {
+                            accumulate(accumulator, target, arc_weight(level, arc));
+                        }
+                    }
+                }
+                if (pass == 0)
+                {
+                    coarse.offsetStorage[c + 1] = accumulator.used.size();
+                    coarse.loops[c] = loops;
+                    continue;
+                }
+                uint64_t strength = loops;
+                uint64_t arc = coarse.offsetStorage[c];
+                for (uint32_t slot : accumulator.used)
+                {
+                    coarse.neighborStorage[arc] = accumulator.keys[slot];
+                    coarse.weightStorage[arc] = accumulator.values[slot];
+                    strength += accumulator.values[slot];
+                    arc++;
+                }
+                coarse.strength[c] = strength;
+            }
+            if (pass == 0)
+            {
+                std::partial_sum(coarse.offsetStorage.begin(), coarse.offsetStorage.end(), coarse.offsetStorage.begin());
+                coarse.neighborStorage.resize(coarse.offsetStorage.back());
+                coarse.weightStorage.resize(coarse.offsetStorage.back());
+            }
+        }
+        coarse.offsets = coarse.offsetStorage.data();
+        coarse.neighbors = coarse.neighborStorage.data();
+        coarse.weights = coarse.weightStorage.data();
+    }
+
+    LouvainResult louvain(const CSRGraph& csr, const LouvainParams& params)
+    {
+        NV_TRACE_ZONE("Louvain");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(params.threads);
+        std::vector<WeightAccumulator> accumulators(threadCount);
+
+        LouvainResult result;
+        result.community.resize(csr.N_nodes);
+        std::iota(result.community.begin(), result.community.end(), 0u);
+        result.N_communities = csr.N_nodes;
+
+        LevelGraph level;
+        LevelGraph coarse;
+        level_from_csr(csr, level, threadCount);
+        std::vector<uint32_t> community;
+        for (uint32_t levelIndex = 0; levelIndex < params.maxLevels && level.N_nodes > 0; levelIndex++)
+        {
+            bool moved = false;
+            double quality = move_nodes(level, community, params, accumulators, threadCount, result.sweeps, moved);
+            if (levelIndex == 0 || moved)
+            {
+                result.modularity = quality;
+            }
+            if (!moved)
+            {
+                break;
+            }
+            uint32_t N_communities = renumber(community, level.N_nodes, threadCount);
+            const int64_t N_nodes = csr.N_nodes;
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+            for (int64_t node = 0; node < N_nodes; node++)
+            {
+                result.community[node] = community[result.community[node]];
+            }
+            result.N_communities = N_communities;
+            result.levels++;
+            if (N_communities == level.N_nodes)
+            {
+                break;
+            }
+            contract(level, community, N_communities, accumulators, threadCount, coarse);
+            std::swap(level, coarse);
+        }
+
+        // Largest community first, ties by the first member
+        std::vector<uint64_t> sizes(result.N_communities, 0);
+        for (uint32_t c : result.community)
+        {
+            sizes[c]++;
+        }
+        std::vector<uint32_t> order(result.N_communities);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                         { return sizes[a] > sizes[b]; });
+        std::vector<uint32_t> rank(result.N_communities);
+        for (uint32_t i = 0; i < result.N_communities; i++)
+        {
+            rank[order[i]] = i;
+        }
+        for (uint32_t& c : result.community)
+        {
+            c = rank[c];
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    double modularity(const CSRGraph& csr, const std::vector<uint32_t>& community, double resolution)
+    {
+        int threadCount = thread_count(0);
+        LevelGraph level;
+        level_from_csr(csr, level, threadCount);
+        uint32_t N_communities = community.empty() ? 0 : *std::max_element(community.begin(), community.end()) + 1;
+        std::vector<uint64_t> totals;
+        community_totals(level, community, N_communities, totals, threadCount);
+        return level_modularity(level, community, totals, resolution, threadCount);
+    }
+
+    std::vector<uint8_t> color_communities(const CSRGraph& csr, const std::vector<uint32_t>& community, uint32_t N_communities, uint32_t N_colors)
+    {
+        NV_TRACE_ZONE("Color communities");
+        N_colors = std::clamp<uint32_t>(N_colors, 1, 256);
+        int threadCount = thread_count(0);
+        std::vector<WeightAccumulator> accumulators(threadCount);
+        LevelGraph level;
+        LevelGraph communities;
+        level_from_csr(csr, level, threadCount);
+        contract(level, community, N_communities, accumulators, threadCount, communities);
+
+        std::vector<uint8_t> colors(N_communities, 0);
+        std::vector<uint64_t> colorUses(N_colors, 0);
+        std::vector<uint64_t> conflict(N_colors);
+        for (uint32_t c = 0; c < N_communities; c++)
+        {
+            std::fill(conflict.begin(), conflict.end(), 0);
+            for (uint64_t arc = communities.offsets[c]; arc < communities.offsets[c + 1]; arc++)
+            {
+                uint32_t neighbor = communities.neighbors[arc];
+                if (neighbor < c)
+                {
+                    conflict[colors[neighbor]] += communities.weights[arc];
+                }
+            }
+            // Least shared weight, then the least used color
+            uint32_t best = 0;
+            for (uint32_t color = 1; color < N_colors; color++)
+            {
+                if (conflict[color] < conflict[best] || (conflict[color] == conflict[best] && colorUses[color] < colorUses[best]))
+                {
+                    best = color;
+                }
+            }
+            colors[c] = static_cast<uint8_t>(best);
+            colorUses[best]++;
+        }
+        return colors;
+    }
+
+    glm::vec4 community_color(uint32_t color, uint32_t N_colors)
+    {
+        float hue = 6.f * color / std::max(N_colors, 1u);
+        float value = color % 2 == 0 ? 1.f : .7f;
+        float saturation = .75f;
+        float fraction = hue - std::floor(hue);
+        float p = value * (1.f - saturation);
+        float q = value * (1.f - saturation * fraction);
+        float t = value * (1.f - saturation * (1.f - fraction));
+        switch (static_cast<int>(hue) % 6)
+        {
+        case 0:
+            return {value, t, p, 1.f};
+        case 1:
+            return {q, value, p, 1.f};
+        case 2:
+            return {p, value, t, 1.f};
+        case 3:
+            return {p, q, value, 1.f};
+        case 4:
+            return {t, p, value, 1.f};
+        default:
+            return {value, p, q, 1.f};
+        }
+    }
+
+    CommunityDetection detect_communities(const CSRGraph& csr, double resolution, uint32_t N_colors)
+    {
+        NV_TRACE_ZONE("Detect communities");
+        CommunityDetection detection;
+        LouvainParams params;
+        params.resolution = resolution;
+        detection.result = louvain(csr, params);
+        const std::vector<uint32_t>& community = detection.result.community;
+        std::vector<uint8_t> colors = color_communities(csr, community, detection.result.N_communities, N_colors);
+        detection.categories.resize(csr.N_nodes);
+        for (uint32_t node = 0; node < csr.N_nodes; node++)
+        {
+            detection.categories[node] = colors[community[node]];
+        }
+        return detection;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef GRAPH_COMMUNITIES_HPP
+#define GRAPH_COMMUNITIES_HPP
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Graph_CSR.hpp"
+
+// Community detection by parallel Louvain modularity optimization on the CSR
+// adjacency. Every level moves nodes to the neighboring community of largest
+// modularity gain until the gain stalls, then contracts each community into
+// one weighted node and starts over on the smaller graph.
+//
+// A sweep visits the nodes in a fixed number of hashed batches. Every node of
+// a batch picks its target from the assignment left by the previous batch,
+// using a thread-local accumulator of its weight to each neighboring
+// community, and the moves of the batch are then applied with atomic updates
+// of the community totals, so no node or community is ever locked. A sweep
+// that lowers the modularity, e.g. because neighbors in one batch moved past
+// each other, is undone. Edge weights are integers and the batches do not
+// depend on the threads, so the result is the same on any thread count.
+namespace graph::community
+{
+    struct LouvainParams
+    {
+        // Above 1 favors more and smaller communities
+        double resolution = 1.;
+        uint32_t maxLevels = 32;
+        uint32_t maxSweeps = 32;
+        // A level ends once a sweep gains less modularity than this
+        double minGain = 1e-4;
+        // 0 uses all OpenMP threads
+        uint32_t threads = 0;
+    };
+
+    struct LouvainResult
+    {
+        // Community of every node, communities are numbered by decreasing size
+        std::vector<uint32_t> community;
+        uint32_t N_communities = 0;
+        double modularity = 0.;
+        uint32_t levels = 0;
+        uint32_t sweeps = 0;
+        double seconds = 0.;
+    };
+
+    LouvainResult louvain(const CSRGraph& csr, const LouvainParams& params = {});
+
+    // Modularity of a partition at the given resolution, self-loops count as internal
+    double modularity(const CSRGraph& csr, const std::vector<uint32_t>& community, double resolution = 1.);
+
+    // One of N_colors colors per community, chosen greedily in id order, i.e. from the largest community of a louvain
+    // result down, to share as little edge weight as possible with the already colored neighboring communities
+    std::vector<uint8_t> color_communities(const CSRGraph& csr, const std::vector<uint32_t>& community, uint32_t N_communities, uint32_t N_colors);
+
+    // Opaque RGB of a color index of color_communities, hues spread evenly with alternating brightness
+    glm::vec4 community_color(uint32_t color, uint32_t N_colors);
+
+    struct CommunityDetection
+    {
+        LouvainResult result;
+        // Color of every node, its community's of color_communities
+        std::vector<uint8_t> categories;
+    };
+
+    // Louvain at the given resolution and the color of every node, e.g. on a worker thread beside the render loop
+    CommunityDetection detect_communities(const CSRGraph& csr, double resolution, uint32_t N_colors);
+}
+
+#endif
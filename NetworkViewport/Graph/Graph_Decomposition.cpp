@@ -0,0 +1,279 @@
+#include "Graph_Decomposition.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <omp.h>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace graph::decomposition
+{
+    // Core number of a node still in the graph, and level of a node not moved to a bucket yet
+    static constexpr uint32_t UNSET = UINT32_MAX;
+
+    static int thread_count(uint32_t threads)
+    {
+        return threads > 0 ? static_cast<int>(threads) : std::max(1, omp_get_max_threads());
+    }
+
+    CoreDecomposition core_decomposition(const CSRGraph& csr, uint32_t threads)
+    {
+        NV_TRACE_ZONE("Core decomposition");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(threads);
+        CoreDecomposition result;
+        const uint32_t N_nodes = csr.N_nodes;
+        if (N_nodes == 0)
+        {
+            return result;
+        }
+
+        // Degree among the nodes not peeled yet
+        std::unique_ptr<std::atomic<uint32_t>[]> remainingDegree(new std::atomic<uint32_t>[N_nodes]);
+        std::unique_ptr<std::atomic<uint32_t>[]> core(new std::atomic<uint32_t>[N_nodes]);
+        // Level in which a node was last queued for another bucket, so it is queued once per level
+        std::unique_ptr<std::atomic<uint32_t>[]> queuedAt(new std::atomic<uint32_t>[N_nodes]);
+        const int64_t N = N_nodes;
+        uint32_t maxDegree = 0;
+#pragma omp parallel for schedule(static) reduction(max : maxDegree) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            uint32_t nodeDegree = degree(csr, static_cast<uint32_t>(node));
+            remainingDegree[node].store(nodeDegree, std::memory_order_relaxed);
+            core[node].store(UNSET, std::memory_order_relaxed);
+            queuedAt[node].store(UNSET, std::memory_order_relaxed);
+            maxDegree = std::max(maxDegree, nodeDegree);
+        }
+        std::vector<std::vector<uint32_t>> buckets(static_cast<size_t>(maxDegree) + 1);
+        for (uint32_t node = 0; node < N_nodes; node++)
+        {
+            buckets[degree(csr, node)].push_back(node);
+        }
+
+        std::vector<std::vector<uint32_t>> nextRounds(threadCount);
+        std::vector<std::vector<uint32_t>> queued(threadCount);
+        std::vector<uint32_t> frontier;
+        uint64_t peeled = 0;
+        for (uint32_t k = 0; k <= maxDegree && peeled < N_nodes; k++)
+        {
+            // Entries of nodes peeled meanwhile or queued on to a lower bucket are stale
+            frontier.clear();
+            for (uint32_t node : buckets[k])
+            {
+                if (core[node].load(std::memory_order_relaxed) == UNSET && remainingDegree[node].load(std::memory_order_relaxed) == k)
+                {
+                    core[node].store(k, std::memory_order_relaxed);
+                    frontier.push_back(node);
+                }
+            }
+            std::vector<uint32_t>().swap(buckets[k]);
+
+            while (!frontier.empty())
+            {
+                peeled += frontier.size();
+                const int64_t N_frontier = frontier.size();
+                // Cleared here, OpenMP may run fewer threads than asked for and leave some lists untouched
+                for (std::vector<uint32_t>& nextRound : nextRounds)
+                {
+                    nextRound.clear();
+                }
+#pragma omp parallel num_threads(threadCount)
+                {
+                    std::vector<uint32_t>& nextRound = nextRounds[omp_get_thread_num()];
+                    std::vector<uint32_t>& moved = queued[omp_get_thread_num()];
+#pragma omp for schedule(dynamic, 64)
+                    for (int64_t i = 0; i < N_frontier; i++)
+                    {
+                        uint32_t node = frontier[i];
+                        for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+                        {
+                            uint32_t neighbor = csr.neighbors[arc];
+                            if (core[neighbor].load(std::memory_order_relaxed) != UNSET)
+                            {
+                                continue;
+                            }
+                            // Exactly one decrement reaches k, the ones racing past it find the node peeled
+                            uint32_t neighborDegree = remainingDegree[neighbor].fetch_sub(1, std::memory_order_relaxed) - 1;
+                            if (neighborDegree == k)
+                            {
+                                core[neighbor].store(k, std::memory_order_relaxed);
+                                nextRound.push_back(neighbor);
+                            }
+                            else if (neighborDegree > k && neighborDegree != UNSET && queuedAt[neighbor].exchange(k, std::memory_order_relaxed) != k)
+                            {
+                                moved.push_back(neighbor);
+                            }
+                        }
+                    }
+                }
+                frontier.clear();
+                for (const std::vector<uint32_t>& nextRound : nextRounds)
+                {
+                    frontier.insert(frontier.end(), nextRound.begin(), nextRound.end());
+                }
+            }
+
+            // Every node left has more than k neighbors left, the lowered ones wait in the bucket of their degree now
+            for (std::vector<uint32_t>& moved : queued)
+            {
+                for (uint32_t node : moved)
+                {
+                    if (core[node].load(std::memory_order_relaxed) == UNSET)
+                    {
+                        buckets[remainingDegree[node].load(std::memory_order_relaxed)].push_back(node);
+                    }
+                }
+                moved.clear();
+            }
+        }
+
+        result.core.resize(N_nodes);
+        uint32_t maxCore = 0;
+#pragma omp parallel for schedule(static) reduction(max : maxCore) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            result.core[node] = core[node].load(std::memory_order_relaxed);
+            maxCore = std::max(maxCore, result.core[node]);
+        }
+        result.maxCore = maxCore;
+        result.coreSizes.assign(static_cast<size_t>(result.maxCore) + 1, 0);
+        for (uint32_t nodeCore : result.core)
+        {
+            result.coreSizes[nodeCore]++;
+        }
+        for (uint32_t k = result.maxCore; k > 0; k--)
+        {
+            result.coreSizes[k - 1] += result.coreSizes[k];
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    // Root of a node, every visited node is relinked to its grandparent on the way
+    static uint32_t find_root(std::atomic<uint32_t>* parent, uint32_t node)
+    {
+        while (true)
+        {
+            uint32_t up = parent[node].load(std::memory_order_relaxed);
+            if (up == node)
+            {
+                return node;
+            }
+            uint32_t grandparent = parent[up].load(std::memory_order_relaxed);
+            if (grandparent != up)
+            {
+                // Losing the race to another relink is harmless, both point to an ancestor
+                parent[node].compare_exchange_weak(up, grandparent, std::memory_order_relaxed);
+            }
+            node = grandparent;
+        }
+    }
+
+    static void unite(std::atomic<uint32_t>* parent, uint32_t a, uint32_t b)
+    {
+        while (true)
+        {
+            a = find_root(parent, a);
+            b = find_root(parent, b);
+            if (a == b)
+            {
+                return;
+            }
+            if (a < b)
+            {
+                std::swap(a, b);
+            }
+            // Fails if a gained a parent meanwhile, then both roots are looked up again
+            uint32_t expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+            {
+                return;
+            }
+        }
+    }
+
+    ComponentDecomposition connected_components(const CSRGraph& csr, uint32_t threads)
+    {
+        NV_TRACE_ZONE("Connected components");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(threads);
+        ComponentDecomposition result;
+        const uint32_t N_nodes = csr.N_nodes;
+        if (N_nodes == 0)
+        {
+            return result;
+        }
+
+        std::unique_ptr<std::atomic<uint32_t>[]> parent(new std::atomic<uint32_t>[N_nodes]);
+        const int64_t N = N_nodes;
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            parent[node].store(static_cast<uint32_t>(node), std::memory_order_relaxed);
+        }
+        // Every undirected edge once, from its larger end
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+            {
+                uint32_t neighbor = csr.neighbors[arc];
+                if (neighbor < node)
+                {
+                    unite(parent.get(), static_cast<uint32_t>(node), neighbor);
+                }
+            }
+        }
+
+        // Roots are the smallest node of their component
+        result.component.resize(N_nodes);
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            result.component[node] = find_root(parent.get(), static_cast<uint32_t>(node));
+        }
+        std::vector<uint32_t> rootIndex(N_nodes, UNSET);
+        std::vector<uint64_t> rootSizes;
+        for (uint32_t node = 0; node < N_nodes; node++)
+        {
+            uint32_t root = result.component[node];
+            if (rootIndex[root] == UNSET)
+            {
+                rootIndex[root] = static_cast<uint32_t>(rootSizes.size());
+                rootSizes.push_back(0);
+            }
+            rootSizes[rootIndex[root]]++;
+        }
+
+        // Largest component first, ties by the smallest member
+        result.N_components = static_cast<uint32_t>(rootSizes.size());
+        std::vector<uint32_t> order(result.N_components);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                         { return rootSizes[a] > rootSizes[b]; });
+        std::vector<uint32_t> rank(result.N_components);
+        result.sizes.resize(result.N_components);
+        for (uint32_t i = 0; i < result.N_components; i++)
+        {
+            rank[order[i]] = i;
+            result.sizes[i] = rootSizes[order[i]];
+        }
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+        for (int64_t node = 0; node < N; node++)
+        {
+            result.component[node] = rank[rootIndex[result.component[node]]];
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    GraphDecomposition decompose_graph(const CSRGraph& csr, uint32_t threads)
+    {
+        NV_TRACE_ZONE("Decompose graph");
+        GraphDecomposition decomposition;
+        decomposition.cores = core_decomposition(csr, threads);
+        decomposition.components = connected_components(csr, threads);
+        return decomposition;
+    }
+}
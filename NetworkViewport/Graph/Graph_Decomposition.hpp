@@ -0,0 +1,55 @@
+#ifndef GRAPH_DECOMPOSITION_HPP
+#define GRAPH_DECOMPOSITION_HPP
+#include <cstdint>
+#include <vector>
+#include "Graph_CSR.hpp"
+
+// Core numbers and connected components on the CSR adjacency of an undirected
+// graph, parallel with OpenMP, for filtering large graphs down to their dense
+// center or their giant component.
+//
+// The k-core peeling keeps the remaining nodes in buckets by degree. Level k
+// removes the nodes of bucket k in rounds, every round decrements the degree
+// of the neighbors of the removed nodes atomically, and a neighbor that drops
+// to k joins the next round. Neighbors that stay above k are moved to the
+// bucket of their new degree once per level, so no level scans all nodes.
+//
+// Components are found by union-find on atomic parent links. Roots are only
+// ever linked below smaller roots, so concurrent unions cannot form cycles,
+// and finds halve the paths they walk.
+namespace graph::decomposition
+{
+    struct CoreDecomposition
+    {
+        // Largest k of a k-core containing the node, self-loops count toward the degree
+        std::vector<uint32_t> core;
+        uint32_t maxCore = 0;
+        // coreSizes[k] nodes of the k-core, i.e. of core number k or above
+        std::vector<uint64_t> coreSizes;
+        double seconds = 0.;
+    };
+
+    struct ComponentDecomposition
+    {
+        // Component of every node, components are numbered by decreasing size so 0 is the giant component
+        std::vector<uint32_t> component;
+        std::vector<uint64_t> sizes;
+        uint32_t N_components = 0;
+        double seconds = 0.;
+    };
+
+    // 0 threads uses all OpenMP threads
+    CoreDecomposition core_decomposition(const CSRGraph& csr, uint32_t threads = 0);
+    ComponentDecomposition connected_components(const CSRGraph& csr, uint32_t threads = 0);
+
+    struct GraphDecomposition
+    {
+        CoreDecomposition cores;
+        ComponentDecomposition components;
+    };
+
+    // Both decompositions, e.g. on a worker thread beside the render loop
+    GraphDecomposition decompose_graph(const CSRGraph& csr, uint32_t threads = 0);
+}
+
+#endif
@@ -1,9 +1,111 @@
 #ifndef GRAPH_GENERATION_HPP
 #define GRAPH_GENERATION_HPP
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <igraph/igraph.h>
+#include <igraph/igraph_games.h>
+#include <igraph/igraph_constructors.h>
 
+// Random graph families parameterized by node count and average degree, so
+// different families of the same size have about the same number of edges.
 namespace graph::generate
 {
+    enum GraphFamily
+    {
+        GRAPH_FAMILY_ERDOS_RENYI,
+        GRAPH_FAMILY_BARABASI_ALBERT,
+        GRAPH_FAMILY_WATTS_STROGATZ,
+        GRAPH_FAMILY_LATTICE
+    };
 
+    inline const char* family_name(GraphFamily family)
+    {
+        switch (family)
+        {
+        case GRAPH_FAMILY_ERDOS_RENYI:
+            return "erdos_renyi";
+        case GRAPH_FAMILY_BARABASI_ALBERT:
+            return "barabasi_albert";
+        case GRAPH_FAMILY_WATTS_STROGATZ:
+            return "watts_strogatz";
+        case GRAPH_FAMILY_LATTICE:
+            return "lattice";
+        }
+        return "unknown";
+    }
+
+    // Accepts the full names and er, ba, ws and lattice
+    inline bool parse_family(const std::string& name, GraphFamily& family)
+    {
+        if (name == "er" || name == "erdos_renyi")
+            family = GRAPH_FAMILY_ERDOS_RENYI;
+        else if (name == "ba" || name == "barabasi_albert")
+            family = GRAPH_FAMILY_BARABASI_ALBERT;
+        else if (name == "ws" || name == "watts_strogatz")
+            family = GRAPH_FAMILY_WATTS_STROGATZ;
+        else if (name == "lattice")
+            family = GRAPH_FAMILY_LATTICE;
+        else
+            return false;
+        return true;
+    }
+
+    // G(n, m) with m = n * degree / 2
+    inline void erdos_renyi(igraph_t* graph, size_t N_nodes, double degree)
+    {
+        igraph_integer_t N_edges = static_cast<igraph_integer_t>(N_nodes * degree / 2);
+        igraph_erdos_renyi_game_gnm(graph, N_nodes, N_edges, IGRAPH_UNDIRECTED, 0);
+    }
+
+    // Linear preferential attachment, every new node attaches degree / 2 edges
+    inline void barabasi_albert(igraph_t* graph, size_t N_nodes, double degree)
+    {
+        igraph_integer_t m = std::max<igraph_integer_t>(1, static_cast<igraph_integer_t>(degree / 2));
+        igraph_barabasi_game(graph, N_nodes, 1., m, nullptr, 1, 1., 0, IGRAPH_BARABASI_PSUMTREE, nullptr);
+    }
+
+    // Ring lattice with degree / 2 neighbors on each side, edges rewired with probability p
+    inline void watts_strogatz(igraph_t* graph, size_t N_nodes, double degree, double p = .1)
+    {
+        igraph_integer_t neighborhood = std::max<igraph_integer_t>(1, static_cast<igraph_integer_t>(degree / 2));
+        igraph_watts_strogatz_game(graph, 1, N_nodes, neighborhood, p, 0, 0);
+    }
+
+    // Square 2D grid of about N_nodes nodes, the degree is fixed at 4
+    inline void lattice(igraph_t* graph, size_t N_nodes)
+    {
+        igraph_integer_t side = 1;
+        while (static_cast<size_t>((side + 1) * (side + 1)) <= N_nodes)
+        {
+            side++;
+        }
+        igraph_vector_int_t dimensions;
+        igraph_vector_int_init(&dimensions, 2);
+        VECTOR(dimensions)[0] = side;
+        VECTOR(dimensions)[1] = side;
+        igraph_square_lattice(graph, &dimensions, 1, IGRAPH_UNDIRECTED, 0, nullptr);
+        igraph_vector_int_destroy(&dimensions);
+    }
+
+    inline void generate(igraph_t* graph, GraphFamily family, size_t N_nodes, double degree)
+    {
+        switch (family)
+        {
+        case GRAPH_FAMILY_ERDOS_RENYI:
+            erdos_renyi(graph, N_nodes, degree);
+            break;
+        case GRAPH_FAMILY_BARABASI_ALBERT:
+            barabasi_albert(graph, N_nodes, degree);
+            break;
+        case GRAPH_FAMILY_WATTS_STROGATZ:
+            watts_strogatz(graph, N_nodes, degree);
+            break;
+        case GRAPH_FAMILY_LATTICE:
+            lattice(graph, N_nodes);
+            break;
+        }
+    }
 }
 
-#endif
\ No newline at end of file
+#endif
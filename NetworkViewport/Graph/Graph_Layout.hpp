@@ -1,15 +1,19 @@
 #ifndef GRAPH_LAYOUT_HPP
 #define GRAPH_LAYOUT_HPP
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <igraph/igraph.h>
 #include <igraph/igraph_layout.h>
 #include <VulkanTools/InstanceGraphics/VulkanNodeInstance.hpp>
 #include <VulkanTools/InstanceGraphics/VulkanEdgeInstance.hpp>
+#include <NetworkViewport/Utils/Trace.hpp>
 
 namespace graph::layout
 {
     std::vector<NodeInstanceData> kamada_kawai_2D(const igraph_t& graph, size_t max_iter, float epsilon)
     {
+        NV_TRACE_ZONE("Kamada-Kawai 2D");
         size_t N_nodes = igraph_vcount(&graph);
         igraph_matrix_t pos;
         igraph_matrix_init(&pos, N_nodes, 2);
@@ -34,6 +38,7 @@ namespace graph::layout
 
     std::vector<NodeInstanceData> kamada_kawai_3D(const igraph_t& graph, size_t max_iter, float epsilon)
     {
+        NV_TRACE_ZONE("Kamada-Kawai 3D");
         size_t N_nodes = igraph_vcount(&graph);
         igraph_matrix_t pos;
         igraph_matrix_init(&pos, N_nodes, 3);
@@ -54,8 +59,69 @@ namespace graph::layout
         return node_data;
     }
 
+    // Moves every community of a partition (ids by decreasing size, as from graph::community::louvain) to its own anchor
+    // on a golden angle spiral, a disk for flat layouts and a sphere otherwise. A community keeps the shape it had in the
+    // layout, scaled to a radius of up to spacing / 2 by the root of its size relative to the largest community
+    void group_by_community(std::vector<NodeInstanceData>& node_data, const std::vector<uint32_t>& community, uint32_t N_communities, float spacing)
+    {
+        NV_TRACE_ZONE("Group by community");
+        if (N_communities == 0)
+        {
+            return;
+        }
+        std::vector<glm::vec3> centroid(N_communities, glm::vec3(0.f));
+        std::vector<float> spread(N_communities, 0.f);
+        std::vector<uint32_t> size(N_communities, 0);
+        bool flat = true;
+        for (size_t i = 0; i < node_data.size(); i++)
+        {
+            centroid[community[i]] += node_data[i].pos;
+            size[community[i]]++;
+            flat = flat && node_data[i].pos.z == 0.f;
+        }
+        for (uint32_t c = 0; c < N_communities; c++)
+        {
+            centroid[c] /= static_cast<float>(std::max(size[c], 1u));
+        }
+        for (size_t i = 0; i < node_data.size(); i++)
+        {
+            glm::vec3 offset = node_data[i].pos - centroid[community[i]];
+            spread[community[i]] += glm::dot(offset, offset);
+        }
+
+        const float goldenAngle = 2.39996323f;
+        uint32_t largest = *std::max_element(size.begin(), size.end());
+        std::vector<glm::vec3> anchor(N_communities);
+        std::vector<float> scale(N_communities);
+        for (uint32_t c = 0; c < N_communities; c++)
+        {
+            float angle = goldenAngle * c;
+            if (flat)
+            {
+                anchor[c] = spacing * std::sqrt(static_cast<float>(c)) * glm::vec3(std::cos(angle), std::sin(angle), 0.f);
+            }
+            else
+            {
+                // Fibonacci sphere direction, radius growing with the cube root to fill the ball evenly
+                float z = 1.f - 2.f * (c + .5f) / N_communities;
+                float ring = std::sqrt(1.f - z * z);
+                anchor[c] = spacing * std::cbrt(static_cast<float>(c)) * glm::vec3(ring * std::cos(angle), ring * std::sin(angle), z);
+            }
+            // Twice the RMS distance to the centroid maps to the target radius
+            float radius = 2.f * std::sqrt(spread[c] / std::max(size[c], 1u));
+            float target = .5f * spacing * std::sqrt(static_cast<float>(size[c]) / largest);
+            scale[c] = radius > 0.f ? target / radius : 0.f;
+        }
+        for (size_t i = 0; i < node_data.size(); i++)
+        {
+            uint32_t c = community[i];
+            node_data[i].pos = anchor[c] + (node_data[i].pos - centroid[c]) * scale[c];
+        }
+    }
+
     std::vector<EdgeInstanceData> get_edge_positions(const std::vector<NodeInstanceData>& nodeInstanceData, const igraph_t& graph)
     {
+        NV_TRACE_ZONE("Edge positions");
         std::vector<EdgeInstanceData> edge_data;
         //write edge node positions to edge_data
         for (size_t i = 0; i < igraph_ecount(&graph); i++)
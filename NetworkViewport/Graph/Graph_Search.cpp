@@ -0,0 +1,287 @@
+#include "Graph_Search.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <omp.h>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace graph::search
+{
+    static constexpr uint32_t NONE = UINT32_MAX;
+    // Go bottom-up once the frontier has more than 1/ALPHA of the unexplored arcs,
+    // and back top-down once it holds fewer than 1/BETA of the nodes
+    static constexpr uint64_t ALPHA = 14;
+    static constexpr uint64_t BETA = 24;
+
+    static int thread_count(uint32_t threads)
+    {
+        return threads > 0 ? static_cast<int>(threads) : std::max(1, omp_get_max_threads());
+    }
+
+    static bool is_visited(const std::vector<uint64_t>& bits, uint32_t node)
+    {
+        return (bits[node >> 6] >> (node & 63)) & 1;
+    }
+
+    // Clear the side and make the source its only visited node
+    static void start_side(SearchSide& side, const CSRGraph& csr, uint32_t source)
+    {
+        side.visited.assign((static_cast<size_t>(csr.N_nodes) + 63) / 64, 0);
+        if (side.parent.size() != csr.N_nodes)
+        {
+            side.parent.resize(csr.N_nodes);
+        }
+        side.visited[source >> 6] |= 1ull << (source & 63);
+        side.parent[source] = source;
+        side.frontier.assign(1, source);
+        side.frontierArcs = degree(csr, source);
+        side.unexploredArcs = arc_count(csr) - side.frontierArcs;
+        side.bottomUp = false;
+    }
+
+    // Replace the frontier of a side by the nodes one level further out
+    static void expand(SearchSide& side, const CSRGraph& csr, SearchWorkspace& workspace, int threadCount, SearchStats& stats)
+    {
+        const uint32_t N_nodes = csr.N_nodes;
+        if (!side.bottomUp && side.frontierArcs > side.unexploredArcs / ALPHA)
+        {
+            side.bottomUp = true;
+        }
+        else if (side.bottomUp && side.frontier.size() < N_nodes / BETA)
+        {
+            side.bottomUp = false;
+        }
+        // OpenMP may run fewer threads than asked for, the lists of threads that do not run stay empty
+        workspace.threadNext.resize(threadCount);
+        for (std::vector<uint32_t>& next : workspace.threadNext)
+        {
+            next.clear();
+        }
+        uint64_t* visited = side.visited.data();
+        uint32_t* parent = side.parent.data();
+        uint64_t nextArcs = 0;
+
+        if (!side.bottomUp)
+        {
+            stats.topDownLevels++;
+            const int64_t N_frontier = side.frontier.size();
+#pragma omp parallel num_threads(threadCount) reduction(+ : nextArcs)
+            {
+                std::vector<uint32_t>& next = workspace.threadNext[omp_get_thread_num()];
+#pragma omp for schedule(dynamic, 64)
+                for (int64_t i = 0; i < N_frontier; i++)
+                {
+                    uint32_t node = side.frontier[i];
+                    for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+                    {
+                        uint32_t neighbor = csr.neighbors[arc];
+                        uint64_t bit = 1ull << (neighbor & 63);
+                        uint64_t word;
+#pragma omp atomic read
+                        word = visited[neighbor >> 6];
+                        if (word & bit)
+                        {
+                            continue;
+                        }
+                        // Exactly one thread finds the bit clear and claims the neighbor
+#pragma omp atomic capture
+                        {
+                            word = visited[neighbor >> 6];
+                            visited[neighbor >> 6] |= bit;
+                        }
+                        if (!(word & bit))
+                        {
+                            parent[neighbor] = node;
+                            next.push_back(neighbor);
+                            nextArcs += degree(csr, neighbor);
+                        }
+                    }
+                }
+            }
+        }
+        else
+        {
+            stats.bottomUpLevels++;
+            const int64_t N_words = side.visited.size();
+            workspace.frontierBits.assign(N_words, 0);
+            uint64_t* frontierBits = workspace.frontierBits.data();
+            const int64_t N_frontier = side.frontier.size();
+#pragma omp parallel for schedule(static) num_threads(threadCount)
+            for (int64_t i = 0; i < N_frontier; i++)
+            {
+                uint32_t node = side.frontier[i];
+#pragma omp atomic
+                frontierBits[node >> 6] |= 1ull << (node & 63);
+            }
+            // A thread owns whole words of the visited bitset, so no update is atomic
+#pragma omp parallel num_threads(threadCount) reduction(+ : nextArcs)
+            {
+                std::vector<uint32_t>& next = workspace.threadNext[omp_get_thread_num()];
+#pragma omp for schedule(dynamic, 256)
+                for (int64_t w = 0; w < N_words; w++)
+                {
+                    uint64_t unvisited = ~visited[w];
+                    if (w == N_words - 1 && (N_nodes & 63) != 0)
+                    {
+                        unvisited &= (1ull << (N_nodes & 63)) - 1;
+                    }
+                    uint64_t found = 0;
+                    while (unvisited)
+                    {
+                        int b = __builtin_ctzll(unvisited);
+                        unvisited &= unvisited - 1;
+                        uint32_t node = static_cast<uint32_t>(w * 64 + b);
+                        for (uint64_t arc = csr.offsets[node]; arc < csr.offsets[node + 1]; arc++)
+                        {
+                            uint32_t neighbor = csr.neighbors[arc];
+                            if (is_visited(workspace.frontierBits, neighbor))
+                            {
+                                parent[node] = neighbor;
+                                found |= 1ull << b;
+                                next.push_back(node);
+                                nextArcs += degree(csr, node);
+                                break;
+                            }
+                        }
+                    }
+                    visited[w] |= found;
+                }
+            }
+        }
+
+        side.frontier.clear();
+        for (const std::vector<uint32_t>& next : workspace.threadNext)
+        {
+            side.frontier.insert(side.frontier.end(), next.begin(), next.end());
+        }
+        side.frontierArcs = nextArcs;
+        side.unexploredArcs -= std::min(nextArcs, side.unexploredArcs);
+        stats.visitedNodes += side.frontier.size();
+    }
+
+    PathResult shortest_path(const CSRGraph& csr, uint32_t source, uint32_t target, SearchWorkspace& workspace, uint32_t threads)
+    {
+        NV_TRACE_ZONE("Shortest path");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(threads);
+        PathResult result;
+        if (source >= csr.N_nodes || target >= csr.N_nodes)
+        {
+            return result;
+        }
+        if (source == target)
+        {
+            result.path.push_back(source);
+            result.stats.visitedNodes = 1;
+            return result;
+        }
+
+        SearchSide& forward = workspace.sides[0];
+        SearchSide& backward = workspace.sides[1];
+        start_side(forward, csr, source);
+        start_side(backward, csr, target);
+        result.stats.visitedNodes = 2;
+        uint32_t meeting = NONE;
+        while (meeting == NONE && !forward.frontier.empty() && !backward.frontier.empty())
+        {
+            bool forwardTurn = forward.frontierArcs <= backward.frontierArcs;
+            SearchSide& side = forwardTurn ? forward : backward;
+            const SearchSide& other = forwardTurn ? backward : forward;
+            expand(side, csr, workspace, threadCount, result.stats);
+
+            // The searches did not overlap before this level, so every new node the other side
+            // has visited lies on a shortest path, the smallest one is taken for repeatable results
+            const int64_t N_frontier = side.frontier.size();
+            uint32_t smallest = NONE;
+#pragma omp parallel for schedule(static) reduction(min : smallest) num_threads(threadCount)
+            for (int64_t i = 0; i < N_frontier; i++)
+            {
+                uint32_t node = side.frontier[i];
+                if (is_visited(other.visited, node))
+                {
+                    smallest = std::min(smallest, node);
+                }
+            }
+            meeting = smallest;
+        }
+
+        if (meeting != NONE)
+        {
+            for (uint32_t node = meeting; node != source; node = forward.parent[node])
+            {
+                result.path.push_back(node);
+            }
+            result.path.push_back(source);
+            std::reverse(result.path.begin(), result.path.end());
+            for (uint32_t node = meeting; node != target;)
+            {
+                node = backward.parent[node];
+                result.path.push_back(node);
+            }
+        }
+        result.stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    NeighborhoodResult neighborhood(const CSRGraph& csr, uint32_t source, uint32_t hops, SearchWorkspace& workspace, uint32_t threads)
+    {
+        NV_TRACE_ZONE("Neighborhood");
+        auto tStart = std::chrono::steady_clock::now();
+        int threadCount = thread_count(threads);
+        NeighborhoodResult result;
+        if (source >= csr.N_nodes)
+        {
+            return result;
+        }
+
+        SearchSide& side = workspace.sides[0];
+        start_side(side, csr, source);
+        result.nodes.push_back(source);
+        result.levelSizes.push_back(1);
+        result.stats.visitedNodes = 1;
+        for (uint32_t hop = 0; hop < hops && !side.frontier.empty(); hop++)
+        {
+            expand(side, csr, workspace, threadCount, result.stats);
+            if (side.frontier.empty())
+            {
+                break;
+            }
+            result.nodes.insert(result.nodes.end(), side.frontier.begin(), side.frontier.end());
+            result.levelSizes.push_back(side.frontier.size());
+        }
+        result.stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        return result;
+    }
+
+    NodeQueryResult run_node_query(const CSRGraph& csr, SearchWorkspace* workspace, NodeQueryMode mode, std::vector<uint32_t> selected,
+                                   uint32_t hops)
+    {
+        NV_TRACE_ZONE("Node query");
+        NodeQueryResult result;
+        char summary[128];
+        if (mode == NODE_QUERY_PATH)
+        {
+            PathResult found = shortest_path(csr, selected[0], selected[1], *workspace);
+            if (found.path.empty())
+            {
+                snprintf(summary, sizeof(summary), "No path, %llu nodes searched in %.2f ms",
+                         static_cast<unsigned long long>(found.stats.visitedNodes), 1000. * found.stats.seconds);
+            }
+            else
+            {
+                snprintf(summary, sizeof(summary), "Path of %zu hops, %llu nodes searched in %.2f ms", found.path.size() - 1,
+                         static_cast<unsigned long long>(found.stats.visitedNodes), 1000. * found.stats.seconds);
+            }
+            result.nodes = std::move(found.path);
+        }
+        else
+        {
+            NeighborhoodResult reached = neighborhood(csr, selected[0], hops, *workspace);
+            snprintf(summary, sizeof(summary), "%zu nodes within %zu hops in %.2f ms", reached.nodes.size(),
+                     reached.levelSizes.empty() ? size_t(0) : reached.levelSizes.size() - 1, 1000. * reached.stats.seconds);
+            result.nodes = std::move(reached.nodes);
+        }
+        result.summary = summary;
+        return result;
+    }
+}
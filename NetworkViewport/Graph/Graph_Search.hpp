@@ -0,0 +1,95 @@
+#ifndef GRAPH_SEARCH_HPP
+#define GRAPH_SEARCH_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Graph_CSR.hpp"
+
+// Breadth-first queries on the CSR adjacency of an undirected graph for
+// interactive use: the shortest path between two nodes and the k-hop
+// neighborhood of one.
+//
+// Every level is expanded in parallel, either top-down from the frontier list,
+// claiming neighbors in the visited bitset atomically, or bottom-up, where
+// every unvisited node looks for a parent in the frontier bitset and a thread
+// owns whole words of the visited bitset. A level goes bottom-up once the
+// frontier's arcs outweigh a share of the unexplored ones and back top-down
+// once the frontier is small again (Beamer's direction-optimizing BFS). The
+// shortest path grows a search from both ends, always the one with fewer
+// frontier arcs, and stops at the first level where they meet.
+//
+// The bitsets and parents live in a workspace that is reused between queries,
+// so a query only clears its bitsets.
+namespace graph::search
+{
+    struct SearchSide
+    {
+        std::vector<uint64_t> visited;
+        // Valid for visited nodes only
+        std::vector<uint32_t> parent;
+        std::vector<uint32_t> frontier;
+        // Arcs of the frontier and of the nodes not visited yet
+        uint64_t frontierArcs = 0;
+        uint64_t unexploredArcs = 0;
+        bool bottomUp = false;
+    };
+
+    struct SearchWorkspace
+    {
+        // The neighborhood uses the first side only
+        SearchSide sides[2];
+        // Frontier of the current bottom-up level
+        std::vector<uint64_t> frontierBits;
+        std::vector<std::vector<uint32_t>> threadNext;
+    };
+
+    struct SearchStats
+    {
+        uint64_t visitedNodes = 0;
+        uint32_t topDownLevels = 0;
+        uint32_t bottomUpLevels = 0;
+        double seconds = 0.;
+    };
+
+    struct PathResult
+    {
+        // From source to target, empty if they are not connected
+        std::vector<uint32_t> path;
+        SearchStats stats;
+    };
+
+    struct NeighborhoodResult
+    {
+        // In breadth-first order, the source first
+        std::vector<uint32_t> nodes;
+        // levelSizes[d] nodes at distance d
+        std::vector<uint64_t> levelSizes;
+        SearchStats stats;
+    };
+
+    // 0 threads uses all OpenMP threads
+    PathResult shortest_path(const CSRGraph& csr, uint32_t source, uint32_t target, SearchWorkspace& workspace, uint32_t threads = 0);
+    NeighborhoodResult neighborhood(const CSRGraph& csr, uint32_t source, uint32_t hops, SearchWorkspace& workspace, uint32_t threads = 0);
+
+    enum NodeQueryMode
+    {
+        // Shortest path between the two selected nodes
+        NODE_QUERY_PATH,
+        // Nodes within a number of hops of the selected node
+        NODE_QUERY_NEIGHBORHOOD
+    };
+
+    struct NodeQueryResult
+    {
+        // Nodes to mark, empty when the query found nothing
+        std::vector<uint32_t> nodes;
+        std::string summary;
+    };
+
+    // A query of the selected nodes, two for a path and one for a neighborhood, with a summary line for the UI, e.g. on a
+    // worker thread beside the render loop
+    NodeQueryResult run_node_query(const CSRGraph& csr, SearchWorkspace* workspace, NodeQueryMode mode, std::vector<uint32_t> selected,
+                                   uint32_t hops);
+}
+
+#endif
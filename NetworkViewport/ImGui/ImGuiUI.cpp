@@ -1,4 +1,8 @@
 #include "ImGuiUI.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <NetworkViewport/Utils/Trace.hpp>
 #include <VulkanTools/Utilities/VulkanInitializers.hpp>
 #include <VulkanTools/Utilities/VulkanPipelineInitializers.hpp>
 #include <VulkanTools/InstanceGraphics/GLTF_Assets.hpp>
@@ -11,13 +15,18 @@ namespace ImGUI_UI
 		ImGui::DestroyContext();
 		VkDevice logicalDevice = ivData.vulkanDevice->logicalDevice;
 		// Release all Vulkan resources required for rendering imGui
-		ivData.vertexBuffer.destroy();
-		ivData.indexBuffer.destroy();
-		vkDestroyImage(logicalDevice, ivData.fontImage, nullptr);
+		for (auto &frame : ivData.frameBuffers)
+		{
+			render::destroyBuffer(*ivData.allocator, frame.vertexBuffer);
+			render::destroyBuffer(*ivData.allocator, frame.indexBuffer);
+		}
 		vkDestroyImageView(logicalDevice, ivData.fontView, nullptr);
-		vkFreeMemory(logicalDevice, ivData.fontMemory, nullptr);
+		render::destroyImage(*ivData.allocator, ivData.fontImage, ivData.fontAllocation);
 		vkDestroySampler(logicalDevice, ivData.sampler, nullptr);
-		vkDestroyPipelineCache(logicalDevice, ivData.pipelineCache, nullptr);
+		if (ivData.ownsPipelineCache)
+		{
+			vkDestroyPipelineCache(logicalDevice, ivData.pipelineCache, nullptr);
+		}
 		vkDestroyPipeline(logicalDevice, ivData.pipeline, nullptr);
 		vkDestroyPipelineLayout(logicalDevice, ivData.pipelineLayout, nullptr);
 		vkDestroyDescriptorPool(logicalDevice, ivData.descriptorPool, nullptr);
@@ -45,12 +54,10 @@ namespace ImGUI_UI
 	}
 
 	// Initialize all Vulkan resources used by the ui
-	void initializeImGuiVulkanResources(ImGuiVulkanData& ivData, VkRenderPass &renderPass, VkQueue copyQueue, const std::string &shadersPath)
+	void initializeImGuiVulkanResources(ImGuiVulkanData& ivData, VkRenderPass &renderPass, render::TransferService &transferService, const std::string &shadersPath)
 	{
 		ImGuiIO &io = ImGui::GetIO();
 
-		VulkanDevice* vulkanDevice = ivData.vulkanDevice;
-
 		// Create font texture
 		unsigned char *fontData;
 		int texWidth, texHeight;
@@ -74,14 +81,7 @@ namespace ImGUI_UI
 
 		VkDevice logicalDevice = ivData.vulkanDevice->logicalDevice;
 
-		VK_CHECK_RESULT(vkCreateImage(logicalDevice, &imageInfo, nullptr, &ivData.fontImage));
-		VkMemoryRequirements memReqs;
-		vkGetImageMemoryRequirements(logicalDevice, ivData.fontImage, &memReqs);
-		VkMemoryAllocateInfo memAllocInfo = initializers::memoryAllocateInfo();
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAllocInfo, nullptr, &ivData.fontMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, ivData.fontImage, ivData.fontMemory, 0));
+		VK_CHECK_RESULT(render::createImage(*ivData.allocator, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ivData.fontImage, ivData.fontAllocation));
 
 		// Image view
 		VkImageViewCreateInfo viewInfo = initializers::imageViewCreateInfo();
@@ -93,61 +93,18 @@ namespace ImGUI_UI
 		viewInfo.subresourceRange.layerCount = 1;
 		VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewInfo, nullptr, &ivData.fontView));
 
-		// Staging buffers for font data upload
-		VulkanBuffer stagingBuffer;
-
-		VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&stagingBuffer,
-			uploadSize));
-		stagingBuffer.map();
-		memcpy(stagingBuffer.mapped, fontData, uploadSize);
-		stagingBuffer.unmap();
-
-		// Copy buffer data to font image
-		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Prepare for transfer
-		tools::setImageLayout(
-			copyCmd,
-			ivData.fontImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_HOST_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT);
-
-		// Copy
-		VkBufferImageCopy bufferCopyRegion = {};
-		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		bufferCopyRegion.imageSubresource.layerCount = 1;
-		bufferCopyRegion.imageExtent.width = texWidth;
-		bufferCopyRegion.imageExtent.height = texHeight;
-		bufferCopyRegion.imageExtent.depth = 1;
-
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer.buffer,
+		// Font data goes out with the next transfer batch, the image is acquired before the first frame samples it
+		render::enqueueImageUpload(
+			transferService,
 			ivData.fontImage,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&bufferCopyRegion);
-
-		// Prepare for shader read
-		tools::setImageLayout(
-			copyCmd,
-			ivData.fontImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			texWidth,
+			texHeight,
+			fontData,
+			uploadSize,
 			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
 			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
-		vulkanDevice->flushCommandBuffer(copyCmd, copyQueue, true);
-
-		stagingBuffer.destroy();
-
 		// Font texture Sampler
 		VkSamplerCreateInfo samplerInfo = initializers::samplerCreateInfo();
 		samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -184,10 +141,14 @@ namespace ImGUI_UI
 			initializers::writeDescriptorSet(ivData.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &fontDescriptor, 1)};
 		vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
-		// Pipeline cache
-		VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		VK_CHECK_RESULT(vkCreatePipelineCache(logicalDevice, &pipelineCacheCreateInfo, nullptr, &ivData.pipelineCache));
+		// Pipeline cache, unless a shared (persistent) one has been handed in
+		if (ivData.pipelineCache == VK_NULL_HANDLE)
+		{
+			VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+			pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			VK_CHECK_RESULT(vkCreatePipelineCache(logicalDevice, &pipelineCacheCreateInfo, nullptr, &ivData.pipelineCache));
+			ivData.ownsPipelineCache = true;
+		}
 
 		// Pipeline layout
 		// Push constants for UI rendering parameters
@@ -276,16 +237,80 @@ namespace ImGUI_UI
 	}
 
 
+	// Frame times of the shortest window, scaled to its p99.9 and the hitch threshold, and percentiles of each window
+	static void frameStatsDisplay(utils::FrameStats& frameStats)
+	{
+		if (frameStats.windows.empty())
+		{
+			return;
+		}
+		const utils::FrameStatsWindow &window = frameStats.windows.front();
+		utils::FrameTimePercentiles shortWindow = utils::frameTimePercentiles(frameStats, 0);
+		float scaleMax = std::max(static_cast<float>(shortWindow.p999), frameStats.budget * frameStats.hitchFactor);
+		auto frameTimeAt = [](void *data, int index)
+		{
+			const std::deque<uint32_t> &values = *static_cast<const std::deque<uint32_t> *>(data);
+			return values[index] * 1e-3f;
+		};
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%.2f ms, budget %.2f ms", utils::lastFrameTime(frameStats), frameStats.budget);
+		ImGui::PlotLines("Frame Times", frameTimeAt, const_cast<std::deque<uint32_t> *>(&window.values), static_cast<int>(window.values.size()), 0, overlay, 0.f, scaleMax, ImVec2(0, 80));
+
+		ImGui::Columns(6, "frameStats");
+		const char *headers[] = {"Frames", "p50", "p95", "p99", "p99.9", "Max"};
+		for (const char *header : headers)
+		{
+			ImGui::Text("%s", header);
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+		for (size_t windowIndex = 0; windowIndex <= frameStats.windows.size(); windowIndex++)
+		{
+			utils::FrameTimePercentiles percentiles = utils::frameTimePercentiles(frameStats, windowIndex);
+			if (windowIndex < frameStats.windows.size())
+			{
+				ImGui::Text("Last %u", frameStats.windows[windowIndex].frames);
+			}
+			else
+			{
+				ImGui::Text("All %llu", static_cast<unsigned long long>(percentiles.frames));
+			}
+			ImGui::NextColumn();
+			for (double value : {percentiles.p50, percentiles.p95, percentiles.p99, percentiles.p999, percentiles.max})
+			{
+				ImGui::Text("%.2f", value);
+				ImGui::NextColumn();
+			}
+		}
+		ImGui::Columns(1);
+		ImGui::Text("Over budget: %llu, hitches: %llu", static_cast<unsigned long long>(frameStats.overBudgetFrames), static_cast<unsigned long long>(frameStats.hitchCount));
+		if (!frameStats.hitches.empty())
+		{
+			const utils::FrameHitch &hitch = frameStats.hitches.back();
+			ImGui::SameLine();
+			ImGui::Text("(last: frame %llu, %.1f ms)", static_cast<unsigned long long>(hitch.frame), hitch.milliseconds);
+		}
+		ImGui::SetNextItemWidth(120);
+		ImGui::InputFloat("Budget (ms)", &frameStats.budget, 0.f, 0.f, "%.2f");
+		ImGui::SameLine();
+		if (ImGui::Button("Reset stats"))
+		{
+			utils::resetFrameStats(frameStats);
+		}
+	}
+
 	// Starts a new imGui frame and sets up windows and ui elements
-	void newFrame(UISettings &uiSettings, float frameTime, Camera& camera, igraph_t* graph)
+	bool newFrame(UISettings &uiSettings, float frameTime, Camera& camera, igraph_t* graph, render::DeviceMemoryAllocator* allocator, render::GpuProfiler* gpuProfiler,
+				  const simulation::EpidemicEngine* epidemic, const simulation::GillespieEngine* gillespie, const render::GpuEpidemic* gpuEpidemic)
 	{
+		NV_TRACE_ZONE("UI new frame");
 		ImGui::NewFrame();
 
 
 		Menu::createTopMenu(uiSettings);
 		// createPopupMenu(uiSettings.popup);
 
-		Menu::dispatchMenuWindows(uiSettings.activeMenus, graph);
+		bool graphCreated = Menu::dispatchMenuWindows(uiSettings.activeMenus, graph, uiSettings.nodeStateColors);
 		static float f = 0.0f;
 		// ImGui::TextUnformatted(ivData.title.c_str());
 		// ImGui::TextUnformatted(vulkanDevice->properties.deviceName);
@@ -293,18 +318,8 @@ namespace ImGUI_UI
 
 
 		// Update frame time display
-		std::rotate(uiSettings.frameTimes.begin(), uiSettings.frameTimes.begin() + 1, uiSettings.frameTimes.end());
-		uiSettings.frameTimes.back() = frameTime;
-		if (frameTime < uiSettings.frameTimeMin)
-		{
-			uiSettings.frameTimeMin = frameTime;
-		}
-		if (frameTime > uiSettings.frameTimeMax)
-		{
-			uiSettings.frameTimeMax = frameTime;
-		}
-
-		ImGui::PlotLines("Frame Times", &uiSettings.frameTimes[0], 50, 0, "", uiSettings.frameTimeMin, uiSettings.frameTimeMax, ImVec2(0, 80));
+		utils::recordFrameTime(uiSettings.frameStats, frameTime * 1000.f);
+		frameStatsDisplay(uiSettings.frameStats);
 
 		ImGui::Text("Camera");
 		ImGui::InputFloat3("position", &camera.position.x);
@@ -314,6 +329,34 @@ namespace ImGUI_UI
 		ImGui::Begin("Example settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 		ImGui::Checkbox("Display nodes", &uiSettings.display.nodes);
 		ImGui::Checkbox("Display edges", &uiSettings.display.edges);
+		ImGui::SameLine();
+		const char *edgeModes[] = {"Cylinders", "Lines"};
+		int edgeMode = uiSettings.display.edgeMode;
+		ImGui::SetNextItemWidth(120);
+		if (ImGui::Combo("Edge mode", &edgeMode, edgeModes, IM_ARRAYSIZE(edgeModes)))
+		{
+			uiSettings.display.edgeMode = static_cast<EdgeRenderMode>(edgeMode);
+		}
+		if (uiSettings.display.edgeMode == EDGE_RENDER_MODE_LINES)
+		{
+			ImGui::SliderFloat("Line width", &uiSettings.display.lineWidth, .25f, 4.0f);
+			ImGui::SliderFloat("Line density", &uiSettings.display.lineDensity, .01f, 4.0f);
+		}
+		const char *splatModes[] = {"Auto", "Always", "Never"};
+		int splatMode = uiSettings.display.splatMode;
+		if (ImGui::Combo("Density splat", &splatMode, splatModes, IM_ARRAYSIZE(splatModes)))
+		{
+			uiSettings.display.splatMode = static_cast<DensitySplatMode>(splatMode);
+		}
+		if (uiSettings.display.splatMode != DENSITY_SPLAT_MODE_NEVER)
+		{
+			if (uiSettings.display.splatMode == DENSITY_SPLAT_MODE_AUTO)
+			{
+				ImGui::SliderFloat("Splat threshold", &uiSettings.display.splatThreshold, .01f, 4.0f, "%.2f nodes/px");
+			}
+			ImGui::SliderFloat("Splat exposure", &uiSettings.display.splatExposure, .05f, 20.0f);
+			ImGui::Checkbox("Splat edges", &uiSettings.display.splatEdges);
+		}
 		ImGui::SliderFloat("Movement speed", &camera.movementSpeed, 1.0f, 100.0f);
 		float fontSize_old = uiSettings.fontSize;
 		ImGui::SliderFloat("Font size", &uiSettings.fontSize, .1f, 10.0f);
@@ -327,50 +370,561 @@ namespace ImGUI_UI
 		// ImGui::ShowDemoWindow();
 
 		// }
+		if (allocator)
+		{
+			memoryStatsWindow(*allocator);
+		}
+		if (gpuProfiler && render::gpuProfilerEnabled(*gpuProfiler))
+		{
+			gpuProfilerWindow(*gpuProfiler);
+		}
+		if (epidemic)
+		{
+			epidemicWindow(uiSettings, *epidemic, gillespie, gpuEpidemic);
+		}
+		if (uiSettings.communities.available)
+		{
+			communitiesWindow(uiSettings);
+		}
+		if (uiSettings.analytics.available)
+		{
+			analyticsWindow(uiSettings);
+		}
+		if (uiSettings.filter.available)
+		{
+			filterWindow(uiSettings);
+		}
+		if (uiSettings.query.available)
+		{
+			queryWindow(uiSettings);
+		}
 
 		// Render to generate draw buffers
 		ImGui::Render();
+		return graphCreated;
 	}
 
-	// Update vertex and index buffer containing the imGui elements when required
-	void updateBuffers(VulkanDevice* vulkanDevice, VulkanBuffer& vertexBuffer, VulkanBuffer& indexBuffer,  int32_t& indexCount, int32_t& vertexCount)
+	// Per heap device memory usage of the sub-allocator
+	void memoryStatsWindow(render::DeviceMemoryAllocator& allocator)
 	{
-		ImDrawData *imDrawData = ImGui::GetDrawData();
+		const float MiB = 1024.f * 1024.f;
+		std::vector<render::HeapStats> heapStats = render::memoryHeapStats(allocator);
 
-		// Note: Alignment is done inside buffer creation
-		VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
-		VkDeviceSize indexBufferSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
+		ImGui::SetNextWindowSize(ImVec2(300, 120), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Device memory", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		for (size_t heap = 0; heap < heapStats.size(); heap++)
+		{
+			const render::HeapStats &stats = heapStats[heap];
+			if (stats.blockCount == 0)
+			{
+				continue;
+			}
+			ImGui::Text("Heap %zu: %u blocks, %u allocations", heap, stats.blockCount, stats.allocationCount);
+			ImGui::Text("  %.2f / %.2f MiB used, %.2f MiB padding", stats.liveBytes / MiB, stats.allocatedBytes / MiB, stats.wastedBytes / MiB);
+		}
+		ImGui::End();
+	}
 
-		if ((vertexBufferSize == 0) || (indexBufferSize == 0))
+	static ImU32 passColor(size_t pass)
+	{
+		static const ImU32 colors[] = {IM_COL32(230, 159, 0, 255), IM_COL32(86, 180, 233, 255), IM_COL32(0, 158, 115, 255), IM_COL32(240, 228, 66, 255),
+									   IM_COL32(0, 114, 178, 255), IM_COL32(213, 94, 0, 255), IM_COL32(204, 121, 167, 255), IM_COL32(160, 160, 160, 255)};
+		return colors[pass % IM_ARRAYSIZE(colors)];
+	}
+
+	void gpuProfilerWindow(render::GpuProfiler& profiler)
+	{
+		std::vector<render::GpuPassStats> passStats = render::gpuPassStats(profiler);
+
+		ImGui::SetNextWindowSize(ImVec2(360, 300), ImGuiCond_FirstUseEver);
+		ImGui::Begin("GPU profiler");
+		if (profiler.history.empty())
 		{
+			ImGui::Text("Waiting for results");
+			ImGui::End();
 			return;
 		}
+		const render::GpuFrameTiming &latest = profiler.history.back();
+		ImGui::Text("Frame %llu: %.3f ms GPU, results %llu frames late", static_cast<unsigned long long>(latest.frame), latest.milliseconds,
+					static_cast<unsigned long long>(profiler.frame - latest.frame));
+
+		ImGui::Columns(5, "gpuPasses");
+		ImGui::Text("Pass");
+		ImGui::NextColumn();
+		ImGui::Text("Last");
+		ImGui::NextColumn();
+		ImGui::Text("Avg");
+		ImGui::NextColumn();
+		ImGui::Text("Min");
+		ImGui::NextColumn();
+		ImGui::Text("Max");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		for (size_t pass = 0; pass < passStats.size(); pass++)
+		{
+			const render::GpuPassStats &stats = passStats[pass];
+			ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(passColor(pass)), "%s", stats.name.c_str());
+			ImGui::NextColumn();
+			ImGui::Text("%.3f", stats.last);
+			ImGui::NextColumn();
+			ImGui::Text("%.3f", stats.average);
+			ImGui::NextColumn();
+			ImGui::Text("%.3f", stats.min);
+			ImGui::NextColumn();
+			ImGui::Text("%.3f", stats.max);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::Separator();
+
+		// Stacked bars, one column per frame of the history, scaled to the slowest frame
+		double maxFrame = 0.;
+		for (const render::GpuFrameTiming &timing : profiler.history)
+		{
+			double total = 0.;
+			for (const render::GpuPassTiming &passTiming : timing.passes)
+			{
+				total += passTiming.milliseconds;
+			}
+			maxFrame = std::max(maxFrame, total);
+		}
+		ImVec2 graphSize(ImGui::GetContentRegionAvail().x, 100.f);
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImDrawList *drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(origin, ImVec2(origin.x + graphSize.x, origin.y + graphSize.y), IM_COL32(30, 30, 30, 255));
+		float barWidth = graphSize.x / render::GPU_PROFILER_HISTORY;
+		float scale = maxFrame > 0. ? graphSize.y / static_cast<float>(maxFrame) : 0.f;
+		size_t firstColumn = render::GPU_PROFILER_HISTORY - profiler.history.size();
+		for (size_t frame = 0; frame < profiler.history.size(); frame++)
+		{
+			float x = origin.x + (firstColumn + frame) * barWidth;
+			float y = origin.y + graphSize.y;
+			for (const render::GpuPassTiming &passTiming : profiler.history[frame].passes)
+			{
+				size_t pass = std::find(profiler.passNames.begin(), profiler.passNames.end(), passTiming.name) - profiler.passNames.begin();
+				float height = static_cast<float>(passTiming.milliseconds) * scale;
+				drawList->AddRectFilled(ImVec2(x, y - height), ImVec2(x + std::max(barWidth, 1.f), y), passColor(pass));
+				y -= height;
+			}
+		}
+		ImGui::Dummy(graphSize);
+		ImGui::Text("Scale: %.3f ms", maxFrame);
+
+		static char exportPath[256] = "gpu_profile.csv";
+		static bool exportFailed = false;
+		ImGui::InputText("##exportPath", exportPath, IM_ARRAYSIZE(exportPath));
+		ImGui::SameLine();
+		if (ImGui::Button("Export CSV"))
+		{
+			exportFailed = !render::writeGpuProfileCsv(profiler, exportPath);
+		}
+		if (exportFailed)
+		{
+			ImGui::TextColored(ImVec4(1.f, .3f, .3f, 1.f), "Could not write %s", exportPath);
+		}
+		ImGui::End();
+	}
+
+	void epidemicWindow(UISettings& uiSettings, const simulation::EpidemicEngine& epidemic, const simulation::GillespieEngine* gillespie,
+						const render::GpuEpidemic* gpuEpidemic)
+	{
+		auto &settings = uiSettings.epidemic;
+		simulation::EpidemicParams &params = settings.params;
+		if ((settings.engine == EPIDEMIC_ENGINE_EVENTS && !gillespie) || (settings.engine == EPIDEMIC_ENGINE_GPU && !gpuEpidemic))
+		{
+			settings.engine = EPIDEMIC_ENGINE_STEPPED;
+		}
+		bool events = settings.engine == EPIDEMIC_ENGINE_EVENTS;
+		bool gpu = settings.engine == EPIDEMIC_ENGINE_GPU;
+
+		ImGui::SetNextWindowSize(ImVec2(300, 260), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Epidemic", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		const char *engineNames[] = {"Stepped", "Event-driven", "GPU"};
+		if (ImGui::BeginCombo("Engine", engineNames[settings.engine]))
+		{
+			for (int engine = EPIDEMIC_ENGINE_STEPPED; engine <= EPIDEMIC_ENGINE_GPU; engine++)
+			{
+				if ((engine == EPIDEMIC_ENGINE_EVENTS && !gillespie) || (engine == EPIDEMIC_ENGINE_GPU && !gpuEpidemic))
+				{
+					continue;
+				}
+				if (ImGui::Selectable(engineNames[engine], settings.engine == engine))
+				{
+					settings.engine = static_cast<EpidemicEngineKind>(engine);
+				}
+			}
+			ImGui::EndCombo();
+		}
+		const char *models[] = {"SIR", "SIS"};
+		int model = params.model;
+		if (ImGui::Combo("Model", &model, models, IM_ARRAYSIZE(models)))
+		{
+			params.model = static_cast<simulation::EpidemicModel>(model);
+		}
+		// Probabilities per step, rates per time unit for the event engine
+		ImGui::SliderFloat(events ? "Transmission rate" : "Transmission", &params.beta, 0.f, 1.f, "%.3f");
+		ImGui::SliderFloat(events ? "Recovery rate" : "Recovery", &params.gamma, 0.f, 1.f, "%.3f");
+		int initialInfected = static_cast<int>(params.initialInfected);
+		if (ImGui::InputInt("Initially infected", &initialInfected))
+		{
+			params.initialInfected = static_cast<uint32_t>(std::max(initialInfected, 1));
+		}
+		int seed = static_cast<int>(params.seed);
+		if (ImGui::InputInt("Seed", &seed))
+		{
+			params.seed = static_cast<uint64_t>(seed);
+		}
+		if (events)
+		{
+			ImGui::SliderFloat("Time per frame", &settings.timePerFrame, .01f, 10.f, "%.2f");
+		}
+		else
+		{
+			ImGui::SliderInt("Steps per frame", &settings.stepsPerFrame, 1, 32);
+		}
+		ImGui::ColorEdit4("Susceptible", (float *)&uiSettings.nodeStateColors[simulation::NODE_STATE_SUSCEPTIBLE], ImGuiColorEditFlags_NoInputs);
+		ImGui::SameLine();
+		ImGui::ColorEdit4("Infected", (float *)&uiSettings.nodeStateColors[simulation::NODE_STATE_INFECTED], ImGuiColorEditFlags_NoInputs);
+		ImGui::SameLine();
+		ImGui::ColorEdit4("Recovered", (float *)&uiSettings.nodeStateColors[simulation::NODE_STATE_RECOVERED], ImGuiColorEditFlags_NoInputs);
+
+		// Parameter changes apply on reset
+		if (ImGui::Button(settings.running ? "Pause" : "Run"))
+		{
+			settings.running = !settings.running;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Step"))
+		{
+			settings.stepOnce = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+		{
+			settings.reset = true;
+		}
+
+		const uint64_t *counts = gpu ? gpuEpidemic->counts : events ? gillespie->counts : epidemic.counts;
+		double nodes = std::max<double>(static_cast<double>(epidemic.state.size()), 1.);
+		bool active;
+		if (gpu)
+		{
+			ImGui::Text("Step %llu on the GPU", static_cast<unsigned long long>(gpuEpidemic->step));
+			active = render::gpuEpidemicActive(*gpuEpidemic);
+		}
+		else if (events)
+		{
+			ImGui::Text("Time %.3f, %llu events (%llu transmissions)", gillespie->time, static_cast<unsigned long long>(gillespie->eventCount),
+						static_cast<unsigned long long>(gillespie->transmissionCount));
+			active = simulation::gillespieActive(*gillespie);
+		}
+		else
+		{
+			ImGui::Text("Step %llu (%llu push)", static_cast<unsigned long long>(epidemic.step), static_cast<unsigned long long>(epidemic.pushSteps));
+			active = simulation::epidemicActive(epidemic);
+		}
+		const char *stateNames[] = {"Susceptible", "Infected", "Recovered"};
+		for (uint32_t nodeState = 0; nodeState < simulation::NODE_STATE_COUNT; nodeState++)
+		{
+			ImGui::TextColored(uiSettings.nodeStateColors[nodeState], "%-12s %10llu  %5.1f%%", stateNames[nodeState],
+							   static_cast<unsigned long long>(counts[nodeState]), 100. * counts[nodeState] / nodes);
+		}
+		if (!active)
+		{
+			ImGui::Text("No infected nodes left");
+		}
+
+		// Recording and the timeline, the file is written in the background
+		auto &recording = uiSettings.recording;
+		ImGui::Separator();
+		ImGui::InputText("File", recording.path, IM_ARRAYSIZE(recording.path));
+		if (!recording.enabled && ImGui::InputInt("Keyframe interval", &recording.keyframeInterval))
+		{
+			recording.keyframeInterval = std::max(recording.keyframeInterval, 1);
+		}
+		ImGui::Checkbox("Record", &recording.enabled);
+		ImGui::SameLine();
+		if (ImGui::Button("Open"))
+		{
+			recording.open = true;
+		}
+		ImGui::SameLine();
+		ImGui::Checkbox("Replay", &recording.replay);
+		if (recording.frames > 0)
+		{
+			ImGui::SliderInt("Frame", &recording.frame, 0, static_cast<int>(recording.frames - 1));
+		}
+		ImGui::Text("%llu frames, %.1f MiB written", static_cast<unsigned long long>(recording.frames), recording.bytes / (1024. * 1024.));
+		if (gpu && recording.enabled)
+		{
+			ImGui::Text("Steps on the GPU are not recorded");
+		}
+		if (recording.failed)
+		{
+			ImGui::TextColored(ImVec4(1.f, .3f, .3f, 1.f), "Could not open %s", recording.path);
+		}
+		ImGui::End();
+	}
+
+	void communitiesWindow(UISettings& uiSettings)
+	{
+		auto &settings = uiSettings.communities;
+		ImGui::SetNextWindowSize(ImVec2(300, 120), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Communities", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		// Above 1 splits into more and smaller communities
+		ImGui::SliderFloat("Resolution", &settings.resolution, .1f, 4.f, "%.2f");
+		if (settings.running)
+		{
+			ImGui::Text("Detecting...");
+		}
+		else if (ImGui::Button("Detect"))
+		{
+			settings.detect = true;
+		}
+		if (settings.count > 0)
+		{
+			ImGui::SameLine();
+			ImGui::Checkbox("Color by community", &settings.color);
+			ImGui::Text("%u communities, modularity %.4f", settings.count, settings.modularity);
+			ImGui::Text("%u levels in %.2f s", settings.levels, settings.seconds);
+		}
+		if (settings.color)
+		{
+			ImGui::Text("The epidemic is paused while shown");
+		}
+		ImGui::End();
+	}
+
+	// Combo over the analytics columns, "None" for -1
+	static void columnCombo(const char *label, int &column, const std::vector<std::string> &columns)
+	{
+		if (column >= static_cast<int>(columns.size()))
+		{
+			column = -1;
+		}
+		if (ImGui::BeginCombo(label, column < 0 ? "None" : columns[column].c_str()))
+		{
+			if (ImGui::Selectable("None", column < 0))
+			{
+				column = -1;
+			}
+			for (int i = 0; i < static_cast<int>(columns.size()); i++)
+			{
+				if (ImGui::Selectable(columns[i].c_str(), column == i))
+				{
+					column = i;
+				}
+			}
+			ImGui::EndCombo();
+		}
+	}
+
+	void analyticsWindow(UISettings& uiSettings)
+	{
+		auto &settings = uiSettings.analytics;
+		ImGui::SetNextWindowSize(ImVec2(320, 200), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Analytics", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		if (settings.running != graph::analytics::ANALYTICS_JOB_NONE)
+		{
+			const char *jobNames[] = {"", "Degrees", "PageRank", "Betweenness"};
+			ImGui::ProgressBar(settings.progress, ImVec2(-1.f, 0.f), jobNames[settings.running]);
+			if (ImGui::Button("Cancel"))
+			{
+				settings.cancel = true;
+			}
+		}
+		else
+		{
+			if (ImGui::Button("Degrees"))
+			{
+				settings.run = graph::analytics::ANALYTICS_JOB_DEGREE;
+			}
+			ImGui::SliderFloat("Damping", &settings.damping, .5f, .99f, "%.2f");
+			ImGui::SameLine();
+			if (ImGui::Button("PageRank"))
+			{
+				settings.run = graph::analytics::ANALYTICS_JOB_PAGERANK;
+			}
+			// Sources of the shortest paths, the error falls with their square root
+			if (ImGui::InputInt("Samples", &settings.samples))
+			{
+				settings.samples = std::max(settings.samples, 1);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Betweenness"))
+			{
+				settings.run = graph::analytics::ANALYTICS_JOB_BETWEENNESS;
+			}
+		}
+		if (!settings.summary.empty())
+		{
+			ImGui::Text("%s", settings.summary.c_str());
+		}
+		if (!settings.degreeHistogram.empty())
+		{
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "max %u, mean %.2f", settings.maxDegree, settings.meanDegree);
+			ImGui::PlotHistogram("Degrees", settings.degreeHistogram.data(), static_cast<int>(settings.degreeHistogram.size()), 0, overlay, 0.f,
+								 FLT_MAX, ImVec2(0, 80));
+			ImGui::Text("%u degrees per bar, heights log10(1 + nodes)", settings.degreesPerBin);
+		}
+		if (!settings.columns.empty())
+		{
+			ImGui::Separator();
+			columnCombo("Color by", settings.colorColumn, settings.columns);
+			columnCombo("Scale by", settings.scaleColumn, settings.columns);
+			ImGui::Checkbox("Logarithmic", &settings.logarithmic);
+			ImGui::DragFloatRange2("Scale range", &settings.scaleMin, &settings.scaleMax, .01f, .05f, 8.f, "%.2f");
+			if (settings.colorColumn >= 0 && uiSettings.communities.color && uiSettings.communities.count > 0)
+			{
+				ImGui::Text("Community colors are shown instead");
+			}
+		}
+		ImGui::End();
+	}
 
-		// Update buffers only if vertex or index count has been changed compared to current buffer size
+	void filterWindow(UISettings& uiSettings)
+	{
+		auto &settings = uiSettings.filter;
+		ImGui::SetNextWindowSize(ImVec2(300, 160), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Filter", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		if (settings.running)
+		{
+			ImGui::Text("Decomposing...");
+		}
+		else if (!settings.decomposed && ImGui::Button("Decompose"))
+		{
+			settings.decompose = true;
+		}
+		if (settings.decomposed)
+		{
+			ImGui::Checkbox("Filter", &settings.enabled);
+			ImGui::SliderInt("k-core", &settings.minCore, 0, static_cast<int>(settings.maxCore));
+			settings.minCore = std::clamp(settings.minCore, 0, static_cast<int>(settings.maxCore));
+			ImGui::Text("%llu nodes in the %d-core", static_cast<unsigned long long>(settings.coreSizes[settings.minCore]), settings.minCore);
+
+			int lastComponent = static_cast<int>(settings.componentSizes.size()) - 1;
+			ImGui::SliderInt("Component", &settings.component, -1, lastComponent, settings.component < 0 ? "All" : "%d");
+			settings.component = std::clamp(settings.component, -1, lastComponent);
+			ImGui::SameLine();
+			if (ImGui::Button("Giant"))
+			{
+				settings.component = 0;
+			}
+			if (settings.component >= 0)
+			{
+				ImGui::Text("%llu nodes in component %d of %u", static_cast<unsigned long long>(settings.componentSizes[settings.component]),
+							settings.component, settings.componentCount);
+			}
+			else
+			{
+				ImGui::Text("%u components", settings.componentCount);
+			}
+			ImGui::Text("Decomposed in %.3f s", settings.seconds);
+			if (settings.enabled && uiSettings.display.edgeMode == EDGE_RENDER_MODE_LINES)
+			{
+				ImGui::Text("Line edges are not filtered");
+			}
+		}
+		ImGui::End();
+	}
 
-		// Vertex buffer
-		if ((vertexBuffer.buffer == VK_NULL_HANDLE) || (vertexCount != imDrawData->TotalVtxCount))
+	void queryWindow(UISettings& uiSettings)
+	{
+		auto &settings = uiSettings.query;
+		ImGui::SetNextWindowSize(ImVec2(300, 160), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Query", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		ImGui::Text("Ctrl+click nodes to query");
+		int mode = settings.mode;
+		ImGui::RadioButton("Shortest path", &mode, graph::search::NODE_QUERY_PATH);
+		ImGui::SameLine();
+		ImGui::RadioButton("Neighborhood", &mode, graph::search::NODE_QUERY_NEIGHBORHOOD);
+		if (mode != settings.mode)
+		{
+			settings.mode = static_cast<graph::search::NodeQueryMode>(mode);
+			settings.rerun = true;
+		}
+		if (settings.mode == graph::search::NODE_QUERY_NEIGHBORHOOD)
 		{
-			vertexBuffer.unmap();
-			vertexBuffer.destroy();
-			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &vertexBuffer, vertexBufferSize));
-			vertexCount = imDrawData->TotalVtxCount;
-			vertexBuffer.map();
+			if (ImGui::SliderInt("Hops", &settings.hops, 1, 8))
+			{
+				settings.rerun = true;
+			}
+			settings.hops = std::clamp(settings.hops, 1, 8);
 		}
+		ImGui::Checkbox("Dim others", &settings.dimOthers);
+		ImGui::SliderFloat("Highlight size", &settings.highlightScale, 1.f, 4.f);
 
-		// Index buffer
-		if ((indexBuffer.buffer == VK_NULL_HANDLE) || (indexCount < imDrawData->TotalIdxCount))
+		if (settings.selected.empty())
+		{
+			ImGui::Text("No node selected");
+		}
+		else if (settings.selected.size() == 1)
 		{
-			indexBuffer.unmap();
-			indexBuffer.destroy();
-			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &indexBuffer, indexBufferSize));
-			indexCount = imDrawData->TotalIdxCount;
-			indexBuffer.map();
+			ImGui::Text("Node %u", settings.selected[0]);
 		}
+		else
+		{
+			ImGui::Text("Nodes %u and %u", settings.selected[0], settings.selected[1]);
+		}
+		if (settings.running)
+		{
+			ImGui::Text("Searching...");
+		}
+		else if (!settings.summary.empty())
+		{
+			ImGui::Text("%s", settings.summary.c_str());
+		}
+		if (!settings.selected.empty() && ImGui::Button("Clear"))
+		{
+			settings.clear = true;
+		}
+		ImGui::End();
+	}
+
+	// Smallest UI buffer allocation, enough for a few windows of text
+	static constexpr VkDeviceSize UI_BUFFER_MIN_CAPACITY = 64 * 1024;
+
+	static void reserveUIBuffer(render::DeviceMemoryAllocator& allocator, render::AllocatedBuffer& buffer, VkDeviceSize& capacity, VkDeviceSize requiredSize, VkBufferUsageFlags usage)
+	{
+		if (buffer.buffer != VK_NULL_HANDLE && requiredSize <= capacity)
+		{
+			return;
+		}
+		VkDeviceSize newCapacity = std::max(capacity, UI_BUFFER_MIN_CAPACITY);
+		while (newCapacity < requiredSize)
+		{
+			newCapacity *= 2;
+		}
+		// Host-visible blocks of the allocator are mapped for their whole lifetime
+		render::destroyBuffer(allocator, buffer);
+		VK_CHECK_RESULT(render::createBuffer(allocator, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, newCapacity, buffer));
+		capacity = newCapacity;
+	}
+
+	// Write the imGui elements into the buffers of the given frame in flight, growing them when required
+	void updateBuffers(ImGuiVulkanData& ivData, uint32_t frameIndex)
+	{
+		NV_TRACE_ZONE("UI update buffers");
+		ImDrawData *imDrawData = ImGui::GetDrawData();
+		ivData.frameIndex = frameIndex % static_cast<uint32_t>(ivData.frameBuffers.size());
+		ImGuiFrameBuffers &frame = ivData.frameBuffers[ivData.frameIndex];
+
+		VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
+		VkDeviceSize indexBufferSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
 
-		// Upload data
-		ImDrawVert *vtxDst = (ImDrawVert *)vertexBuffer.mapped;
-		ImDrawIdx *idxDst = (ImDrawIdx *)indexBuffer.mapped;
+		if ((vertexBufferSize == 0) || (indexBufferSize == 0))
+		{
+			return;
+		}
+
+		// Buffers only ever grow, in steady state this allocates nothing
+		reserveUIBuffer(*ivData.allocator, frame.vertexBuffer, frame.vertexCapacity, vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		reserveUIBuffer(*ivData.allocator, frame.indexBuffer, frame.indexCapacity, indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+		// Upload data, the memory is coherent so no flush is needed
+		ImDrawVert *vtxDst = (ImDrawVert *)frame.vertexBuffer.mapped;
+		ImDrawIdx *idxDst = (ImDrawIdx *)frame.indexBuffer.mapped;
 
 		for (int n = 0; n < imDrawData->CmdListsCount; n++)
 		{
@@ -380,10 +934,6 @@ namespace ImGUI_UI
 			vtxDst += cmd_list->VtxBuffer.Size;
 			idxDst += cmd_list->IdxBuffer.Size;
 		}
-
-		// Flush to make writes visible to GPU
-		vertexBuffer.flush();
-		indexBuffer.flush();
 	}
 
 	// Draw current imGui frame into a command buffer
@@ -407,12 +957,14 @@ namespace ImGUI_UI
 		int32_t vertexOffset = 0;
 		int32_t indexOffset = 0;
 
-		if (imDrawData->CmdListsCount > 0)
+		ImGuiFrameBuffers &frame = ivData.frameBuffers[ivData.frameIndex];
+
+		if (imDrawData->CmdListsCount > 0 && frame.vertexBuffer.buffer != VK_NULL_HANDLE)
 		{
 
 			VkDeviceSize offsets[1] = {0};
-			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &ivData.vertexBuffer.buffer, offsets);
-			vkCmdBindIndexBuffer(commandBuffer, ivData.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frame.vertexBuffer.buffer, offsets);
+			vkCmdBindIndexBuffer(commandBuffer, frame.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
 
 			for (int32_t i = 0; i < imDrawData->CmdListsCount; i++)
 			{
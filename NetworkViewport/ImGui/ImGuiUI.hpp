@@ -1,6 +1,7 @@
 #ifndef IMGUI_UI_HPP
 #define IMGUI_UI_HPP
 
+#include <vector>
 #include <imgui/imgui.h>
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.hpp>
@@ -10,6 +11,12 @@
 #include <NetworkViewport/Menu/Menu_Window_Defines.hpp>
 #include <NetworkViewport/Menu/Menu.hpp>
 #include <NetworkViewport/Menu/UISettings.hpp>
+#include <NetworkViewport/Render/Memory_Allocator.hpp>
+#include <NetworkViewport/Render/Transfer_Service.hpp>
+#include <NetworkViewport/Render/Gpu_Profiler.hpp>
+#include <NetworkViewport/Render/Gpu_Epidemic.hpp>
+#include <NetworkViewport/Simulation/Epidemic.hpp>
+#include <NetworkViewport/Simulation/Gillespie.hpp>
 // Options and values to display/toggle from the UI
 // ----------------------------------------------------------------------------
 // ImGUI class
@@ -23,24 +30,34 @@ enum ImGUI_UI_Status
 	IMGUI_UI_STATUS_NEW_GRAPH
 };
 
+// Persistently mapped UI geometry, grown by doubling and never shrunk
+struct ImGuiFrameBuffers
+{
+	render::AllocatedBuffer vertexBuffer;
+	render::AllocatedBuffer indexBuffer;
+	VkDeviceSize vertexCapacity = 0;
+	VkDeviceSize indexCapacity = 0;
+};
+
 struct ImGuiVulkanData
 {
-	ImGuiVulkanData(VulkanDevice* _vulkanDevice): vulkanDevice(_vulkanDevice){}
+	ImGuiVulkanData(VulkanDevice* _vulkanDevice, render::DeviceMemoryAllocator* _allocator, uint32_t framesInFlight = 2): frameBuffers(framesInFlight), vulkanDevice(_vulkanDevice), allocator(_allocator){}
 	VkSampler sampler;
-	VulkanBuffer vertexBuffer;
-	VulkanBuffer indexBuffer;
-	int32_t vertexCount = 0;
-	int32_t indexCount = 0;
-	VkDeviceMemory fontMemory = VK_NULL_HANDLE;
+	// One set per frame in flight, so a frame never writes geometry the GPU is still reading
+	std::vector<ImGuiFrameBuffers> frameBuffers;
+	uint32_t frameIndex = 0;
+	render::Allocation *fontAllocation = nullptr;
 	VkImage fontImage = VK_NULL_HANDLE;
 	VkImageView fontView = VK_NULL_HANDLE;
-	VkPipelineCache pipelineCache;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	bool ownsPipelineCache = false;
 	VkPipelineLayout pipelineLayout;
 	VkPipeline pipeline;
 	VkDescriptorPool descriptorPool;
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorSet descriptorSet;
 	VulkanDevice *vulkanDevice;
+	render::DeviceMemoryAllocator *allocator;
 	std::string title;
 	// UI params are set via push constants
 	struct PushConstBlock
@@ -55,14 +72,34 @@ struct ImGuiVulkanData
 	// Initialize styles, keys, etc.
 	void setupImGuiVisuals(float width, float height, const UISettings &uiSettings);
 	// Initialize all Vulkan resources used by the ui
-	void initializeImGuiVulkanResources(ImGuiVulkanData& ivData, VkRenderPass &renderPass, VkQueue copyQueue, const std::string &shadersPath);
+	void initializeImGuiVulkanResources(ImGuiVulkanData& ivData, VkRenderPass &renderPass, render::TransferService &transferService, const std::string &shadersPath);
+
+
+	// Starts a new imGui frame and sets up windows and ui elements. Returns true when the menus generated a new graph
+	// into graph, which the caller then owns
+	bool newFrame(UISettings &uiSettings, float frameTime, Camera& camera, igraph_t* graph, render::DeviceMemoryAllocator* allocator = nullptr, render::GpuProfiler* gpuProfiler = nullptr,
+				  const simulation::EpidemicEngine* epidemic = nullptr, const simulation::GillespieEngine* gillespie = nullptr,
+				  const render::GpuEpidemic* gpuEpidemic = nullptr);
 
+	// Per heap device memory usage of the sub-allocator
+	void memoryStatsWindow(render::DeviceMemoryAllocator& allocator);
+	// Per pass GPU times as a table and a stacked graph of the recent frames
+	void gpuProfilerWindow(render::GpuProfiler& profiler);
+	// Epidemic parameters, run controls and the state counts of the selected engine, engines without an instance are not offered
+	void epidemicWindow(UISettings& uiSettings, const simulation::EpidemicEngine& epidemic, const simulation::GillespieEngine* gillespie = nullptr,
+						const render::GpuEpidemic* gpuEpidemic = nullptr);
 
-	// Starts a new imGui frame and sets up windows and ui elements
-	void newFrame(UISettings &uiSettings, float frameTime, Camera& camera, igraph_t* graph);
+	// Louvain resolution, detection request and result, and the toggle between community and epidemic colors
+	void communitiesWindow(UISettings& uiSettings);
+	// Analytics jobs with their progress, the degree histogram and the columns driving node color and scale
+	void analyticsWindow(UISettings& uiSettings);
+	// Decomposition request, the k slider and the component selector of the node and edge filter
+	void filterWindow(UISettings& uiSettings);
+	// Mode and hops of the Ctrl+click queries, the selected nodes and the result
+	void queryWindow(UISettings& uiSettings);
 
-	// Update vertex and index buffer containing the imGui elements when required
-	void updateBuffers(VulkanDevice* vulkanDevice, VulkanBuffer& vertexBuffer, VulkanBuffer& indexBuffer,  int32_t& indexCount, int32_t& vertexCount);
+	// Write the imGui elements into the buffers of the given frame in flight, growing them when required
+	void updateBuffers(ImGuiVulkanData& ivData, uint32_t frameIndex);
 	// Draw current imGui frame into a command buffer
 	void drawFrame(ImGuiVulkanData& ivData, VkCommandBuffer commandBuffer);
 }
@@ -24,11 +24,26 @@ GraphDesignStatus createGraphDesignerMenu(igraph_t* graph)
         case GRAPH_DESIGN_GENERATION:
         {
             status = displayGraphGeneration(graph, genParam);
+            if (status == GRAPH_DESIGN_STATUS_NEXT)
+            {
+                current_page = GRAPH_DESIGN_LAYOUT;
+                status = GRAPH_DESIGN_STATUS_IDLE;
+            }
             break;
         }
         case GRAPH_DESIGN_LAYOUT:
         {
             status = displayGraphLayout(graph, layoutParam);
+            if (status == GRAPH_DESIGN_STATUS_BACK)
+            {
+                current_page = GRAPH_DESIGN_GENERATION;
+                status = GRAPH_DESIGN_STATUS_IDLE;
+            }
+            else if (status == GRAPH_DESIGN_STATUS_NEXT)
+            {
+                current_page = GRAPH_DESIGN_GENERATION;
+                status = createGraph(graph, genParam, layoutParam);
+            }
             break;
         }
     }
@@ -132,6 +147,16 @@ GraphDesignStatus displayGraphLayout(igraph_t* graph, GraphLayoutParam& param)
             }
             ImGui::EndCombo();
         }
+
+        if (ImGui::Button("Back", ImVec2(120, 0)))
+        {
+            status = GRAPH_DESIGN_STATUS_BACK;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Create", ImVec2(120, 0)))
+        {
+            status = GRAPH_DESIGN_STATUS_NEXT;
+        }
         ImGui::End();
     }
     return status;
@@ -37,11 +37,13 @@ struct GraphLayoutParam
     const char *layoutType = "Kamada-Kawai";
 };
 enum GraphDesignStatus {GRAPH_DESIGN_STATUS_IDLE, GRAPH_DESIGN_STATUS_CANCELED,
-GRAPH_DESIGN_STATUS_GRAPH_CREATED, GRAPH_DESIGN_STATUS_NEXT};
+GRAPH_DESIGN_STATUS_GRAPH_CREATED, GRAPH_DESIGN_STATUS_NEXT, GRAPH_DESIGN_STATUS_BACK};
 
 GraphDesignStatus createGraphDesignerMenu(igraph_t* graph);
 GraphDesignStatus displayGraphGeneration(igraph_t* graph, GraphGenerationParam& param);
 GraphDesignStatus displayGraphLayout(igraph_t* graph, GraphLayoutParam& param);
+// Generate the designed graph into graph, which the caller then owns
+GraphDesignStatus createGraph(igraph_t* graph, const GraphGenerationParam& genParam, const GraphLayoutParam& layoutParam);
 
 }
 #endif
\ No newline at end of file
@@ -8,18 +8,20 @@
 namespace Menu
 {
 
-void createPreferencesMenu(ImVec4 *nodeStateColors)
+// The node state palette, edits recolor every node with one palette upload
+void createPreferencesMenu(ImVec4 *nodeStateColors, bool *open)
 {
-    if (ImGui::Begin("Preferences"))
+    if (ImGui::Begin("Preferences", open))
     {
         ImGui::ColorEdit4("Suceptible", (float *)&nodeStateColors[0], ImGuiColorEditFlags_Float);
         ImGui::ColorEdit4("Infected", (float *)&nodeStateColors[1], ImGuiColorEditFlags_Float);
         ImGui::ColorEdit4("Recovered", (float *)&nodeStateColors[2], ImGuiColorEditFlags_Float);
-        ImGui::End();
     }
+    ImGui::End();
 }
-void dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* graph)
+bool dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* graph, ImVec4 *nodeStateColors)
 {
+    bool graphCreated = false;
     for (auto p_menu = activeMenus.begin(); p_menu != activeMenus.end();)
     {
         bool erase_entry = false;
@@ -49,6 +51,9 @@ void dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* gra
                         break;
                     case GRAPH_DESIGN_STATUS_GRAPH_CREATED:
                         erase_entry = true;
+                        graphCreated = true;
+                        break;
+                    default:
                         break;
                 }
             }
@@ -57,6 +62,9 @@ void dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* gra
             }
             else if (p_menu->first == MENU_WINDOW_PREFERENCES)
             {
+                bool open = true;
+                createPreferencesMenu(nodeStateColors, &open);
+                erase_entry = !open;
             }
 
             if (erase_entry)
@@ -69,6 +77,7 @@ void dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* gra
             }
         }
     }
+    return graphCreated;
 }
 
 void createTopMenu(UISettings &uiSettings)
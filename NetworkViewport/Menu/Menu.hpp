@@ -6,8 +6,9 @@
 #include "Menu_Window_Defines.hpp"
 namespace Menu
 {
-void createPreferencesMenu(ImVec4 *nodeStateColors);
-void dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* graph);
+void createPreferencesMenu(ImVec4 *nodeStateColors, bool *open);
+// Returns true when the graph designer generated a new graph into graph, which the caller then owns
+bool dispatchMenuWindows(std::map<Menu_Window, bool> &activeMenus, igraph_t* graph, ImVec4 *nodeStateColors);
 void createTopMenu(UISettings &uiSettings);
 }
 #endif
\ No newline at end of file
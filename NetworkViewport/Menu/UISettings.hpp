@@ -1,27 +1,181 @@
 #ifndef UISETTINGS_HPP
 #define UISETTINGS_HPP
 #include <string>
+#include <vector>
 #include <array>
 #include <map>
 #include <imgui/imgui.h>
+#include <NetworkViewport/Utils/Frame_Stats.hpp>
+#include <NetworkViewport/Graph/Graph_Analytics.hpp>
+#include <NetworkViewport/Graph/Graph_Search.hpp>
+#include <NetworkViewport/Simulation/Epidemic.hpp>
 #include "Menu_Window_Defines.hpp"
+
+enum EdgeRenderMode
+{
+	EDGE_RENDER_MODE_CYLINDERS,
+	EDGE_RENDER_MODE_LINES
+};
+
+enum DensitySplatMode
+{
+	DENSITY_SPLAT_MODE_AUTO,
+	DENSITY_SPLAT_MODE_ALWAYS,
+	DENSITY_SPLAT_MODE_NEVER
+};
+
+enum EpidemicEngineKind
+{
+	// Discrete steps on the CPU
+	EPIDEMIC_ENGINE_STEPPED,
+	// Continuous time, one event at a time
+	EPIDEMIC_ENGINE_EVENTS,
+	// Discrete steps in a compute shader, the node shader then reads its state buffer
+	EPIDEMIC_ENGINE_GPU
+};
+
 struct UISettings
 {
 	struct
 	{
 		bool nodes = true;
 		bool edges = true;
+		EdgeRenderMode edgeMode = EDGE_RENDER_MODE_CYLINDERS;
+		float lineWidth = 1.f;
+		float lineDensity = 1.f;
+		DensitySplatMode splatMode = DENSITY_SPLAT_MODE_AUTO;
+		// Projected nodes per pixel above which the graph is splatted
+		float splatThreshold = .25f;
+		float splatExposure = 1.f;
+		bool splatEdges = false;
 	} display;
 	bool animateLight = false;
 	float lightSpeed = 0.25f;
-	std::array<float, 50> frameTimes{};
-	float frameTimeMin = 9999.0f, frameTimeMax = 0.0f;
+	// Frame time percentiles and hitches, fed by ImGUI_UI::newFrame
+	utils::FrameStats frameStats;
 	float lightTimer = 0.0f;
 	bool popup = false;
 	float fontPixels = 64.0;
 	float fontSize = .5*(fontPixels)/64.0;
 	std::string fontPath;
 	ImVec4 nodeStateColors[3] = {ImVec4{1.0,1.0,.0,1.0}, ImVec4{1.0,.0,.0,1.0}, ImVec4{.0,.0,1.0,1.0}};
+	// Network epidemic coloring the nodes by nodeStateColors, stepped by the render loop
+	struct
+	{
+		simulation::EpidemicParams params;
+		bool running = false;
+		int stepsPerFrame = 1;
+		EpidemicEngineKind engine = EPIDEMIC_ENGINE_STEPPED;
+		// Simulated time per frame of the event engine, beta and gamma are rates per time unit there
+		float timePerFrame = .1f;
+		// Requests from the UI, cleared by the render loop
+		bool reset = false;
+		bool stepOnce = false;
+	} epidemic;
+	// Recording of the CPU epidemic engines, one frame per step, and the timeline replaying it
+	struct
+	{
+		bool enabled = false;
+		// Applies when a recording starts
+		int keyframeInterval = 64;
+		char path[256] = "epidemic.nvsr";
+		// Show the timeline frame instead of the simulation, which pauses meanwhile
+		bool replay = false;
+		int frame = 0;
+		// Request to replay the file at path instead of the current recording, cleared by the render loop
+		bool open = false;
+		// Written by the render loop
+		uint64_t frames = 0;
+		uint64_t bytes = 0;
+		bool failed = false;
+	} recording;
+	// Louvain communities coloring the nodes through the node palette in place of the epidemic
+	struct
+	{
+		// Set by scenes that can detect communities
+		bool available = false;
+		float resolution = 1.f;
+		// Request from the UI, cleared by the render loop
+		bool detect = false;
+		bool color = false;
+		// Written by the render loop
+		bool running = false;
+		uint32_t count = 0;
+		double modularity = 0.;
+		uint32_t levels = 0;
+		double seconds = 0.;
+	} communities;
+	// Node statistics computed in the background, their columns drive the node colors and scales
+	struct
+	{
+		// Set by scenes that can compute them
+		bool available = false;
+		float damping = .85f;
+		int samples = 256;
+		// Requests from the UI, cleared by the render loop
+		graph::analytics::AnalyticsJob run = graph::analytics::ANALYTICS_JOB_NONE;
+		bool cancel = false;
+		// Indices into columns, -1 keeps the other colors or the layout scales
+		int colorColumn = -1;
+		int scaleColumn = -1;
+		// Compresses heavy tailed columns, e.g. degrees of scale-free graphs
+		bool logarithmic = true;
+		// Factors of the layout scale at the smallest and the largest value
+		float scaleMin = .5f;
+		float scaleMax = 3.f;
+		// Written by the render loop
+		graph::analytics::AnalyticsJob running = graph::analytics::ANALYTICS_JOB_NONE;
+		float progress = 0.f;
+		std::vector<std::string> columns;
+		// log10(1 + nodes) per degree bin
+		std::vector<float> degreeHistogram;
+		uint32_t degreesPerBin = 1;
+		uint32_t maxDegree = 0;
+		double meanDegree = 0.;
+		std::string summary;
+	} analytics;
+	// k-core and component filters, applied by the node and edge shaders without touching the instance buffers
+	struct
+	{
+		// Set by scenes that can filter
+		bool available = false;
+		// Request from the UI, cleared by the render loop
+		bool decompose = false;
+		bool enabled = false;
+		// Nodes of a lower core number are hidden
+		int minCore = 0;
+		// Component shown, -1 for all, components are numbered by decreasing size
+		int component = -1;
+		// Written by the render loop
+		bool running = false;
+		bool decomposed = false;
+		uint32_t maxCore = 0;
+		// coreSizes[k] nodes in the k-core
+		std::vector<uint64_t> coreSizes;
+		// Sizes of the components that can be selected, largest first
+		std::vector<uint64_t> componentSizes;
+		uint32_t componentCount = 0;
+		double seconds = 0.;
+	} filter;
+	// Ctrl+click queries, their result is highlighted by the node and edge shaders
+	struct
+	{
+		// Set by scenes that can pick and highlight nodes
+		bool available = false;
+		graph::search::NodeQueryMode mode = graph::search::NODE_QUERY_PATH;
+		int hops = 2;
+		bool dimOthers = true;
+		// Size factor of the highlighted nodes and edges
+		float highlightScale = 1.5f;
+		// Requests from the UI, cleared by the render loop
+		bool clear = false;
+		bool rerun = false;
+		// Written by the render loop
+		// Picked nodes, the source first
+		std::vector<uint32_t> selected;
+		bool running = false;
+		std::string summary;
+	} query;
 	bool prefMenu = false;
 	int activeNumKey = -1;
 	std::map<Menu_Window, bool> activeMenus;
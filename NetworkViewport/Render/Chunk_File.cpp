@@ -0,0 +1,341 @@
+#include "Chunk_File.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	static const char CHUNK_FILE_MAGIC[4] = {'N', 'V', 'C', 'H'};
+	// Chunks start on page boundaries so a chunk maps to whole pages
+	constexpr uint64_t CHUNK_ALIGNMENT = 4096;
+	// Aggregated nodes grow with the number of nodes they stand for, up to this factor
+	constexpr float MAX_AGGREGATE_SCALE = 4.f;
+
+	struct OctreeCell
+	{
+		glm::vec3 lo;
+		glm::vec3 hi;
+		uint32_t level = 0;
+		// -1 where the octant is empty
+		std::array<int32_t, 8> children = {-1, -1, -1, -1, -1, -1, -1, -1};
+		bool leaf = true;
+		// Leaves: contained nodes and the edges starting in them.
+		// Inner cells: a sample of the subtree, with the number of nodes each sampled node represents.
+		std::vector<uint32_t> nodes;
+		std::vector<float> nodeWeights;
+		std::vector<uint32_t> edges;
+	};
+
+	static uint32_t octant(const glm::vec3 &p, const glm::vec3 &center)
+	{
+		return (p.x >= center.x ? 1u : 0u) | (p.y >= center.y ? 2u : 0u) | (p.z >= center.z ? 4u : 0u);
+	}
+
+	static void splitCell(std::vector<OctreeCell> &cells, uint32_t cellIndex, const std::vector<glm::vec3> &positions, const ChunkBuildSettings &settings)
+	{
+		if (cells[cellIndex].nodes.size() <= settings.maxChunkNodes || cells[cellIndex].level >= settings.maxDepth)
+		{
+			return;
+		}
+		glm::vec3 lo = cells[cellIndex].lo;
+		glm::vec3 hi = cells[cellIndex].hi;
+		glm::vec3 center = (lo + hi) * 0.5f;
+		std::array<std::vector<uint32_t>, 8> parts;
+		for (uint32_t node : cells[cellIndex].nodes)
+		{
+			parts[octant(positions[node], center)].push_back(node);
+		}
+		cells[cellIndex].nodes.clear();
+		cells[cellIndex].nodes.shrink_to_fit();
+		cells[cellIndex].leaf = false;
+
+		uint32_t level = cells[cellIndex].level + 1;
+		for (uint32_t o = 0; o < 8; o++)
+		{
+			if (parts[o].empty())
+			{
+				continue;
+			}
+			OctreeCell child;
+			child.lo = glm::vec3(o & 1 ? center.x : lo.x, o & 2 ? center.y : lo.y, o & 4 ? center.z : lo.z);
+			child.hi = glm::vec3(o & 1 ? hi.x : center.x, o & 2 ? hi.y : center.y, o & 4 ? hi.z : center.z);
+			child.level = level;
+			child.nodes = std::move(parts[o]);
+			uint32_t childIndex = static_cast<uint32_t>(cells.size());
+			cells.push_back(std::move(child));
+			cells[cellIndex].children[o] = static_cast<int32_t>(childIndex);
+			splitCell(cells, childIndex, positions, settings);
+		}
+	}
+
+	static uint32_t leafContaining(const std::vector<OctreeCell> &cells, const glm::vec3 &p)
+	{
+		uint32_t cellIndex = 0;
+		while (!cells[cellIndex].leaf)
+		{
+			const OctreeCell &cell = cells[cellIndex];
+			int32_t child = cell.children[octant(p, (cell.lo + cell.hi) * 0.5f)];
+			// Points that are not node positions may fall into an empty octant
+			for (uint32_t o = 0; child < 0 && o < 8; o++)
+			{
+				child = cell.children[o];
+			}
+			cellIndex = static_cast<uint32_t>(child);
+		}
+		return cellIndex;
+	}
+
+	// Fill inner cells with an evenly spaced sample of their children, bottom up
+	static void aggregateCell(std::vector<OctreeCell> &cells, uint32_t cellIndex, uint32_t maxChunkNodes)
+	{
+		if (cells[cellIndex].leaf)
+		{
+			cells[cellIndex].nodeWeights.assign(cells[cellIndex].nodes.size(), 1.f);
+			return;
+		}
+		std::vector<uint32_t> nodes, edges;
+		std::vector<float> weights;
+		for (int32_t child : cells[cellIndex].children)
+		{
+			if (child < 0)
+			{
+				continue;
+			}
+			aggregateCell(cells, static_cast<uint32_t>(child), maxChunkNodes);
+			const OctreeCell &childCell = cells[child];
+			nodes.insert(nodes.end(), childCell.nodes.begin(), childCell.nodes.end());
+			weights.insert(weights.end(), childCell.nodeWeights.begin(), childCell.nodeWeights.end());
+			edges.insert(edges.end(), childCell.edges.begin(), childCell.edges.end());
+		}
+
+		OctreeCell &cell = cells[cellIndex];
+		size_t nodeStep = (nodes.size() + maxChunkNodes - 1) / maxChunkNodes;
+		for (size_t i = 0; i < nodes.size(); i += nodeStep)
+		{
+			float weight = 0.f;
+			for (size_t j = i; j < std::min(i + nodeStep, nodes.size()); j++)
+			{
+				weight += weights[j];
+			}
+			cell.nodes.push_back(nodes[i]);
+			cell.nodeWeights.push_back(weight);
+		}
+		size_t edgeStep = (edges.size() + maxChunkNodes - 1) / maxChunkNodes;
+		for (size_t i = 0; i < edges.size(); i += edgeStep)
+		{
+			cell.edges.push_back(edges[i]);
+		}
+	}
+
+	static void expandBox(glm::vec3 &lo, glm::vec3 &hi, const glm::vec3 &p)
+	{
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+
+	static bool padTo(std::ofstream &out, uint64_t &offset, uint64_t alignment)
+	{
+		static const char zeros[CHUNK_ALIGNMENT] = {};
+		uint64_t padding = (alignment - offset % alignment) % alignment;
+		out.write(zeros, static_cast<std::streamsize>(padding));
+		offset += padding;
+		return out.good();
+	}
+
+	template <typename T>
+	static bool writeBlock(std::ofstream &out, uint64_t &offset, const std::vector<T> &data)
+	{
+		out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(T)));
+		offset += data.size() * sizeof(T);
+		return out.good();
+	}
+
+	bool writeChunkFile(const std::string &path, const std::vector<NodeInstanceData> &nodeInstanceData, const std::vector<EdgeInstanceData> &edgeInstanceData,
+						const ChunkBuildSettings &settings)
+	{
+		NV_TRACE_ZONE("Write chunk file");
+		if (nodeInstanceData.empty() || settings.maxChunkNodes == 0)
+		{
+			return false;
+		}
+
+		// Octree over node positions, the root is the bounding cube of the graph
+		std::vector<glm::vec3> positions(nodeInstanceData.size());
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		for (size_t i = 0; i < nodeInstanceData.size(); i++)
+		{
+			positions[i] = nodeInstanceData[i].pos;
+			expandBox(lo, hi, positions[i]);
+		}
+		glm::vec3 size = hi - lo;
+		float side = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+		glm::vec3 center = (lo + hi) * 0.5f;
+
+		std::vector<OctreeCell> cells(1);
+		cells[0].lo = center - glm::vec3(side * 0.5f);
+		cells[0].hi = center + glm::vec3(side * 0.5f);
+		cells[0].nodes.resize(nodeInstanceData.size());
+		for (uint32_t i = 0; i < cells[0].nodes.size(); i++)
+		{
+			cells[0].nodes[i] = i;
+		}
+		splitCell(cells, 0, positions, settings);
+
+		for (uint32_t i = 0; i < edgeInstanceData.size(); i++)
+		{
+			cells[leafContaining(cells, edgeInstanceStart(edgeInstanceData[i]))].edges.push_back(i);
+		}
+		aggregateCell(cells, 0, settings.maxChunkNodes);
+
+		// Breadth first order keeps the children of every chunk contiguous
+		std::vector<uint32_t> cellOfChunk = {0};
+		std::vector<ChunkRecord> records(cells.size());
+		std::memset(static_cast<void *>(records.data()), 0, records.size() * sizeof(ChunkRecord));
+		for (size_t chunk = 0; chunk < cellOfChunk.size(); chunk++)
+		{
+			const OctreeCell &cell = cells[cellOfChunk[chunk]];
+			records[chunk].firstChild = static_cast<uint32_t>(cellOfChunk.size());
+			for (int32_t child : cell.children)
+			{
+				if (child >= 0)
+				{
+					cellOfChunk.push_back(static_cast<uint32_t>(child));
+					records[chunk].childCount++;
+				}
+			}
+		}
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+		ChunkFileHeader header = {};
+		std::memcpy(header.magic, CHUNK_FILE_MAGIC, sizeof(header.magic));
+		header.version = CHUNK_FILE_VERSION;
+		header.nodeStride = sizeof(GpuNodeInstance);
+		header.edgeStride = sizeof(GpuEdgeInstance);
+		header.chunkCount = static_cast<uint32_t>(records.size());
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		uint64_t offset = sizeof(header);
+
+		for (size_t chunk = 0; chunk < cellOfChunk.size(); chunk++)
+		{
+			const OctreeCell &cell = cells[cellOfChunk[chunk]];
+			ChunkRecord &record = records[chunk];
+
+			std::vector<NodeInstanceData> nodes;
+			nodes.reserve(cell.nodes.size());
+			for (size_t i = 0; i < cell.nodes.size(); i++)
+			{
+				float weight = cell.nodeWeights[i];
+				float scale = weight > 1.f ? std::min(std::cbrt(weight), MAX_AGGREGATE_SCALE) : 1.f;
+				nodes.push_back(scaledNodeInstance(nodeInstanceData[cell.nodes[i]], scale));
+			}
+			std::vector<EdgeInstanceData> edges;
+			edges.reserve(cell.edges.size());
+			glm::vec3 boxLo(INFINITY), boxHi(-INFINITY);
+			for (uint32_t node : cell.nodes)
+			{
+				expandBox(boxLo, boxHi, positions[node]);
+			}
+			for (uint32_t edge : cell.edges)
+			{
+				edges.push_back(edgeInstanceData[edge]);
+				expandBox(boxLo, boxHi, edgeInstanceStart(edgeInstanceData[edge]));
+				expandBox(boxLo, boxHi, edgeInstanceEnd(edgeInstanceData[edge]));
+			}
+
+			record.boxMin = glm::vec4(boxLo, 0.f);
+			record.boxMax = glm::vec4(boxHi, 0.f);
+			record.nodeBounds = computeInstanceBounds(nodes);
+			record.edgeBounds = computeInstanceBounds(edges);
+			record.level = cell.level;
+			record.nodeCount = static_cast<uint32_t>(nodes.size());
+			record.edgeCount = static_cast<uint32_t>(edges.size());
+			header.maxChunkNodes = std::max(header.maxChunkNodes, record.nodeCount);
+			header.maxChunkEdges = std::max(header.maxChunkEdges, record.edgeCount);
+
+			if (!padTo(out, offset, CHUNK_ALIGNMENT))
+			{
+				return false;
+			}
+			record.nodeOffset = offset;
+			if (!writeBlock(out, offset, toGpuNodeInstances(nodes, record.nodeBounds)) || !padTo(out, offset, 16))
+			{
+				return false;
+			}
+			record.edgeOffset = offset;
+			if (!writeBlock(out, offset, toGpuEdgeInstances(edges, record.edgeBounds)))
+			{
+				return false;
+			}
+		}
+
+		if (!padTo(out, offset, 16))
+		{
+			return false;
+		}
+		header.tableOffset = offset;
+		writeBlock(out, offset, records);
+		out.seekp(0);
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		return out.good();
+	}
+
+	bool openChunkFile(ChunkFile &chunkFile, const std::string &path)
+	{
+		NV_TRACE_ZONE("Open chunk file");
+		utils::MappedFile file;
+		if (!utils::mapFile(file, path))
+		{
+			return false;
+		}
+		bool valid = file.size >= sizeof(ChunkFileHeader);
+		const ChunkFileHeader *header = reinterpret_cast<const ChunkFileHeader *>(file.data);
+		valid = valid && std::memcmp(header->magic, CHUNK_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+				header->version == CHUNK_FILE_VERSION &&
+				header->nodeStride == sizeof(GpuNodeInstance) &&
+				header->edgeStride == sizeof(GpuEdgeInstance) &&
+				header->chunkCount > 0 &&
+				header->tableOffset <= file.size &&
+				(file.size - header->tableOffset) / sizeof(ChunkRecord) >= header->chunkCount;
+		const ChunkRecord *chunks = valid ? reinterpret_cast<const ChunkRecord *>(file.data + header->tableOffset) : nullptr;
+		for (uint32_t i = 0; valid && i < header->chunkCount; i++)
+		{
+			const ChunkRecord &chunk = chunks[i];
+			valid = chunk.nodeCount <= header->maxChunkNodes && chunk.edgeCount <= header->maxChunkEdges &&
+					chunk.nodeOffset + uint64_t(chunk.nodeCount) * header->nodeStride <= file.size &&
+					chunk.edgeOffset + uint64_t(chunk.edgeCount) * header->edgeStride <= file.size &&
+					(chunk.childCount == 0 || (chunk.firstChild > i && uint64_t(chunk.firstChild) + chunk.childCount <= header->chunkCount));
+		}
+		if (!valid)
+		{
+			utils::unmapFile(file);
+			return false;
+		}
+		chunkFile.file = file;
+		chunkFile.header = header;
+		chunkFile.chunks = chunks;
+		return true;
+	}
+
+	void closeChunkFile(ChunkFile &chunkFile)
+	{
+		utils::unmapFile(chunkFile.file);
+		chunkFile = ChunkFile();
+	}
+
+	const uint8_t *chunkNodeData(const ChunkFile &chunkFile, const ChunkRecord &chunk)
+	{
+		return chunkFile.file.data + chunk.nodeOffset;
+	}
+
+	const uint8_t *chunkEdgeData(const ChunkFile &chunkFile, const ChunkRecord &chunk)
+	{
+		return chunkFile.file.data + chunk.edgeOffset;
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef CHUNK_FILE_HPP
+#define CHUNK_FILE_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <NetworkViewport/Utils/Mapped_File.hpp>
+#include "Packed_Instances.hpp"
+
+// ----------------------------------------------------------------------------
+// Octree chunk files
+// ----------------------------------------------------------------------------
+// Node positions are partitioned with an octree until a cell holds at most
+// maxChunkNodes nodes. Each leaf becomes a chunk with its nodes and the edges
+// that start in it. Each inner cell becomes an aggregate chunk holding an
+// evenly spaced sample of its subtree, with the sampled nodes scaled up.
+// Instances are stored in the compiled GPU layout, each chunk page aligned,
+// so a mapped chunk is copied into device memory as it is.
+//
+// Layout: ChunkFileHeader | chunk data ... | ChunkRecord[chunkCount]
+// Chunk 0 is the root, the children of a chunk are stored contiguously.
+
+namespace render
+{
+constexpr uint32_t CHUNK_FILE_VERSION = 1;
+
+struct ChunkFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	// Size of GpuNodeInstance and GpuEdgeInstance the file was written with
+	uint32_t nodeStride;
+	uint32_t edgeStride;
+	uint32_t chunkCount;
+	uint32_t maxChunkNodes;
+	uint32_t maxChunkEdges;
+	uint32_t reserved;
+	uint64_t tableOffset;
+};
+
+struct ChunkRecord
+{
+	// Box of everything drawn by the chunk, used for culling and detail selection
+	glm::vec4 boxMin;
+	glm::vec4 boxMax;
+	// Quantization boxes of the node and edge instances
+	InstanceBounds nodeBounds;
+	InstanceBounds edgeBounds;
+	uint32_t firstChild;
+	uint32_t childCount;
+	uint32_t level;
+	uint32_t nodeCount;
+	uint64_t nodeOffset;
+	uint64_t edgeOffset;
+	uint32_t edgeCount;
+	uint32_t reserved;
+};
+
+struct ChunkBuildSettings
+{
+	uint32_t maxChunkNodes = 4096;
+	uint32_t maxDepth = 16;
+};
+
+struct ChunkFile
+{
+	utils::MappedFile file;
+	const ChunkFileHeader *header = nullptr;
+	const ChunkRecord *chunks = nullptr;
+};
+
+	// Partition the graph and write it to path, returns false if the file could not be written
+	bool writeChunkFile(const std::string &path, const std::vector<NodeInstanceData> &nodeInstanceData, const std::vector<EdgeInstanceData> &edgeInstanceData,
+						const ChunkBuildSettings &settings = ChunkBuildSettings());
+
+	// Map a chunk file, fails if it is damaged or was written with the other instance layout
+	bool openChunkFile(ChunkFile &chunkFile, const std::string &path);
+	void closeChunkFile(ChunkFile &chunkFile);
+
+	const uint8_t *chunkNodeData(const ChunkFile &chunkFile, const ChunkRecord &chunk);
+	const uint8_t *chunkEdgeData(const ChunkFile &chunkFile, const ChunkRecord &chunk);
+}
+
+#endif
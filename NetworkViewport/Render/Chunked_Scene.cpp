@@ -0,0 +1,418 @@
+#include "Chunked_Scene.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	// Chunks whose data is prefetched from disk ahead of their upload
+	constexpr size_t PREFETCH_CHUNKS = 8;
+
+	struct ChunkRequest
+	{
+		uint32_t chunk;
+		uint32_t level;
+		float distance;
+	};
+
+	struct ChunkSelection
+	{
+		std::array<glm::vec4, 6> frustumPlanes;
+		glm::vec3 eye;
+		std::vector<ChunkRequest> requests;
+	};
+
+	std::unique_ptr<ChunkedScene> prepareChunkedScene(const ChunkedSceneParams &params)
+	{
+		auto scene = std::make_unique<ChunkedScene>();
+		scene->vulkanDevice = params.nodeParams.vulkanDevice;
+		scene->allocator = params.nodeParams.allocator;
+		scene->transferService = params.nodeParams.transferService;
+		scene->poolSize = params.poolSize;
+		scene->compactionBudget = params.compactionBudget;
+		scene->uploadBudget = params.uploadBudget;
+		scene->detailThreshold = params.detailThreshold;
+		scene->framesInFlight = params.framesInFlight;
+		if (!openChunkFile(scene->chunkFile, params.chunkFilePath))
+		{
+			throw std::runtime_error("Could not open chunk file " + params.chunkFilePath);
+		}
+		const ChunkFileHeader &header = *scene->chunkFile.header;
+
+		// Meshes and pipelines only, the instances live in the chunk buffers
+		scene->nodePipeline = prepareNodeInstancePipeline(params.nodeParams, {});
+		scene->edgePipeline = prepareEdgeInstancePipeline(params.edgeParams, {});
+
+		scene->chunks.resize(header.chunkCount);
+		scene->stats.chunkCount = header.chunkCount;
+		return scene;
+	}
+
+	static void releaseMove(ChunkedScene &scene, const ChunkedScene::ChunkMove &move)
+	{
+		vkDestroyBuffer(scene.vulkanDevice->logicalDevice, move.oldBuffer, nullptr);
+		freeMemory(*scene.allocator, move.source);
+	}
+
+	void destroyChunkedScene(ChunkedScene &scene)
+	{
+		destroyInstancePipeline(*scene.nodePipeline);
+		destroyInstancePipeline(*scene.edgePipeline);
+		for (auto &entry : scene.chunks)
+		{
+			destroyBuffer(*scene.allocator, entry.nodes);
+			destroyBuffer(*scene.allocator, entry.edges);
+		}
+		for (const auto &move : scene.pendingMoves)
+		{
+			releaseMove(scene, move);
+		}
+		for (const auto &move : scene.retiringMoves)
+		{
+			releaseMove(scene, move);
+		}
+		scene.pendingMoves.clear();
+		scene.retiringMoves.clear();
+		closeChunkFile(scene.chunkFile);
+	}
+
+	static std::array<glm::vec4, 6> frustumPlanes(const glm::mat4 &viewProjection)
+	{
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		return {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2};
+	}
+
+	static bool boxVisible(const std::array<glm::vec4, 6> &planes, const ChunkRecord &chunk)
+	{
+		for (const auto &plane : planes)
+		{
+			// Corner of the box furthest along the plane normal
+			glm::vec3 p(plane.x >= 0.f ? chunk.boxMax.x : chunk.boxMin.x,
+						plane.y >= 0.f ? chunk.boxMax.y : chunk.boxMin.y,
+						plane.z >= 0.f ? chunk.boxMax.z : chunk.boxMin.z);
+			if (glm::dot(glm::vec3(plane), p) + plane.w < 0.f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static float boxDistance(const glm::vec3 &eye, const ChunkRecord &chunk)
+	{
+		glm::vec3 closest = glm::clamp(eye, glm::vec3(chunk.boxMin), glm::vec3(chunk.boxMax));
+		return glm::length(eye - closest);
+	}
+
+	static bool chunkResident(const ChunkedScene &scene, uint32_t chunk)
+	{
+		return scene.chunks[chunk].state == ChunkedScene::CHUNK_RESIDENT;
+	}
+
+	// Mark a chunk as needed this frame, queue it for upload if it is missing
+	static void requestChunk(ChunkedScene &scene, ChunkSelection &selection, uint32_t chunk, float distance)
+	{
+		ChunkedScene::ChunkEntry &entry = scene.chunks[chunk];
+		if (entry.lastUsedFrame == scene.frame)
+		{
+			return;
+		}
+		entry.lastUsedFrame = scene.frame;
+		if (entry.state == ChunkedScene::CHUNK_RESIDENT)
+		{
+			scene.lru.splice(scene.lru.begin(), scene.lru, entry.lruPosition);
+		}
+		else if (entry.state == ChunkedScene::CHUNK_NOT_LOADED)
+		{
+			selection.requests.push_back({chunk, scene.chunkFile.chunks[chunk].level, distance});
+		}
+	}
+
+	static void drawChunk(ChunkedScene &scene, uint32_t chunk)
+	{
+		const ChunkRecord &record = scene.chunkFile.chunks[chunk];
+		const ChunkedScene::ChunkEntry &entry = scene.chunks[chunk];
+		if (record.nodeCount > 0)
+		{
+			scene.nodeDraws.push_back({record.nodeBounds, 0, record.nodeCount, entry.nodes.buffer});
+		}
+		if (record.edgeCount > 0)
+		{
+			scene.edgeDraws.push_back({record.edgeBounds, 0, record.edgeCount, entry.edges.buffer});
+		}
+		scene.stats.drawnChunks++;
+	}
+
+	static void selectChunk(ChunkedScene &scene, ChunkSelection &selection, uint32_t chunk)
+	{
+		const ChunkRecord &record = scene.chunkFile.chunks[chunk];
+		if (!boxVisible(selection.frustumPlanes, record))
+		{
+			return;
+		}
+		float distance = boxDistance(selection.eye, record);
+		float size = glm::length(glm::vec3(record.boxMax) - glm::vec3(record.boxMin));
+		bool refine = record.childCount > 0 && size > scene.detailThreshold * distance;
+		if (!refine)
+		{
+			requestChunk(scene, selection, chunk, distance);
+			if (chunkResident(scene, chunk))
+			{
+				drawChunk(scene, chunk);
+			}
+			return;
+		}
+
+		// Visit children front to back
+		std::vector<std::pair<float, uint32_t>> children;
+		bool childrenResident = true;
+		for (uint32_t child = record.firstChild; child < record.firstChild + record.childCount; child++)
+		{
+			const ChunkRecord &childRecord = scene.chunkFile.chunks[child];
+			if (boxVisible(selection.frustumPlanes, childRecord))
+			{
+				float childDistance = boxDistance(selection.eye, childRecord);
+				children.push_back({childDistance, child});
+				requestChunk(scene, selection, child, childDistance);
+				childrenResident = childrenResident && chunkResident(scene, child);
+			}
+		}
+		std::sort(children.begin(), children.end());
+
+		if (!childrenResident)
+		{
+			// Show the coarser aggregate while the detailed chunks load
+			requestChunk(scene, selection, chunk, distance);
+			if (chunkResident(scene, chunk))
+			{
+				drawChunk(scene, chunk);
+				scene.stats.fallbackChunks++;
+				return;
+			}
+		}
+		for (const auto &child : children)
+		{
+			selectChunk(scene, selection, child.second);
+		}
+	}
+
+	// Evict the least recently used chunks no frame in flight still draws until bytes more fit into the pool
+	static bool makeRoom(ChunkedScene &scene, VkDeviceSize bytes)
+	{
+		while (scene.residentBytes > 0 && scene.residentBytes + bytes > scene.poolSize)
+		{
+			if (scene.lru.empty())
+			{
+				return false;
+			}
+			ChunkedScene::ChunkEntry &victim = scene.chunks[scene.lru.back()];
+			if (victim.lastUsedFrame + scene.framesInFlight > scene.frame)
+			{
+				return false;
+			}
+			scene.lru.pop_back();
+			victim.state = ChunkedScene::CHUNK_NOT_LOADED;
+			scene.residentBytes -= victim.nodes.size + victim.edges.size;
+			destroyBuffer(*scene.allocator, victim.nodes);
+			destroyBuffer(*scene.allocator, victim.edges);
+			scene.stats.evictions++;
+			scene.compactionPending = true;
+		}
+		return true;
+	}
+
+	static void retireLoadedChunks(ChunkedScene &scene)
+	{
+		auto loaded = std::remove_if(scene.loading.begin(), scene.loading.end(), [&scene](uint32_t chunk)
+									 {
+										 ChunkedScene::ChunkEntry &entry = scene.chunks[chunk];
+										 if (!transferComplete(*scene.transferService, entry.ticket))
+										 {
+											 return false;
+										 }
+										 entry.state = ChunkedScene::CHUNK_RESIDENT;
+										 scene.lru.push_front(chunk);
+										 entry.lruPosition = scene.lru.begin();
+										 return true; });
+		scene.loading.erase(loaded, scene.loading.end());
+	}
+
+	static void uploadRequestedChunks(ChunkedScene &scene, ChunkSelection &selection)
+	{
+		// Coarse levels first, so there is always something to fall back to, then nearest first
+		std::sort(selection.requests.begin(), selection.requests.end(), [](const ChunkRequest &a, const ChunkRequest &b)
+				  { return a.level != b.level ? a.level < b.level : a.distance < b.distance; });
+
+		const ChunkFile &chunkFile = scene.chunkFile;
+		VkDeviceSize budget = scene.uploadBudget;
+		std::vector<uint32_t> started;
+		size_t next = 0;
+		for (; next < selection.requests.size(); next++)
+		{
+			uint32_t chunk = selection.requests[next].chunk;
+			const ChunkRecord &record = chunkFile.chunks[chunk];
+			VkDeviceSize nodeBytes = VkDeviceSize(record.nodeCount) * sizeof(GpuNodeInstance);
+			VkDeviceSize edgeBytes = VkDeviceSize(record.edgeCount) * sizeof(GpuEdgeInstance);
+			// The first chunk always goes, even if it alone exceeds the budget
+			if ((nodeBytes + edgeBytes > budget && !started.empty()) || !makeRoom(scene, nodeBytes + edgeBytes))
+			{
+				break;
+			}
+			// The buffers only become movable once resident, compaction waits until no chunk is loading
+			ChunkedScene::ChunkEntry &entry = scene.chunks[chunk];
+			if (nodeBytes > 0)
+			{
+				VK_CHECK_RESULT(createMovableBuffer(*scene.allocator, &scene, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nodeBytes, entry.nodes));
+				enqueueBufferUpload(*scene.transferService, entry.nodes.buffer, 0, chunkNodeData(chunkFile, record), nodeBytes,
+									VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+			}
+			if (edgeBytes > 0)
+			{
+				VK_CHECK_RESULT(createMovableBuffer(*scene.allocator, &scene, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, edgeBytes, entry.edges));
+				enqueueBufferUpload(*scene.transferService, entry.edges.buffer, 0, chunkEdgeData(chunkFile, record), edgeBytes,
+									VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+			}
+			entry.state = ChunkedScene::CHUNK_LOADING;
+			scene.residentBytes += nodeBytes + edgeBytes;
+			started.push_back(chunk);
+			budget -= std::min(budget, nodeBytes + edgeBytes);
+			scene.stats.uploadedBytes += nodeBytes + edgeBytes;
+		}
+
+		// Let the OS read the next chunks from disk while this frame renders
+		for (size_t i = next; i < std::min(next + PREFETCH_CHUNKS, selection.requests.size()); i++)
+		{
+			const ChunkRecord &record = chunkFile.chunks[selection.requests[i].chunk];
+			size_t end = record.edgeOffset + size_t(record.edgeCount) * sizeof(GpuEdgeInstance);
+			utils::prefetchMappedRange(chunkFile.file, record.nodeOffset, end - record.nodeOffset);
+		}
+
+		if (started.empty())
+		{
+			return;
+		}
+		TransferTicket ticket = submitTransfers(*scene.transferService);
+		for (uint32_t chunk : started)
+		{
+			scene.chunks[chunk].ticket = ticket;
+			scene.loading.push_back(chunk);
+		}
+	}
+
+	// Move resident chunk buffers out of sparsely used blocks, the frame records the copies. Draws selected before
+	// still read the old buffers, which stay alive until the frame completed
+	static void compactChunkPool(ChunkedScene &scene)
+	{
+		NV_TRACE_ZONE("Compact chunk pool");
+		std::vector<DefragmentationMove> moves = defragment(*scene.allocator, &scene, scene.compactionBudget);
+		if (moves.empty())
+		{
+			scene.compactionPending = false;
+			return;
+		}
+		std::unordered_map<Allocation *, std::pair<ChunkedScene::ChunkEntry *, AllocatedBuffer *>> owners;
+		for (uint32_t chunk : scene.lru)
+		{
+			ChunkedScene::ChunkEntry &entry = scene.chunks[chunk];
+			owners[entry.nodes.allocation] = {&entry, &entry.nodes};
+			owners[entry.edges.allocation] = {&entry, &entry.edges};
+		}
+		for (const DefragmentationMove &move : moves)
+		{
+			auto owner = owners.at(move.allocation);
+			ChunkedScene::ChunkMove chunkMove;
+			chunkMove.size = owner.second->size;
+			chunkMove.source = move.source;
+			chunkMove.oldBuffer = rebindMovedBuffer(*scene.allocator, *owner.second);
+			chunkMove.newBuffer = owner.second->buffer;
+			chunkMove.frame = scene.frame;
+			scene.pendingMoves.push_back(chunkMove);
+			// The copy of this frame reads and writes the chunk, it must not be evicted before the frame completed
+			owner.first->lastUsedFrame = scene.frame;
+			scene.stats.movedBytes += chunkMove.size;
+		}
+	}
+
+	static void releaseRetiredMoves(ChunkedScene &scene)
+	{
+		auto retired = std::remove_if(scene.retiringMoves.begin(), scene.retiringMoves.end(), [&scene](const ChunkedScene::ChunkMove &move)
+									  {
+										  if (move.frame + scene.framesInFlight > scene.frame)
+										  {
+											  return false;
+										  }
+										  releaseMove(scene, move);
+										  return true; });
+		scene.retiringMoves.erase(retired, scene.retiringMoves.end());
+	}
+
+	void updateChunkedScene(ChunkedScene &scene, const glm::mat4 &projection, const glm::mat4 &view)
+	{
+		NV_TRACE_ZONE("Update chunked scene");
+		scene.frame++;
+		retireLoadedChunks(scene);
+		releaseRetiredMoves(scene);
+
+		ChunkSelection selection;
+		selection.frustumPlanes = frustumPlanes(projection * view);
+		selection.eye = glm::vec3(glm::inverse(view)[3]);
+		scene.nodeDraws.clear();
+		scene.edgeDraws.clear();
+		scene.stats.drawnChunks = 0;
+		scene.stats.fallbackChunks = 0;
+		selectChunk(scene, selection, 0);
+
+		uploadRequestedChunks(scene, selection);
+		if (scene.compactionPending && scene.loading.empty())
+		{
+			compactChunkPool(scene);
+		}
+		scene.stats.residentBytes = scene.residentBytes;
+		scene.stats.residentChunks = static_cast<uint32_t>(scene.lru.size());
+		scene.stats.loadingChunks = static_cast<uint32_t>(scene.loading.size());
+	}
+
+	void recordChunkedSceneMoves(ChunkedScene &scene, VkCommandBuffer commandBuffer)
+	{
+		if (scene.pendingMoves.empty())
+		{
+			return;
+		}
+		// Old buffers were filled by acquired uploads or earlier moves, the destinations may still be written by
+		// earlier moves through other buffers
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 1, &barrier, 0, nullptr, 0, nullptr);
+		for (const auto &move : scene.pendingMoves)
+		{
+			VkBufferCopy region = {0, 0, move.size};
+			vkCmdCopyBuffer(commandBuffer, move.oldBuffer, move.newBuffer, 1, &region);
+		}
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+							 1, &barrier, 0, nullptr, 0, nullptr);
+		scene.retiringMoves.insert(scene.retiringMoves.end(), scene.pendingMoves.begin(), scene.pendingMoves.end());
+		scene.pendingMoves.clear();
+	}
+
+	void buildChunkedSceneCommandBuffer(ChunkedScene &scene, VkCommandBuffer commandBuffer, bool nodes, bool edges)
+	{
+		if (nodes)
+		{
+			buildInstanceCommandBuffer(*scene.nodePipeline, commandBuffer, VK_NULL_HANDLE, scene.nodeDraws);
+		}
+		if (edges)
+		{
+			buildInstanceCommandBuffer(*scene.edgePipeline, commandBuffer, VK_NULL_HANDLE, scene.edgeDraws);
+		}
+	}
+}
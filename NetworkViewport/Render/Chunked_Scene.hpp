@@ -0,0 +1,142 @@
+#ifndef CHUNKED_SCENE_HPP
+#define CHUNKED_SCENE_HPP
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include "Chunk_File.hpp"
+#include "Instance_Pipeline.hpp"
+#include "Memory_Allocator.hpp"
+#include "Transfer_Service.hpp"
+
+// ----------------------------------------------------------------------------
+// Out-of-core chunk streaming
+// ----------------------------------------------------------------------------
+// Chunks of a mapped chunk file are streamed into device-local buffers of
+// their own, up to a pool size. Every frame the octree is walked front to back: chunks
+// outside the frustum are skipped, chunks that are small on screen are drawn
+// as they are and larger ones are refined into their children. Until all
+// visible children of a chunk are resident the chunk itself (a coarser
+// aggregate) is drawn instead. Missing chunks are uploaded coarse first and
+// nearest first within a per-frame budget, and when the pool is full the
+// least recently used chunks are evicted. Evictions leave holes in the memory
+// blocks, so afterwards the chunk buffers are compacted into fewer blocks: the
+// allocator moves them, the frame copies them over and the emptied blocks are
+// released once no frame in flight reads them.
+
+namespace render
+{
+struct ChunkedSceneParams
+{
+	std::string chunkFilePath;
+	// Pipelines for the node and edge meshes, instances come from the pool
+	InstancePipelineParams nodeParams;
+	InstancePipelineParams edgeParams;
+	// Device memory for resident chunks at most
+	VkDeviceSize poolSize = 256 * 1024 * 1024;
+	// Bytes moved per compaction at most
+	VkDeviceSize compactionBudget = 16 * 1024 * 1024;
+	// Bytes uploaded per frame at most
+	VkDeviceSize uploadBudget = 16 * 1024 * 1024;
+	// A chunk is refined while its box size over its distance to the camera exceeds this
+	float detailThreshold = 0.5f;
+	// A chunk is evicted only when the frames that drew it have completed
+	uint32_t framesInFlight = 2;
+};
+
+struct ChunkedSceneStats
+{
+	uint32_t chunkCount = 0;
+	uint64_t residentBytes = 0;
+	uint32_t residentChunks = 0;
+	uint32_t loadingChunks = 0;
+	uint32_t drawnChunks = 0;
+	// Aggregates drawn because their children are still loading
+	uint32_t fallbackChunks = 0;
+	uint64_t uploadedBytes = 0;
+	uint64_t evictions = 0;
+	uint64_t movedBytes = 0;
+};
+
+struct ChunkedScene
+{
+	enum ChunkState
+	{
+		CHUNK_NOT_LOADED,
+		CHUNK_LOADING,
+		CHUNK_RESIDENT
+	};
+	struct ChunkEntry
+	{
+		ChunkState state = CHUNK_NOT_LOADED;
+		// Instances while loading or resident
+		AllocatedBuffer nodes;
+		AllocatedBuffer edges;
+		TransferTicket ticket = 0;
+		uint64_t lastUsedFrame = 0;
+		// Position in the LRU list while resident
+		std::list<uint32_t>::iterator lruPosition;
+	};
+
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	TransferService *transferService = nullptr;
+	ChunkFile chunkFile;
+	std::unique_ptr<InstancePipeline> nodePipeline;
+	std::unique_ptr<InstancePipeline> edgePipeline;
+
+	// A chunk buffer moved by compaction. The old buffer and its memory stay alive until the copy and every frame
+	// that drew from them have completed
+	struct ChunkMove
+	{
+		VkBuffer oldBuffer = VK_NULL_HANDLE;
+		VkBuffer newBuffer = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		Allocation *source = nullptr;
+		uint64_t frame = 0;
+	};
+
+	std::vector<ChunkEntry> chunks;
+	// Resident chunks, most recently used first
+	std::list<uint32_t> lru;
+	std::vector<uint32_t> loading;
+
+	// Moves whose copies the next frame records, and recorded ones waiting for their frame to complete
+	std::vector<ChunkMove> pendingMoves;
+	std::vector<ChunkMove> retiringMoves;
+	// Chunks were evicted and the pool has not been compacted since, or the last compaction hit its budget
+	bool compactionPending = false;
+
+	VkDeviceSize poolSize = 0;
+	VkDeviceSize residentBytes = 0;
+	VkDeviceSize compactionBudget = 0;
+	VkDeviceSize uploadBudget = 0;
+	float detailThreshold = 0.5f;
+	uint32_t framesInFlight = 2;
+	uint64_t frame = 0;
+
+	// Selection of the last update
+	std::vector<InstanceDraw> nodeDraws;
+	std::vector<InstanceDraw> edgeDraws;
+	ChunkedSceneStats stats;
+};
+
+	// Map the chunk file and prepare the pipelines, throws if the file can not be opened
+	std::unique_ptr<ChunkedScene> prepareChunkedScene(const ChunkedSceneParams &params);
+	void destroyChunkedScene(ChunkedScene &scene);
+
+	// Select the chunks to draw, retire finished uploads, submit new ones and compact the pool after evictions.
+	// Must run before the frame takes its transfer acquires.
+	void updateChunkedScene(ChunkedScene &scene, const glm::mat4 &projection, const glm::mat4 &view);
+
+	// Record the copies of the chunks moved by the last update, outside a render pass and after the transfer acquires
+	void recordChunkedSceneMoves(ChunkedScene &scene, VkCommandBuffer commandBuffer);
+
+	// Record the selected chunks inside an active render pass
+	void buildChunkedSceneCommandBuffer(ChunkedScene &scene, VkCommandBuffer commandBuffer, bool nodes, bool edges);
+}
+
+#endif
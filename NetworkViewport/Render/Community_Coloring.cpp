@@ -0,0 +1,56 @@
+#include "Community_Coloring.hpp"
+#include <chrono>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	bool updateCommunityColoring(CommunityColoring &communities, EpidemicColoring &epidemic, UISettings &uiSettings, UploadRing &uploadRing,
+								 UploadBatch &uploadBatch)
+	{
+		auto &settings = uiSettings.communities;
+		if (settings.detect && !communities.detection.valid())
+		{
+			communities.detection = std::async(std::launch::async, graph::community::detect_communities, std::cref(*communities.csr),
+												   settings.resolution, NODE_PALETTE_SIZE);
+		}
+		settings.detect = false;
+		if (communities.detection.valid() && communities.detection.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			graph::community::CommunityDetection detection = communities.detection.get();
+			communities.categories = std::move(detection.categories);
+			communities.shown = false;
+			settings.count = detection.result.N_communities;
+			settings.modularity = detection.result.modularity;
+			settings.levels = detection.result.levels;
+			settings.seconds = detection.result.seconds;
+			settings.color = true;
+		}
+		settings.running = communities.detection.valid();
+		if (!settings.color || communities.categories.empty())
+		{
+			communities.shown = false;
+			return false;
+		}
+
+		NV_TRACE_ZONE("Update communities");
+		glm::vec4 palette[NODE_PALETTE_SIZE];
+		for (uint32_t color = 0; color < NODE_PALETTE_SIZE; color++)
+		{
+			palette[color] = graph::community::community_color(color, NODE_PALETTE_SIZE);
+		}
+		setNodePalette(epidemic.stateBuffer, palette, NODE_PALETTE_SIZE);
+		if (!communities.shown)
+		{
+			setAllNodeStates(epidemic.stateBuffer, communities.categories.data());
+			communities.shown = true;
+		}
+		epidemic.nodes->stateLookup.enabled = 1;
+		// The epidemic shows its states again once the communities are hidden, the compute shader one starts over
+		epidemic.stale = epidemic.shown;
+		epidemic.gpuShown = false;
+		epidemic.replaying = false;
+		uiSettings.epidemic.stepOnce = false;
+		stageNodeStates(epidemic.stateBuffer, uploadRing, uploadBatch);
+		return true;
+	}
+}
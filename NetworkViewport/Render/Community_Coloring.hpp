@@ -0,0 +1,38 @@
+#ifndef COMMUNITY_COLORING_HPP
+#define COMMUNITY_COLORING_HPP
+#include <cstdint>
+#include <future>
+#include <vector>
+#include <NetworkViewport/Graph/Graph_Communities.hpp>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include "Epidemic_Coloring.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Community node colors
+// ----------------------------------------------------------------------------
+// Louvain communities detected on a worker thread, shown through the node
+// state buffer of the epidemic coloring with a palette of well separated hues.
+// The epidemic pauses while the communities are shown and starts from its own
+// states again once they are hidden.
+
+namespace render
+{
+struct CommunityColoring
+{
+	// Must outlive a running detection
+	const graph::CSRGraph *csr = nullptr;
+	std::future<graph::community::CommunityDetection> detection;
+	// Empty until the first detection finished
+	std::vector<uint8_t> categories;
+	// The state buffer holds the categories
+	bool shown = false;
+};
+
+	// Start a requested detection, take over a finished one and color by the categories while enabled, through the epidemic's
+	// state buffer and palette. True while the communities are shown, the epidemic is not updated meanwhile
+	bool updateCommunityColoring(CommunityColoring &communities, EpidemicColoring &epidemic, UISettings &uiSettings, UploadRing &uploadRing,
+								 UploadBatch &uploadBatch);
+}
+
+#endif
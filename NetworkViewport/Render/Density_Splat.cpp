@@ -0,0 +1,498 @@
+#include "Density_Splat.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+#include <VulkanTools/Utilities/VulkanPipelineInitializers.hpp>
+#include <VulkanTools/InstanceGraphics/GLTF_Assets.hpp>
+
+namespace render
+{
+	static_assert(sizeof(EdgeInstanceData) >= 2 * sizeof(glm::vec3), "EdgeInstanceData must start with its two end points");
+
+	// Hysteresis band for leaving splat mode, as a fraction of the entry threshold
+	static constexpr float DENSITY_SPLAT_EXIT_FRACTION = .5f;
+
+	static VkFormat selectAccumulationFormat(VulkanDevice *vulkanDevice)
+	{
+		// 32 bit float blending is optional, 16 bit float blending is guaranteed
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, VK_FORMAT_R32_SFLOAT, &formatProperties);
+		VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		if ((formatProperties.optimalTilingFeatures & required) == required)
+		{
+			return VK_FORMAT_R32_SFLOAT;
+		}
+		return VK_FORMAT_R16_SFLOAT;
+	}
+
+	static void createSplatRenderPass(DensitySplat &splat)
+	{
+		VkAttachmentDescription attachment = {};
+		attachment.format = splat.accumulationFormat;
+		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference colorReference = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorReference;
+
+		// Previous heatmap reads must finish before accumulating, and accumulation before the next read
+		std::array<VkSubpassDependency, 2> dependencies{};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &attachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
+		VK_CHECK_RESULT(vkCreateRenderPass(splat.vulkanDevice->logicalDevice, &renderPassInfo, nullptr, &splat.splatRenderPass));
+	}
+
+	static void createAccumulationTarget(DensitySplat &splat)
+	{
+		VkDevice logicalDevice = splat.vulkanDevice->logicalDevice;
+
+		VkImageCreateInfo imageInfo = initializers::imageCreateInfo();
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = splat.accumulationFormat;
+		imageInfo.extent.width = splat.width;
+		imageInfo.extent.height = splat.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK_RESULT(createImage(*splat.allocator, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, splat.image, splat.imageAllocation));
+
+		VkImageViewCreateInfo viewInfo = initializers::imageViewCreateInfo();
+		viewInfo.image = splat.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = splat.accumulationFormat;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.layerCount = 1;
+		VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewInfo, nullptr, &splat.imageView));
+
+		VkFramebufferCreateInfo frameBufferInfo = {};
+		frameBufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frameBufferInfo.renderPass = splat.splatRenderPass;
+		frameBufferInfo.attachmentCount = 1;
+		frameBufferInfo.pAttachments = &splat.imageView;
+		frameBufferInfo.width = splat.width;
+		frameBufferInfo.height = splat.height;
+		frameBufferInfo.layers = 1;
+		VK_CHECK_RESULT(vkCreateFramebuffer(logicalDevice, &frameBufferInfo, nullptr, &splat.frameBuffer));
+
+		if (splat.heatmapSet != VK_NULL_HANDLE)
+		{
+			VkDescriptorImageInfo densityDescriptor = initializers::descriptorImageInfo(
+				splat.sampler,
+				splat.imageView,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+				initializers::writeDescriptorSet(splat.heatmapSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &densityDescriptor, 1)};
+			vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		}
+	}
+
+	static void destroyAccumulationTarget(DensitySplat &splat)
+	{
+		VkDevice logicalDevice = splat.vulkanDevice->logicalDevice;
+		vkDestroyFramebuffer(logicalDevice, splat.frameBuffer, nullptr);
+		vkDestroyImageView(logicalDevice, splat.imageView, nullptr);
+		destroyImage(*splat.allocator, splat.image, splat.imageAllocation);
+	}
+
+	static VkPipeline createPipeline(VkDevice logicalDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache pipelineCache,
+									 VkPrimitiveTopology topology, const VkPipelineColorBlendAttachmentState &blendAttachmentState,
+									 const VkPipelineVertexInputStateCreateInfo &vertexInputState,
+									 const std::string &vertexShaderPath, const std::string &fragmentShaderPath)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			initializers::pipelineInputAssemblyStateCreateInfo(topology, 0, VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState =
+			initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			initializers::pipelineDepthStencilStateCreateInfo(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT);
+
+		std::vector<VkDynamicState> dynamicStateEnables = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR};
+		VkPipelineDynamicStateCreateInfo dynamicState =
+			initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
+
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+		shaderStages[0] = loadShader(logicalDevice, vertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
+		shaderStages[1] = loadShader(logicalDevice, fragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfo = initializers::pipelineCreateInfo(pipelineLayout, renderPass);
+		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+		pipelineCreateInfo.pRasterizationState = &rasterizationState;
+		pipelineCreateInfo.pColorBlendState = &colorBlendState;
+		pipelineCreateInfo.pMultisampleState = &multisampleState;
+		pipelineCreateInfo.pViewportState = &viewportState;
+		pipelineCreateInfo.pDepthStencilState = &depthStencilState;
+		pipelineCreateInfo.pDynamicState = &dynamicState;
+		pipelineCreateInfo.pVertexInputState = &vertexInputState;
+		pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCreateInfo.pStages = shaderStages.data();
+
+		VkPipeline pipeline;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(logicalDevice, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline));
+
+		vkDestroyShaderModule(logicalDevice, shaderStages[0].module, nullptr);
+		vkDestroyShaderModule(logicalDevice, shaderStages[1].module, nullptr);
+		return pipeline;
+	}
+
+	static void createPipelines(DensitySplat &splat, const DensitySplatParams &params)
+	{
+		VkDevice logicalDevice = splat.vulkanDevice->logicalDevice;
+
+		// Pipeline layouts
+		VkPushConstantRange splatPushConstantRange = initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(splat.splatPushConstBlock), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = initializers::pipelineLayoutCreateInfo(&splat.splatSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &splatPushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &splat.splatPipelineLayout));
+
+		VkPushConstantRange heatmapPushConstantRange = initializers::pushConstantRange(VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(splat.heatmapPushConstBlock), 0);
+		pipelineLayoutCreateInfo = initializers::pipelineLayoutCreateInfo(&splat.heatmapSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &heatmapPushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &splat.heatmapPipelineLayout));
+
+		// Splats accumulate additively
+		VkPipelineColorBlendAttachmentState additiveBlend{};
+		additiveBlend.blendEnable = VK_TRUE;
+		additiveBlend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+		additiveBlend.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		additiveBlend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		additiveBlend.colorBlendOp = VK_BLEND_OP_ADD;
+		additiveBlend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		additiveBlend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		additiveBlend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		// Nodes: one point per node instance, only the position is read
+		std::vector<VkVertexInputBindingDescription> nodeBindings = {
+			initializers::vertexInputBindingDescription(0, sizeof(GpuNodeInstance), VK_VERTEX_INPUT_RATE_VERTEX),
+		};
+		std::vector<VkVertexInputAttributeDescription> nodeAttributes = {
+#ifdef NV_PACKED_INSTANCES
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedNodeInstance, position)), // Location 0: Node position
+#else
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(NodeInstanceData, pos)), // Location 0: Node position
+#endif
+		};
+		VkPipelineVertexInputStateCreateInfo nodeInputState = initializers::pipelineVertexInputStateCreateInfo();
+		nodeInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(nodeBindings.size());
+		nodeInputState.pVertexBindingDescriptions = nodeBindings.data();
+		nodeInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(nodeAttributes.size());
+		nodeInputState.pVertexAttributeDescriptions = nodeAttributes.data();
+
+		splat.nodePipeline = createPipeline(logicalDevice, splat.splatPipelineLayout, splat.splatRenderPass, params.pipelineCache,
+											VK_PRIMITIVE_TOPOLOGY_POINT_LIST, additiveBlend, nodeInputState,
+											params.shadersPath + "splat_node" + INSTANCE_SHADER_VARIANT + ".vert.spv", params.shadersPath + "splat_node.frag.spv");
+
+		// Edges: one line per edge instance, end points picked by gl_VertexIndex
+		std::vector<VkVertexInputBindingDescription> edgeBindings = {
+			initializers::vertexInputBindingDescription(0, sizeof(GpuEdgeInstance), VK_VERTEX_INPUT_RATE_INSTANCE),
+		};
+		std::vector<VkVertexInputAttributeDescription> edgeAttributes = {
+#ifdef NV_PACKED_INSTANCES
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedEdgeInstance, start)), // Location 0: Start node position
+			initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedEdgeInstance, end)),   // Location 1: End node position
+#else
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),                 // Location 0: Start node position
+			initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(glm::vec3)), // Location 1: End node position
+#endif
+		};
+		VkPipelineVertexInputStateCreateInfo edgeInputState = initializers::pipelineVertexInputStateCreateInfo();
+		edgeInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(edgeBindings.size());
+		edgeInputState.pVertexBindingDescriptions = edgeBindings.data();
+		edgeInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(edgeAttributes.size());
+		edgeInputState.pVertexAttributeDescriptions = edgeAttributes.data();
+
+		splat.edgePipeline = createPipeline(logicalDevice, splat.splatPipelineLayout, splat.splatRenderPass, params.pipelineCache,
+											VK_PRIMITIVE_TOPOLOGY_LINE_LIST, additiveBlend, edgeInputState,
+											params.shadersPath + "splat_edge" + INSTANCE_SHADER_VARIANT + ".vert.spv", params.shadersPath + "splat_edge.frag.spv");
+
+		// Heatmap: fullscreen triangle blended over the cleared background
+		VkPipelineColorBlendAttachmentState alphaBlend{};
+		alphaBlend.blendEnable = VK_TRUE;
+		alphaBlend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		alphaBlend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		alphaBlend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		alphaBlend.colorBlendOp = VK_BLEND_OP_ADD;
+		alphaBlend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		alphaBlend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		alphaBlend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineVertexInputStateCreateInfo emptyInputState = initializers::pipelineVertexInputStateCreateInfo();
+
+		splat.heatmapPipeline = createPipeline(logicalDevice, splat.heatmapPipelineLayout, params.renderPass, params.pipelineCache,
+											   VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, alphaBlend, emptyInputState,
+											   params.shadersPath + "heatmap.vert.spv", params.shadersPath + "heatmap.frag.spv");
+	}
+
+	std::unique_ptr<DensitySplat> prepareDensitySplat(const DensitySplatParams &params, const InstanceBufferView &nodeInstances, const InstanceBufferView &edgeInstances)
+	{
+		auto splat = std::make_unique<DensitySplat>();
+		splat->vulkanDevice = params.vulkanDevice;
+		splat->allocator = params.allocator;
+		splat->width = params.width;
+		splat->height = params.height;
+		splat->accumulationFormat = selectAccumulationFormat(params.vulkanDevice);
+		VkDevice logicalDevice = params.vulkanDevice->logicalDevice;
+
+		// Point sizes above one pixel need the largePoints feature
+		if (!params.vulkanDevice->enabledFeatures.largePoints)
+		{
+			splat->splatPushConstBlock.pointSize = 1.f;
+		}
+
+		splat->nodeBuffer = nodeInstances.buffer;
+		splat->nodeCount = nodeInstances.instanceCount;
+		splat->nodeBounds = nodeInstances.bounds;
+		splat->boundsMin = glm::vec3(nodeInstances.bounds.origin);
+		splat->boundsMax = glm::vec3(nodeInstances.bounds.origin + nodeInstances.bounds.extent);
+		splat->edgeBuffer = edgeInstances.buffer;
+		splat->edgeCount = edgeInstances.instanceCount;
+		splat->edgeBounds = edgeInstances.bounds;
+
+		// Density sampler
+		VkSamplerCreateInfo samplerInfo = initializers::samplerCreateInfo();
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+		VK_CHECK_RESULT(vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &splat->sampler));
+
+		// Descriptor pool
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+			initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = initializers::descriptorPoolCreateInfo(poolSizes, 2);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &splat->descriptorPool));
+
+		// Descriptor set layouts
+		std::vector<VkDescriptorSetLayoutBinding> splatBindings = {
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0, 1),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = initializers::descriptorSetLayoutCreateInfo(splatBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &splat->splatSetLayout));
+
+		std::vector<VkDescriptorSetLayoutBinding> heatmapBindings = {
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0, 1),
+		};
+		descriptorLayout = initializers::descriptorSetLayoutCreateInfo(heatmapBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &splat->heatmapSetLayout));
+
+		// Descriptor sets
+		VkDescriptorSetAllocateInfo allocInfo = initializers::descriptorSetAllocateInfo(splat->descriptorPool, &splat->splatSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &splat->splatSet));
+		allocInfo = initializers::descriptorSetAllocateInfo(splat->descriptorPool, &splat->heatmapSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &splat->heatmapSet));
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			initializers::writeDescriptorSet(splat->splatSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &params.uniformProjectionBuffer, 1)};
+		vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+		createSplatRenderPass(*splat);
+		createAccumulationTarget(*splat);
+		createPipelines(*splat, params);
+
+		return splat;
+	}
+
+	void destroyDensitySplat(DensitySplat &splat)
+	{
+		VkDevice logicalDevice = splat.vulkanDevice->logicalDevice;
+		destroyAccumulationTarget(splat);
+		vkDestroySampler(logicalDevice, splat.sampler, nullptr);
+		vkDestroyRenderPass(logicalDevice, splat.splatRenderPass, nullptr);
+		vkDestroyPipeline(logicalDevice, splat.nodePipeline, nullptr);
+		vkDestroyPipeline(logicalDevice, splat.edgePipeline, nullptr);
+		vkDestroyPipeline(logicalDevice, splat.heatmapPipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, splat.splatPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, splat.heatmapPipelineLayout, nullptr);
+		vkDestroyDescriptorPool(logicalDevice, splat.descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, splat.splatSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, splat.heatmapSetLayout, nullptr);
+	}
+
+	void resizeDensitySplat(DensitySplat &splat, uint32_t width, uint32_t height)
+	{
+		if (width == splat.width && height == splat.height)
+		{
+			return;
+		}
+		destroyAccumulationTarget(splat);
+		splat.width = width;
+		splat.height = height;
+		createAccumulationTarget(splat);
+	}
+
+	float projectedNodeDensity(const glm::mat4 &viewProjection, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, uint32_t nodeCount, uint32_t width, uint32_t height)
+	{
+		if (nodeCount == 0 || width == 0 || height == 0)
+		{
+			return 0.f;
+		}
+		glm::vec2 screenMin(std::numeric_limits<float>::max());
+		glm::vec2 screenMax(std::numeric_limits<float>::lowest());
+		bool anyInFront = false;
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 p((corner & 1) ? boundsMax.x : boundsMin.x,
+						(corner & 2) ? boundsMax.y : boundsMin.y,
+						(corner & 4) ? boundsMax.z : boundsMin.z);
+			glm::vec4 clip = viewProjection * glm::vec4(p, 1.f);
+			if (clip.w <= 0.f)
+			{
+				// Bounds straddle the camera, the graph fills the screen
+				screenMin = glm::vec2(-1.f);
+				screenMax = glm::vec2(1.f);
+				continue;
+			}
+			anyInFront = true;
+			glm::vec2 ndc = glm::vec2(clip) / clip.w;
+			screenMin = glm::min(screenMin, ndc);
+			screenMax = glm::max(screenMax, ndc);
+		}
+		if (!anyInFront)
+		{
+			return 0.f;
+		}
+		screenMin = glm::clamp(screenMin, glm::vec2(-1.f), glm::vec2(1.f));
+		screenMax = glm::clamp(screenMax, glm::vec2(-1.f), glm::vec2(1.f));
+		glm::vec2 extent = (screenMax - screenMin) * 0.5f * glm::vec2(width, height);
+		float pixels = std::max(extent.x, 1.f) * std::max(extent.y, 1.f);
+		return nodeCount / pixels;
+	}
+
+	bool chooseDensitySplat(DensitySplatMode mode, float density, float threshold, bool currentlyActive)
+	{
+		switch (mode)
+		{
+		case DENSITY_SPLAT_MODE_ALWAYS:
+			return true;
+		case DENSITY_SPLAT_MODE_NEVER:
+			return false;
+		case DENSITY_SPLAT_MODE_AUTO:
+			break;
+		}
+		if (currentlyActive)
+		{
+			return density > threshold * DENSITY_SPLAT_EXIT_FRACTION;
+		}
+		return density > threshold;
+	}
+
+	void updateDensitySplatState(DensitySplat &splat, DensitySplatMode mode, const glm::mat4 &viewProjection, float threshold)
+	{
+		float density = projectedNodeDensity(viewProjection, splat.boundsMin, splat.boundsMax, splat.nodeCount, splat.width, splat.height);
+		splat.active = chooseDensitySplat(mode, density, threshold, splat.active);
+		// Normalize so that the average covered pixel lands in the middle of the heatmap
+		float pointArea = splat.splatPushConstBlock.pointSize * splat.splatPushConstBlock.pointSize;
+		splat.heatmapPushConstBlock.exposure = 1.f / std::max(density * pointArea * splat.splatPushConstBlock.weight, 1e-3f);
+	}
+
+	void buildDensitySplatPass(DensitySplat &splat, VkCommandBuffer commandBuffer, bool splatEdges)
+	{
+		VkClearValue clearValue;
+		clearValue.color = {{0.f, 0.f, 0.f, 0.f}};
+
+		VkRenderPassBeginInfo renderPassBeginInfo = initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = splat.splatRenderPass;
+		renderPassBeginInfo.framebuffer = splat.frameBuffer;
+		renderPassBeginInfo.renderArea.extent.width = splat.width;
+		renderPassBeginInfo.renderArea.extent.height = splat.height;
+		renderPassBeginInfo.clearValueCount = 1;
+		renderPassBeginInfo.pClearValues = &clearValue;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = initializers::viewport((float)splat.width, (float)splat.height, 0.0f, 1.0f);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		VkRect2D scissor = initializers::rect2D(splat.width, splat.height, 0, 0);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, splat.splatPipelineLayout, 0, 1, &splat.splatSet, 0, nullptr);
+		VkDeviceSize offsets[1] = {0};
+
+		if (splat.nodeCount > 0)
+		{
+			DensitySplat::SplatPushConstBlock nodePushConstBlock = splat.splatPushConstBlock;
+			nodePushConstBlock.bounds = splat.nodeBounds;
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, splat.nodePipeline);
+			vkCmdPushConstants(commandBuffer, splat.splatPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(nodePushConstBlock), &nodePushConstBlock);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &splat.nodeBuffer, offsets);
+			vkCmdDraw(commandBuffer, splat.nodeCount, 1, 0, 0);
+		}
+		if (splatEdges && splat.edgeCount > 0)
+		{
+			// Edges cover many pixels each, weigh them down so nodes still dominate
+			DensitySplat::SplatPushConstBlock edgePushConstBlock = splat.splatPushConstBlock;
+			edgePushConstBlock.bounds = splat.edgeBounds;
+			edgePushConstBlock.weight *= .1f;
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, splat.edgePipeline);
+			vkCmdPushConstants(commandBuffer, splat.splatPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(edgePushConstBlock), &edgePushConstBlock);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &splat.edgeBuffer, offsets);
+			vkCmdDraw(commandBuffer, 2, splat.edgeCount, 0, 0);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void drawDensityHeatmap(DensitySplat &splat, VkCommandBuffer commandBuffer, float exposure)
+	{
+		DensitySplat::HeatmapPushConstBlock pushConstBlock = splat.heatmapPushConstBlock;
+		pushConstBlock.exposure *= exposure;
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, splat.heatmapPipelineLayout, 0, 1, &splat.heatmapSet, 0, nullptr);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, splat.heatmapPipeline);
+		vkCmdPushConstants(commandBuffer, splat.heatmapPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstBlock), &pushConstBlock);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+}
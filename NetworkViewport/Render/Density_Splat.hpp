@@ -0,0 +1,117 @@
+#ifndef DENSITY_SPLAT_HPP
+#define DENSITY_SPLAT_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <VulkanTools/Structures/VulkanBuffer.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include "Instance_Pipeline.hpp"
+#include "Memory_Allocator.hpp"
+
+// ----------------------------------------------------------------------------
+// Density splatting
+// ----------------------------------------------------------------------------
+// Nodes (and optionally edges) are splatted with additive blending into a
+// single channel float target at screen resolution, which is then tone-mapped
+// to a heatmap inside the main render pass. Cost is bounded by the number of
+// pixels touched rather than by the per-instance glTF geometry. Nodes and edges
+// are read from the instance pipelines' buffers, in the compiled GPU layout
+// (see Packed_Instances.hpp), pair the splat with the matching splat_node and
+// splat_edge shader variants.
+
+namespace render
+{
+struct DensitySplatParams
+{
+	std::string shadersPath;
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	VkDescriptorBufferInfo uniformProjectionBuffer{};
+	// Main render pass the heatmap is composited in
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+struct DensitySplat
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	VkFormat accumulationFormat = VK_FORMAT_R16_SFLOAT;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	// Accumulation target
+	VkImage image = VK_NULL_HANDLE;
+	Allocation *imageAllocation = nullptr;
+	VkImageView imageView = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkRenderPass splatRenderPass = VK_NULL_HANDLE;
+	VkFramebuffer frameBuffer = VK_NULL_HANDLE;
+
+	// Borrowed from the node and edge instance pipelines
+	VkBuffer nodeBuffer = VK_NULL_HANDLE;
+	VkBuffer edgeBuffer = VK_NULL_HANDLE;
+	uint32_t nodeCount = 0;
+	uint32_t edgeCount = 0;
+	InstanceBounds nodeBounds;
+	InstanceBounds edgeBounds;
+	glm::vec3 boundsMin = glm::vec3(0.f);
+	glm::vec3 boundsMax = glm::vec3(0.f);
+
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout splatSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout heatmapSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet splatSet = VK_NULL_HANDLE;
+	VkDescriptorSet heatmapSet = VK_NULL_HANDLE;
+	VkPipelineLayout splatPipelineLayout = VK_NULL_HANDLE;
+	VkPipelineLayout heatmapPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline nodePipeline = VK_NULL_HANDLE;
+	VkPipeline edgePipeline = VK_NULL_HANDLE;
+	VkPipeline heatmapPipeline = VK_NULL_HANDLE;
+
+	// Set each frame by updateDensitySplatState
+	bool active = false;
+
+	// The quantization box of the drawn instances comes first as in edge.vert, set per draw
+	struct SplatPushConstBlock
+	{
+		InstanceBounds bounds;
+		float pointSize = 3.f;
+		float weight = 1.f;
+	} splatPushConstBlock;
+	struct HeatmapPushConstBlock
+	{
+		float exposure = 1.f;
+		float opacity = 1.f;
+	} heatmapPushConstBlock;
+};
+
+	// Create the accumulation target and the pipelines splatting the given instances, the buffers have to outlive it
+	std::unique_ptr<DensitySplat> prepareDensitySplat(const DensitySplatParams &params, const InstanceBufferView &nodeInstances, const InstanceBufferView &edgeInstances);
+
+	void destroyDensitySplat(DensitySplat &splat);
+
+	// Recreate the accumulation target for a new framebuffer size
+	void resizeDensitySplat(DensitySplat &splat, uint32_t width, uint32_t height);
+
+	// Projected nodes per pixel of the screen area covered by the graph bounds, 0 if the graph is behind the camera
+	float projectedNodeDensity(const glm::mat4 &viewProjection, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, uint32_t nodeCount, uint32_t width, uint32_t height);
+
+	// Decide whether to splat this frame, with hysteresis so the view does not flicker at the threshold
+	bool chooseDensitySplat(DensitySplatMode mode, float density, float threshold, bool currentlyActive);
+
+	void updateDensitySplatState(DensitySplat &splat, DensitySplatMode mode, const glm::mat4 &viewProjection, float threshold);
+
+	// Record the accumulation pass, must be called outside of a render pass
+	void buildDensitySplatPass(DensitySplat &splat, VkCommandBuffer commandBuffer, bool splatEdges);
+
+	// Composite the tone-mapped density inside the main render pass
+	void drawDensityHeatmap(DensitySplat &splat, VkCommandBuffer commandBuffer, float exposure);
+}
+
+#endif
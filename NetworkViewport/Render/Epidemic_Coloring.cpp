@@ -0,0 +1,186 @@
+#include "Epidemic_Coloring.hpp"
+#include <algorithm>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	// Bounds the work of one frame when the event rates are high for the graph, simulated time then lags behind
+	constexpr uint64_t EPIDEMIC_EVENTS_PER_FRAME_MAX = 1 << 20;
+
+	bool updateEpidemicReplay(EpidemicColoring &epidemic, UISettings &uiSettings)
+	{
+		auto &recording = uiSettings.recording;
+		uint32_t N_nodes = static_cast<uint32_t>(epidemic.engine.state.size());
+		if (recording.open)
+		{
+			recording.open = false;
+			recording.enabled = false;
+			simulation::stopStateRecorder(epidemic.recorder);
+			bool opened = simulation::openStatePlayback(epidemic.playback, recording.path) && epidemic.playback.N_nodes == N_nodes;
+			if (!opened)
+			{
+				simulation::closeStatePlayback(epidemic.playback);
+			}
+			recording.failed = !opened;
+			recording.replay = opened;
+			recording.frame = 0;
+			epidemic.playbackFromFile = opened;
+		}
+		if (recording.enabled && !epidemic.recorder.active)
+		{
+			// Starting over truncates the file, possibly the one replayed
+			simulation::closeStatePlayback(epidemic.playback);
+			epidemic.playbackFromFile = false;
+			recording.failed = !simulation::startStateRecorder(epidemic.recorder, recording.path, N_nodes, static_cast<uint32_t>(std::max(recording.keyframeInterval, 1)));
+			recording.enabled = !recording.failed;
+		}
+		else if (!recording.enabled && epidemic.recorder.active)
+		{
+			simulation::stopStateRecorder(epidemic.recorder);
+		}
+		if (!epidemic.playbackFromFile)
+		{
+			if (epidemic.playback.file.is_open())
+			{
+				simulation::refreshStatePlayback(epidemic.playback, epidemic.recorder);
+			}
+			else
+			{
+				simulation::attachStatePlayback(epidemic.playback, epidemic.recorder);
+			}
+		}
+		recording.frames = simulation::playbackFrameCount(epidemic.playback);
+		recording.bytes = epidemic.recorder.fileBytes;
+
+		if (!recording.replay || recording.frames == 0)
+		{
+			epidemic.replaying = false;
+			return false;
+		}
+		recording.frame = std::clamp(recording.frame, 0, static_cast<int>(recording.frames - 1));
+		simulation::StatePlayback &playback = epidemic.playback;
+		bool entering = !epidemic.replaying;
+		if (entering || playback.frame != recording.frame)
+		{
+			// A failed seek still reports the nodes it changed
+			simulation::seekStatePlayback(playback, static_cast<uint64_t>(recording.frame));
+			if (entering)
+			{
+				setAllNodeStates(epidemic.stateBuffer, playback.state.data());
+			}
+			else
+			{
+				setNodeStates(epidemic.stateBuffer, playback.changed, playback.state.data());
+			}
+		}
+		epidemic.nodes->stateLookup.enabled = 1;
+		epidemic.replaying = true;
+		epidemic.stale = true;
+		epidemic.gpuShown = false;
+		uiSettings.epidemic.stepOnce = false;
+		return true;
+	}
+
+	void updateGpuEpidemicColoring(EpidemicColoring &epidemic, GpuEpidemic &gpuEpidemic, UISettings &uiSettings)
+	{
+		auto &settings = uiSettings.epidemic;
+		// The outbreak starts over once a CPU engine or the replay has overwritten its states
+		if (settings.reset || !epidemic.gpuShown)
+		{
+			resetGpuEpidemic(gpuEpidemic, settings.params);
+			settings.reset = false;
+		}
+		discardNodeStateUploads(epidemic.stateBuffer);
+		int steps = settings.running ? settings.stepsPerFrame : (settings.stepOnce ? 1 : 0);
+		settings.stepOnce = false;
+		scheduleGpuEpidemicSteps(gpuEpidemic, static_cast<uint32_t>(steps));
+
+		epidemic.nodes->stateLookup.enabled = 1;
+		epidemic.gpuShown = true;
+		epidemic.stale = true;
+	}
+
+	void updateEpidemicColoring(EpidemicColoring &epidemic, UISettings &uiSettings, UploadRing &uploadRing, UploadBatch &uploadBatch,
+								GpuEpidemic *gpuEpidemic)
+	{
+		NV_TRACE_ZONE("Update epidemic");
+		auto &settings = uiSettings.epidemic;
+		glm::vec4 palette[simulation::NODE_STATE_COUNT];
+		for (uint32_t nodeState = 0; nodeState < simulation::NODE_STATE_COUNT; nodeState++)
+		{
+			const ImVec4 &color = uiSettings.nodeStateColors[nodeState];
+			palette[nodeState] = glm::vec4(color.x, color.y, color.z, color.w);
+		}
+		setNodePalette(epidemic.stateBuffer, palette, simulation::NODE_STATE_COUNT);
+		if (updateEpidemicReplay(epidemic, uiSettings))
+		{
+			stageNodeStates(epidemic.stateBuffer, uploadRing, uploadBatch);
+			return;
+		}
+		if (gpuEpidemic && settings.engine == EPIDEMIC_ENGINE_GPU)
+		{
+			updateGpuEpidemicColoring(epidemic, *gpuEpidemic, uiSettings);
+			stageNodeStates(epidemic.stateBuffer, uploadRing, uploadBatch);
+			return;
+		}
+
+		bool events = settings.engine == EPIDEMIC_ENGINE_EVENTS;
+		bool recolor = epidemic.stale || (epidemic.shown && settings.engine != epidemic.shownEngine);
+		if (settings.reset)
+		{
+			if (events)
+			{
+				simulation::resetGillespie(epidemic.events, settings.params);
+			}
+			else
+			{
+				simulation::resetEpidemic(epidemic.engine, settings.params);
+			}
+			settings.reset = false;
+			recolor = true;
+			epidemic.recorder.keyframePending = true;
+		}
+		if ((settings.running || settings.stepOnce) && !epidemic.shown)
+		{
+			recolor = true;
+		}
+		const uint8_t *states = events ? epidemic.events.state.data() : epidemic.engine.state.data();
+		if (recolor)
+		{
+			setAllNodeStates(epidemic.stateBuffer, states);
+			epidemic.shown = true;
+			epidemic.shownEngine = settings.engine;
+			epidemic.stale = false;
+			epidemic.gpuShown = false;
+		}
+		epidemic.nodes->stateLookup.enabled = epidemic.shown ? 1 : 0;
+		if (epidemic.recorder.keyframePending)
+		{
+			simulation::recordSimulationFrame(epidemic.recorder, settings.engine, states, {});
+		}
+
+		if (events)
+		{
+			// Step advances one time unit
+			double duration = settings.running ? settings.timePerFrame : (settings.stepOnce ? 1. : 0.);
+			settings.stepOnce = false;
+			if (duration > 0. && simulation::gillespieActive(epidemic.events))
+			{
+				simulation::advanceGillespie(epidemic.events, epidemic.events.time + duration, EPIDEMIC_EVENTS_PER_FRAME_MAX);
+				setNodeStates(epidemic.stateBuffer, epidemic.events.changed, states);
+				simulation::recordSimulationFrame(epidemic.recorder, settings.engine, states, epidemic.events.changed);
+			}
+			stageNodeStates(epidemic.stateBuffer, uploadRing, uploadBatch);
+			return;
+		}
+		int steps = settings.running ? settings.stepsPerFrame : (settings.stepOnce ? 1 : 0);
+		settings.stepOnce = false;
+		for (int step = 0; step < steps && simulation::epidemicActive(epidemic.engine); step++)
+		{
+			simulation::stepEpidemic(epidemic.engine);
+			setNodeStates(epidemic.stateBuffer, epidemic.engine.changed, states);
+			simulation::recordSimulationFrame(epidemic.recorder, settings.engine, states, epidemic.engine.changed);
+		}
+		stageNodeStates(epidemic.stateBuffer, uploadRing, uploadBatch);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef EPIDEMIC_COLORING_HPP
+#define EPIDEMIC_COLORING_HPP
+#include <cstdint>
+#include <vector>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include <NetworkViewport/Simulation/Epidemic.hpp>
+#include <NetworkViewport/Simulation/Gillespie.hpp>
+#include <NetworkViewport/Simulation/State_Recording.hpp>
+#include "Gpu_Epidemic.hpp"
+#include "Instance_Pipeline.hpp"
+#include "Node_State_Buffer.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Epidemic node colors
+// ----------------------------------------------------------------------------
+// Steps the engine selected in the UI, the discrete or the event-driven one on
+// the CPU or the compute shader one, and shows its states through the node
+// state buffer and the nodeStateColors palette. The CPU engines' changes can
+// be recorded, and a recording replaces the simulation on the timeline while
+// it is replayed.
+
+namespace render
+{
+struct EpidemicColoring
+{
+	simulation::EpidemicEngine engine;
+	simulation::GillespieEngine events;
+	// Colors by the state buffer while stateLookup is enabled, by the layout colors otherwise
+	InstancePipeline *nodes = nullptr;
+	// Node states and the nodeStateColors palette, shared with the compute shader epidemic
+	NodeStateBuffer stateBuffer;
+	// The layout colors are kept until the epidemic is first run, stepped or reset
+	bool shown = false;
+	// CPU engine whose states the node colors show
+	EpidemicEngineKind shownEngine = EPIDEMIC_ENGINE_STEPPED;
+	// The state buffer holds something else than shownEngine, e.g. after a replay
+	bool stale = false;
+	// The state buffer holds the compute shader's states, which a CPU engine or the replay overwrite
+	bool gpuShown = false;
+
+	// Records the frames of the CPU engines, the engine is the frame's source
+	simulation::StateRecorder recorder;
+	// Timeline of the recorder, or of a loaded file
+	simulation::StatePlayback playback;
+	bool playbackFromFile = false;
+	bool replaying = false;
+};
+
+	// Start or stop the recorder as requested and color by the timeline frame while replaying. True while the replay is
+	// shown, the simulation pauses meanwhile
+	bool updateEpidemicReplay(EpidemicColoring &epidemic, UISettings &uiSettings);
+	// Schedule the UI requests on the compute shader epidemic, which steps the shared state buffer in place
+	void updateGpuEpidemicColoring(EpidemicColoring &epidemic, GpuEpidemic &gpuEpidemic, UISettings &uiSettings);
+	// Apply the UI requests, step the epidemic and stage the states of the nodes that changed. Palette edits only upload
+	// the palette. Without gpuEpidemic the compute shader engine is ignored
+	void updateEpidemicColoring(EpidemicColoring &epidemic, UISettings &uiSettings, UploadRing &uploadRing, UploadBatch &uploadBatch,
+								GpuEpidemic *gpuEpidemic = nullptr);
+}
+
+#endif
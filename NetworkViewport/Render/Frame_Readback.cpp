@@ -0,0 +1,229 @@
+#include "Frame_Readback.hpp"
+#include <cstdio>
+#include <NetworkViewport/Utils/Image_Writer.hpp>
+#include <NetworkViewport/Utils/Trace.hpp>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+
+namespace render
+{
+	static std::string framePath(const FrameReadback &readback, uint64_t frameNumber)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "frame_%06llu.%s", static_cast<unsigned long long>(frameNumber),
+				 readback.format == FRAME_OUTPUT_FORMAT_PNG ? "png" : "rgba");
+		return readback.outputDirectory.empty() ? std::string(name) : readback.outputDirectory + "/" + name;
+	}
+
+	static void writerLoop(FrameReadback &readback)
+	{
+		NV_TRACE_THREAD("Frame writer");
+		const size_t rowPitch = 4 * static_cast<size_t>(readback.width);
+		std::unique_lock<std::mutex> lock(readback.mutex);
+		while (true)
+		{
+			readback.condition.wait(lock, [&readback]
+									{ return readback.stopWriter || !readback.writeQueue.empty(); });
+			if (readback.writeQueue.empty())
+			{
+				return;
+			}
+			uint32_t slotIndex = readback.writeQueue.front();
+			readback.writeQueue.pop_front();
+			ReadbackSlot &slot = readback.slots[slotIndex];
+			lock.unlock();
+
+			// The slot memory is not touched by the GPU or the render thread while SLOT_WRITING
+			const uint8_t *pixels = static_cast<const uint8_t *>(slot.buffer.mapped);
+			bool written = true;
+			if (readback.format == FRAME_OUTPUT_FORMAT_PNG)
+			{
+				written = utils::writePNG(framePath(readback, slot.frameNumber), readback.width, readback.height, pixels, rowPitch);
+			}
+			else if (readback.format == FRAME_OUTPUT_FORMAT_RAW)
+			{
+				written = utils::writeRaw(framePath(readback, slot.frameNumber), readback.width, readback.height, pixels, rowPitch);
+			}
+			if (written)
+			{
+				readback.framesWritten++;
+			}
+			else
+			{
+				readback.writeFailures++;
+			}
+
+			lock.lock();
+			slot.state = ReadbackSlot::SLOT_FREE;
+			readback.condition.notify_all();
+		}
+	}
+
+	void createFrameReadback(FrameReadback &readback, DeviceMemoryAllocator *allocator, uint32_t queueFamilyIndex, uint32_t width, uint32_t height,
+							 uint32_t slotCount, FrameOutputFormat format, const std::string &outputDirectory)
+	{
+		VulkanDevice *vulkanDevice = allocator->vulkanDevice;
+		VkDevice logicalDevice = vulkanDevice->logicalDevice;
+		readback.vulkanDevice = vulkanDevice;
+		readback.allocator = allocator;
+		readback.width = width;
+		readback.height = height;
+		readback.format = format;
+		readback.outputDirectory = outputDirectory;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndex;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VK_CHECK_RESULT(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &readback.commandPool));
+
+		std::vector<VkCommandBuffer> commandBuffers(slotCount);
+		VkCommandBufferAllocateInfo allocInfo = initializers::commandBufferAllocateInfo(readback.commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, slotCount);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()));
+
+		readback.slots.resize(slotCount);
+		for (uint32_t i = 0; i < slotCount; i++)
+		{
+			ReadbackSlot &slot = readback.slots[i];
+			VK_CHECK_RESULT(createBuffer(
+				*allocator,
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				4 * static_cast<VkDeviceSize>(width) * height,
+				slot.buffer));
+			slot.commandBuffer = commandBuffers[i];
+			VkFenceCreateInfo fenceInfo = initializers::fenceCreateInfo(0);
+			VK_CHECK_RESULT(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &slot.fence));
+		}
+
+		readback.stopWriter = false;
+		readback.writer = std::thread(writerLoop, std::ref(readback));
+	}
+
+	// Hand the oldest submitted frame to the writer. Without wait, returns false if its fence has not signaled yet.
+	static bool retireOldestFrame(FrameReadback &readback, bool wait)
+	{
+		uint32_t slotIndex = readback.inFlightSlots.front();
+		ReadbackSlot &slot = readback.slots[slotIndex];
+		VkDevice logicalDevice = readback.vulkanDevice->logicalDevice;
+		if (wait)
+		{
+			VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+		}
+		else if (vkGetFenceStatus(logicalDevice, slot.fence) != VK_SUCCESS)
+		{
+			return false;
+		}
+		VK_CHECK_RESULT(vkResetFences(logicalDevice, 1, &slot.fence));
+		{
+			std::lock_guard<std::mutex> lock(readback.mutex);
+			slot.state = ReadbackSlot::SLOT_WRITING;
+			readback.writeQueue.push_back(slotIndex);
+		}
+		readback.condition.notify_all();
+		readback.inFlightSlots.pop_front();
+		return true;
+	}
+
+	VkCommandBuffer beginReadbackFrame(FrameReadback &readback)
+	{
+		uint32_t slotIndex = static_cast<uint32_t>(readback.frameCounter % readback.slots.size());
+		// Slots are reused in submission order, so the one to record into is the oldest in flight if it is in flight
+		// at all. Completed frames ahead of it are retired without blocking.
+		while (!readback.inFlightSlots.empty() && retireOldestFrame(readback, readback.inFlightSlots.front() == slotIndex))
+		{
+		}
+
+		ReadbackSlot &slot = readback.slots[slotIndex];
+		{
+			std::unique_lock<std::mutex> lock(readback.mutex);
+			readback.condition.wait(lock, [&slot]
+									{ return slot.state == ReadbackSlot::SLOT_FREE; });
+			slot.state = ReadbackSlot::SLOT_RECORDING;
+		}
+		slot.frameNumber = readback.frameCounter++;
+		readback.recordingSlot = static_cast<int32_t>(slotIndex);
+
+		VK_CHECK_RESULT(vkResetCommandBuffer(slot.commandBuffer, 0));
+		VkCommandBufferBeginInfo beginInfo = initializers::commandBufferBeginInfo();
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(slot.commandBuffer, &beginInfo));
+		return slot.commandBuffer;
+	}
+
+	void submitReadbackFrame(FrameReadback &readback, VkQueue queue, VkImage colorImage)
+	{
+		ReadbackSlot &slot = readback.slots[readback.recordingSlot];
+
+		VkBufferImageCopy copyRegion = {};
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageExtent.width = readback.width;
+		copyRegion.imageExtent.height = readback.height;
+		copyRegion.imageExtent.depth = 1;
+		vkCmdCopyImageToBuffer(slot.commandBuffer, colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer.buffer, 1, &copyRegion);
+
+		// Make the copy visible to host reads after the fence wait
+		VkBufferMemoryBarrier barrier = initializers::bufferMemoryBarrier();
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = slot.buffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+							 0, nullptr, 1, &barrier, 0, nullptr);
+		VK_CHECK_RESULT(vkEndCommandBuffer(slot.commandBuffer));
+
+		VkSubmitInfo submitInfo = initializers::submitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, slot.fence));
+
+		{
+			std::lock_guard<std::mutex> lock(readback.mutex);
+			slot.state = ReadbackSlot::SLOT_IN_FLIGHT;
+		}
+		readback.inFlightSlots.push_back(static_cast<uint32_t>(readback.recordingSlot));
+		readback.recordingSlot = -1;
+	}
+
+	void flushFrameReadback(FrameReadback &readback)
+	{
+		while (!readback.inFlightSlots.empty())
+		{
+			retireOldestFrame(readback, true);
+		}
+		std::unique_lock<std::mutex> lock(readback.mutex);
+		readback.condition.wait(lock, [&readback]
+								{
+									for (const auto &slot : readback.slots)
+									{
+										if (slot.state == ReadbackSlot::SLOT_WRITING)
+										{
+											return false;
+										}
+									}
+									return true; });
+	}
+
+	void destroyFrameReadback(FrameReadback &readback)
+	{
+		flushFrameReadback(readback);
+		{
+			std::lock_guard<std::mutex> lock(readback.mutex);
+			readback.stopWriter = true;
+		}
+		readback.condition.notify_all();
+		readback.writer.join();
+
+		VkDevice logicalDevice = readback.vulkanDevice->logicalDevice;
+		for (auto &slot : readback.slots)
+		{
+			destroyBuffer(*readback.allocator, slot.buffer);
+			vkDestroyFence(logicalDevice, slot.fence, nullptr);
+		}
+		readback.slots.clear();
+		vkDestroyCommandPool(logicalDevice, readback.commandPool, nullptr);
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef FRAME_READBACK_HPP
+#define FRAME_READBACK_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include "Memory_Allocator.hpp"
+
+// ----------------------------------------------------------------------------
+// Asynchronous frame readback
+// ----------------------------------------------------------------------------
+// A ring of host-visible buffers, each with its own command buffer and fence.
+// Every frame renders and copies its color image into the next slot of the
+// ring, so up to one frame per slot is in flight. Frames are handed to a writer
+// thread once their fence has signaled, and the writer encodes straight from
+// the mapped slot memory. The render thread only blocks on the slot it reuses,
+// while that frame is still on the GPU or being written.
+
+namespace render
+{
+enum FrameOutputFormat
+{
+	FRAME_OUTPUT_FORMAT_NONE,
+	FRAME_OUTPUT_FORMAT_PNG,
+	FRAME_OUTPUT_FORMAT_RAW
+};
+
+struct ReadbackSlot
+{
+	enum State
+	{
+		SLOT_FREE,
+		SLOT_RECORDING,
+		SLOT_IN_FLIGHT,
+		SLOT_WRITING
+	};
+	AllocatedBuffer buffer;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	uint64_t frameNumber = 0;
+	State state = SLOT_FREE;
+};
+
+struct FrameReadback
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<ReadbackSlot> slots;
+	// Slot being recorded, -1 if none
+	int32_t recordingSlot = -1;
+	// Submitted slots not yet handed to the writer, oldest first
+	std::deque<uint32_t> inFlightSlots;
+	uint64_t frameCounter = 0;
+
+	FrameOutputFormat format = FRAME_OUTPUT_FORMAT_PNG;
+	// Frames are written to outputDirectory/frame_000000.png (.rgba for raw)
+	std::string outputDirectory;
+
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<uint32_t> writeQueue;
+	bool stopWriter = false;
+	std::atomic<uint64_t> framesWritten{0};
+	std::atomic<uint64_t> writeFailures{0};
+};
+
+	void createFrameReadback(FrameReadback &readback, DeviceMemoryAllocator *allocator, uint32_t queueFamilyIndex, uint32_t width, uint32_t height,
+							 uint32_t slotCount, FrameOutputFormat format, const std::string &outputDirectory);
+	// Flushes all outstanding frames and joins the writer
+	void destroyFrameReadback(FrameReadback &readback);
+
+	// Hand the completed frames to the writer and return the command buffer of the next slot, begun and ready for
+	// recording. Waits only for the frame submitted slots.size() frames ago, which used the same slot.
+	VkCommandBuffer beginReadbackFrame(FrameReadback &readback);
+	// Record the copy of colorImage (in TRANSFER_SRC_OPTIMAL) and submit the slot
+	void submitReadbackFrame(FrameReadback &readback, VkQueue queue, VkImage colorImage);
+	// Wait until every submitted frame has been written
+	void flushFrameReadback(FrameReadback &readback);
+}
+
+#endif
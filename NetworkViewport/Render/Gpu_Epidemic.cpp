@@ -0,0 +1,339 @@
+#include "Gpu_Epidemic.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+#include <VulkanTools/Utilities/VulkanPipelineInitializers.hpp>
+#include <VulkanTools/InstanceGraphics/GLTF_Assets.hpp>
+
+namespace render
+{
+	// Matches local_size_x of epidemic.comp
+	constexpr uint32_t EPIDEMIC_WORKGROUP_SIZE = 256;
+	// Guaranteed maxComputeWorkGroupCount, larger dispatches are split over y
+	constexpr uint32_t EPIDEMIC_MAX_GROUPS_X = 65535;
+	// uints per counts slot
+	constexpr uint32_t EPIDEMIC_COUNT_STRIDE = 4;
+	// Node states per word of the state buffers
+	constexpr uint32_t EPIDEMIC_STATES_PER_WORD = 4;
+
+	static void createStorageBuffer(GpuEpidemic &epidemic, TransferService &transferService, AllocatedBuffer &buffer, const std::vector<uint32_t> &data)
+	{
+		// Empty buffers are not allowed, an edgeless graph still gets one word
+		VkDeviceSize bufferSize = std::max<VkDeviceSize>(data.size(), 1) * sizeof(uint32_t);
+		VK_CHECK_RESULT(createBuffer(
+			*epidemic.allocator,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			bufferSize,
+			buffer));
+		if (!data.empty())
+		{
+			enqueueBufferUpload(transferService, buffer.buffer, 0, data.data(), data.size() * sizeof(uint32_t),
+								VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+	}
+
+	static uint32_t stateWordCount(uint32_t nodeCount)
+	{
+		return std::max((nodeCount + EPIDEMIC_STATES_PER_WORD - 1) / EPIDEMIC_STATES_PER_WORD, 1u);
+	}
+
+	static void uploadGraph(GpuEpidemic &epidemic, TransferService &transferService, const graph::CSRGraph &graph, const AllocatedBuffer *stateBuffer)
+	{
+		if (graph::arc_count(graph) > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error("Graph has too many arcs for 32 bit offsets on the GPU");
+		}
+		std::vector<uint32_t> offsets(graph.offsets.begin(), graph.offsets.end());
+		createStorageBuffer(epidemic, transferService, epidemic.offsetBuffer, offsets);
+		createStorageBuffer(epidemic, transferService, epidemic.neighborBuffer, graph.neighbors);
+
+		VkDeviceSize stateSize = stateWordCount(epidemic.nodeCount) * sizeof(uint32_t);
+		VkBufferUsageFlags stateUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		epidemic.ownsStateBuffer = stateBuffer == nullptr;
+		if (stateBuffer)
+		{
+			if (stateBuffer->size < stateSize)
+			{
+				throw std::runtime_error("Node state buffer is too small for the epidemic");
+			}
+			epidemic.stateBuffer = *stateBuffer;
+		}
+		else
+		{
+			VK_CHECK_RESULT(createBuffer(*epidemic.allocator, stateUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stateSize, epidemic.stateBuffer));
+		}
+		VK_CHECK_RESULT(createBuffer(*epidemic.allocator, stateUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stateSize, epidemic.nextStateBuffer));
+
+		VK_CHECK_RESULT(createBuffer(
+			*epidemic.allocator,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			epidemic.countSlots * EPIDEMIC_COUNT_STRIDE * sizeof(uint32_t),
+			epidemic.countBuffer));
+	}
+
+	static void createEpidemicPipeline(GpuEpidemic &epidemic, const GpuEpidemicParams &params)
+	{
+		VkDevice logicalDevice = epidemic.vulkanDevice->logicalDevice;
+
+		// Offsets, neighbors, states, next states and counts
+		const uint32_t bindingCount = 5;
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bindingCount)};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = initializers::descriptorPoolCreateInfo(poolSizes, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &epidemic.descriptorPool));
+
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+		for (uint32_t binding = 0; binding < bindingCount; binding++)
+		{
+			setLayoutBindings.push_back(initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, binding, 1));
+		}
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &epidemic.descriptorSetLayout));
+
+		VkDescriptorSetAllocateInfo allocInfo = initializers::descriptorSetAllocateInfo(epidemic.descriptorPool, &epidemic.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &epidemic.descriptorSet));
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			initializers::writeDescriptorSet(epidemic.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &epidemic.offsetBuffer.descriptor, 1),
+			initializers::writeDescriptorSet(epidemic.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &epidemic.neighborBuffer.descriptor, 1),
+			initializers::writeDescriptorSet(epidemic.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &epidemic.stateBuffer.descriptor, 1),
+			initializers::writeDescriptorSet(epidemic.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &epidemic.nextStateBuffer.descriptor, 1),
+			initializers::writeDescriptorSet(epidemic.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &epidemic.countBuffer.descriptor, 1)};
+		vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+		VkPushConstantRange pushConstantRange = initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(GpuEpidemic::PushConstBlock), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = initializers::pipelineLayoutCreateInfo(&epidemic.descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &epidemic.pipelineLayout));
+
+		VkComputePipelineCreateInfo pipelineCreateInfo{};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.layout = epidemic.pipelineLayout;
+		pipelineCreateInfo.stage = loadShader(logicalDevice, params.computeShadersPath + "epidemic.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, params.pipelineCache, 1, &pipelineCreateInfo, nullptr, &epidemic.pipeline));
+		vkDestroyShaderModule(logicalDevice, pipelineCreateInfo.stage.module, nullptr);
+	}
+
+	std::unique_ptr<GpuEpidemic> prepareGpuEpidemic(const GpuEpidemicParams &params, const graph::CSRGraph &graph, const simulation::EpidemicParams &epidemicParams)
+	{
+		auto epidemic = std::make_unique<GpuEpidemic>();
+		epidemic->vulkanDevice = params.vulkanDevice;
+		epidemic->allocator = params.allocator;
+		epidemic->nodeCount = graph.N_nodes;
+		epidemic->countSlots = std::max(params.countSlots, 1u);
+
+		uploadGraph(*epidemic, *params.transferService, graph, params.stateBuffer);
+		createEpidemicPipeline(*epidemic, params);
+		resetGpuEpidemic(*epidemic, epidemicParams);
+		return epidemic;
+	}
+
+	void destroyGpuEpidemic(GpuEpidemic &epidemic)
+	{
+		VkDevice logicalDevice = epidemic.vulkanDevice->logicalDevice;
+		destroyBuffer(*epidemic.allocator, epidemic.offsetBuffer);
+		destroyBuffer(*epidemic.allocator, epidemic.neighborBuffer);
+		if (epidemic.ownsStateBuffer)
+		{
+			destroyBuffer(*epidemic.allocator, epidemic.stateBuffer);
+		}
+		destroyBuffer(*epidemic.allocator, epidemic.nextStateBuffer);
+		destroyBuffer(*epidemic.allocator, epidemic.countBuffer);
+		vkDestroyPipeline(logicalDevice, epidemic.pipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, epidemic.pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(logicalDevice, epidemic.descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, epidemic.descriptorSetLayout, nullptr);
+	}
+
+	void resetGpuEpidemic(GpuEpidemic &epidemic, const simulation::EpidemicParams &params)
+	{
+		epidemic.params = params;
+		epidemic.step = 0;
+		epidemic.frame.reset = true;
+		// Stream 0, the CPU engine seeds from the stream after its partitions
+		epidemic.frame.initialInfected = simulation::sampleInitialInfected(epidemic.nodeCount, params, 0);
+		epidemic.frame.firstStep = 0;
+		epidemic.frame.steps = 0;
+		// Steps of the previous run still in flight are not reported
+		epidemic.submittedFrames.clear();
+
+		uint64_t initialInfected = epidemic.frame.initialInfected.size();
+		epidemic.counts[simulation::NODE_STATE_SUSCEPTIBLE] = epidemic.nodeCount - initialInfected;
+		epidemic.counts[simulation::NODE_STATE_INFECTED] = initialInfected;
+		epidemic.counts[simulation::NODE_STATE_RECOVERED] = 0;
+	}
+
+	uint32_t scheduleGpuEpidemicSteps(GpuEpidemic &epidemic, uint32_t steps)
+	{
+		if (!gpuEpidemicActive(epidemic))
+		{
+			return 0;
+		}
+		// Count slots are only reused once the host has read them
+		uint32_t unread = epidemic.frame.steps;
+		for (const GpuEpidemic::SubmittedFrame &submitted : epidemic.submittedFrames)
+		{
+			unread += submitted.steps;
+		}
+		steps = std::min(steps, epidemic.countSlots - std::min(unread, epidemic.countSlots));
+		if (epidemic.frame.steps == 0)
+		{
+			epidemic.frame.firstStep = epidemic.step;
+		}
+		epidemic.frame.steps += steps;
+		epidemic.step += steps;
+		return steps;
+	}
+
+	static VkBufferMemoryBarrier bufferBarrier(const AllocatedBuffer &buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+	{
+		VkBufferMemoryBarrier barrier = initializers::bufferMemoryBarrier();
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		return barrier;
+	}
+
+	void recordGpuEpidemic(const GpuEpidemic &epidemic, VkCommandBuffer commandBuffer)
+	{
+		const GpuEpidemic::Frame &frame = epidemic.frame;
+		if (!frame.reset && frame.steps == 0)
+		{
+			return;
+		}
+
+		// The state buffer is overwritten, node shaders of earlier submissions have to be done reading it and
+		// host uploads into a shared state buffer done writing it
+		VkBufferMemoryBarrier stateBarrier = bufferBarrier(epidemic.stateBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 1, &stateBarrier, 0, nullptr);
+		if (frame.reset)
+		{
+			// Susceptible is zero, so a cleared word holds four susceptible nodes
+			vkCmdFillBuffer(commandBuffer, epidemic.stateBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+								 0, nullptr, 1, &stateBarrier, 0, nullptr);
+			// One update per word holding seeds, the seeds are sorted
+			for (size_t i = 0; i < frame.initialInfected.size();)
+			{
+				uint32_t word = frame.initialInfected[i] / EPIDEMIC_STATES_PER_WORD;
+				uint32_t states = 0;
+				for (; i < frame.initialInfected.size() && frame.initialInfected[i] / EPIDEMIC_STATES_PER_WORD == word; i++)
+				{
+					states |= static_cast<uint32_t>(simulation::NODE_STATE_INFECTED) << (frame.initialInfected[i] % EPIDEMIC_STATES_PER_WORD * 8);
+				}
+				vkCmdUpdateBuffer(commandBuffer, epidemic.stateBuffer.buffer, word * sizeof(uint32_t), sizeof(uint32_t), &states);
+			}
+		}
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, epidemic.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, epidemic.pipelineLayout, 0, 1, &epidemic.descriptorSet, 0, nullptr);
+
+		uint32_t groups = (stateWordCount(epidemic.nodeCount) + EPIDEMIC_WORKGROUP_SIZE - 1) / EPIDEMIC_WORKGROUP_SIZE;
+		uint32_t groupsX = std::max(std::min(groups, EPIDEMIC_MAX_GROUPS_X), 1u);
+		uint32_t groupsY = (groups + groupsX - 1) / groupsX;
+
+		GpuEpidemic::PushConstBlock pushConstants;
+		pushConstants.nodeCount = epidemic.nodeCount;
+		pushConstants.model = static_cast<uint32_t>(epidemic.params.model);
+		pushConstants.beta = epidemic.params.beta;
+		pushConstants.gamma = epidemic.params.gamma;
+		pushConstants.seed = static_cast<uint32_t>(epidemic.params.seed ^ (epidemic.params.seed >> 32));
+
+		for (uint32_t i = 0; i < frame.steps; i++)
+		{
+			uint64_t step = frame.firstStep + i;
+			uint32_t countSlot = static_cast<uint32_t>(step % epidemic.countSlots);
+			VkDeviceSize countOffset = countSlot * EPIDEMIC_COUNT_STRIDE * sizeof(uint32_t);
+			vkCmdFillBuffer(commandBuffer, epidemic.countBuffer.buffer, countOffset, EPIDEMIC_COUNT_STRIDE * sizeof(uint32_t), 0);
+
+			// Reset writes, the copy of the previous step and the cleared counts before the step reads them
+			std::vector<VkBufferMemoryBarrier> barriers = {
+				bufferBarrier(epidemic.stateBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT),
+				bufferBarrier(epidemic.countBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT),
+				// The previous copy read the next states before they are written again
+				bufferBarrier(epidemic.nextStateBuffer, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT)};
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+								 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+			pushConstants.step = static_cast<uint32_t>(step);
+			pushConstants.countSlot = countSlot;
+			vkCmdPushConstants(commandBuffer, epidemic.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+			vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+
+			// The step has read the states and written the next ones before they are copied back
+			barriers = {
+				bufferBarrier(epidemic.nextStateBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+				bufferBarrier(epidemic.stateBuffer, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT)};
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+								 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+			VkBufferCopy copyRegion = {0, 0, epidemic.nextStateBuffer.size};
+			vkCmdCopyBuffer(commandBuffer, epidemic.nextStateBuffer.buffer, epidemic.stateBuffer.buffer, 1, &copyRegion);
+		}
+
+		// New states to the node shaders, counts to the host
+		std::vector<VkBufferMemoryBarrier> barriers = {
+			bufferBarrier(epidemic.stateBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT),
+			bufferBarrier(epidemic.countBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)};
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+							 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+	}
+
+	void submitGpuEpidemicFrame(GpuEpidemic &epidemic, uint32_t slot)
+	{
+		GpuEpidemic::Frame &frame = epidemic.frame;
+		if (frame.steps > 0)
+		{
+			GpuEpidemic::SubmittedFrame submitted;
+			submitted.slot = slot;
+			submitted.firstStep = frame.firstStep;
+			submitted.steps = frame.steps;
+			epidemic.submittedFrames.push_back(submitted);
+		}
+		frame.reset = false;
+		frame.initialInfected.clear();
+		frame.steps = 0;
+	}
+
+	void completeGpuEpidemicFrame(GpuEpidemic &epidemic, uint32_t slot)
+	{
+		epidemic.completedSteps.clear();
+		auto last = std::find_if(epidemic.submittedFrames.begin(), epidemic.submittedFrames.end(), [slot](const GpuEpidemic::SubmittedFrame &submitted)
+								 { return submitted.slot == slot; });
+		if (last == epidemic.submittedFrames.end())
+		{
+			return;
+		}
+		// Submissions complete in order, the frames before the slot's are done as well
+		const uint32_t *slots = static_cast<const uint32_t *>(epidemic.countBuffer.mapped);
+		for (auto submitted = epidemic.submittedFrames.begin(); submitted != last + 1; submitted++)
+		{
+			for (uint32_t i = 0; i < submitted->steps; i++)
+			{
+				GpuEpidemicStepCounts stepCounts;
+				stepCounts.step = submitted->firstStep + i + 1;
+				const uint32_t *countSlot = slots + ((submitted->firstStep + i) % epidemic.countSlots) * EPIDEMIC_COUNT_STRIDE;
+				for (uint32_t nodeState = 0; nodeState < simulation::NODE_STATE_COUNT; nodeState++)
+				{
+					stepCounts.counts[nodeState] = countSlot[nodeState];
+					epidemic.counts[nodeState] = countSlot[nodeState];
+				}
+				epidemic.completedSteps.push_back(stepCounts);
+			}
+		}
+		epidemic.submittedFrames.erase(epidemic.submittedFrames.begin(), last + 1);
+	}
+
+	bool gpuEpidemicActive(const GpuEpidemic &epidemic)
+	{
+		return epidemic.counts[simulation::NODE_STATE_INFECTED] > 0;
+	}
+}
@@ -0,0 +1,138 @@
+#ifndef GPU_EPIDEMIC_HPP
+#define GPU_EPIDEMIC_HPP
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include <NetworkViewport/Simulation/Epidemic.hpp>
+#include "Memory_Allocator.hpp"
+#include "Transfer_Service.hpp"
+
+// ----------------------------------------------------------------------------
+// Compute shader epidemics
+// ----------------------------------------------------------------------------
+// The discrete-time SIR/SIS step of Simulation/Epidemic.hpp as a compute
+// shader (epidemic.comp). The CSR adjacency and the node states live in
+// storage buffers, the states as uint8 packed four to a word like those of
+// Node_State_Buffer.hpp, and one invocation updates one word. A step writes the
+// next states into a scratch buffer which is then copied back, so the state
+// buffer keeps its place and the node pipeline reads it directly (node.vert
+// with NODE_STATE_BUFFER). Node states never leave the GPU, only the
+// per-state counts of every step are reduced into a small host-visible ring.
+//
+// Work is scheduled once per frame on the host and recorded without side
+// effects. Several frames may be in flight, the counts of a frame are read
+// once the caller reports its submission complete.
+// Random streams are derived from (seed, step, node), a run repeats for the
+// same seed on any device but differs from the CPU engine's.
+
+namespace render
+{
+struct GpuEpidemicParams
+{
+	// Directory of epidemic.comp.spv
+	std::string computeShadersPath;
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	// The graph is uploaded with the next submitted transfer batch
+	TransferService *transferService = nullptr;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	// Steps in flight whose counts are read back, more steps are not scheduled until earlier frames completed
+	uint32_t countSlots = 64;
+	// Packed states to step in place, e.g. a NodeStateBuffer's device buffer, which stays owned by the caller.
+	// Needs storage and transfer dst usage and ceil(N_nodes / 4) words, a buffer is created if null
+	const AllocatedBuffer *stateBuffer = nullptr;
+};
+
+struct GpuEpidemicStepCounts
+{
+	uint64_t step = 0;
+	uint64_t counts[simulation::NODE_STATE_COUNT] = {};
+};
+
+struct GpuEpidemic
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	uint32_t nodeCount = 0;
+	AllocatedBuffer offsetBuffer;
+	AllocatedBuffer neighborBuffer;
+	// Four uint8 states per word, read by the node pipeline
+	AllocatedBuffer stateBuffer;
+	bool ownsStateBuffer = false;
+	// Written by a step, copied into stateBuffer
+	AllocatedBuffer nextStateBuffer;
+	// Host-visible, four uints per slot, slot = step % countSlots
+	AllocatedBuffer countBuffer;
+	uint32_t countSlots = 0;
+
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	simulation::EpidemicParams params;
+	// Steps scheduled since the last reset
+	uint64_t step = 0;
+	// Counts after the last completed step or reset
+	uint64_t counts[simulation::NODE_STATE_COUNT] = {};
+
+	// Work of the current frame, recorded by recordGpuEpidemic
+	struct Frame
+	{
+		bool reset = false;
+		// Sorted seed nodes of a pending reset
+		std::vector<uint32_t> initialInfected;
+		uint64_t firstStep = 0;
+		uint32_t steps = 0;
+	} frame;
+	// Steps of submitted frames whose counts have not been read, oldest first
+	struct SubmittedFrame
+	{
+		uint32_t slot = 0;
+		uint64_t firstStep = 0;
+		uint32_t steps = 0;
+	};
+	std::deque<SubmittedFrame> submittedFrames;
+	// Counts of the steps completed with the last completed frame, oldest first
+	std::vector<GpuEpidemicStepCounts> completedSteps;
+
+	struct PushConstBlock
+	{
+		uint32_t nodeCount;
+		uint32_t model;
+		float beta;
+		float gamma;
+		uint32_t seed;
+		uint32_t step;
+		uint32_t countSlot;
+	};
+};
+
+	// Node ids and arc offsets have to fit in 32 bits, throws otherwise. The states are
+	// initialized by the first recorded frame, which includes a reset with params
+	std::unique_ptr<GpuEpidemic> prepareGpuEpidemic(const GpuEpidemicParams &params, const graph::CSRGraph &graph, const simulation::EpidemicParams &epidemicParams);
+	void destroyGpuEpidemic(GpuEpidemic &epidemic);
+
+	// Replace the pending frame work by a reset, steps scheduled after it follow the reset
+	void resetGpuEpidemic(GpuEpidemic &epidemic, const simulation::EpidemicParams &params);
+	// Add steps to the current frame, returns how many were scheduled. SIR outbreaks stop once no node is
+	// infected, which the host sees once the frame that got there has completed
+	uint32_t scheduleGpuEpidemicSteps(GpuEpidemic &epidemic, uint32_t steps);
+	// Record the reset and steps of the current frame outside of a render pass. Node shader reads of the
+	// previous frame are waited for, the new states are visible to vertex shaders afterwards
+	void recordGpuEpidemic(const GpuEpidemic &epidemic, VkCommandBuffer commandBuffer);
+	// The recorded frame was submitted in slot, e.g. the upload ring partition whose fence guards it.
+	// Starts a new frame
+	void submitGpuEpidemicFrame(GpuEpidemic &epidemic, uint32_t slot);
+	// The submission of slot and every earlier one have finished executing, reads their step counts
+	void completeGpuEpidemicFrame(GpuEpidemic &epidemic, uint32_t slot);
+	bool gpuEpidemicActive(const GpuEpidemic &epidemic);
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include "Gpu_Profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+
+namespace render
+{
+	static uint32_t slotFirstQuery(uint32_t slot)
+	{
+		return slot * GPU_PROFILER_MAX_SCOPES * 2;
+	}
+
+	void createGpuProfiler(GpuProfiler &profiler, VulkanDevice *vulkanDevice, uint32_t slotCount)
+	{
+		profiler.vulkanDevice = vulkanDevice;
+		uint32_t validBits = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits;
+		if (validBits == 0 || slotCount == 0)
+		{
+			return;
+		}
+		profiler.timestampPeriod = vulkanDevice->properties.limits.timestampPeriod;
+		profiler.timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		profiler.slots.resize(slotCount);
+
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = slotFirstQuery(slotCount);
+		VK_CHECK_RESULT(vkCreateQueryPool(vulkanDevice->logicalDevice, &queryPoolInfo, nullptr, &profiler.queryPool));
+	}
+
+	void destroyGpuProfiler(GpuProfiler &profiler)
+	{
+		if (profiler.queryPool != VK_NULL_HANDLE)
+		{
+			vkDestroyQueryPool(profiler.vulkanDevice->logicalDevice, profiler.queryPool, nullptr);
+			profiler.queryPool = VK_NULL_HANDLE;
+		}
+	}
+
+	bool gpuProfilerEnabled(const GpuProfiler &profiler)
+	{
+		return profiler.queryPool != VK_NULL_HANDLE;
+	}
+
+	void beginGpuProfilerFrame(GpuProfiler &profiler, VkCommandBuffer commandBuffer, uint32_t slot)
+	{
+		if (!gpuProfilerEnabled(profiler))
+		{
+			return;
+		}
+		profiler.recordingSlot = slot % static_cast<uint32_t>(profiler.slots.size());
+		profiler.slots[profiler.recordingSlot].recordedScopes.clear();
+		profiler.scopeOpen = false;
+		vkCmdResetQueryPool(commandBuffer, profiler.queryPool, slotFirstQuery(profiler.recordingSlot), GPU_PROFILER_MAX_SCOPES * 2);
+	}
+
+	void beginGpuScope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name)
+	{
+		if (!gpuProfilerEnabled(profiler))
+		{
+			return;
+		}
+		GpuProfiler::Slot &slot = profiler.slots[profiler.recordingSlot];
+		if (profiler.scopeOpen || slot.recordedScopes.size() == GPU_PROFILER_MAX_SCOPES)
+		{
+			return;
+		}
+		uint32_t query = slotFirstQuery(profiler.recordingSlot) + 2 * static_cast<uint32_t>(slot.recordedScopes.size());
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, profiler.queryPool, query);
+		slot.recordedScopes.push_back(name);
+		profiler.scopeOpen = true;
+	}
+
+	void endGpuScope(GpuProfiler &profiler, VkCommandBuffer commandBuffer)
+	{
+		if (!gpuProfilerEnabled(profiler) || !profiler.scopeOpen)
+		{
+			return;
+		}
+		const GpuProfiler::Slot &slot = profiler.slots[profiler.recordingSlot];
+		uint32_t query = slotFirstQuery(profiler.recordingSlot) + 2 * static_cast<uint32_t>(slot.recordedScopes.size()) - 1;
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, profiler.queryPool, query);
+		profiler.scopeOpen = false;
+	}
+
+	void submitGpuProfilerFrame(GpuProfiler &profiler, uint32_t slot)
+	{
+		if (!gpuProfilerEnabled(profiler))
+		{
+			return;
+		}
+		GpuProfiler::Slot &submitted = profiler.slots[slot % profiler.slots.size()];
+		if (submitted.pending)
+		{
+			profiler.droppedFrames++;
+		}
+		submitted.submittedScopes = submitted.recordedScopes;
+		submitted.submittedFrame = profiler.frame++;
+		submitted.pending = !submitted.submittedScopes.empty();
+	}
+
+	static void addPassName(GpuProfiler &profiler, const std::string &name)
+	{
+		if (std::find(profiler.passNames.begin(), profiler.passNames.end(), name) == profiler.passNames.end())
+		{
+			profiler.passNames.push_back(name);
+		}
+	}
+
+	void collectGpuProfilerResults(GpuProfiler &profiler)
+	{
+		if (!gpuProfilerEnabled(profiler))
+		{
+			return;
+		}
+		// Oldest submissions first, so the history stays ordered
+		std::vector<uint32_t> pendingSlots;
+		for (uint32_t slot = 0; slot < profiler.slots.size(); slot++)
+		{
+			if (profiler.slots[slot].pending)
+			{
+				pendingSlots.push_back(slot);
+			}
+		}
+		std::sort(pendingSlots.begin(), pendingSlots.end(), [&profiler](uint32_t a, uint32_t b)
+				  { return profiler.slots[a].submittedFrame < profiler.slots[b].submittedFrame; });
+
+		// Value and availability per query
+		std::vector<uint64_t> results(GPU_PROFILER_MAX_SCOPES * 4);
+		for (uint32_t slotIndex : pendingSlots)
+		{
+			GpuProfiler::Slot &slot = profiler.slots[slotIndex];
+			uint32_t queryCount = 2 * static_cast<uint32_t>(slot.submittedScopes.size());
+			VkResult result = vkGetQueryPoolResults(profiler.vulkanDevice->logicalDevice, profiler.queryPool, slotFirstQuery(slotIndex), queryCount,
+													queryCount * 2 * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+													VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			bool available = result == VK_SUCCESS;
+			for (uint32_t query = 0; available && query < queryCount; query++)
+			{
+				available = results[2 * query + 1] != 0;
+			}
+			if (!available)
+			{
+				// Later submissions can not be done either
+				break;
+			}
+
+			GpuFrameTiming timing;
+			timing.frame = slot.submittedFrame;
+			uint64_t first = results[0] & profiler.timestampMask;
+			uint64_t last = results[0];
+			for (size_t scope = 0; scope < slot.submittedScopes.size(); scope++)
+			{
+				uint64_t begin = results[4 * scope] & profiler.timestampMask;
+				uint64_t end = results[4 * scope + 2] & profiler.timestampMask;
+				uint64_t ticks = (end - begin) & profiler.timestampMask;
+				timing.passes.push_back({slot.submittedScopes[scope], ticks * profiler.timestampPeriod * 1e-6});
+				addPassName(profiler, slot.submittedScopes[scope]);
+				last = end;
+			}
+			timing.milliseconds = ((last - first) & profiler.timestampMask) * profiler.timestampPeriod * 1e-6;
+			slot.pending = false;
+
+			profiler.history.push_back(std::move(timing));
+			if (profiler.history.size() > GPU_PROFILER_HISTORY)
+			{
+				profiler.history.pop_front();
+			}
+		}
+	}
+
+	std::vector<GpuPassStats> gpuPassStats(const GpuProfiler &profiler)
+	{
+		std::vector<GpuPassStats> stats(profiler.passNames.size());
+		std::vector<size_t> samples(profiler.passNames.size(), 0);
+		for (size_t pass = 0; pass < profiler.passNames.size(); pass++)
+		{
+			stats[pass].name = profiler.passNames[pass];
+		}
+		for (const GpuFrameTiming &timing : profiler.history)
+		{
+			for (const GpuPassTiming &passTiming : timing.passes)
+			{
+				size_t pass = std::find(profiler.passNames.begin(), profiler.passNames.end(), passTiming.name) - profiler.passNames.begin();
+				GpuPassStats &passStats = stats[pass];
+				passStats.last = passTiming.milliseconds;
+				passStats.min = samples[pass] == 0 ? passTiming.milliseconds : std::min(passStats.min, passTiming.milliseconds);
+				passStats.max = std::max(passStats.max, passTiming.milliseconds);
+				passStats.average += passTiming.milliseconds;
+				samples[pass]++;
+			}
+		}
+		for (size_t pass = 0; pass < stats.size(); pass++)
+		{
+			if (samples[pass] > 0)
+			{
+				stats[pass].average /= samples[pass];
+			}
+		}
+		return stats;
+	}
+
+	bool writeGpuProfileCsv(const GpuProfiler &profiler, const std::string &path)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		file << "frame,pass,milliseconds\n";
+		for (const GpuFrameTiming &timing : profiler.history)
+		{
+			for (const GpuPassTiming &passTiming : timing.passes)
+			{
+				file << timing.frame << ',' << passTiming.name << ',' << passTiming.milliseconds << '\n';
+			}
+			file << timing.frame << ",frame," << timing.milliseconds << '\n';
+		}
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,101 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+
+// ----------------------------------------------------------------------------
+// GPU pass timings
+// ----------------------------------------------------------------------------
+// Named scopes write a timestamp query pair into the command buffer they are
+// recorded in. Each command buffer owns a slot of the query pool, so a
+// command buffer can be re-recorded while the results of its last submission
+// are still pending. Results are polled without waiting and land in the
+// history a few frames after the submission that produced them. Scopes are
+// not nested, the frame time is the span from the first to the last one.
+
+namespace render
+{
+// Query pairs per command buffer
+constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 16;
+// Frames kept for the graph, statistics and export
+constexpr size_t GPU_PROFILER_HISTORY = 240;
+
+struct GpuPassTiming
+{
+	std::string name;
+	double milliseconds = 0.;
+};
+
+struct GpuFrameTiming
+{
+	// Profiler frame the command buffer was submitted in
+	uint64_t frame = 0;
+	double milliseconds = 0.;
+	std::vector<GpuPassTiming> passes;
+};
+
+struct GpuPassStats
+{
+	std::string name;
+	double last = 0.;
+	double average = 0.;
+	double min = 0.;
+	double max = 0.;
+};
+
+struct GpuProfiler
+{
+	struct Slot
+	{
+		// Scopes of the last recording
+		std::vector<std::string> recordedScopes;
+		// Scopes of the submission whose results are pending
+		std::vector<std::string> submittedScopes;
+		bool pending = false;
+		uint64_t submittedFrame = 0;
+	};
+
+	VulkanDevice *vulkanDevice = nullptr;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	// Nanoseconds per timestamp tick
+	double timestampPeriod = 1.;
+	uint64_t timestampMask = ~0ull;
+	std::vector<Slot> slots;
+	uint32_t recordingSlot = 0;
+	bool scopeOpen = false;
+	uint64_t frame = 0;
+	// Submissions overwritten before their results were read
+	uint64_t droppedFrames = 0;
+
+	std::deque<GpuFrameTiming> history;
+	// Pass names in first-seen order, keeps table rows and graph colors stable
+	std::vector<std::string> passNames;
+};
+
+	// One slot per command buffer that is recorded and submitted independently.
+	// Does nothing if the graphics queue has no timestamp support.
+	void createGpuProfiler(GpuProfiler &profiler, VulkanDevice *vulkanDevice, uint32_t slotCount);
+	void destroyGpuProfiler(GpuProfiler &profiler);
+	bool gpuProfilerEnabled(const GpuProfiler &profiler);
+
+	// Reset the queries of a slot, must be recorded outside a render pass before the first scope
+	void beginGpuProfilerFrame(GpuProfiler &profiler, VkCommandBuffer commandBuffer, uint32_t slot);
+	void beginGpuScope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name);
+	void endGpuScope(GpuProfiler &profiler, VkCommandBuffer commandBuffer);
+
+	// The command buffer of slot was submitted, its results are read by a later collect
+	void submitGpuProfilerFrame(GpuProfiler &profiler, uint32_t slot);
+	// Move finished submissions into the history, never waits on the GPU
+	void collectGpuProfilerResults(GpuProfiler &profiler);
+
+	// Per pass statistics over the history, in passNames order
+	std::vector<GpuPassStats> gpuPassStats(const GpuProfiler &profiler);
+	// One row per frame and pass: frame,pass,milliseconds
+	bool writeGpuProfileCsv(const GpuProfiler &profiler, const std::string &path);
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include "Graph_Load.hpp"
+#include <chrono>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	void startGraphLoad(GraphLoad &load, std::future<GraphScene> prepared)
+	{
+		load.prepared = std::move(prepared);
+		load.uploading = false;
+		load.ticket = 0;
+	}
+
+	bool graphLoadActive(const GraphLoad &load)
+	{
+		return load.prepared.valid() || load.uploading;
+	}
+
+	bool updateGraphLoad(GraphLoad &load, TransferService &transferService)
+	{
+		if (load.prepared.valid())
+		{
+			if (load.prepared.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				return false;
+			}
+			NV_TRACE_ZONE("Submit graph load");
+			load.scene = load.prepared.get();
+			// Everything the worker recorded goes with this batch
+			load.ticket = submitTransfers(transferService);
+			load.uploading = true;
+		}
+		if (!load.uploading || !transferComplete(transferService, load.ticket))
+		{
+			return false;
+		}
+		load.uploading = false;
+		return true;
+	}
+
+	void destroyGraphScene(GraphScene &scene)
+	{
+		// Lines and the splat borrow the instance buffers, release them first
+		if (scene.lineEdges)
+		{
+			destroyLineEdgePipeline(*scene.lineEdges);
+		}
+		if (scene.densitySplat)
+		{
+			destroyDensitySplat(*scene.densitySplat);
+		}
+		if (scene.nodes)
+		{
+			destroyInstancePipeline(*scene.nodes);
+		}
+		if (scene.edges)
+		{
+			destroyInstancePipeline(*scene.edges);
+		}
+		scene = GraphScene();
+	}
+
+	void retireGraphScene(std::vector<RetiredGraphScene> &retired, GraphScene &&scene, uint32_t framesInFlight)
+	{
+		RetiredGraphScene entry;
+		entry.scene = std::move(scene);
+		entry.framesLeft = framesInFlight;
+		retired.push_back(std::move(entry));
+	}
+
+	void collectRetiredGraphScenes(std::vector<RetiredGraphScene> &retired)
+	{
+		for (auto it = retired.begin(); it != retired.end();)
+		{
+			if (it->framesLeft > 0)
+			{
+				it->framesLeft--;
+			}
+			if (it->framesLeft == 0)
+			{
+				destroyGraphScene(it->scene);
+				it = retired.erase(it);
+			}
+			else
+			{
+				it++;
+			}
+		}
+	}
+
+	void destroyRetiredGraphScenes(std::vector<RetiredGraphScene> &retired)
+	{
+		for (auto &entry : retired)
+		{
+			destroyGraphScene(entry.scene);
+		}
+		retired.clear();
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef GRAPH_LOAD_HPP
+#define GRAPH_LOAD_HPP
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+#include "Density_Splat.hpp"
+#include "Instance_Pipeline.hpp"
+#include "Line_Edges.hpp"
+#include "Transfer_Service.hpp"
+
+// ----------------------------------------------------------------------------
+// Asynchronous graph loads
+// ----------------------------------------------------------------------------
+// A new graph is laid out and its instance pipelines are prepared on a worker
+// thread, which only records their uploads into the transfer service's batch.
+// The batch is submitted once the worker is done and the current graph keeps
+// being drawn while it is in flight. Once it has completed the caller swaps in
+// the new pipelines, their ownership acquires come with the next
+// takeTransferAcquires. The replaced pipelines are retired and destroyed once
+// no frame in flight can draw them anymore.
+
+namespace render
+{
+// The pipelines drawing one graph, lines and the splat borrow the instance buffers
+struct GraphScene
+{
+	std::unique_ptr<InstancePipeline> nodes;
+	std::unique_ptr<InstancePipeline> edges;
+	std::unique_ptr<LineEdgePipeline> lineEdges;
+	std::unique_ptr<DensitySplat> densitySplat;
+};
+
+struct GraphLoad
+{
+	// Worker building the new graph's instance pipelines
+	std::future<GraphScene> prepared;
+	GraphScene scene;
+	// Batch carrying the instance uploads, valid while uploading
+	TransferTicket ticket = 0;
+	bool uploading = false;
+};
+
+struct RetiredGraphScene
+{
+	GraphScene scene;
+	// Frames to begin before the scene is destroyed
+	uint32_t framesLeft = 0;
+};
+
+	// Track the worker preparing a graph, its pipelines have to record their uploads into the transfer service
+	void startGraphLoad(GraphLoad &load, std::future<GraphScene> prepared);
+	bool graphLoadActive(const GraphLoad &load);
+
+	// Submit the uploads once the worker is done. True once they have completed, load.scene can then be swapped in
+	// and the load is finished
+	bool updateGraphLoad(GraphLoad &load, TransferService &transferService);
+
+	void destroyGraphScene(GraphScene &scene);
+
+	// Destroy scene once framesInFlight more frames have begun, i.e. their fences have been waited for
+	void retireGraphScene(std::vector<RetiredGraphScene> &retired, GraphScene &&scene, uint32_t framesInFlight);
+	// Call once per frame after waiting for the frame's fence
+	void collectRetiredGraphScenes(std::vector<RetiredGraphScene> &retired);
+	// Destroy all retired scenes, the device has to be idle
+	void destroyRetiredGraphScenes(std::vector<RetiredGraphScene> &retired);
+}
+
+#endif
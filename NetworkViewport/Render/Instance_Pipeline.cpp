@@ -0,0 +1,432 @@
+#include "Instance_Pipeline.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cmath>
+#include <map>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+#include <VulkanTools/Utilities/VulkanPipelineInitializers.hpp>
+#include <VulkanTools/InstanceGraphics/GLTF_Assets.hpp>
+
+namespace render
+{
+	constexpr float MESH_PI = 3.14159265358979f;
+
+	static InstanceMeshVertex sphereVertex(glm::vec3 direction)
+	{
+		direction = glm::normalize(direction);
+		float u = 0.5f + std::atan2(direction.z, direction.x) / (2.f * MESH_PI);
+		float v = 0.5f - std::asin(direction.y) / MESH_PI;
+		return {direction, direction, {u, v}, {1.f, 1.f, 1.f}};
+	}
+
+	// Unit icosphere, each subdivision splits every triangle into four
+	static void buildIcosphere(std::vector<InstanceMeshVertex> &vertices, std::vector<uint32_t> &indices, uint32_t subdivisions)
+	{
+		const float t = (1.f + std::sqrt(5.f)) / 2.f;
+		const std::array<glm::vec3, 12> corners = {{
+			{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+			{0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+			{t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}}};
+		for (const auto &corner : corners)
+		{
+			vertices.push_back(sphereVertex(corner));
+		}
+		indices = {
+			0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+			1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+			3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+			4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+
+		for (uint32_t s = 0; s < subdivisions; s++)
+		{
+			std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints;
+			auto midpoint = [&](uint32_t a, uint32_t b)
+			{
+				auto key = std::minmax(a, b);
+				auto it = midpoints.find(key);
+				if (it != midpoints.end())
+				{
+					return it->second;
+				}
+				uint32_t index = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(sphereVertex(vertices[a].pos + vertices[b].pos));
+				midpoints.emplace(key, index);
+				return index;
+			};
+			std::vector<uint32_t> subdivided;
+			subdivided.reserve(indices.size() * 4);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+				subdivided.insert(subdivided.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+			}
+			indices.swap(subdivided);
+		}
+	}
+
+	// Open unit cylinder along z in [-1, 1], edge.vert scales it to the edge length
+	static void buildCylinder(std::vector<InstanceMeshVertex> &vertices, std::vector<uint32_t> &indices, uint32_t segments)
+	{
+		for (uint32_t i = 0; i <= segments; i++)
+		{
+			float u = static_cast<float>(i) / segments;
+			float angle = u * 2.f * MESH_PI;
+			glm::vec3 normal(std::cos(angle), std::sin(angle), 0.f);
+			vertices.push_back({normal + glm::vec3(0.f, 0.f, -1.f), normal, {u, 0.f}, {1.f, 1.f, 1.f}});
+			vertices.push_back({normal + glm::vec3(0.f, 0.f, 1.f), normal, {u, 1.f}, {1.f, 1.f, 1.f}});
+		}
+		for (uint32_t i = 0; i < segments; i++)
+		{
+			uint32_t b = 2 * i;
+			indices.insert(indices.end(), {b, b + 2, b + 1, b + 1, b + 2, b + 3});
+		}
+	}
+
+	static void uploadInstanceMesh(InstancePipeline &instancePipeline, TransferService &transferService)
+	{
+		std::vector<InstanceMeshVertex> vertices;
+		std::vector<uint32_t> indices;
+		if (instancePipeline.kind == INSTANCE_MESH_NODE)
+		{
+			buildIcosphere(vertices, indices, 1);
+		}
+		else
+		{
+			buildCylinder(vertices, indices, 8);
+		}
+
+		VkDeviceSize vertexSize = vertices.size() * sizeof(InstanceMeshVertex);
+		VkDeviceSize indexSize = indices.size() * sizeof(uint32_t);
+		VK_CHECK_RESULT(createBuffer(
+			*instancePipeline.allocator,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			vertexSize,
+			instancePipeline.vertexBuffer));
+		VK_CHECK_RESULT(createBuffer(
+			*instancePipeline.allocator,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			indexSize,
+			instancePipeline.indexBuffer));
+
+		enqueueBufferUpload(transferService, instancePipeline.vertexBuffer.buffer, 0, vertices.data(), vertexSize,
+							VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+		enqueueBufferUpload(transferService, instancePipeline.indexBuffer.buffer, 0, indices.data(), indexSize,
+							VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+		instancePipeline.indexCount = static_cast<uint32_t>(indices.size());
+	}
+
+	template <typename T>
+	static void uploadInstances(InstancePipeline &instancePipeline, TransferService &transferService, const std::vector<T> &instances)
+	{
+		instancePipeline.instanceCount = static_cast<uint32_t>(instances.size());
+		if (instances.empty())
+		{
+			return;
+		}
+		VkDeviceSize bufferSize = instances.size() * sizeof(T);
+		VK_CHECK_RESULT(createBuffer(
+			*instancePipeline.allocator,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			bufferSize,
+			instancePipeline.instanceBuffer));
+		enqueueBufferUpload(transferService, instancePipeline.instanceBuffer.buffer, 0, instances.data(), bufferSize,
+							VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	}
+
+	// Per-instance attributes start at location 4, after the mesh vertex
+	static std::vector<VkVertexInputAttributeDescription> instanceAttributes(InstanceMeshKind kind)
+	{
+#ifdef NV_PACKED_INSTANCES
+		if (kind == INSTANCE_MESH_NODE)
+		{
+			return {
+				initializers::vertexInputAttributeDescription(1, 4, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedNodeInstance, position)), // Location 4: Position, scale in w
+				initializers::vertexInputAttributeDescription(1, 6, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedNodeInstance, color)),       // Location 6: Color
+			};
+		}
+		return {
+			initializers::vertexInputAttributeDescription(1, 4, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedEdgeInstance, start)), // Location 4: Start position, scale in w
+			initializers::vertexInputAttributeDescription(1, 5, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedEdgeInstance, end)),   // Location 5: End position
+		};
+#else
+		if (kind == INSTANCE_MESH_NODE)
+		{
+			return {
+				initializers::vertexInputAttributeDescription(1, 4, VK_FORMAT_R32G32B32_SFLOAT, 0),                                        // Location 4: Position
+				initializers::vertexInputAttributeDescription(1, 5, VK_FORMAT_R32_SFLOAT, sizeof(glm::vec3) + sizeof(glm::vec4)),          // Location 5: Scale
+				initializers::vertexInputAttributeDescription(1, 6, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(glm::vec3)),                      // Location 6: Color
+			};
+		}
+		return {
+			initializers::vertexInputAttributeDescription(1, 4, VK_FORMAT_R32G32B32_SFLOAT, 0),                     // Location 4: Start position
+			initializers::vertexInputAttributeDescription(1, 5, VK_FORMAT_R32G32B32_SFLOAT, sizeof(glm::vec3)),     // Location 5: End position
+			initializers::vertexInputAttributeDescription(1, 6, VK_FORMAT_R32G32B32_SFLOAT, 2 * sizeof(glm::vec3)), // Location 6: Scale
+		};
+#endif
+	}
+
+	static void createInstancePipeline(InstancePipeline &instancePipeline, const InstancePipelineParams &params)
+	{
+		VkDevice logicalDevice = params.vulkanDevice->logicalDevice;
+
+		// Bindings 1 and 2 hold the node states and their palette for the _state vertex shader variants
+		instancePipeline.nodeStates = instancePipeline.kind == INSTANCE_MESH_NODE && params.nodeStateBuffer.buffer != VK_NULL_HANDLE &&
+									  params.nodePaletteBuffer.buffer != VK_NULL_HANDLE;
+		// Binding 3 holds the node filter keys and binding 4 the edge ends for the _filter variants
+		bool edgeEnds = instancePipeline.kind == INSTANCE_MESH_EDGE && params.edgeEndBuffer.buffer != VK_NULL_HANDLE;
+		instancePipeline.nodeFilter = params.nodeFilterBuffer.buffer != VK_NULL_HANDLE && (instancePipeline.kind == INSTANCE_MESH_NODE || edgeEnds);
+		// Binding 5 holds the node highlight flags for the _highlight variants, edges look them up through binding 4
+		instancePipeline.nodeHighlights = params.nodeHighlightBuffer.buffer != VK_NULL_HANDLE && (instancePipeline.kind == INSTANCE_MESH_NODE || edgeEnds);
+		bool bindEdgeEnds = edgeEnds && (instancePipeline.nodeFilter || instancePipeline.nodeHighlights);
+
+		// Descriptor pool
+		uint32_t storageBufferCount = (instancePipeline.nodeStates ? 1 : 0) + (instancePipeline.nodeFilter ? 1 : 0) +
+									  (instancePipeline.nodeHighlights ? 1 : 0) + (bindEdgeEnds ? 1 : 0);
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, instancePipeline.nodeStates ? 2 : 1)};
+		if (storageBufferCount > 0)
+		{
+			poolSizes.push_back(initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBufferCount));
+		}
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = initializers::descriptorPoolCreateInfo(poolSizes, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &instancePipeline.descriptorPool));
+
+		// Descriptor set layout
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0, 1),
+		};
+		if (instancePipeline.nodeStates)
+		{
+			setLayoutBindings.push_back(initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1, 1));
+			setLayoutBindings.push_back(initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 2, 1));
+		}
+		if (instancePipeline.nodeFilter)
+		{
+			setLayoutBindings.push_back(initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 3, 1));
+		}
+		if (bindEdgeEnds)
+		{
+			setLayoutBindings.push_back(initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 4, 1));
+		}
+		if (instancePipeline.nodeHighlights)
+		{
+			setLayoutBindings.push_back(initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 5, 1));
+		}
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &instancePipeline.descriptorSetLayout));
+
+		// Descriptor set
+		VkDescriptorSetAllocateInfo allocInfo = initializers::descriptorSetAllocateInfo(instancePipeline.descriptorPool, &instancePipeline.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &instancePipeline.descriptorSet));
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			initializers::writeDescriptorSet(instancePipeline.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &params.uniformProjectionBuffer, 1)};
+		if (instancePipeline.nodeStates)
+		{
+			writeDescriptorSets.push_back(initializers::writeDescriptorSet(instancePipeline.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &params.nodeStateBuffer, 1));
+			writeDescriptorSets.push_back(initializers::writeDescriptorSet(instancePipeline.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &params.nodePaletteBuffer, 1));
+		}
+		if (instancePipeline.nodeFilter)
+		{
+			writeDescriptorSets.push_back(initializers::writeDescriptorSet(instancePipeline.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &params.nodeFilterBuffer, 1));
+		}
+		if (bindEdgeEnds)
+		{
+			writeDescriptorSets.push_back(initializers::writeDescriptorSet(instancePipeline.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &params.edgeEndBuffer, 1));
+		}
+		if (instancePipeline.nodeHighlights)
+		{
+			writeDescriptorSets.push_back(initializers::writeDescriptorSet(instancePipeline.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &params.nodeHighlightBuffer, 1));
+		}
+		vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+		// Pipeline layout
+		// The quantization box is pushed per draw, the float layout ignores it
+		uint32_t pushConstantSize = sizeof(InstanceBounds) + (instancePipeline.nodeStates ? sizeof(NodeStateLookup) : 0) +
+									(instancePipeline.nodeFilter ? sizeof(NodeFilter) : 0) + (instancePipeline.nodeHighlights ? sizeof(NodeHighlight) : 0);
+		VkPushConstantRange pushConstantRange = initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, pushConstantSize, 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = initializers::pipelineLayoutCreateInfo(&instancePipeline.descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &instancePipeline.pipelineLayout));
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+
+		// The edge cylinders are open, so both sides are drawn
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+		VkPipelineColorBlendAttachmentState blendAttachmentState =
+			initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState =
+			initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT);
+
+		std::vector<VkDynamicState> dynamicStateEnables = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR};
+		VkPipelineDynamicStateCreateInfo dynamicState =
+			initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
+
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfo = initializers::pipelineCreateInfo(instancePipeline.pipelineLayout, params.renderPass);
+
+		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+		pipelineCreateInfo.pRasterizationState = &rasterizationState;
+		pipelineCreateInfo.pColorBlendState = &colorBlendState;
+		pipelineCreateInfo.pMultisampleState = &multisampleState;
+		pipelineCreateInfo.pViewportState = &viewportState;
+		pipelineCreateInfo.pDepthStencilState = &depthStencilState;
+		pipelineCreateInfo.pDynamicState = &dynamicState;
+		pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCreateInfo.pStages = shaderStages.data();
+
+		// Binding 0: mesh vertices, binding 1: instances in the compiled GPU layout
+		uint32_t instanceStride = instancePipeline.kind == INSTANCE_MESH_NODE ? sizeof(GpuNodeInstance) : sizeof(GpuEdgeInstance);
+		std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
+			initializers::vertexInputBindingDescription(0, sizeof(InstanceMeshVertex), VK_VERTEX_INPUT_RATE_VERTEX),
+			initializers::vertexInputBindingDescription(1, instanceStride, VK_VERTEX_INPUT_RATE_INSTANCE),
+		};
+		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceMeshVertex, pos)),    // Location 0: Position
+			initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceMeshVertex, normal)), // Location 1: Normal
+			initializers::vertexInputAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(InstanceMeshVertex, uv)),        // Location 2: Texture coordinates
+			initializers::vertexInputAttributeDescription(0, 3, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceMeshVertex, color)),  // Location 3: Color
+		};
+		auto instanceInputAttributes = instanceAttributes(instancePipeline.kind);
+		vertexInputAttributes.insert(vertexInputAttributes.end(), instanceInputAttributes.begin(), instanceInputAttributes.end());
+
+		VkPipelineVertexInputStateCreateInfo vertexInputState = initializers::pipelineVertexInputStateCreateInfo();
+		vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputBindings.size());
+		vertexInputState.pVertexBindingDescriptions = vertexInputBindings.data();
+		vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
+		vertexInputState.pVertexAttributeDescriptions = vertexInputAttributes.data();
+
+		pipelineCreateInfo.pVertexInputState = &vertexInputState;
+
+		shaderStages[0] = loadShader(logicalDevice, params.vertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
+		shaderStages[1] = loadShader(logicalDevice, params.fragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(logicalDevice, params.pipelineCache, 1, &pipelineCreateInfo, nullptr, &instancePipeline.pipeline));
+
+		vkDestroyShaderModule(logicalDevice, shaderStages[0].module, nullptr);
+		vkDestroyShaderModule(logicalDevice, shaderStages[1].module, nullptr);
+	}
+
+	std::unique_ptr<InstancePipeline> prepareNodeInstancePipeline(const InstancePipelineParams &params, const std::vector<NodeInstanceData> &nodeInstanceData)
+	{
+		auto instancePipeline = std::make_unique<InstancePipeline>();
+		instancePipeline->vulkanDevice = params.vulkanDevice;
+		instancePipeline->allocator = params.allocator;
+		instancePipeline->kind = INSTANCE_MESH_NODE;
+		instancePipeline->bounds = computeInstanceBounds(nodeInstanceData);
+
+		uploadInstanceMesh(*instancePipeline, *params.transferService);
+		uploadInstances(*instancePipeline, *params.transferService, toGpuNodeInstances(nodeInstanceData, instancePipeline->bounds));
+		createInstancePipeline(*instancePipeline, params);
+		return instancePipeline;
+	}
+
+	std::unique_ptr<InstancePipeline> prepareEdgeInstancePipeline(const InstancePipelineParams &params, const std::vector<EdgeInstanceData> &edgeInstanceData)
+	{
+		auto instancePipeline = std::make_unique<InstancePipeline>();
+		instancePipeline->vulkanDevice = params.vulkanDevice;
+		instancePipeline->allocator = params.allocator;
+		instancePipeline->kind = INSTANCE_MESH_EDGE;
+		instancePipeline->bounds = computeInstanceBounds(edgeInstanceData);
+
+		uploadInstanceMesh(*instancePipeline, *params.transferService);
+		uploadInstances(*instancePipeline, *params.transferService, toGpuEdgeInstances(edgeInstanceData, instancePipeline->bounds));
+		createInstancePipeline(*instancePipeline, params);
+		return instancePipeline;
+	}
+
+	void destroyInstancePipeline(InstancePipeline &instancePipeline)
+	{
+		VkDevice logicalDevice = instancePipeline.vulkanDevice->logicalDevice;
+		destroyBuffer(*instancePipeline.allocator, instancePipeline.vertexBuffer);
+		destroyBuffer(*instancePipeline.allocator, instancePipeline.indexBuffer);
+		destroyBuffer(*instancePipeline.allocator, instancePipeline.instanceBuffer);
+		vkDestroyPipeline(logicalDevice, instancePipeline.pipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, instancePipeline.pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(logicalDevice, instancePipeline.descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, instancePipeline.descriptorSetLayout, nullptr);
+	}
+
+	InstanceBufferView instanceBufferView(const InstancePipeline &instancePipeline)
+	{
+		InstanceBufferView view;
+		view.buffer = instancePipeline.instanceBuffer.buffer;
+		view.instanceCount = instancePipeline.instanceCount;
+		view.bounds = instancePipeline.bounds;
+		return view;
+	}
+
+	void buildInstanceCommandBuffer(InstancePipeline &instancePipeline, VkCommandBuffer commandBuffer)
+	{
+		if (instancePipeline.instanceCount == 0)
+		{
+			return;
+		}
+		InstanceDraw draw;
+		draw.bounds = instancePipeline.bounds;
+		draw.instanceCount = instancePipeline.instanceCount;
+		buildInstanceCommandBuffer(instancePipeline, commandBuffer, instancePipeline.instanceBuffer.buffer, {draw});
+	}
+
+	void buildInstanceCommandBuffer(InstancePipeline &instancePipeline, VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, const std::vector<InstanceDraw> &draws)
+	{
+		if (draws.empty())
+		{
+			return;
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancePipeline.pipelineLayout, 0, 1, &instancePipeline.descriptorSet, 0, nullptr);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancePipeline.pipeline);
+
+		VkDeviceSize offsets[1] = {0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &instancePipeline.vertexBuffer.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, instancePipeline.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+		if (instancePipeline.nodeStates)
+		{
+			vkCmdPushConstants(commandBuffer, instancePipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(InstanceBounds), sizeof(NodeStateLookup), &instancePipeline.stateLookup);
+		}
+		if (instancePipeline.nodeFilter)
+		{
+			uint32_t filterOffset = sizeof(InstanceBounds) + (instancePipeline.nodeStates ? sizeof(NodeStateLookup) : 0);
+			vkCmdPushConstants(commandBuffer, instancePipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, filterOffset, sizeof(NodeFilter), &instancePipeline.filter);
+		}
+		if (instancePipeline.nodeHighlights)
+		{
+			uint32_t highlightOffset = sizeof(InstanceBounds) + (instancePipeline.nodeStates ? sizeof(NodeStateLookup) : 0) +
+									   (instancePipeline.nodeFilter ? sizeof(NodeFilter) : 0);
+			vkCmdPushConstants(commandBuffer, instancePipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, highlightOffset, sizeof(NodeHighlight), &instancePipeline.highlight);
+		}
+		VkBuffer boundBuffer = VK_NULL_HANDLE;
+		for (const auto &draw : draws)
+		{
+			VkBuffer drawBuffer = draw.instanceBuffer != VK_NULL_HANDLE ? draw.instanceBuffer : instanceBuffer;
+			if (drawBuffer != boundBuffer)
+			{
+				vkCmdBindVertexBuffers(commandBuffer, 1, 1, &drawBuffer, offsets);
+				boundBuffer = drawBuffer;
+			}
+			vkCmdPushConstants(commandBuffer, instancePipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(InstanceBounds), &draw.bounds);
+			vkCmdDrawIndexed(commandBuffer, instancePipeline.indexCount, draw.instanceCount, 0, 0, draw.firstInstance);
+		}
+	}
+}
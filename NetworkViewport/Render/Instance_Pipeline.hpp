@@ -0,0 +1,131 @@
+#ifndef INSTANCE_PIPELINE_HPP
+#define INSTANCE_PIPELINE_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <VulkanTools/Structures/VulkanBuffer.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include "Memory_Allocator.hpp"
+#include "Node_Filter.hpp"
+#include "Node_Highlight.hpp"
+#include "Packed_Instances.hpp"
+#include "Transfer_Service.hpp"
+
+// ----------------------------------------------------------------------------
+// Instanced node and edge meshes
+// ----------------------------------------------------------------------------
+// Nodes are drawn as instanced icospheres and edges as instanced cylinders
+// stretched between their end points. The meshes are generated on startup and
+// the instance buffers use the compiled GPU layout (float or packed, see
+// Packed_Instances.hpp), so the vertex input matches node.vert and edge.vert.
+
+namespace render
+{
+enum InstanceMeshKind
+{
+	INSTANCE_MESH_NODE,
+	INSTANCE_MESH_EDGE
+};
+
+struct InstanceMeshVertex
+{
+	glm::vec3 pos;
+	glm::vec3 normal;
+	glm::vec2 uv;
+	glm::vec3 color;
+};
+
+// Pushed after the bounds by node pipelines with a state buffer, matches node.vert with NODE_STATE_BUFFER
+struct NodeStateLookup
+{
+	// Nonzero to color by the node state palette instead of the instance colors
+	uint32_t enabled = 0;
+	uint32_t padding[3] = {};
+};
+
+struct InstancePipelineParams
+{
+	std::string vertexShaderPath;
+	std::string fragmentShaderPath;
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	// Camera uniform block, usually a ProjectionUniform (see Projection_Uniform.hpp)
+	VkDescriptorBufferInfo uniformProjectionBuffer{};
+	// Mesh and instance data are uploaded with the next submitted transfer batch
+	TransferService *transferService = nullptr;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	// Node pipelines only, the packed uint8 states and the palette uniform read by the _state shader variants
+	// (see Node_State_Buffer.hpp)
+	VkDescriptorBufferInfo nodeStateBuffer{};
+	VkDescriptorBufferInfo nodePaletteBuffer{};
+	// The node filter keys, and for edge pipelines the edge ends, read by the _filter shader variants (see Node_Filter.hpp)
+	VkDescriptorBufferInfo nodeFilterBuffer{};
+	VkDescriptorBufferInfo edgeEndBuffer{};
+	// The node highlight flags read by the _highlight variants together with the edge ends (see Node_Highlight.hpp)
+	VkDescriptorBufferInfo nodeHighlightBuffer{};
+};
+
+struct InstancePipeline
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	InstanceMeshKind kind = INSTANCE_MESH_NODE;
+	AllocatedBuffer vertexBuffer;
+	AllocatedBuffer indexBuffer;
+	uint32_t indexCount = 0;
+	AllocatedBuffer instanceBuffer;
+	uint32_t instanceCount = 0;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	// Quantization box of the instance buffer, pushed with every draw
+	InstanceBounds bounds;
+	// Set when the pipeline reads a node state buffer, stateLookup is then pushed with every draw
+	bool nodeStates = false;
+	NodeStateLookup stateLookup;
+	// Set when the pipeline reads the node filter keys, filter is then pushed with every draw
+	bool nodeFilter = false;
+	NodeFilter filter;
+	// Set when the pipeline reads the node highlight flags, highlight is then pushed with every draw
+	bool nodeHighlights = false;
+	NodeHighlight highlight;
+};
+
+// A range of instances sharing one quantization box
+struct InstanceDraw
+{
+	InstanceBounds bounds;
+	uint32_t firstInstance = 0;
+	uint32_t instanceCount = 0;
+	// Buffer the instances are read from, the one passed to buildInstanceCommandBuffer if null
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+};
+
+// The instance buffer of a pipeline as borrowed by other passes drawing the same instances, e.g. line edges
+struct InstanceBufferView
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	uint32_t instanceCount = 0;
+	InstanceBounds bounds;
+};
+
+	std::unique_ptr<InstancePipeline> prepareNodeInstancePipeline(const InstancePipelineParams &params, const std::vector<NodeInstanceData> &nodeInstanceData);
+	std::unique_ptr<InstancePipeline> prepareEdgeInstancePipeline(const InstancePipelineParams &params, const std::vector<EdgeInstanceData> &edgeInstanceData);
+
+	void destroyInstancePipeline(InstancePipeline &instancePipeline);
+
+	// Valid until the pipeline is destroyed
+	InstanceBufferView instanceBufferView(const InstancePipeline &instancePipeline);
+
+	// Record the instanced draw into a command buffer inside an active render pass
+	void buildInstanceCommandBuffer(InstancePipeline &instancePipeline, VkCommandBuffer commandBuffer);
+	// Draw ranges of external instance buffers with the pipeline's mesh, e.g. resident chunks
+	void buildInstanceCommandBuffer(InstancePipeline &instancePipeline, VkCommandBuffer commandBuffer, VkBuffer instanceBuffer, const std::vector<InstanceDraw> &draws);
+}
+
+#endif
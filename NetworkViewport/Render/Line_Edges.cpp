@@ -0,0 +1,176 @@
+#include "Line_Edges.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+#include <VulkanTools/Utilities/VulkanPipelineInitializers.hpp>
+#include <VulkanTools/InstanceGraphics/GLTF_Assets.hpp>
+
+namespace render
+{
+	// The line shader only reads the two end points of an edge
+	static_assert(sizeof(EdgeInstanceData) >= 2 * sizeof(glm::vec3), "EdgeInstanceData must start with its two end points");
+
+	std::unique_ptr<LineEdgePipeline> prepareLineEdgeRendering(const LineEdgeParams &params, const InstanceBufferView &edgeInstances)
+	{
+		auto lineEdges = std::make_unique<LineEdgePipeline>();
+		lineEdges->vulkanDevice = params.vulkanDevice;
+		lineEdges->instanceBuffer = edgeInstances.buffer;
+		lineEdges->edgeCount = edgeInstances.instanceCount;
+		lineEdges->pushConstBlock.bounds = edgeInstances.bounds;
+		VkDevice logicalDevice = params.vulkanDevice->logicalDevice;
+
+		// Descriptor pool
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = initializers::descriptorPoolCreateInfo(poolSizes, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &lineEdges->descriptorPool));
+
+		// Descriptor set layout
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0, 1),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &lineEdges->descriptorSetLayout));
+
+		// Descriptor set
+		VkDescriptorSetAllocateInfo allocInfo = initializers::descriptorSetAllocateInfo(lineEdges->descriptorPool, &lineEdges->descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &lineEdges->descriptorSet));
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			initializers::writeDescriptorSet(lineEdges->descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &params.uniformProjectionBuffer, 1)};
+		vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+		// Pipeline layout
+		// Push constants for the quantization box, line width, viewport and density alpha
+		VkPushConstantRange pushConstantRange = initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(lineEdges->pushConstBlock), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = initializers::pipelineLayoutCreateInfo(&lineEdges->descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &lineEdges->pipelineLayout));
+
+		// Quads are generated from gl_VertexIndex, two triangles per edge
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+		// Coverage is written to alpha, blend over the scene
+		VkPipelineColorBlendAttachmentState blendAttachmentState{};
+		blendAttachmentState.blendEnable = VK_TRUE;
+		blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+		blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState =
+			initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+
+		// Lines are hidden behind nodes but do not occlude each other
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT);
+
+		std::vector<VkDynamicState> dynamicStateEnables = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR};
+		VkPipelineDynamicStateCreateInfo dynamicState =
+			initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
+
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfo = initializers::pipelineCreateInfo(lineEdges->pipelineLayout, params.renderPass);
+
+		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+		pipelineCreateInfo.pRasterizationState = &rasterizationState;
+		pipelineCreateInfo.pColorBlendState = &colorBlendState;
+		pipelineCreateInfo.pMultisampleState = &multisampleState;
+		pipelineCreateInfo.pViewportState = &viewportState;
+		pipelineCreateInfo.pDepthStencilState = &depthStencilState;
+		pipelineCreateInfo.pDynamicState = &dynamicState;
+		pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCreateInfo.pStages = shaderStages.data();
+
+		// Edge end points are read per instance, straight from the GPU edge layout
+		std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
+			initializers::vertexInputBindingDescription(0, sizeof(GpuEdgeInstance), VK_VERTEX_INPUT_RATE_INSTANCE),
+		};
+		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
+#ifdef NV_PACKED_INSTANCES
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedEdgeInstance, start)), // Location 0: Start node position
+			initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedEdgeInstance, end)),   // Location 1: End node position
+#else
+			initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),                 // Location 0: Start node position
+			initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(glm::vec3)), // Location 1: End node position
+#endif
+		};
+		VkPipelineVertexInputStateCreateInfo vertexInputState = initializers::pipelineVertexInputStateCreateInfo();
+		vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputBindings.size());
+		vertexInputState.pVertexBindingDescriptions = vertexInputBindings.data();
+		vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
+		vertexInputState.pVertexAttributeDescriptions = vertexInputAttributes.data();
+
+		pipelineCreateInfo.pVertexInputState = &vertexInputState;
+
+		shaderStages[0] = loadShader(logicalDevice, params.vertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
+		shaderStages[1] = loadShader(logicalDevice, params.fragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(logicalDevice, params.pipelineCache, 1, &pipelineCreateInfo, nullptr, &lineEdges->pipeline));
+
+		vkDestroyShaderModule(logicalDevice, shaderStages[0].module, nullptr);
+		vkDestroyShaderModule(logicalDevice, shaderStages[1].module, nullptr);
+
+		return lineEdges;
+	}
+
+	void destroyLineEdgePipeline(LineEdgePipeline &lineEdges)
+	{
+		VkDevice logicalDevice = lineEdges.vulkanDevice->logicalDevice;
+		vkDestroyPipeline(logicalDevice, lineEdges.pipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, lineEdges.pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(logicalDevice, lineEdges.descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, lineEdges.descriptorSetLayout, nullptr);
+	}
+
+	float lineEdgeDensityAlpha(uint32_t edgeCount, float lineWidth, uint32_t width, uint32_t height, float densityScale)
+	{
+		if (edgeCount == 0 || width == 0 || height == 0)
+		{
+			return 1.f;
+		}
+		// Assume an average projected edge length on the order of the viewport size,
+		// the expected overdraw per pixel is then edges * length * width / area
+		float pixels = static_cast<float>(width) * static_cast<float>(height);
+		float overdraw = edgeCount * std::max(lineWidth, 1.f) * std::sqrt(pixels) / pixels;
+		// Never fade below what an 8-bit target can still accumulate
+		return std::clamp(densityScale / std::max(overdraw, 1e-6f), 4.f / 255.f, 1.f);
+	}
+
+	void buildLineEdgeCommandBuffer(LineEdgePipeline &lineEdges, VkCommandBuffer commandBuffer, uint32_t width, uint32_t height, float lineWidth, float densityScale)
+	{
+		if (lineEdges.edgeCount == 0)
+		{
+			return;
+		}
+		lineEdges.pushConstBlock.viewport = glm::vec2(width, height);
+		lineEdges.pushConstBlock.lineWidth = lineWidth;
+		lineEdges.pushConstBlock.alpha = lineEdgeDensityAlpha(lineEdges.edgeCount, lineWidth, width, height, densityScale);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lineEdges.pipelineLayout, 0, 1, &lineEdges.descriptorSet, 0, nullptr);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lineEdges.pipeline);
+		vkCmdPushConstants(commandBuffer, lineEdges.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(lineEdges.pushConstBlock), &lineEdges.pushConstBlock);
+
+		VkDeviceSize offsets[1] = {0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &lineEdges.instanceBuffer, offsets);
+		vkCmdDraw(commandBuffer, 6, lineEdges.edgeCount, 0, 0);
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef LINE_EDGES_HPP
+#define LINE_EDGES_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <VulkanTools/Structures/VulkanBuffer.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include "Instance_Pipeline.hpp"
+
+// ----------------------------------------------------------------------------
+// Screen-space line edges
+// ----------------------------------------------------------------------------
+// Every edge instance is expanded into a thin, camera-facing quad in the
+// vertex shader (no mesh, 6 vertices per instance) and anti-aliased
+// analytically in the fragment shader from the pixel distance to the line.
+// The instances are read from the edge instance pipeline's buffer, in the
+// compiled GPU layout (see Packed_Instances.hpp), pair the pipeline with the
+// matching line shader variant.
+
+namespace render
+{
+struct LineEdgeParams
+{
+	std::string vertexShaderPath;
+	std::string fragmentShaderPath;
+	VulkanDevice *vulkanDevice = nullptr;
+	VkDescriptorBufferInfo uniformProjectionBuffer{};
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+};
+
+struct LineEdgePipeline
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	// Borrowed from the edge instance pipeline
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	uint32_t edgeCount = 0;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	// Line params are set via push constants, the quantization box comes first as in edge.vert
+	struct PushConstBlock
+	{
+		InstanceBounds bounds;
+		glm::vec4 color = {1.f, 1.f, 1.f, 1.f};
+		glm::vec2 viewport = {1.f, 1.f};
+		float lineWidth = 1.f;
+		float alpha = 1.f;
+	} pushConstBlock;
+};
+
+	// Create the line pipeline drawing the given edge instances, the buffer has to outlive it
+	std::unique_ptr<LineEdgePipeline> prepareLineEdgeRendering(const LineEdgeParams &params, const InstanceBufferView &edgeInstances);
+
+	void destroyLineEdgePipeline(LineEdgePipeline &lineEdges);
+
+	// Line alpha for the given edge count, so that a viewport covered by edges saturates to roughly densityScale
+	float lineEdgeDensityAlpha(uint32_t edgeCount, float lineWidth, uint32_t width, uint32_t height, float densityScale);
+
+	// Record the line draw into a command buffer inside an active render pass
+	void buildLineEdgeCommandBuffer(LineEdgePipeline &lineEdges, VkCommandBuffer commandBuffer, uint32_t width, uint32_t height, float lineWidth, float densityScale);
+}
+
+#endif
@@ -0,0 +1,537 @@
+#include "Memory_Allocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+
+namespace render
+{
+	// Initial size of the transient staging arena
+	static constexpr VkDeviceSize TRANSIENT_ARENA_MIN_SIZE = 16 * 1024 * 1024;
+
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static bool isHostVisible(DeviceMemoryAllocator &allocator, uint32_t memoryTypeIndex)
+	{
+		return allocator.vulkanDevice->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+
+	static std::unique_ptr<MemoryBlock> allocateBlock(DeviceMemoryAllocator &allocator, VkDeviceSize size, uint32_t memoryTypeIndex, AllocationKind kind)
+	{
+		VkDevice logicalDevice = allocator.vulkanDevice->logicalDevice;
+		auto block = std::make_unique<MemoryBlock>();
+		block->size = size;
+		block->memoryTypeIndex = memoryTypeIndex;
+		block->kind = kind;
+
+		VkMemoryAllocateInfo memAllocInfo = initializers::memoryAllocateInfo();
+		memAllocInfo.allocationSize = size;
+		memAllocInfo.memoryTypeIndex = memoryTypeIndex;
+		VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAllocInfo, nullptr, &block->memory));
+
+		// Host-visible blocks stay mapped, a memory object can only be mapped once
+		if (isHostVisible(allocator, memoryTypeIndex))
+		{
+			VK_CHECK_RESULT(vkMapMemory(logicalDevice, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+		}
+		block->freeRanges[0] = size;
+		return block;
+	}
+
+	static void freeBlock(DeviceMemoryAllocator &allocator, MemoryBlock &block)
+	{
+		VkDevice logicalDevice = allocator.vulkanDevice->logicalDevice;
+		if (block.mapped)
+		{
+			vkUnmapMemory(logicalDevice, block.memory);
+			block.mapped = nullptr;
+		}
+		vkFreeMemory(logicalDevice, block.memory, nullptr);
+		block.memory = VK_NULL_HANDLE;
+	}
+
+	// Best fit over the free spans of a block
+	static bool allocateFromBlock(MemoryBlock &block, VkDeviceSize size, VkDeviceSize alignment, Allocation &allocation)
+	{
+		auto best = block.freeRanges.end();
+		VkDeviceSize bestRemainder = VK_WHOLE_SIZE;
+		for (auto range = block.freeRanges.begin(); range != block.freeRanges.end(); range++)
+		{
+			VkDeviceSize aligned = alignUp(range->first, alignment);
+			VkDeviceSize needed = aligned - range->first + size;
+			if (needed <= range->second && range->second - needed < bestRemainder)
+			{
+				best = range;
+				bestRemainder = range->second - needed;
+				if (bestRemainder == 0)
+				{
+					break;
+				}
+			}
+		}
+		if (best == block.freeRanges.end())
+		{
+			return false;
+		}
+
+		VkDeviceSize spanOffset = best->first;
+		VkDeviceSize aligned = alignUp(spanOffset, alignment);
+		VkDeviceSize spanSize = aligned - spanOffset + size;
+		block.freeRanges.erase(best);
+		if (bestRemainder > 0)
+		{
+			block.freeRanges[spanOffset + spanSize] = bestRemainder;
+		}
+
+		allocation.memory = block.memory;
+		allocation.offset = aligned;
+		allocation.size = size;
+		allocation.alignment = alignment;
+		allocation.mapped = block.mapped ? static_cast<char *>(block.mapped) + aligned : nullptr;
+		allocation.memoryTypeIndex = block.memoryTypeIndex;
+		allocation.spanOffset = spanOffset;
+		allocation.spanSize = spanSize;
+		allocation.block = &block;
+
+		block.liveBytes += size;
+		block.paddingBytes += spanSize - size;
+		block.allocationCount++;
+		return true;
+	}
+
+	static void releaseSpan(MemoryBlock &block, const Allocation &allocation)
+	{
+		VkDeviceSize offset = allocation.spanOffset;
+		VkDeviceSize size = allocation.spanSize;
+
+		// Merge with the following span
+		auto next = block.freeRanges.find(offset + size);
+		if (next != block.freeRanges.end())
+		{
+			size += next->second;
+			block.freeRanges.erase(next);
+		}
+		// Merge with the preceding span
+		auto inserted = block.freeRanges.emplace(offset, size).first;
+		if (inserted != block.freeRanges.begin())
+		{
+			auto prev = std::prev(inserted);
+			if (prev->first + prev->second == offset)
+			{
+				prev->second += size;
+				block.freeRanges.erase(inserted);
+			}
+		}
+
+		block.liveBytes -= allocation.size;
+		block.paddingBytes -= allocation.spanSize - allocation.size;
+		block.allocationCount--;
+	}
+
+	void createDeviceMemoryAllocator(DeviceMemoryAllocator &allocator, VulkanDevice *vulkanDevice, VkDeviceSize blockSize)
+	{
+		allocator.vulkanDevice = vulkanDevice;
+		allocator.blockSize = blockSize;
+	}
+
+	void destroyDeviceMemoryAllocator(DeviceMemoryAllocator &allocator)
+	{
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		for (auto &pool : allocator.pools)
+		{
+			for (auto &block : pool.second)
+			{
+				freeBlock(allocator, *block);
+			}
+		}
+		allocator.pools.clear();
+		allocator.allocations.clear();
+		if (allocator.transientBlock)
+		{
+			freeBlock(allocator, *allocator.transientBlock);
+			allocator.transientBlock.reset();
+		}
+		for (auto &block : allocator.retiredTransientBlocks)
+		{
+			freeBlock(allocator, *block);
+		}
+		allocator.retiredTransientBlocks.clear();
+	}
+
+	Allocation *allocateMemory(DeviceMemoryAllocator &allocator, const VkMemoryRequirements &memReqs, VkMemoryPropertyFlags properties, AllocationKind kind, const void *mover)
+	{
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		uint32_t memoryTypeIndex = allocator.vulkanDevice->getMemoryType(memReqs.memoryTypeBits, properties);
+		auto &pool = allocator.pools[{memoryTypeIndex, kind}];
+
+		auto allocation = std::make_unique<Allocation>();
+		allocation->mover = mover;
+
+		bool placed = false;
+		// Resources larger than half a block get a block of their own
+		if (memReqs.size > allocator.blockSize / 2)
+		{
+			pool.push_back(allocateBlock(allocator, memReqs.size, memoryTypeIndex, kind));
+			pool.back()->dedicated = true;
+			placed = allocateFromBlock(*pool.back(), memReqs.size, memReqs.alignment, *allocation);
+		}
+		else
+		{
+			for (auto &block : pool)
+			{
+				if (!block->dedicated && !block->draining && allocateFromBlock(*block, memReqs.size, memReqs.alignment, *allocation))
+				{
+					placed = true;
+					break;
+				}
+			}
+			if (!placed)
+			{
+				pool.push_back(allocateBlock(allocator, allocator.blockSize, memoryTypeIndex, kind));
+				placed = allocateFromBlock(*pool.back(), memReqs.size, memReqs.alignment, *allocation);
+			}
+		}
+		if (!placed)
+		{
+			throw std::runtime_error("Device memory allocation does not fit into a fresh block");
+		}
+
+		Allocation *handle = allocation.get();
+		allocator.allocations[handle] = std::move(allocation);
+		return handle;
+	}
+
+	void freeMemory(DeviceMemoryAllocator &allocator, Allocation *allocation)
+	{
+		if (allocation == nullptr)
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		MemoryBlock *block = allocation->block;
+		releaseSpan(*block, *allocation);
+
+		// Keep at most one empty block per pool around to absorb allocate/free churn
+		if (block->allocationCount == 0)
+		{
+			auto &pool = allocator.pools[{block->memoryTypeIndex, block->kind}];
+			bool keep = !block->dedicated && !block->draining && std::count_if(pool.begin(), pool.end(), [](const std::unique_ptr<MemoryBlock> &b)
+																			   { return b->allocationCount == 0 && !b->dedicated && !b->draining; }) == 1;
+			if (!keep)
+			{
+				freeBlock(allocator, *block);
+				pool.erase(std::find_if(pool.begin(), pool.end(), [block](const std::unique_ptr<MemoryBlock> &b)
+										{ return b.get() == block; }));
+			}
+		}
+		allocator.allocations.erase(allocation);
+	}
+
+	Allocation allocateTransient(DeviceMemoryAllocator &allocator, const VkMemoryRequirements &memReqs)
+	{
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		MemoryBlock *block = allocator.transientBlock.get();
+		VkDeviceSize offset = block ? alignUp(allocator.transientHead, memReqs.alignment) : 0;
+		if (block == nullptr || offset + memReqs.size > block->size)
+		{
+			// Retire the outgrown arena, its contents may still be read by pending copies
+			VkDeviceSize newSize = std::max(TRANSIENT_ARENA_MIN_SIZE, memReqs.size);
+			if (block)
+			{
+				newSize = std::max(newSize, block->size * 2);
+				allocator.retiredTransientBlocks.push_back(std::move(allocator.transientBlock));
+			}
+			uint32_t memoryTypeIndex = allocator.vulkanDevice->getMemoryType(memReqs.memoryTypeBits, properties);
+			allocator.transientBlock = allocateBlock(allocator, newSize, memoryTypeIndex, ALLOCATION_KIND_BUFFER);
+			block = allocator.transientBlock.get();
+			offset = 0;
+		}
+		if (((1u << block->memoryTypeIndex) & memReqs.memoryTypeBits) == 0)
+		{
+			throw std::runtime_error("Transient allocation is not compatible with the staging arena memory type");
+		}
+
+		allocator.transientHead = offset + memReqs.size;
+		Allocation allocation;
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = memReqs.size;
+		allocation.mapped = static_cast<char *>(block->mapped) + offset;
+		allocation.memoryTypeIndex = block->memoryTypeIndex;
+		allocation.spanOffset = offset;
+		allocation.spanSize = memReqs.size;
+		return allocation;
+	}
+
+	void resetTransient(DeviceMemoryAllocator &allocator)
+	{
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		allocator.transientHead = 0;
+		// An arena grown by a burst of uploads is released, the next one starts at the minimum size again
+		if (allocator.transientBlock && allocator.transientBlock->size > TRANSIENT_ARENA_MIN_SIZE)
+		{
+			allocator.retiredTransientBlocks.push_back(std::move(allocator.transientBlock));
+		}
+		for (auto &block : allocator.retiredTransientBlocks)
+		{
+			freeBlock(allocator, *block);
+		}
+		allocator.retiredTransientBlocks.clear();
+	}
+
+	std::vector<DefragmentationMove> defragment(DeviceMemoryAllocator &allocator, const void *mover, VkDeviceSize maxBytesToMove)
+	{
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		std::vector<DefragmentationMove> moves;
+		VkDeviceSize bytesMoved = 0;
+
+		for (auto &pool : allocator.pools)
+		{
+			std::vector<MemoryBlock *> candidates;
+			for (auto &block : pool.second)
+			{
+				if (!block->dedicated && !block->draining)
+				{
+					candidates.push_back(block.get());
+				}
+			}
+			// Least occupied first, each block is only emptied into fuller ones so nothing moves twice
+			std::sort(candidates.begin(), candidates.end(), [](const MemoryBlock *a, const MemoryBlock *b)
+					  { return a->liveBytes < b->liveBytes; });
+
+			for (size_t sourceIndex = 0; sourceIndex + 1 < candidates.size(); sourceIndex++)
+			{
+				MemoryBlock *source = candidates[sourceIndex];
+				std::vector<Allocation *> residents;
+				bool movable = true;
+				for (auto &entry : allocator.allocations)
+				{
+					if (entry.first->block == source)
+					{
+						residents.push_back(entry.first);
+						movable = movable && entry.first->mover == mover;
+					}
+				}
+				if (!movable || residents.empty())
+				{
+					continue;
+				}
+				if (maxBytesToMove != VK_WHOLE_SIZE && bytesMoved + source->liveBytes > maxBytesToMove)
+				{
+					continue;
+				}
+
+				// Reserve destinations for every resident first, roll back if one does not fit
+				std::vector<Allocation> destinations(residents.size());
+				size_t reserved = 0;
+				for (; reserved < residents.size(); reserved++)
+				{
+					bool placed = false;
+					for (size_t target = sourceIndex + 1; !placed && target < candidates.size(); target++)
+					{
+						placed = !candidates[target]->draining &&
+								 allocateFromBlock(*candidates[target], residents[reserved]->size, residents[reserved]->alignment, destinations[reserved]);
+					}
+					if (!placed)
+					{
+						break;
+					}
+				}
+				if (reserved < residents.size())
+				{
+					for (size_t i = 0; i < reserved; i++)
+					{
+						releaseSpan(*destinations[i].block, destinations[i]);
+					}
+					continue;
+				}
+
+				// The residents keep their handles, the source spans get new ones until their copies completed
+				for (size_t i = 0; i < residents.size(); i++)
+				{
+					Allocation *resident = residents[i];
+					auto sourceSpan = std::make_unique<Allocation>(*resident);
+					sourceSpan->mover = nullptr;
+					DefragmentationMove move;
+					move.allocation = resident;
+					move.source = sourceSpan.get();
+					allocator.allocations[move.source] = std::move(sourceSpan);
+
+					destinations[i].mover = mover;
+					*resident = destinations[i];
+					bytesMoved += resident->size;
+					moves.push_back(move);
+				}
+				source->draining = true;
+			}
+		}
+		return moves;
+	}
+
+	std::vector<HeapStats> memoryHeapStats(DeviceMemoryAllocator &allocator)
+	{
+		std::lock_guard<std::mutex> lock(allocator.mutex);
+		const VkPhysicalDeviceMemoryProperties &memoryProperties = allocator.vulkanDevice->memoryProperties;
+		std::vector<HeapStats> stats(memoryProperties.memoryHeapCount);
+
+		auto accumulate = [&](const MemoryBlock &block)
+		{
+			HeapStats &heap = stats[memoryProperties.memoryTypes[block.memoryTypeIndex].heapIndex];
+			heap.allocatedBytes += block.size;
+			heap.liveBytes += block.liveBytes;
+			heap.wastedBytes += block.paddingBytes;
+			heap.blockCount++;
+			heap.allocationCount += block.allocationCount;
+		};
+		for (auto &pool : allocator.pools)
+		{
+			for (auto &block : pool.second)
+			{
+				accumulate(*block);
+			}
+		}
+		if (allocator.transientBlock)
+		{
+			accumulate(*allocator.transientBlock);
+		}
+		for (auto &block : allocator.retiredTransientBlocks)
+		{
+			accumulate(*block);
+		}
+		return stats;
+	}
+
+	static void createBoundBuffer(DeviceMemoryAllocator &allocator, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, AllocatedBuffer &buffer, const void *mover)
+	{
+		VkDevice logicalDevice = allocator.vulkanDevice->logicalDevice;
+		VkBufferCreateInfo bufferInfo = initializers::bufferCreateInfo(usage, size);
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer.buffer));
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(logicalDevice, buffer.buffer, &memReqs);
+		buffer.allocation = allocateMemory(allocator, memReqs, properties, ALLOCATION_KIND_BUFFER, mover);
+		VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, buffer.buffer, buffer.allocation->memory, buffer.allocation->offset));
+
+		buffer.size = size;
+		buffer.usageFlags = usage;
+		buffer.memoryPropertyFlags = properties;
+		buffer.mapped = buffer.allocation->mapped;
+		buffer.descriptor.buffer = buffer.buffer;
+		buffer.descriptor.offset = 0;
+		buffer.descriptor.range = VK_WHOLE_SIZE;
+	}
+
+	VkResult createBuffer(DeviceMemoryAllocator &allocator, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, AllocatedBuffer &buffer, const void *data)
+	{
+		createBoundBuffer(allocator, usage, properties, size, buffer, nullptr);
+		if (data != nullptr)
+		{
+			if (buffer.mapped == nullptr)
+			{
+				return VK_ERROR_MEMORY_MAP_FAILED;
+			}
+			memcpy(buffer.mapped, data, size);
+		}
+		return VK_SUCCESS;
+	}
+
+	void destroyBuffer(DeviceMemoryAllocator &allocator, AllocatedBuffer &buffer)
+	{
+		if (buffer.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(allocator.vulkanDevice->logicalDevice, buffer.buffer, nullptr);
+		}
+		freeMemory(allocator, buffer.allocation);
+		buffer = AllocatedBuffer();
+	}
+
+	VkResult createMovableBuffer(DeviceMemoryAllocator &allocator, const void *mover, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, AllocatedBuffer &buffer)
+	{
+		createBoundBuffer(allocator, usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties, size, buffer, mover);
+		return VK_SUCCESS;
+	}
+
+	VkBuffer rebindMovedBuffer(DeviceMemoryAllocator &allocator, AllocatedBuffer &buffer)
+	{
+		VkDevice logicalDevice = allocator.vulkanDevice->logicalDevice;
+		VkBuffer oldBuffer = buffer.buffer;
+		VkBufferCreateInfo bufferInfo = initializers::bufferCreateInfo(buffer.usageFlags, buffer.size);
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer.buffer));
+		// Same usage and size, so the requirements the allocation was made for still hold
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(logicalDevice, buffer.buffer, &memReqs);
+		VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, buffer.buffer, buffer.allocation->memory, buffer.allocation->offset));
+		buffer.mapped = buffer.allocation->mapped;
+		buffer.descriptor.buffer = buffer.buffer;
+		return oldBuffer;
+	}
+
+	VkResult createStagingBuffer(DeviceMemoryAllocator &allocator, VkDeviceSize size, AllocatedBuffer &buffer, const void *data)
+	{
+		VkDevice logicalDevice = allocator.vulkanDevice->logicalDevice;
+		VkBufferCreateInfo bufferInfo = initializers::bufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size);
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer.buffer));
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(logicalDevice, buffer.buffer, &memReqs);
+		Allocation allocation = allocateTransient(allocator, memReqs);
+		VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, buffer.buffer, allocation.memory, allocation.offset));
+
+		buffer.allocation = nullptr;
+		buffer.size = size;
+		buffer.usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer.memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		buffer.mapped = allocation.mapped;
+		buffer.descriptor.buffer = buffer.buffer;
+		buffer.descriptor.offset = 0;
+		buffer.descriptor.range = VK_WHOLE_SIZE;
+		if (data != nullptr)
+		{
+			memcpy(buffer.mapped, data, size);
+		}
+		return VK_SUCCESS;
+	}
+
+	void destroyStagingBuffer(DeviceMemoryAllocator &allocator, AllocatedBuffer &buffer)
+	{
+		// The arena memory itself is recycled by resetTransient
+		if (buffer.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(allocator.vulkanDevice->logicalDevice, buffer.buffer, nullptr);
+		}
+		buffer = AllocatedBuffer();
+	}
+
+	VkResult createImage(DeviceMemoryAllocator &allocator, const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, Allocation *&allocation)
+	{
+		VkDevice logicalDevice = allocator.vulkanDevice->logicalDevice;
+		VK_CHECK_RESULT(vkCreateImage(logicalDevice, &imageInfo, nullptr, &image));
+
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(logicalDevice, image, &memReqs);
+		// Linear images share pools with buffers, optimal images get their own
+		AllocationKind kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? ALLOCATION_KIND_BUFFER : ALLOCATION_KIND_IMAGE;
+		allocation = allocateMemory(allocator, memReqs, properties, kind);
+		VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, image, allocation->memory, allocation->offset));
+		return VK_SUCCESS;
+	}
+
+	void destroyImage(DeviceMemoryAllocator &allocator, VkImage &image, Allocation *&allocation)
+	{
+		if (image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(allocator.vulkanDevice->logicalDevice, image, nullptr);
+		}
+		freeMemory(allocator, allocation);
+		image = VK_NULL_HANDLE;
+		allocation = nullptr;
+	}
+}
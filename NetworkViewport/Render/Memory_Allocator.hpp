@@ -0,0 +1,151 @@
+#ifndef MEMORY_ALLOCATOR_HPP
+#define MEMORY_ALLOCATOR_HPP
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+
+// ----------------------------------------------------------------------------
+// Device memory sub-allocation
+// ----------------------------------------------------------------------------
+// Resources are placed in large VkDeviceMemory blocks instead of getting one
+// vkAllocateMemory each. Blocks are pooled per memory type and per resource
+// kind (buffers and optimal images never share a block, which sidesteps
+// bufferImageGranularity). Host-visible blocks are mapped once for their
+// lifetime. A separate linear arena serves transient staging memory.
+// Movable buffers can be compacted out of sparsely used blocks: defragment
+// moves them, and their owner copies the contents and rebinds the buffer.
+
+namespace render
+{
+enum AllocationKind
+{
+	ALLOCATION_KIND_BUFFER,
+	ALLOCATION_KIND_IMAGE
+};
+
+struct MemoryBlock
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	uint32_t memoryTypeIndex = 0;
+	AllocationKind kind = ALLOCATION_KIND_BUFFER;
+	void *mapped = nullptr;
+	// Free spans keyed by offset, adjacent spans are always merged
+	std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+	VkDeviceSize liveBytes = 0;
+	VkDeviceSize paddingBytes = 0;
+	uint32_t allocationCount = 0;
+	// Blocks holding a single oversized resource are freed with it
+	bool dedicated = false;
+	// Emptied by defragmentation, takes no new allocations and is freed with its last span
+	bool draining = false;
+};
+
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	// Aligned offset the resource is bound at
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 1;
+	void *mapped = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	// Reserved span in the block, including alignment padding
+	VkDeviceSize spanOffset = 0;
+	VkDeviceSize spanSize = 0;
+	MemoryBlock *block = nullptr;
+	// Owner that rebinds the resource when defragmentation moves it, null if the resource stays in place
+	const void *mover = nullptr;
+};
+
+struct HeapStats
+{
+	// Bytes obtained from vkAllocateMemory
+	VkDeviceSize allocatedBytes = 0;
+	// Bytes requested by live resources
+	VkDeviceSize liveBytes = 0;
+	// Alignment padding inside reserved spans
+	VkDeviceSize wastedBytes = 0;
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+};
+
+struct DefragmentationMove
+{
+	// Rewritten to the destination
+	Allocation *allocation = nullptr;
+	// The span the resource was moved out of. Freed with freeMemory once the copy has completed
+	Allocation *source = nullptr;
+};
+
+struct DeviceMemoryAllocator
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	VkDeviceSize blockSize = 64 * 1024 * 1024;
+	// Pools keyed by (memory type, kind)
+	std::map<std::pair<uint32_t, AllocationKind>, std::vector<std::unique_ptr<MemoryBlock>>> pools;
+	std::map<Allocation *, std::unique_ptr<Allocation>> allocations;
+
+	// Linear arena for transient staging memory, reset once its uploads completed
+	std::unique_ptr<MemoryBlock> transientBlock;
+	VkDeviceSize transientHead = 0;
+	// Outgrown arenas, still read by in-flight copies until the next reset
+	std::vector<std::unique_ptr<MemoryBlock>> retiredTransientBlocks;
+
+	std::mutex mutex;
+};
+
+	void createDeviceMemoryAllocator(DeviceMemoryAllocator &allocator, VulkanDevice *vulkanDevice, VkDeviceSize blockSize = 64 * 1024 * 1024);
+	void destroyDeviceMemoryAllocator(DeviceMemoryAllocator &allocator);
+
+	Allocation *allocateMemory(DeviceMemoryAllocator &allocator, const VkMemoryRequirements &memReqs, VkMemoryPropertyFlags properties, AllocationKind kind, const void *mover = nullptr);
+	void freeMemory(DeviceMemoryAllocator &allocator, Allocation *allocation);
+
+	// Bump allocation from the host-visible staging arena, grows the arena when it runs out
+	Allocation allocateTransient(DeviceMemoryAllocator &allocator, const VkMemoryRequirements &memReqs);
+	// All transient allocations must have been consumed by the GPU. The transfer service resets the arena itself
+	void resetTransient(DeviceMemoryAllocator &allocator);
+
+	// Empty the least occupied blocks of every pool whose allocations all belong to mover into fuller blocks, moving
+	// at most maxBytesToMove. The allocations are rewritten to their destination, the owner has to copy the contents
+	// and rebind the resources before it uses them again.
+	std::vector<DefragmentationMove> defragment(DeviceMemoryAllocator &allocator, const void *mover, VkDeviceSize maxBytesToMove = VK_WHOLE_SIZE);
+
+	// Per memory heap statistics, indexed by heap index
+	std::vector<HeapStats> memoryHeapStats(DeviceMemoryAllocator &allocator);
+
+// Buffer bound to sub-allocated memory
+struct AllocatedBuffer
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation *allocation = nullptr;
+	VkDeviceSize size = 0;
+	VkBufferUsageFlags usageFlags = 0;
+	VkMemoryPropertyFlags memoryPropertyFlags = 0;
+	// Valid for host-visible memory
+	void *mapped = nullptr;
+	VkDescriptorBufferInfo descriptor{};
+};
+
+	VkResult createBuffer(DeviceMemoryAllocator &allocator, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, AllocatedBuffer &buffer, const void *data = nullptr);
+	void destroyBuffer(DeviceMemoryAllocator &allocator, AllocatedBuffer &buffer);
+
+	// Buffer that defragment may move on behalf of mover, also usable as copy source and destination
+	VkResult createMovableBuffer(DeviceMemoryAllocator &allocator, const void *mover, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, AllocatedBuffer &buffer);
+	// Bind a new buffer at the destination of a moved allocation. Returns the old buffer, still bound to the source
+	// span: the owner copies the contents over and destroys it once the copy has completed
+	VkBuffer rebindMovedBuffer(DeviceMemoryAllocator &allocator, AllocatedBuffer &buffer);
+
+	// Staging buffer in the transient arena, only valid until the next resetTransient
+	VkResult createStagingBuffer(DeviceMemoryAllocator &allocator, VkDeviceSize size, AllocatedBuffer &buffer, const void *data = nullptr);
+	void destroyStagingBuffer(DeviceMemoryAllocator &allocator, AllocatedBuffer &buffer);
+
+	VkResult createImage(DeviceMemoryAllocator &allocator, const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, Allocation *&allocation);
+	void destroyImage(DeviceMemoryAllocator &allocator, VkImage &image, Allocation *&allocation);
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "Node_Analytics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	void createNodeAnalytics(NodeAnalytics &analytics, const graph::CSRGraph &csr, InstancePipeline &nodes,
+							 const std::vector<NodeInstanceData> &nodeInstanceData)
+	{
+		analytics.csr = &csr;
+		createNodeScaleStream(analytics.scales, nodes, nodeInstanceData);
+		analytics.layoutScales.resize(nodeInstanceData.size());
+		for (size_t node = 0; node < nodeInstanceData.size(); node++)
+		{
+			analytics.layoutScales[node] = nodeInstanceScale(nodeInstanceData[node]);
+		}
+	}
+
+	void destroyNodeAnalytics(NodeAnalytics &analytics)
+	{
+		analytics.progress.cancel = true;
+		if (analytics.job.valid())
+		{
+			analytics.job.wait();
+		}
+		destroyNodeScaleStream(analytics.scales);
+	}
+
+	bool updateNodeAnalytics(NodeAnalytics &analytics, EpidemicColoring &epidemic, UISettings &uiSettings, bool colorAllowed, UploadRing &uploadRing,
+							 UploadBatch &uploadBatch)
+	{
+		auto &settings = uiSettings.analytics;
+		if (settings.run != graph::analytics::ANALYTICS_JOB_NONE && !analytics.job.valid())
+		{
+			analytics.progress.fraction = 0.f;
+			analytics.progress.cancel = false;
+			analytics.job = std::async(std::launch::async, graph::analytics::run_analytics_job, std::cref(*analytics.csr), settings.run, settings.damping,
+									   static_cast<uint32_t>(std::max(settings.samples, 1)), &analytics.progress);
+			settings.running = settings.run;
+		}
+		settings.run = graph::analytics::ANALYTICS_JOB_NONE;
+		if (settings.cancel)
+		{
+			analytics.progress.cancel = true;
+		}
+		settings.cancel = false;
+		if (analytics.job.valid() && analytics.job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			graph::analytics::AnalyticsJobResult result = analytics.job.get();
+			settings.summary = result.summary;
+			if (result.job == graph::analytics::ANALYTICS_JOB_DEGREE && !result.column.empty())
+			{
+				const graph::analytics::DegreeHistogram &histogram = result.histogram;
+				settings.degreesPerBin = histogram.maxDegree / DEGREE_HISTOGRAM_BARS + 1;
+				settings.degreeHistogram.assign(histogram.maxDegree / settings.degreesPerBin + 1, 0.f);
+				std::vector<uint64_t> bars(settings.degreeHistogram.size(), 0);
+				for (size_t degree = 0; degree < histogram.counts.size(); degree++)
+				{
+					bars[degree / settings.degreesPerBin] += histogram.counts[degree];
+				}
+				for (size_t bar = 0; bar < bars.size(); bar++)
+				{
+					settings.degreeHistogram[bar] = static_cast<float>(std::log10(1. + bars[bar]));
+				}
+				settings.maxDegree = histogram.maxDegree;
+				settings.meanDegree = histogram.meanDegree;
+			}
+			if (!result.column.empty())
+			{
+				size_t column = graph::analytics::set_column(analytics.table, result.column, std::move(result.values));
+				settings.columns.resize(analytics.table.columns.size());
+				settings.columns[column] = result.column;
+				// A shown column is mapped again
+				if (static_cast<int>(column) == analytics.shownColorColumn)
+				{
+					analytics.colorShown = false;
+				}
+				if (static_cast<int>(column) == analytics.shownScaleColumn)
+				{
+					analytics.shownScaleColumn = -1;
+				}
+			}
+		}
+		settings.running = analytics.job.valid() ? settings.running : graph::analytics::ANALYTICS_JOB_NONE;
+		settings.progress = analytics.progress.fraction;
+
+		int scaleColumn = settings.scaleColumn < static_cast<int>(analytics.table.columns.size()) ? settings.scaleColumn : -1;
+		if (scaleColumn != analytics.shownScaleColumn ||
+			(scaleColumn >= 0 && (settings.logarithmic != analytics.shownScaleLogarithmic || settings.scaleMin != analytics.shownScaleMin ||
+								  settings.scaleMax != analytics.shownScaleMax)))
+		{
+			NV_TRACE_ZONE("Analytics scales");
+			std::vector<float> scales = scaleColumn < 0 ? analytics.layoutScales
+														: graph::analytics::column_scales(analytics.table.columns[scaleColumn], analytics.layoutScales,
+																						  settings.scaleMin, settings.scaleMax, settings.logarithmic);
+			setNodeScales(analytics.scales, scales.data());
+			analytics.shownScaleColumn = scaleColumn;
+			analytics.shownScaleLogarithmic = settings.logarithmic;
+			analytics.shownScaleMin = settings.scaleMin;
+			analytics.shownScaleMax = settings.scaleMax;
+		}
+		stageNodeScales(analytics.scales, uploadRing, uploadBatch);
+
+		int colorColumn = settings.colorColumn < static_cast<int>(analytics.table.columns.size()) ? settings.colorColumn : -1;
+		if (!colorAllowed || colorColumn < 0)
+		{
+			analytics.colorShown = false;
+			return false;
+		}
+
+		NV_TRACE_ZONE("Analytics colors");
+		glm::vec4 palette[NODE_PALETTE_SIZE];
+		for (uint32_t bin = 0; bin < NODE_PALETTE_SIZE; bin++)
+		{
+			palette[bin] = graph::analytics::ramp_color(bin, NODE_PALETTE_SIZE);
+		}
+		setNodePalette(epidemic.stateBuffer, palette, NODE_PALETTE_SIZE);
+		if (!analytics.colorShown || colorColumn != analytics.shownColorColumn || settings.logarithmic != analytics.shownColorLogarithmic)
+		{
+			std::vector<uint8_t> bins = graph::analytics::column_bins(analytics.table.columns[colorColumn], NODE_PALETTE_SIZE, settings.logarithmic);
+			setAllNodeStates(epidemic.stateBuffer, bins.data());
+			analytics.colorShown = true;
+			analytics.shownColorColumn = colorColumn;
+			analytics.shownColorLogarithmic = settings.logarithmic;
+		}
+		epidemic.nodes->stateLookup.enabled = 1;
+		// The epidemic shows its states again once the column is hidden, the compute shader one starts over
+		epidemic.stale = epidemic.shown;
+		epidemic.gpuShown = false;
+		epidemic.replaying = false;
+		uiSettings.epidemic.stepOnce = false;
+		stageNodeStates(epidemic.stateBuffer, uploadRing, uploadBatch);
+		return true;
+	}
+}
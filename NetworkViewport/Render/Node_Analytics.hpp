@@ -0,0 +1,61 @@
+#ifndef NODE_ANALYTICS_HPP
+#define NODE_ANALYTICS_HPP
+#include <cstdint>
+#include <future>
+#include <vector>
+#include <VulkanTools/InstanceGraphics/VulkanNodeInstance.hpp>
+#include <NetworkViewport/Graph/Graph_Analytics.hpp>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include "Epidemic_Coloring.hpp"
+#include "Instance_Pipeline.hpp"
+#include "Node_Scales.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Node statistics in the viewer
+// ----------------------------------------------------------------------------
+// Runs the jobs of graph::analytics requested in the UI on a worker thread
+// while the frames go on and keeps their columns. One column colors the nodes
+// through the state buffer of the epidemic coloring and a palette ramp,
+// another one scales them through a streamed scale per node.
+
+namespace render
+{
+// Bars of the degree histogram plot, neighboring degrees share a bar above this many
+constexpr uint32_t DEGREE_HISTOGRAM_BARS = 128;
+
+struct NodeAnalytics
+{
+	// Must outlive a running job
+	const graph::CSRGraph *csr = nullptr;
+	std::future<graph::analytics::AnalyticsJobResult> job;
+	// Read by the running job, so it stays at this address
+	graph::analytics::Progress progress;
+	graph::analytics::AttributeTable table;
+	// Streamed scales of the node instances, and the layout scales they are factors of
+	NodeScaleStream scales;
+	std::vector<float> layoutScales;
+	// The state buffer holds the bins of colorColumn
+	bool colorShown = false;
+	int shownColorColumn = -1;
+	bool shownColorLogarithmic = false;
+	// Mapping the instance scales were last set with, scaleColumn -1 for the layout scales
+	int shownScaleColumn = -1;
+	bool shownScaleLogarithmic = false;
+	float shownScaleMin = 0.f;
+	float shownScaleMax = 0.f;
+};
+
+	void createNodeAnalytics(NodeAnalytics &analytics, const graph::CSRGraph &csr, InstancePipeline &nodes,
+							 const std::vector<NodeInstanceData> &nodeInstanceData);
+	// Cancels a running job and waits for it
+	void destroyNodeAnalytics(NodeAnalytics &analytics);
+
+	// Start a requested job, take over a finished one, and map the chosen columns to node colors and scales. Colors only
+	// while colorAllowed, e.g. not while the communities are shown. True while the colors are shown, the epidemic is not
+	// updated meanwhile
+	bool updateNodeAnalytics(NodeAnalytics &analytics, EpidemicColoring &epidemic, UISettings &uiSettings, bool colorAllowed, UploadRing &uploadRing,
+							 UploadBatch &uploadBatch);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "Node_Filter.hpp"
+#include <algorithm>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	// Bits of the core number in a key, the component takes the rest
+	constexpr uint32_t NODE_FILTER_CORE_BITS = 16;
+
+	void createNodeFilterBuffer(NodeFilterBuffer &buffer, DeviceMemoryAllocator *allocator, TransferService &transferService, uint32_t nodeCount,
+								const std::vector<std::pair<uint32_t, uint32_t>> &edges)
+	{
+		buffer.nodeCount = nodeCount;
+		// Empty buffers are not allowed, an empty graph still gets one element
+		buffer.keys.assign(std::max<size_t>(nodeCount, 1), 0);
+		createStreamedBuffer(buffer.keyStream, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(uint32_t), buffer.keys.size());
+		buffer.keyStream.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		buffer.keyStream.dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+		markDirty(buffer.keyStream.dirty, 0, buffer.keyStream.elementCount);
+
+		// The pairs are uploaded as they are, two node indices each
+		static_assert(sizeof(std::pair<uint32_t, uint32_t>) == 2 * sizeof(uint32_t), "Edge pairs are not packed");
+		VkDeviceSize edgeEndSize = std::max<VkDeviceSize>(edges.size(), 1) * 2 * sizeof(uint32_t);
+		VK_CHECK_RESULT(createBuffer(
+			*allocator,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			edgeEndSize,
+			buffer.edgeEndBuffer));
+		if (!edges.empty())
+		{
+			enqueueBufferUpload(transferService, buffer.edgeEndBuffer.buffer, 0, edges.data(), edges.size() * 2 * sizeof(uint32_t),
+								VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+		}
+	}
+
+	void destroyNodeFilterBuffer(NodeFilterBuffer &buffer)
+	{
+		destroyBuffer(*buffer.keyStream.allocator, buffer.edgeEndBuffer);
+		destroyStreamedBuffer(buffer.keyStream);
+		buffer.keys.clear();
+		buffer.keys.shrink_to_fit();
+		buffer.nodeCount = 0;
+	}
+
+	void setNodeFilterKeys(NodeFilterBuffer &buffer, const uint32_t *cores, const uint32_t *components)
+	{
+		NV_TRACE_ZONE("Node filter keys");
+		const uint32_t coreMask = (1u << NODE_FILTER_CORE_BITS) - 1;
+		for (uint32_t node = 0; node < buffer.nodeCount; node++)
+		{
+			uint32_t core = cores ? std::min(cores[node], NODE_FILTER_KEY_MAX) : buffer.keys[node] & coreMask;
+			uint32_t component = components ? std::min(components[node], NODE_FILTER_KEY_MAX) : buffer.keys[node] >> NODE_FILTER_CORE_BITS;
+			buffer.keys[node] = core | component << NODE_FILTER_CORE_BITS;
+		}
+		buffer.keyStream.dirty.ranges.clear();
+		markDirty(buffer.keyStream.dirty, 0, buffer.keyStream.elementCount);
+	}
+
+	void stageNodeFilter(NodeFilterBuffer &buffer, UploadRing &ring, UploadBatch &batch)
+	{
+		stageStreamedBuffer(ring, buffer.keyStream, buffer.keys.data(), batch);
+	}
+}
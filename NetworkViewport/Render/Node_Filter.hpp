@@ -0,0 +1,64 @@
+#ifndef NODE_FILTER_HPP
+#define NODE_FILTER_HPP
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Transfer_Service.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Node and edge visibility filters
+// ----------------------------------------------------------------------------
+// The core number and the component of every node are packed into one word of
+// a storage buffer, beside the two end nodes of every edge instance. node.vert
+// and edge.vert with NODE_FILTER compare them against thresholds pushed with
+// every draw and move hidden nodes, and edges with a hidden end, out of the
+// view volume. The visibility mask is thus evaluated on the GPU: changing k or
+// the component changes a push constant, the keys are only uploaded once per
+// decomposition and the instance buffers are never touched. The edge ends never
+// change and go up once with the transfer batch of the pipelines.
+
+namespace render
+{
+// Keys are 16 bits, larger core numbers and components share the last value
+constexpr uint32_t NODE_FILTER_KEY_MAX = 0xFFFF;
+// Component of NodeFilter showing every component
+constexpr uint32_t NODE_FILTER_ALL_COMPONENTS = 0xFFFFFFFF;
+
+// Pushed after the bounds, and after the NodeStateLookup of node pipelines reading states, matches NODE_FILTER of
+// node.vert and edge.vert
+struct NodeFilter
+{
+	// Nonzero hides the nodes failing the filter
+	uint32_t enabled = 0;
+	// Nodes of a lower core number are hidden
+	uint32_t minCore = 0;
+	// Nodes of other components are hidden
+	uint32_t component = NODE_FILTER_ALL_COMPONENTS;
+	uint32_t padding = 0;
+};
+
+struct NodeFilterBuffer
+{
+	uint32_t nodeCount = 0;
+	// Core number in the low and component in the high 16 bits, per node
+	std::vector<uint32_t> keys;
+	StreamedBuffer keyStream;
+	// Two node indices per edge instance, uploaded once, without a host copy
+	AllocatedBuffer edgeEndBuffer;
+};
+
+	// edges in the order of the edge instances, e.g. graph::get_edge_list. The edge ends are usable once the
+	// current transfer batch has completed
+	void createNodeFilterBuffer(NodeFilterBuffer &buffer, DeviceMemoryAllocator *allocator, TransferService &transferService, uint32_t nodeCount,
+								const std::vector<std::pair<uint32_t, uint32_t>> &edges);
+	void destroyNodeFilterBuffer(NodeFilterBuffer &buffer);
+
+	// Replace the core numbers or the components of all nodes, a null array keeps them
+	void setNodeFilterKeys(NodeFilterBuffer &buffer, const uint32_t *cores, const uint32_t *components);
+
+	// Stage the changed keys into this frame's upload batch, what does not fit follows next frame
+	void stageNodeFilter(NodeFilterBuffer &buffer, UploadRing &ring, UploadBatch &batch);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include "Node_Filtering.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace render
+{
+	void updateNodeFiltering(NodeFiltering &filtering, std::vector<std::unique_ptr<InstancePipeline>> &instancePipelines, UISettings &uiSettings,
+							 UploadRing &uploadRing, UploadBatch &uploadBatch)
+	{
+		auto &settings = uiSettings.filter;
+		if (settings.decompose && !filtering.decomposition.valid())
+		{
+			filtering.decomposition = std::async(std::launch::async, graph::decomposition::decompose_graph, std::cref(*filtering.csr), 0u);
+		}
+		settings.decompose = false;
+		if (filtering.decomposition.valid() && filtering.decomposition.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			graph::decomposition::GraphDecomposition decomposition = filtering.decomposition.get();
+			setNodeFilterKeys(filtering.buffer, decomposition.cores.core.data(), decomposition.components.component.data());
+			settings.maxCore = std::min(decomposition.cores.maxCore, NODE_FILTER_KEY_MAX);
+			settings.coreSizes = std::move(decomposition.cores.coreSizes);
+			settings.coreSizes.resize(settings.maxCore + 1);
+			// Larger component numbers share one key, only the ones before can be told apart
+			settings.componentSizes = std::move(decomposition.components.sizes);
+			settings.componentSizes.resize(std::min<size_t>(settings.componentSizes.size(), NODE_FILTER_KEY_MAX));
+			settings.componentCount = decomposition.components.N_components;
+			settings.seconds = decomposition.cores.seconds + decomposition.components.seconds;
+			settings.decomposed = true;
+		}
+		settings.running = filtering.decomposition.valid();
+		stageNodeFilter(filtering.buffer, uploadRing, uploadBatch);
+
+		NodeFilter filter;
+		filter.enabled = settings.enabled && settings.decomposed ? 1 : 0;
+		filter.minCore = static_cast<uint32_t>(std::max(settings.minCore, 0));
+		filter.component = settings.component < 0 ? NODE_FILTER_ALL_COMPONENTS : static_cast<uint32_t>(settings.component);
+		for (auto &instancePipeline : instancePipelines)
+		{
+			instancePipeline->filter = filter;
+		}
+	}
+}
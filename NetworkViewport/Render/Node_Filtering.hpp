@@ -0,0 +1,37 @@
+#ifndef NODE_FILTERING_HPP
+#define NODE_FILTERING_HPP
+#include <future>
+#include <memory>
+#include <vector>
+#include <NetworkViewport/Graph/Graph_Decomposition.hpp>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include "Instance_Pipeline.hpp"
+#include "Node_Filter.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// k-core and component filtering in the viewer
+// ----------------------------------------------------------------------------
+// Decomposes the graph on a worker thread when the UI asks for it, uploads
+// the keys of the node filter buffer once it has finished and pushes the k
+// and the component chosen in the UI with the draws of every instance
+// pipeline.
+
+namespace render
+{
+struct NodeFiltering
+{
+	// Must outlive a running decomposition
+	const graph::CSRGraph *csr = nullptr;
+	// Read by the _filter shader variants of the node and edge pipelines
+	NodeFilterBuffer buffer;
+	std::future<graph::decomposition::GraphDecomposition> decomposition;
+};
+
+	// Start a requested decomposition, upload the keys of a finished one and push the current k and component with the next
+	// draws of the node and edge pipelines
+	void updateNodeFiltering(NodeFiltering &filtering, std::vector<std::unique_ptr<InstancePipeline>> &instancePipelines, UISettings &uiSettings,
+							 UploadRing &uploadRing, UploadBatch &uploadBatch);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include "Node_Highlight.hpp"
+#include <algorithm>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	void createNodeHighlightBuffer(NodeHighlightBuffer &buffer, DeviceMemoryAllocator *allocator, uint32_t nodeCount)
+	{
+		buffer.nodeCount = nodeCount;
+		// Empty buffers are not allowed, an empty graph still gets one word
+		buffer.words.assign(std::max<size_t>((static_cast<size_t>(nodeCount) + NODE_HIGHLIGHTS_PER_WORD - 1) / NODE_HIGHLIGHTS_PER_WORD, 1), 0);
+		createStreamedBuffer(buffer.flagStream, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(uint32_t), buffer.words.size());
+		buffer.flagStream.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		buffer.flagStream.dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+		markDirty(buffer.flagStream.dirty, 0, buffer.flagStream.elementCount);
+	}
+
+	void destroyNodeHighlightBuffer(NodeHighlightBuffer &buffer)
+	{
+		destroyStreamedBuffer(buffer.flagStream);
+		buffer.words.clear();
+		buffer.words.shrink_to_fit();
+		buffer.flagged.clear();
+		buffer.flagged.shrink_to_fit();
+		buffer.nodeCount = 0;
+	}
+
+	// Mark the words of nodes dirty in ascending order, so the tracker merges neighboring words
+	static void markNodeWords(NodeHighlightBuffer &buffer, const std::vector<uint32_t> &nodes)
+	{
+		std::vector<uint32_t> wordIndices;
+		wordIndices.reserve(nodes.size());
+		for (uint32_t node : nodes)
+		{
+			if (node < buffer.nodeCount)
+			{
+				wordIndices.push_back(node / NODE_HIGHLIGHTS_PER_WORD);
+			}
+		}
+		std::sort(wordIndices.begin(), wordIndices.end());
+		wordIndices.erase(std::unique(wordIndices.begin(), wordIndices.end()), wordIndices.end());
+		for (uint32_t word : wordIndices)
+		{
+			markDirty(buffer.flagStream.dirty, word, word + 1);
+		}
+	}
+
+	void clearNodeHighlights(NodeHighlightBuffer &buffer)
+	{
+		for (uint32_t node : buffer.flagged)
+		{
+			buffer.words[node / NODE_HIGHLIGHTS_PER_WORD] = 0;
+		}
+		markNodeWords(buffer, buffer.flagged);
+		buffer.flagged.clear();
+	}
+
+	void setNodeHighlights(NodeHighlightBuffer &buffer, const std::vector<uint32_t> &nodes, uint32_t flag)
+	{
+		NV_TRACE_ZONE("Node highlights");
+		for (uint32_t node : nodes)
+		{
+			if (node < buffer.nodeCount)
+			{
+				buffer.words[node / NODE_HIGHLIGHTS_PER_WORD] |= flag << (node % NODE_HIGHLIGHTS_PER_WORD * NODE_HIGHLIGHT_BITS);
+				buffer.flagged.push_back(node);
+			}
+		}
+		markNodeWords(buffer, nodes);
+	}
+
+	void stageNodeHighlights(NodeHighlightBuffer &buffer, UploadRing &ring, UploadBatch &batch)
+	{
+		stageStreamedBuffer(ring, buffer.flagStream, buffer.words.data(), batch);
+	}
+
+	uint32_t pickNode(const std::vector<NodeInstanceData> &nodeInstanceData, const glm::mat4 &viewProjection, glm::vec2 cursor,
+					  uint32_t width, uint32_t height, float radius)
+	{
+		NV_TRACE_ZONE("Pick node");
+		uint32_t picked = NODE_PICK_NONE;
+		float pickedDistance = radius * radius;
+		float pickedDepth = 0.f;
+		glm::vec2 viewport(static_cast<float>(width), static_cast<float>(height));
+		for (size_t node = 0; node < nodeInstanceData.size(); node++)
+		{
+			glm::vec4 clip = viewProjection * glm::vec4(nodeInstanceData[node].pos, 1.f);
+			// Behind the camera
+			if (clip.w <= 0.f)
+			{
+				continue;
+			}
+			// Vulkan's clip space has y pointing down, as the cursor does
+			glm::vec2 pixel = (glm::vec2(clip) / clip.w * .5f + .5f) * viewport;
+			glm::vec2 offset = pixel - cursor;
+			float distance = glm::dot(offset, offset);
+			float depth = clip.z / clip.w;
+			if (distance < pickedDistance || (distance == pickedDistance && picked != NODE_PICK_NONE && depth < pickedDepth))
+			{
+				picked = static_cast<uint32_t>(node);
+				pickedDistance = distance;
+				pickedDepth = depth;
+			}
+		}
+		return picked;
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef NODE_HIGHLIGHT_HPP
+#define NODE_HIGHLIGHT_HPP
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Packed_Instances.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Node and edge highlights
+// ----------------------------------------------------------------------------
+// Two flag bits per node, sixteen nodes to a word of a storage buffer, mark
+// the result of a graph query (a shortest path or a neighborhood) and the
+// nodes it was started from. node.vert with NODE_HIGHLIGHT recolors and
+// enlarges flagged nodes, edge.vert recolors the edges with both ends flagged
+// through the edge ends of Node_Filter.hpp, which are on the GPU once the
+// startup transfer batch has completed, and both may dim everything else.
+// A new query only rewrites the words of the nodes it flags or unflags, the
+// instance buffers are never touched. Nodes are picked on the CPU from the
+// same instance data the node pipeline was built from.
+
+namespace render
+{
+// Flag bits of a node
+constexpr uint32_t NODE_HIGHLIGHT_MARKED = 1;
+constexpr uint32_t NODE_HIGHLIGHT_SELECTED = 2;
+constexpr uint32_t NODE_HIGHLIGHT_BITS = 2;
+constexpr uint32_t NODE_HIGHLIGHTS_PER_WORD = 32 / NODE_HIGHLIGHT_BITS;
+// Result of pickNode when no node is near the cursor
+constexpr uint32_t NODE_PICK_NONE = UINT32_MAX;
+
+// Pushed after the NodeFilter, matches NODE_HIGHLIGHT of node.vert and edge.vert
+struct NodeHighlight
+{
+	glm::vec4 markedColor = {1.f, .8f, .1f, 1.f};
+	glm::vec4 selectedColor = {1.f, .2f, .2f, 1.f};
+	// Nonzero applies the flags
+	uint32_t enabled = 0;
+	// Color factor of the nodes and edges not flagged, 1 keeps them
+	float dimFactor = 1.f;
+	// Size factor of the flagged nodes
+	float markedScale = 1.5f;
+	float padding = 0.f;
+};
+
+struct NodeHighlightBuffer
+{
+	uint32_t nodeCount = 0;
+	std::vector<uint32_t> words;
+	StreamedBuffer flagStream;
+	// Nodes with a flag set, so clearing touches only their words
+	std::vector<uint32_t> flagged;
+};
+
+	void createNodeHighlightBuffer(NodeHighlightBuffer &buffer, DeviceMemoryAllocator *allocator, uint32_t nodeCount);
+	void destroyNodeHighlightBuffer(NodeHighlightBuffer &buffer);
+
+	// Clear the flags of all nodes
+	void clearNodeHighlights(NodeHighlightBuffer &buffer);
+	// Add a flag to nodes, out of range nodes are skipped
+	void setNodeHighlights(NodeHighlightBuffer &buffer, const std::vector<uint32_t> &nodes, uint32_t flag);
+
+	// Stage the changed words into this frame's upload batch, what does not fit follows next frame
+	void stageNodeHighlights(NodeHighlightBuffer &buffer, UploadRing &ring, UploadBatch &batch);
+
+	// Node whose center projects closest to the cursor, in pixels from the top left of a width x height viewport, if
+	// within radius pixels, the nearer one to the camera on ties
+	uint32_t pickNode(const std::vector<NodeInstanceData> &nodeInstanceData, const glm::mat4 &viewProjection, glm::vec2 cursor,
+					  uint32_t width, uint32_t height, float radius);
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "Node_Query.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace render
+{
+	void destroyNodeQuery(NodeQuery &query)
+	{
+		if (query.job.valid())
+		{
+			query.job.wait();
+		}
+		destroyNodeHighlightBuffer(query.buffer);
+	}
+
+	void updateNodeQuery(NodeQuery &query, std::vector<std::unique_ptr<InstancePipeline>> &instancePipelines, UISettings &uiSettings,
+						 uint32_t pickedNode, UploadRing &uploadRing, UploadBatch &uploadBatch)
+	{
+		auto &settings = uiSettings.query;
+		// A path needs two nodes, a third click starts a new one
+		size_t needed = settings.mode == graph::search::NODE_QUERY_PATH ? 2 : 1;
+		if (pickedNode != NODE_PICK_NONE)
+		{
+			if (settings.selected.size() >= needed)
+			{
+				settings.selected.clear();
+			}
+			settings.selected.push_back(pickedNode);
+			query.pending = true;
+		}
+		if (settings.selected.size() > needed)
+		{
+			settings.selected.erase(settings.selected.begin(), settings.selected.end() - needed);
+		}
+		if (settings.clear)
+		{
+			settings.selected.clear();
+			settings.summary.clear();
+		}
+		query.pending = query.pending || settings.clear || settings.rerun;
+		settings.clear = false;
+		settings.rerun = false;
+
+		if (query.job.valid() && query.job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			graph::search::NodeQueryResult result = query.job.get();
+			// A result of an older selection is dropped, the pending query replaces it
+			if (!query.pending)
+			{
+				setNodeHighlights(query.buffer, result.nodes, NODE_HIGHLIGHT_MARKED);
+				settings.summary = result.summary;
+			}
+		}
+		if (query.pending && !query.job.valid())
+		{
+			clearNodeHighlights(query.buffer);
+			setNodeHighlights(query.buffer, settings.selected, NODE_HIGHLIGHT_SELECTED);
+			if (settings.selected.size() == needed)
+			{
+				query.job = std::async(std::launch::async, graph::search::run_node_query, std::cref(*query.csr), &query.workspace, settings.mode, settings.selected,
+									   static_cast<uint32_t>(std::max(settings.hops, 1)));
+			}
+			else if (!settings.selected.empty())
+			{
+				settings.summary = "Ctrl+click the target node";
+			}
+			query.pending = false;
+		}
+		settings.running = query.job.valid();
+		stageNodeHighlights(query.buffer, uploadRing, uploadBatch);
+
+		NodeHighlight highlight;
+		highlight.enabled = settings.selected.empty() ? 0 : 1;
+		highlight.dimFactor = settings.dimOthers ? NODE_QUERY_DIM_FACTOR : 1.f;
+		highlight.markedScale = settings.highlightScale;
+		for (auto &instancePipeline : instancePipelines)
+		{
+			instancePipeline->highlight = highlight;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef NODE_QUERY_HPP
+#define NODE_QUERY_HPP
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+#include <NetworkViewport/Graph/Graph_Search.hpp>
+#include <NetworkViewport/Menu/UISettings.hpp>
+#include "Instance_Pipeline.hpp"
+#include "Node_Highlight.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Node queries in the viewer
+// ----------------------------------------------------------------------------
+// Ctrl+clicked nodes form the selection of a shortest path or neighborhood
+// query, which is searched on a worker thread while the frames go on. The
+// selection and the found nodes are flagged in the highlight buffer read by
+// the _highlight shader variants of the node and edge pipelines.
+
+namespace render
+{
+// Pixels around a node center that still pick it
+constexpr float NODE_PICK_RADIUS = 12.f;
+// Color factor of the nodes and edges outside a highlighted result
+constexpr float NODE_QUERY_DIM_FACTOR = .25f;
+
+struct NodeQuery
+{
+	// Must outlive a running query
+	const graph::CSRGraph *csr = nullptr;
+	// Read by the _highlight shader variants of the node and edge pipelines
+	NodeHighlightBuffer buffer;
+	// Used by the running query, so it stays at this address
+	graph::search::SearchWorkspace workspace;
+	std::future<graph::search::NodeQueryResult> job;
+	// The selection changed, the highlights are redone once no query runs
+	bool pending = false;
+};
+
+	// Waits for a running query
+	void destroyNodeQuery(NodeQuery &query);
+
+	// Add a picked node to the selection, start the query of a changed selection once the last one has finished, highlight
+	// a finished one and push the highlight settings with the next draws of the node and edge pipelines. pickedNode is
+	// NODE_PICK_NONE without a click
+	void updateNodeQuery(NodeQuery &query, std::vector<std::unique_ptr<InstancePipeline>> &instancePipelines, UISettings &uiSettings,
+						 uint32_t pickedNode, UploadRing &uploadRing, UploadBatch &uploadBatch);
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "Node_Scales.hpp"
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	void createNodeScaleStream(NodeScaleStream &scales, InstancePipeline &nodes, const std::vector<NodeInstanceData> &nodeInstanceData)
+	{
+		scales.nodes = &nodes;
+		scales.nodeInstanceData = &nodeInstanceData;
+		scales.scales.resize(nodeInstanceData.size());
+		for (size_t node = 0; node < nodeInstanceData.size(); node++)
+		{
+			scales.scales[node] = nodeInstanceScale(nodeInstanceData[node]);
+		}
+		scales.stream.allocator = nodes.allocator;
+		scales.stream.deviceBuffer = nodes.instanceBuffer;
+		scales.stream.elementSize = sizeof(GpuNodeInstance);
+		scales.stream.elementCount = nodes.instanceCount;
+		scales.stream.dirty.ranges.clear();
+	}
+
+	void destroyNodeScaleStream(NodeScaleStream &scales)
+	{
+		// The device buffer belongs to the pipeline
+		scales.stream = StreamedBuffer();
+		scales.scales.clear();
+		scales.scales.shrink_to_fit();
+		scales.nodeInstanceData = nullptr;
+		scales.nodes = nullptr;
+	}
+
+	void setNodeScales(NodeScaleStream &scales, const float *nodeScales)
+	{
+		NV_TRACE_ZONE("Node scales");
+		// Ascending nodes, so neighboring changes extend the last dirty range
+		for (size_t node = 0; node < scales.scales.size(); node++)
+		{
+			if (scales.scales[node] != nodeScales[node])
+			{
+				scales.scales[node] = nodeScales[node];
+				markDirty(scales.stream.dirty, node, node + 1);
+			}
+		}
+	}
+
+	void stageNodeScales(NodeScaleStream &scales, UploadRing &ring, UploadBatch &batch)
+	{
+		const std::vector<NodeInstanceData> &nodeInstanceData = *scales.nodeInstanceData;
+		const InstanceBounds &bounds = scales.nodes->bounds;
+		const float *nodeScales = scales.scales.data();
+		stageStreamedBuffer(ring, scales.stream, [&](void *dst, size_t first, size_t count)
+							{
+								GpuNodeInstance *instances = static_cast<GpuNodeInstance *>(dst);
+								for (size_t i = 0; i < count; i++)
+								{
+									// Built on the stack, the ring is written once per instance
+									GpuNodeInstance instance = toGpuNodeInstance(nodeInstanceData[first + i], bounds);
+									setGpuNodeInstanceScale(instance, nodeScales[first + i]);
+									instances[i] = instance;
+								} },
+							batch);
+	}
+}
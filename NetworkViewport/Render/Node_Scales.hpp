@@ -0,0 +1,40 @@
+#ifndef NODE_SCALES_HPP
+#define NODE_SCALES_HPP
+#include <cstdint>
+#include <vector>
+#include "Instance_Pipeline.hpp"
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Streamed node scales
+// ----------------------------------------------------------------------------
+// Resizes nodes of an instance pipeline while it is drawn. Only one scale per
+// node is kept on the host, the instances of changed nodes are rebuilt from the
+// caller's instance data while they are written into the upload ring and
+// copied into the pipeline's instance buffer. Unchanged nodes are not uploaded.
+
+namespace render
+{
+struct NodeScaleStream
+{
+	InstancePipeline *nodes = nullptr;
+	// The data the pipeline was prepared with, owned by the caller
+	const std::vector<NodeInstanceData> *nodeInstanceData = nullptr;
+	// Views the pipeline's instance buffer, which stays owned by the pipeline
+	StreamedBuffer stream;
+	// Scale of each node as last set
+	std::vector<float> scales;
+};
+
+	// nodeInstanceData has to be the data the pipeline was prepared with and outlive the stream
+	void createNodeScaleStream(NodeScaleStream &scales, InstancePipeline &nodes, const std::vector<NodeInstanceData> &nodeInstanceData);
+	void destroyNodeScaleStream(NodeScaleStream &scales);
+
+	// Set the scales of all nodes, scales[node] for each, only the nodes whose scale changed are uploaded
+	void setNodeScales(NodeScaleStream &scales, const float *nodeScales);
+
+	// Stage the changed instances into this frame's upload batch, what does not fit follows next frame
+	void stageNodeScales(NodeScaleStream &scales, UploadRing &ring, UploadBatch &batch);
+}
+
+#endif
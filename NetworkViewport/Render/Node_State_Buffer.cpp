@@ -0,0 +1,78 @@
+#include "Node_State_Buffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	// States per storage buffer word
+	constexpr uint32_t NODE_STATES_PER_WORD = 4;
+
+	void createNodeStateBuffer(NodeStateBuffer &buffer, DeviceMemoryAllocator *allocator, uint32_t nodeCount)
+	{
+		buffer.nodeCount = nodeCount;
+		// Empty buffers are not allowed, an empty graph still gets one word
+		size_t wordCount = std::max<size_t>((nodeCount + NODE_STATES_PER_WORD - 1) / NODE_STATES_PER_WORD, 1);
+		buffer.states.assign(wordCount * NODE_STATES_PER_WORD, 0);
+		createStreamedBuffer(buffer.stateStream, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, NODE_STATES_PER_WORD, wordCount);
+		buffer.stateStream.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		buffer.stateStream.dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+		std::fill(std::begin(buffer.palette.colors), std::end(buffer.palette.colors), glm::vec4(1.f));
+		createStreamedBuffer(buffer.paletteStream, allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(NodePalette), 1);
+		buffer.paletteStream.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+		buffer.paletteStream.dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	}
+
+	void destroyNodeStateBuffer(NodeStateBuffer &buffer)
+	{
+		destroyStreamedBuffer(buffer.stateStream);
+		destroyStreamedBuffer(buffer.paletteStream);
+		buffer.states.clear();
+		buffer.states.shrink_to_fit();
+		buffer.nodeCount = 0;
+	}
+
+	void setNodeStates(NodeStateBuffer &buffer, const std::vector<uint32_t> &nodes, const uint8_t *states)
+	{
+		NV_TRACE_ZONE("Node states");
+		for (uint32_t node : nodes)
+		{
+			if (buffer.states[node] != states[node])
+			{
+				buffer.states[node] = states[node];
+				markDirty(buffer.stateStream.dirty, node / NODE_STATES_PER_WORD, node / NODE_STATES_PER_WORD + 1);
+			}
+		}
+	}
+
+	void setAllNodeStates(NodeStateBuffer &buffer, const uint8_t *states)
+	{
+		NV_TRACE_ZONE("Node states");
+		memcpy(buffer.states.data(), states, buffer.nodeCount);
+		buffer.stateStream.dirty.ranges.clear();
+		markDirty(buffer.stateStream.dirty, 0, buffer.stateStream.elementCount);
+	}
+
+	void setNodePalette(NodeStateBuffer &buffer, const glm::vec4 *colors, uint32_t count)
+	{
+		count = std::min(count, NODE_PALETTE_SIZE);
+		if (std::equal(colors, colors + count, buffer.palette.colors))
+		{
+			return;
+		}
+		std::copy(colors, colors + count, buffer.palette.colors);
+		markDirty(buffer.paletteStream.dirty, 0, 1);
+	}
+
+	void discardNodeStateUploads(NodeStateBuffer &buffer)
+	{
+		buffer.stateStream.dirty.ranges.clear();
+	}
+
+	void stageNodeStates(NodeStateBuffer &buffer, UploadRing &ring, UploadBatch &batch)
+	{
+		stageStreamedBuffer(ring, buffer.paletteStream, &buffer.palette, batch);
+		stageStreamedBuffer(ring, buffer.stateStream, buffer.states.data(), batch);
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef NODE_STATE_BUFFER_HPP
+#define NODE_STATE_BUFFER_HPP
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Upload_Ring.hpp"
+
+// ----------------------------------------------------------------------------
+// Palette-indexed node states
+// ----------------------------------------------------------------------------
+// One uint8 state or category per node, packed four to a word in a storage
+// buffer, and a small uniform palette the node shader looks the colors up in
+// (node.vert with NODE_STATE_BUFFER). Changing a node's state streams one byte
+// instead of its 16 byte instance color, rounded up to the touched words, and
+// changing the palette recolors every node with a single upload of the
+// palette. The compute shader epidemic writes the same packed layout, so it
+// can step the states in place.
+
+namespace render
+{
+// Matches NODE_PALETTE_SIZE of node.vert, states above it use the last color
+constexpr uint32_t NODE_PALETTE_SIZE = 16;
+
+// std140 layout of the NodePalette uniform block
+struct NodePalette
+{
+	glm::vec4 colors[NODE_PALETTE_SIZE];
+};
+
+struct NodeStateBuffer
+{
+	uint32_t nodeCount = 0;
+	// Host copy in the GPU layout, padded to whole words
+	std::vector<uint8_t> states;
+	// One element per word of four states
+	StreamedBuffer stateStream;
+	NodePalette palette;
+	StreamedBuffer paletteStream;
+};
+
+	void createNodeStateBuffer(NodeStateBuffer &buffer, DeviceMemoryAllocator *allocator, uint32_t nodeCount);
+	void destroyNodeStateBuffer(NodeStateBuffer &buffer);
+
+	// Copy states[node] for each listed node
+	void setNodeStates(NodeStateBuffer &buffer, const std::vector<uint32_t> &nodes, const uint8_t *states);
+	// Copy nodeCount states
+	void setAllNodeStates(NodeStateBuffer &buffer, const uint8_t *states);
+	// Replace the first count palette colors, only uploaded if one of them changed
+	void setNodePalette(NodeStateBuffer &buffer, const glm::vec4 *colors, uint32_t count);
+	// Drop the pending state uploads once the GPU writes the states, e.g. the epidemic compute shader. The host copy is
+	// stale afterwards, setAllNodeStates makes it current again
+	void discardNodeStateUploads(NodeStateBuffer &buffer);
+
+	// Stage the changed states and the palette into this frame's upload batch, what does not fit follows next frame
+	void stageNodeStates(NodeStateBuffer &buffer, UploadRing &ring, UploadBatch &batch);
+}
+
+#endif
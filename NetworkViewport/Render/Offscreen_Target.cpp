@@ -0,0 +1,168 @@
+#include "Offscreen_Target.hpp"
+#include <array>
+#include <stdexcept>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+
+namespace render
+{
+	static VkFormat selectDepthFormat(VulkanDevice *vulkanDevice)
+	{
+		const std::array<VkFormat, 4> candidates = {
+			VK_FORMAT_D32_SFLOAT,
+			VK_FORMAT_D32_SFLOAT_S8_UINT,
+			VK_FORMAT_D24_UNORM_S8_UINT,
+			VK_FORMAT_D16_UNORM};
+		for (VkFormat format : candidates)
+		{
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, format, &formatProperties);
+			if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			{
+				return format;
+			}
+		}
+		throw std::runtime_error("No depth attachment format available for the offscreen target");
+	}
+
+	static void createAttachment(OffscreenTarget &target, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectMask,
+								 VkImage &image, Allocation *&allocation, VkImageView &view)
+	{
+		VkImageCreateInfo imageInfo = initializers::imageCreateInfo();
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = target.width;
+		imageInfo.extent.height = target.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK_RESULT(createImage(*target.allocator, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation));
+
+		VkImageViewCreateInfo viewInfo = initializers::imageViewCreateInfo();
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = aspectMask;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.layerCount = 1;
+		VK_CHECK_RESULT(vkCreateImageView(target.vulkanDevice->logicalDevice, &viewInfo, nullptr, &view));
+	}
+
+	static void createOffscreenRenderPass(OffscreenTarget &target)
+	{
+		std::array<VkAttachmentDescription, 2> attachments = {};
+		attachments[0].format = target.colorFormat;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		attachments[1].format = target.depthFormat;
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorReference = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		VkAttachmentReference depthReference = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorReference;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		// Frames in flight share the attachments: the previous frame's readback copy and its depth and color writes
+		// must finish before the images are cleared again, and the rendered image has to be visible to the readback copy
+		std::array<VkSubpassDependency, 2> dependencies{};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
+		VK_CHECK_RESULT(vkCreateRenderPass(target.vulkanDevice->logicalDevice, &renderPassInfo, nullptr, &target.renderPass));
+	}
+
+	void createOffscreenTarget(OffscreenTarget &target, DeviceMemoryAllocator *allocator, uint32_t width, uint32_t height)
+	{
+		target.vulkanDevice = allocator->vulkanDevice;
+		target.allocator = allocator;
+		target.width = width;
+		target.height = height;
+		target.depthFormat = selectDepthFormat(target.vulkanDevice);
+
+		createAttachment(target, target.colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+						 target.colorImage, target.colorAllocation, target.colorView);
+		createAttachment(target, target.depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+						 target.depthImage, target.depthAllocation, target.depthView);
+		createOffscreenRenderPass(target);
+
+		std::array<VkImageView, 2> attachments = {target.colorView, target.depthView};
+		VkFramebufferCreateInfo frameBufferInfo = {};
+		frameBufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frameBufferInfo.renderPass = target.renderPass;
+		frameBufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		frameBufferInfo.pAttachments = attachments.data();
+		frameBufferInfo.width = width;
+		frameBufferInfo.height = height;
+		frameBufferInfo.layers = 1;
+		VK_CHECK_RESULT(vkCreateFramebuffer(target.vulkanDevice->logicalDevice, &frameBufferInfo, nullptr, &target.frameBuffer));
+	}
+
+	void destroyOffscreenTarget(OffscreenTarget &target)
+	{
+		VkDevice logicalDevice = target.vulkanDevice->logicalDevice;
+		vkDestroyFramebuffer(logicalDevice, target.frameBuffer, nullptr);
+		vkDestroyRenderPass(logicalDevice, target.renderPass, nullptr);
+		vkDestroyImageView(logicalDevice, target.colorView, nullptr);
+		vkDestroyImageView(logicalDevice, target.depthView, nullptr);
+		destroyImage(*target.allocator, target.colorImage, target.colorAllocation);
+		destroyImage(*target.allocator, target.depthImage, target.depthAllocation);
+	}
+
+	void beginOffscreenRenderPass(const OffscreenTarget &target, VkCommandBuffer commandBuffer)
+	{
+		VkClearValue clearValues[2];
+		clearValues[0].color = {{67. / 255, 74. / 255, 69. / 255, 1.f}};
+		clearValues[1].depthStencil = {1.0f, 0};
+
+		VkRenderPassBeginInfo renderPassBeginInfo = initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = target.renderPass;
+		renderPassBeginInfo.framebuffer = target.frameBuffer;
+		renderPassBeginInfo.renderArea.extent.width = target.width;
+		renderPassBeginInfo.renderArea.extent.height = target.height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = initializers::viewport((float)target.width, (float)target.height, 0.0f, 1.0f);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		VkRect2D scissor = initializers::rect2D(target.width, target.height, 0, 0);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+}
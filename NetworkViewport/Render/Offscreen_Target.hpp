@@ -0,0 +1,43 @@
+#ifndef OFFSCREEN_TARGET_HPP
+#define OFFSCREEN_TARGET_HPP
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include "Memory_Allocator.hpp"
+
+// ----------------------------------------------------------------------------
+// Offscreen render target
+// ----------------------------------------------------------------------------
+// Color and depth images with a render pass and framebuffer, standing in for
+// the swapchain when there is no display. The color image ends the render
+// pass in TRANSFER_SRC_OPTIMAL, ready to be copied out.
+
+namespace render
+{
+struct OffscreenTarget
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+	VkImage colorImage = VK_NULL_HANDLE;
+	Allocation *colorAllocation = nullptr;
+	VkImageView colorView = VK_NULL_HANDLE;
+	VkImage depthImage = VK_NULL_HANDLE;
+	Allocation *depthAllocation = nullptr;
+	VkImageView depthView = VK_NULL_HANDLE;
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkFramebuffer frameBuffer = VK_NULL_HANDLE;
+};
+
+	void createOffscreenTarget(OffscreenTarget &target, DeviceMemoryAllocator *allocator, uint32_t width, uint32_t height);
+	void destroyOffscreenTarget(OffscreenTarget &target);
+
+	// Begin the render pass and set a full-target viewport and scissor
+	void beginOffscreenRenderPass(const OffscreenTarget &target, VkCommandBuffer commandBuffer);
+}
+
+#endif
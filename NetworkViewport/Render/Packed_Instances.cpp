@@ -0,0 +1,207 @@
+#include "Packed_Instances.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace render
+{
+	// Instance data is read by layout, as the vertex input descriptions do
+	struct NodeInstanceLayout
+	{
+		glm::vec3 pos;
+		glm::vec4 color;
+		float scale;
+	};
+	struct EdgeInstanceLayout
+	{
+		glm::vec3 start;
+		glm::vec3 end;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(NodeInstanceData) == sizeof(NodeInstanceLayout), "NodeInstanceData must be position, color and scale");
+	static_assert(sizeof(EdgeInstanceData) == sizeof(EdgeInstanceLayout), "EdgeInstanceData must be start, end and scale");
+
+	static NodeInstanceLayout readNode(const NodeInstanceData &node)
+	{
+		NodeInstanceLayout layout;
+		std::memcpy(static_cast<void *>(&layout), &node, sizeof(layout));
+		return layout;
+	}
+
+	static EdgeInstanceLayout readEdge(const EdgeInstanceData &edge)
+	{
+		EdgeInstanceLayout layout;
+		std::memcpy(static_cast<void *>(&layout), &edge, sizeof(layout));
+		return layout;
+	}
+
+	glm::vec3 edgeInstanceStart(const EdgeInstanceData &edge)
+	{
+		return readEdge(edge).start;
+	}
+
+	glm::vec3 edgeInstanceEnd(const EdgeInstanceData &edge)
+	{
+		return readEdge(edge).end;
+	}
+
+	NodeInstanceData scaledNodeInstance(const NodeInstanceData &node, float factor)
+	{
+		NodeInstanceLayout layout = readNode(node);
+		layout.scale *= factor;
+		NodeInstanceData scaled = node;
+		std::memcpy(static_cast<void *>(&scaled), &layout, sizeof(layout));
+		return scaled;
+	}
+
+	float nodeInstanceScale(const NodeInstanceData &node)
+	{
+		return readNode(node).scale;
+	}
+
+	static InstanceBounds boundsFromRange(glm::vec3 lo, glm::vec3 hi)
+	{
+		InstanceBounds bounds;
+		if (lo.x > hi.x)
+		{
+			return bounds;
+		}
+		// A flat axis (2D layouts) still needs a non-zero extent to divide by
+		bounds.origin = glm::vec4(lo, 0.f);
+		bounds.extent = glm::vec4(glm::max(hi - lo, glm::vec3(1e-6f)), 0.f);
+		return bounds;
+	}
+
+	InstanceBounds computeInstanceBounds(const std::vector<NodeInstanceData> &nodeInstanceData)
+	{
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		for (const auto &node : nodeInstanceData)
+		{
+			glm::vec3 pos = readNode(node).pos;
+			lo = glm::min(lo, pos);
+			hi = glm::max(hi, pos);
+		}
+		return boundsFromRange(lo, hi);
+	}
+
+	InstanceBounds computeInstanceBounds(const std::vector<EdgeInstanceData> &edgeInstanceData)
+	{
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		for (const auto &edge : edgeInstanceData)
+		{
+			EdgeInstanceLayout layout = readEdge(edge);
+			lo = glm::min(lo, glm::min(layout.start, layout.end));
+			hi = glm::max(hi, glm::max(layout.start, layout.end));
+		}
+		return boundsFromRange(lo, hi);
+	}
+
+	static void quantizePosition(const glm::vec3 &pos, const InstanceBounds &bounds, uint16_t out[3])
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float t = (pos[i] - bounds.origin[i]) / bounds.extent[i];
+			out[i] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.f, 1.f) * 65535.f));
+		}
+	}
+
+	static uint8_t quantizeScale(float scale)
+	{
+		return static_cast<uint8_t>(std::lround(std::clamp(scale / PACKED_SCALE_STEP, 0.f, 255.f)));
+	}
+
+	static uint8_t quantizeUnorm8(float value)
+	{
+		return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+	}
+
+	PackedNodeInstance packNodeInstance(const NodeInstanceData &node, const InstanceBounds &bounds)
+	{
+		NodeInstanceLayout layout = readNode(node);
+		PackedNodeInstance packed = {};
+		quantizePosition(layout.pos, bounds, packed.position);
+		packed.scale = quantizeScale(layout.scale);
+		for (int i = 0; i < 4; i++)
+		{
+			packed.color[i] = quantizeUnorm8(layout.color[i]);
+		}
+		return packed;
+	}
+
+	PackedEdgeInstance packEdgeInstance(const EdgeInstanceData &edge, const InstanceBounds &bounds)
+	{
+		EdgeInstanceLayout layout = readEdge(edge);
+		PackedEdgeInstance packed = {};
+		quantizePosition(layout.start, bounds, packed.start);
+		quantizePosition(layout.end, bounds, packed.end);
+		// Edges are scaled uniformly in the packed layout
+		packed.scale = quantizeScale(std::max(layout.scale.x, std::max(layout.scale.y, layout.scale.z)));
+		return packed;
+	}
+
+	glm::vec3 unpackPosition(const uint16_t position[3], const InstanceBounds &bounds)
+	{
+		glm::vec3 t(position[0], position[1], position[2]);
+		return glm::vec3(bounds.origin) + t / 65535.f * glm::vec3(bounds.extent);
+	}
+
+	GpuNodeInstance toGpuNodeInstance(const NodeInstanceData &node, const InstanceBounds &bounds)
+	{
+#ifdef NV_PACKED_INSTANCES
+		return packNodeInstance(node, bounds);
+#else
+		(void)bounds;
+		return node;
+#endif
+	}
+
+	std::vector<GpuNodeInstance> toGpuNodeInstances(const std::vector<NodeInstanceData> &nodeInstanceData, const InstanceBounds &bounds)
+	{
+#ifdef NV_PACKED_INSTANCES
+		std::vector<GpuNodeInstance> instances(nodeInstanceData.size());
+		std::transform(nodeInstanceData.begin(), nodeInstanceData.end(), instances.begin(),
+					   [&bounds](const NodeInstanceData &node)
+					   { return packNodeInstance(node, bounds); });
+		return instances;
+#else
+		(void)bounds;
+		return nodeInstanceData;
+#endif
+	}
+
+	std::vector<GpuEdgeInstance> toGpuEdgeInstances(const std::vector<EdgeInstanceData> &edgeInstanceData, const InstanceBounds &bounds)
+	{
+#ifdef NV_PACKED_INSTANCES
+		std::vector<GpuEdgeInstance> instances(edgeInstanceData.size());
+		std::transform(edgeInstanceData.begin(), edgeInstanceData.end(), instances.begin(),
+					   [&bounds](const EdgeInstanceData &edge)
+					   { return packEdgeInstance(edge, bounds); });
+		return instances;
+#else
+		(void)bounds;
+		return edgeInstanceData;
+#endif
+	}
+
+	void setGpuNodeInstanceColor(GpuNodeInstance &instance, const glm::vec4 &color)
+	{
+#ifdef NV_PACKED_INSTANCES
+		for (int i = 0; i < 4; i++)
+		{
+			instance.color[i] = quantizeUnorm8(color[i]);
+		}
+#else
+		std::memcpy(reinterpret_cast<char *>(&instance) + offsetof(NodeInstanceLayout, color), &color, sizeof(color));
+#endif
+	}
+
+	void setGpuNodeInstanceScale(GpuNodeInstance &instance, float scale)
+	{
+#ifdef NV_PACKED_INSTANCES
+		instance.scale = quantizeScale(scale);
+#else
+		std::memcpy(reinterpret_cast<char *>(&instance) + offsetof(NodeInstanceLayout, scale), &scale, sizeof(scale));
+#endif
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef PACKED_INSTANCES_HPP
+#define PACKED_INSTANCES_HPP
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <VulkanTools/InstanceGraphics/VulkanNodeInstance.hpp>
+#include <VulkanTools/InstanceGraphics/VulkanEdgeInstance.hpp>
+
+// ----------------------------------------------------------------------------
+// Packed instance formats
+// ----------------------------------------------------------------------------
+// Positions are quantized to 16 bits per axis relative to the bounding box of
+// the chunk they are drawn with, colors are RGBA8 and scales 8-bit fixed point.
+// A node shrinks from 32 to 12 bytes and an edge from 36 to 16 bytes. The
+// layout is chosen at compile time with NV_PACKED_INSTANCES, the node and edge
+// shaders have to be compiled with the matching PACKED_INSTANCES define.
+
+namespace render
+{
+// Per-chunk quantization box, pushed to the shaders as two vec4s
+struct InstanceBounds
+{
+	glm::vec4 origin = glm::vec4(0.f);
+	glm::vec4 extent = glm::vec4(1.f);
+};
+
+struct PackedNodeInstance
+{
+	uint16_t position[3];
+	uint8_t scale;
+	uint8_t reserved;
+	uint8_t color[4];
+};
+
+struct PackedEdgeInstance
+{
+	uint16_t start[3];
+	uint8_t scale;
+	uint8_t reserved;
+	uint16_t end[3];
+	uint16_t reserved1;
+};
+
+static_assert(sizeof(PackedNodeInstance) == 12, "PackedNodeInstance must stay tightly packed");
+static_assert(sizeof(PackedEdgeInstance) == 16, "PackedEdgeInstance must stay tightly packed");
+
+// Scales are stored as multiples of 1/32, covering [0, 7.97]
+constexpr float PACKED_SCALE_STEP = 1.f / 32.f;
+
+#ifdef NV_PACKED_INSTANCES
+typedef PackedNodeInstance GpuNodeInstance;
+typedef PackedEdgeInstance GpuEdgeInstance;
+// Appended to the node and edge shader names
+constexpr const char *INSTANCE_SHADER_VARIANT = "_packed";
+#else
+typedef NodeInstanceData GpuNodeInstance;
+typedef EdgeInstanceData GpuEdgeInstance;
+constexpr const char *INSTANCE_SHADER_VARIANT = "";
+#endif
+
+	// Field access by layout, NodeInstanceData is position, color and scale, EdgeInstanceData start, end and scale
+	glm::vec3 edgeInstanceStart(const EdgeInstanceData &edge);
+	glm::vec3 edgeInstanceEnd(const EdgeInstanceData &edge);
+	NodeInstanceData scaledNodeInstance(const NodeInstanceData &node, float factor);
+	float nodeInstanceScale(const NodeInstanceData &node);
+
+	InstanceBounds computeInstanceBounds(const std::vector<NodeInstanceData> &nodeInstanceData);
+	InstanceBounds computeInstanceBounds(const std::vector<EdgeInstanceData> &edgeInstanceData);
+
+	PackedNodeInstance packNodeInstance(const NodeInstanceData &node, const InstanceBounds &bounds);
+	PackedEdgeInstance packEdgeInstance(const EdgeInstanceData &edge, const InstanceBounds &bounds);
+	glm::vec3 unpackPosition(const uint16_t position[3], const InstanceBounds &bounds);
+
+	// Convert instances to the compiled GPU layout, quantized against bounds in the packed layout
+	GpuNodeInstance toGpuNodeInstance(const NodeInstanceData &node, const InstanceBounds &bounds);
+	std::vector<GpuNodeInstance> toGpuNodeInstances(const std::vector<NodeInstanceData> &nodeInstanceData, const InstanceBounds &bounds);
+	std::vector<GpuEdgeInstance> toGpuEdgeInstances(const std::vector<EdgeInstanceData> &edgeInstanceData, const InstanceBounds &bounds);
+	// Overwrite the color of an instance already in the GPU layout
+	void setGpuNodeInstanceColor(GpuNodeInstance &instance, const glm::vec4 &color);
+	// Overwrite the scale of an instance already in the GPU layout, clamped to the packed range there
+	void setGpuNodeInstanceScale(GpuNodeInstance &instance, float scale);
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "Pipeline_Cache.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	static constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x4E565043; // "NVPC"
+	static constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+	struct PipelineCacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t checksum;
+	};
+
+	// FNV-1a, enough to catch truncated or corrupted files
+	static uint64_t checksum(const uint8_t *data, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static PipelineCacheFileHeader deviceHeader(VulkanDevice *vulkanDevice)
+	{
+		const VkPhysicalDeviceProperties &properties = vulkanDevice->properties;
+		PipelineCacheFileHeader header = {};
+		header.magic = PIPELINE_CACHE_FILE_MAGIC;
+		header.version = PIPELINE_CACHE_FILE_VERSION;
+		header.vendorID = properties.vendorID;
+		header.deviceID = properties.deviceID;
+		header.driverVersion = properties.driverVersion;
+		memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+		return header;
+	}
+
+	static std::vector<uint8_t> readCacheFile(VulkanDevice *vulkanDevice, const std::string &path, bool &rejected)
+	{
+		rejected = false;
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return {};
+		}
+		std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		rejected = true;
+		if (contents.size() < sizeof(PipelineCacheFileHeader))
+		{
+			return {};
+		}
+
+		PipelineCacheFileHeader header;
+		memcpy(&header, contents.data(), sizeof(header));
+		PipelineCacheFileHeader expected = deviceHeader(vulkanDevice);
+		if (header.magic != expected.magic || header.version != expected.version ||
+			header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+			header.driverVersion != expected.driverVersion ||
+			memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			return {};
+		}
+		const uint8_t *payload = contents.data() + sizeof(header);
+		if (header.dataSize != contents.size() - sizeof(header) || header.checksum != checksum(payload, header.dataSize))
+		{
+			return {};
+		}
+		rejected = false;
+		return std::vector<uint8_t>(payload, payload + header.dataSize);
+	}
+
+	VkPipelineCache loadPipelineCache(VulkanDevice *vulkanDevice, const std::string &path, PipelineCacheLoadInfo *loadInfo)
+	{
+		NV_TRACE_ZONE("Load pipeline cache");
+		bool rejected = false;
+		std::vector<uint8_t> data = readCacheFile(vulkanDevice, path, rejected);
+
+		VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		pipelineCacheCreateInfo.initialDataSize = data.size();
+		pipelineCacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		VkResult result = vkCreatePipelineCache(vulkanDevice->logicalDevice, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+		if (result != VK_SUCCESS && !data.empty())
+		{
+			// The driver may still refuse data that passed our header checks
+			rejected = true;
+			data.clear();
+			pipelineCacheCreateInfo.initialDataSize = 0;
+			pipelineCacheCreateInfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(vulkanDevice->logicalDevice, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+		}
+		VK_CHECK_RESULT(result);
+
+		if (loadInfo)
+		{
+			loadInfo->loadedBytes = data.size();
+			loadInfo->rejected = rejected;
+		}
+		return pipelineCache;
+	}
+
+	bool savePipelineCache(VulkanDevice *vulkanDevice, VkPipelineCache pipelineCache, const std::string &path)
+	{
+		NV_TRACE_ZONE("Save pipeline cache");
+		size_t dataSize = 0;
+		VK_CHECK_RESULT(vkGetPipelineCacheData(vulkanDevice->logicalDevice, pipelineCache, &dataSize, nullptr));
+		std::vector<uint8_t> data(dataSize);
+		VK_CHECK_RESULT(vkGetPipelineCacheData(vulkanDevice->logicalDevice, pipelineCache, &dataSize, data.data()));
+		data.resize(dataSize);
+
+		PipelineCacheFileHeader header = deviceHeader(vulkanDevice);
+		header.dataSize = dataSize;
+		header.checksum = checksum(data.data(), data.size());
+
+		const std::string tmpPath = path + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!file)
+			{
+				return false;
+			}
+			file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char *>(data.data()), data.size());
+			if (!file)
+			{
+				return false;
+			}
+		}
+		// Replaces an existing cache atomically on POSIX, Windows needs the old file out of the way
+#ifdef WIN32
+		std::remove(path.c_str());
+#endif
+		return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+	}
+}
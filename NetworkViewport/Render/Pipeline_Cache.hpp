@@ -0,0 +1,34 @@
+#ifndef PIPELINE_CACHE_HPP
+#define PIPELINE_CACHE_HPP
+#include <cstddef>
+#include <string>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+
+// ----------------------------------------------------------------------------
+// Persistent pipeline cache
+// ----------------------------------------------------------------------------
+// The cache data is stored behind a small header carrying the vendor, device,
+// driver version and pipeline cache UUID it was produced with, plus a checksum
+// of the payload. A mismatch (new driver, other GPU, truncated file) silently
+// falls back to an empty cache. Files are written to a temporary name and
+// renamed, so a crash while saving never leaves a torn cache behind.
+
+namespace render
+{
+struct PipelineCacheLoadInfo
+{
+	// Payload bytes handed to vkCreatePipelineCache, 0 for a cold start
+	size_t loadedBytes = 0;
+	// Set when a file existed but was rejected
+	bool rejected = false;
+};
+
+	// Create a pipeline cache seeded from path when the file matches this device
+	VkPipelineCache loadPipelineCache(VulkanDevice *vulkanDevice, const std::string &path, PipelineCacheLoadInfo *loadInfo = nullptr);
+
+	// Serialize the cache to path, returns false if the file could not be written
+	bool savePipelineCache(VulkanDevice *vulkanDevice, VkPipelineCache pipelineCache, const std::string &path);
+}
+
+#endif
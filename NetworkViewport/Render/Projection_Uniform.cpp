@@ -0,0 +1,43 @@
+#include "Projection_Uniform.hpp"
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+
+namespace render
+{
+	void createProjectionUniform(ProjectionUniform &uniform, DeviceMemoryAllocator *allocator, VkDeviceSize size)
+	{
+		uniform.allocator = allocator;
+		VK_CHECK_RESULT(createBuffer(
+			*allocator,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			size,
+			uniform.buffer));
+	}
+
+	void destroyProjectionUniform(ProjectionUniform &uniform)
+	{
+		destroyBuffer(*uniform.allocator, uniform.buffer);
+	}
+
+	void recordProjectionUpdate(const ProjectionUniform &uniform, VkCommandBuffer commandBuffer, const void *data)
+	{
+		VkBufferMemoryBarrier barrier = initializers::bufferMemoryBarrier();
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = uniform.buffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		// Write after read, the previous frame's draws only need to be done
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 1, &barrier, 0, nullptr);
+		vkCmdUpdateBuffer(commandBuffer, uniform.buffer.buffer, 0, uniform.buffer.size, data);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+							 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+}
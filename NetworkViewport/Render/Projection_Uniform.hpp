@@ -0,0 +1,32 @@
+#ifndef PROJECTION_UNIFORM_HPP
+#define PROJECTION_UNIFORM_HPP
+#include <vulkan/vulkan.hpp>
+#include "Memory_Allocator.hpp"
+
+// ----------------------------------------------------------------------------
+// Per-frame camera uniform
+// ----------------------------------------------------------------------------
+// Device-local copy of the projection uniform block that the frame's command
+// buffer updates itself with vkCmdUpdateBuffer. The camera of every frame is
+// part of its submission, so the host can move on to the next frame while
+// earlier ones are still being drawn, instead of rewriting a host-visible
+// buffer that in-flight frames still read.
+
+namespace render
+{
+struct ProjectionUniform
+{
+	DeviceMemoryAllocator *allocator = nullptr;
+	AllocatedBuffer buffer;
+};
+
+	// size is that of the uniform block, at most 65536 bytes and a multiple of 4
+	void createProjectionUniform(ProjectionUniform &uniform, DeviceMemoryAllocator *allocator, VkDeviceSize size);
+	void destroyProjectionUniform(ProjectionUniform &uniform);
+
+	// Record the update outside of a render pass, vertex shaders of earlier submissions are waited for and later
+	// ones see the new block
+	void recordProjectionUpdate(const ProjectionUniform &uniform, VkCommandBuffer commandBuffer, const void *data);
+}
+
+#endif
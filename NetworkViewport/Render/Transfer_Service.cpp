@@ -0,0 +1,290 @@
+#include "Transfer_Service.hpp"
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+
+namespace render
+{
+	void createTransferService(TransferService &service, DeviceMemoryAllocator *allocator, VkQueue graphicsQueue)
+	{
+		VulkanDevice *vulkanDevice = allocator->vulkanDevice;
+		service.vulkanDevice = vulkanDevice;
+		service.allocator = allocator;
+		service.graphicsQueueFamilyIndex = vulkanDevice->queueFamilyIndices.graphics;
+		service.queueFamilyIndex = vulkanDevice->queueFamilyIndices.transfer;
+		service.dedicated = service.queueFamilyIndex != service.graphicsQueueFamilyIndex;
+		if (service.dedicated)
+		{
+			vkGetDeviceQueue(vulkanDevice->logicalDevice, service.queueFamilyIndex, 0, &service.queue);
+		}
+		else
+		{
+			service.queue = graphicsQueue;
+		}
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = service.queueFamilyIndex;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		VK_CHECK_RESULT(vkCreateCommandPool(vulkanDevice->logicalDevice, &poolInfo, nullptr, &service.commandPool));
+	}
+
+	static void retireSubmission(TransferService &service, TransferService::Submission &submission)
+	{
+		for (auto &stagingBuffer : submission.stagingBuffers)
+		{
+			destroyStagingBuffer(*service.allocator, stagingBuffer);
+		}
+		vkFreeCommandBuffers(service.vulkanDevice->logicalDevice, service.commandPool, 1, &submission.commandBuffer);
+		VK_CHECK_RESULT(vkResetFences(service.vulkanDevice->logicalDevice, 1, &submission.fence));
+		service.freeFences.push_back(submission.fence);
+
+		auto &ready = service.readyAcquires;
+		ready.bufferBarriers.insert(ready.bufferBarriers.end(), submission.acquires.bufferBarriers.begin(), submission.acquires.bufferBarriers.end());
+		ready.imageBarriers.insert(ready.imageBarriers.end(), submission.acquires.imageBarriers.begin(), submission.acquires.imageBarriers.end());
+		ready.dstStageMask |= submission.acquires.dstStageMask;
+		service.completedTicket = submission.ticket;
+	}
+
+	// Expects the service mutex to be held. Staging memory is only allocated under that mutex, so once no batch is
+	// recording or in flight nothing reads the transient arena anymore
+	static void resetStaging(TransferService &service)
+	{
+		if (service.inFlight.empty() && service.recording == VK_NULL_HANDLE)
+		{
+			resetTransient(*service.allocator);
+		}
+	}
+
+	// Expects the service mutex to be held
+	static void retireCompleted(TransferService &service)
+	{
+		VkDevice logicalDevice = service.vulkanDevice->logicalDevice;
+		// Retire in submission order so completedTicket stays a watermark
+		while (!service.inFlight.empty() && vkGetFenceStatus(logicalDevice, service.inFlight.front().fence) == VK_SUCCESS)
+		{
+			retireSubmission(service, service.inFlight.front());
+			service.inFlight.pop_front();
+		}
+		resetStaging(service);
+	}
+
+	void destroyTransferService(TransferService &service)
+	{
+		submitTransfers(service);
+		std::lock_guard<std::mutex> lock(service.mutex);
+		VkDevice logicalDevice = service.vulkanDevice->logicalDevice;
+		for (auto &submission : service.inFlight)
+		{
+			VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &submission.fence, VK_TRUE, UINT64_MAX));
+			retireSubmission(service, submission);
+		}
+		service.inFlight.clear();
+		resetStaging(service);
+		for (auto &fence : service.freeFences)
+		{
+			vkDestroyFence(logicalDevice, fence, nullptr);
+		}
+		service.freeFences.clear();
+		vkDestroyCommandPool(logicalDevice, service.commandPool, nullptr);
+		service.readyAcquires = TransferAcquireBatch();
+	}
+
+	// Expects the service mutex to be held
+	static VkCommandBuffer recordingCommandBuffer(TransferService &service)
+	{
+		if (service.recording == VK_NULL_HANDLE)
+		{
+			VkCommandBufferAllocateInfo allocInfo = initializers::commandBufferAllocateInfo(service.commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(service.vulkanDevice->logicalDevice, &allocInfo, &service.recording));
+			VkCommandBufferBeginInfo beginInfo = initializers::commandBufferBeginInfo();
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			VK_CHECK_RESULT(vkBeginCommandBuffer(service.recording, &beginInfo));
+		}
+		return service.recording;
+	}
+
+	// Expects the service mutex to be held
+	static AllocatedBuffer &stageData(TransferService &service, const void *data, VkDeviceSize size)
+	{
+		service.recordingStaging.emplace_back();
+		AllocatedBuffer &stagingBuffer = service.recordingStaging.back();
+		VK_CHECK_RESULT(createStagingBuffer(*service.allocator, size, stagingBuffer, data));
+		return stagingBuffer;
+	}
+
+	void enqueueBufferUpload(TransferService &service, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size,
+							 VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		VkCommandBuffer commandBuffer = recordingCommandBuffer(service);
+		AllocatedBuffer &stagingBuffer = stageData(service, data, size);
+
+		VkBufferCopy copyRegion = {};
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, dstBuffer, 1, &copyRegion);
+
+		VkBufferMemoryBarrier barrier = initializers::bufferMemoryBarrier();
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = dstBuffer;
+		barrier.offset = dstOffset;
+		barrier.size = size;
+		if (service.dedicated)
+		{
+			// Release half of the ownership transfer, the destination access is ignored here
+			barrier.srcQueueFamilyIndex = service.queueFamilyIndex;
+			barrier.dstQueueFamilyIndex = service.graphicsQueueFamilyIndex;
+			VkBufferMemoryBarrier release = barrier;
+			release.dstAccessMask = 0;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+								 0, nullptr, 1, &release, 0, nullptr);
+			// The acquire does not wait on any write of the graphics queue
+			barrier.srcAccessMask = 0;
+		}
+		service.recordingAcquires.bufferBarriers.push_back(barrier);
+		service.recordingAcquires.dstStageMask |= dstStageMask;
+	}
+
+	void enqueueImageUpload(TransferService &service, VkImage image, uint32_t width, uint32_t height, const void *data, VkDeviceSize size,
+							VkImageLayout finalLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		VkCommandBuffer commandBuffer = recordingCommandBuffer(service);
+		AllocatedBuffer &stagingBuffer = stageData(service, data, size);
+
+		VkImageSubresourceRange subresourceRange = {};
+		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		subresourceRange.levelCount = 1;
+		subresourceRange.layerCount = 1;
+
+		VkImageMemoryBarrier toTransfer = initializers::imageMemoryBarrier();
+		toTransfer.srcAccessMask = 0;
+		toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.image = image;
+		toTransfer.subresourceRange = subresourceRange;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+		VkBufferImageCopy bufferCopyRegion = {};
+		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bufferCopyRegion.imageSubresource.layerCount = 1;
+		bufferCopyRegion.imageExtent.width = width;
+		bufferCopyRegion.imageExtent.height = height;
+		bufferCopyRegion.imageExtent.depth = 1;
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
+
+		// The layout transition is part of both halves of an ownership transfer, and done right away otherwise
+		VkImageMemoryBarrier release = initializers::imageMemoryBarrier();
+		release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		release.dstAccessMask = 0;
+		release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		release.newLayout = finalLayout;
+		release.srcQueueFamilyIndex = service.dedicated ? service.queueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+		release.dstQueueFamilyIndex = service.dedicated ? service.graphicsQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+		release.image = image;
+		release.subresourceRange = subresourceRange;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &release);
+
+		VkImageMemoryBarrier acquire = release;
+		acquire.srcAccessMask = service.dedicated ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+		acquire.dstAccessMask = dstAccessMask;
+		if (!service.dedicated)
+		{
+			acquire.oldLayout = finalLayout;
+		}
+		service.recordingAcquires.imageBarriers.push_back(acquire);
+		service.recordingAcquires.dstStageMask |= dstStageMask;
+	}
+
+	TransferTicket submitTransfers(TransferService &service)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		if (service.recording == VK_NULL_HANDLE)
+		{
+			return service.nextTicket - 1;
+		}
+		VkDevice logicalDevice = service.vulkanDevice->logicalDevice;
+		VK_CHECK_RESULT(vkEndCommandBuffer(service.recording));
+
+		TransferService::Submission submission;
+		submission.ticket = service.nextTicket++;
+		submission.commandBuffer = service.recording;
+		submission.stagingBuffers = std::move(service.recordingStaging);
+		submission.acquires = std::move(service.recordingAcquires);
+		if (service.freeFences.empty())
+		{
+			VkFenceCreateInfo fenceInfo = initializers::fenceCreateInfo(0);
+			VK_CHECK_RESULT(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &submission.fence));
+		}
+		else
+		{
+			submission.fence = service.freeFences.back();
+			service.freeFences.pop_back();
+		}
+
+		VkSubmitInfo submitInfo = initializers::submitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &submission.commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(service.queue, 1, &submitInfo, submission.fence));
+
+		service.recording = VK_NULL_HANDLE;
+		service.recordingStaging.clear();
+		service.recordingAcquires = TransferAcquireBatch();
+		service.inFlight.push_back(std::move(submission));
+		return service.inFlight.back().ticket;
+	}
+
+	void pollTransfers(TransferService &service)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		retireCompleted(service);
+	}
+
+	bool transferComplete(TransferService &service, TransferTicket ticket)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		retireCompleted(service);
+		return service.completedTicket >= ticket;
+	}
+
+	void waitTransfer(TransferService &service, TransferTicket ticket)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		VkDevice logicalDevice = service.vulkanDevice->logicalDevice;
+		while (!service.inFlight.empty() && service.inFlight.front().ticket <= ticket)
+		{
+			VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &service.inFlight.front().fence, VK_TRUE, UINT64_MAX));
+			retireSubmission(service, service.inFlight.front());
+			service.inFlight.pop_front();
+		}
+		resetStaging(service);
+	}
+
+	TransferAcquireBatch takeTransferAcquires(TransferService &service)
+	{
+		std::lock_guard<std::mutex> lock(service.mutex);
+		retireCompleted(service);
+		TransferAcquireBatch batch = std::move(service.readyAcquires);
+		service.readyAcquires = TransferAcquireBatch();
+		return batch;
+	}
+
+	void recordTransferAcquires(const TransferAcquireBatch &batch, VkCommandBuffer commandBuffer)
+	{
+		if (batch.bufferBarriers.empty() && batch.imageBarriers.empty())
+		{
+			return;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, batch.dstStageMask, 0,
+							 0, nullptr,
+							 static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+							 static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+	}
+}
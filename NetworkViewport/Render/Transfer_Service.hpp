@@ -0,0 +1,97 @@
+#ifndef TRANSFER_SERVICE_HPP
+#define TRANSFER_SERVICE_HPP
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include "Memory_Allocator.hpp"
+
+// ----------------------------------------------------------------------------
+// Asynchronous uploads
+// ----------------------------------------------------------------------------
+// Copies are recorded into one command buffer and submitted as a batch to the
+// dedicated transfer queue family when the device has one, otherwise to the
+// graphics queue. Every batch signals a fence and is identified by a ticket,
+// so the caller polls for completion instead of waiting on the queue.
+// Resources uploaded on a dedicated transfer family are released to the
+// graphics family, the matching acquire barriers are handed out once the
+// batch has completed and must be recorded before the first use. Staging
+// memory comes from the allocator's transient arena, which the service resets
+// whenever no batch is recording or in flight, so nothing else may use it.
+
+namespace render
+{
+typedef uint64_t TransferTicket;
+
+// Barriers to record on the graphics queue before using completed uploads
+struct TransferAcquireBatch
+{
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	VkPipelineStageFlags dstStageMask = 0;
+};
+
+struct TransferService
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t queueFamilyIndex = 0;
+	uint32_t graphicsQueueFamilyIndex = 0;
+	// Whether uploads run on their own queue family and need ownership transfers
+	bool dedicated = false;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+
+	// Batch currently being recorded
+	VkCommandBuffer recording = VK_NULL_HANDLE;
+	std::vector<AllocatedBuffer> recordingStaging;
+	TransferAcquireBatch recordingAcquires;
+
+	struct Submission
+	{
+		TransferTicket ticket = 0;
+		VkFence fence = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		std::vector<AllocatedBuffer> stagingBuffers;
+		TransferAcquireBatch acquires;
+	};
+	std::deque<Submission> inFlight;
+	std::vector<VkFence> freeFences;
+
+	TransferTicket nextTicket = 1;
+	// All batches up to and including this ticket have completed
+	TransferTicket completedTicket = 0;
+	TransferAcquireBatch readyAcquires;
+
+	std::mutex mutex;
+};
+
+	// The transfer queue has to be created with the logical device, which is the case whenever
+	// queueFamilyIndices.transfer differs from the graphics family
+	void createTransferService(TransferService &service, DeviceMemoryAllocator *allocator, VkQueue graphicsQueue);
+	void destroyTransferService(TransferService &service);
+
+	// Stage data and record its copy into the current batch
+	void enqueueBufferUpload(TransferService &service, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size,
+							 VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+	// Upload the first mip level of a 2D image and leave it in finalLayout
+	void enqueueImageUpload(TransferService &service, VkImage image, uint32_t width, uint32_t height, const void *data, VkDeviceSize size,
+							VkImageLayout finalLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+	// Submit the current batch, returns its ticket. Without recorded copies the last submitted ticket is returned.
+	// When the graphics queue is shared the caller has to serialize this with its own submissions.
+	TransferTicket submitTransfers(TransferService &service);
+
+	// Retire completed batches and release their staging memory
+	void pollTransfers(TransferService &service);
+	bool transferComplete(TransferService &service, TransferTicket ticket);
+	void waitTransfer(TransferService &service, TransferTicket ticket);
+
+	// Acquire barriers of all batches completed since the last call
+	TransferAcquireBatch takeTransferAcquires(TransferService &service);
+	void recordTransferAcquires(const TransferAcquireBatch &batch, VkCommandBuffer commandBuffer);
+}
+
+#endif
@@ -0,0 +1,247 @@
+#include "Upload_Ring.hpp"
+#include <algorithm>
+#include <cstring>
+#include <VulkanTools/Utilities/VulkanInitializers.hpp>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace render
+{
+	// Coalesce eagerly once this many unsorted ranges have piled up
+	static constexpr size_t DIRTY_RANGE_COALESCE_LIMIT = 4096;
+
+	void markDirty(DirtyRangeTracker &tracker, size_t begin, size_t end)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+		// Extending the last range covers the common sequential write pattern without growing the list
+		if (!tracker.ranges.empty())
+		{
+			auto &last = tracker.ranges.back();
+			if (begin >= last.first && begin <= last.second + tracker.mergeGap)
+			{
+				last.second = std::max(last.second, end);
+				return;
+			}
+		}
+		tracker.ranges.emplace_back(begin, end);
+		if (tracker.ranges.size() > DIRTY_RANGE_COALESCE_LIMIT)
+		{
+			coalesceDirtyRanges(tracker);
+		}
+	}
+
+	void coalesceDirtyRanges(DirtyRangeTracker &tracker)
+	{
+		auto &ranges = tracker.ranges;
+		if (ranges.size() < 2)
+		{
+			return;
+		}
+		std::sort(ranges.begin(), ranges.end());
+		size_t out = 0;
+		for (size_t i = 1; i < ranges.size(); i++)
+		{
+			if (ranges[i].first <= ranges[out].second + tracker.mergeGap)
+			{
+				ranges[out].second = std::max(ranges[out].second, ranges[i].second);
+			}
+			else
+			{
+				ranges[++out] = ranges[i];
+			}
+		}
+		ranges.resize(out + 1);
+	}
+
+	void createUploadRing(UploadRing &ring, DeviceMemoryAllocator *allocator, VkDeviceSize frameSize, uint32_t framesInFlight)
+	{
+		VulkanDevice *vulkanDevice = allocator->vulkanDevice;
+		ring.vulkanDevice = vulkanDevice;
+		ring.allocator = allocator;
+		ring.frameSize = frameSize;
+		ring.frameIndex = 0;
+		ring.head = 0;
+
+		// Host-visible allocator blocks stay mapped, so the ring is mapped for its whole lifetime
+		VK_CHECK_RESULT(createBuffer(
+			*allocator,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frameSize * framesInFlight,
+			ring.buffer));
+
+		// Created signaled so the first pass over the partitions does not block
+		VkFenceCreateInfo fenceInfo = initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+		ring.fences.resize(framesInFlight);
+		for (auto &fence : ring.fences)
+		{
+			VK_CHECK_RESULT(vkCreateFence(vulkanDevice->logicalDevice, &fenceInfo, nullptr, &fence));
+		}
+	}
+
+	void destroyUploadRing(UploadRing &ring)
+	{
+		VkDevice logicalDevice = ring.vulkanDevice->logicalDevice;
+		for (auto &fence : ring.fences)
+		{
+			vkDestroyFence(logicalDevice, fence, nullptr);
+		}
+		ring.fences.clear();
+		destroyBuffer(*ring.allocator, ring.buffer);
+	}
+
+	void beginUploadFrame(UploadRing &ring)
+	{
+		NV_TRACE_ZONE("Wait upload frame");
+		ring.frameIndex = (ring.frameIndex + 1) % static_cast<uint32_t>(ring.fences.size());
+		ring.head = 0;
+		VkDevice logicalDevice = ring.vulkanDevice->logicalDevice;
+		VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &ring.fences[ring.frameIndex], VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(logicalDevice, 1, &ring.fences[ring.frameIndex]));
+	}
+
+	VkFence uploadFrameFence(const UploadRing &ring)
+	{
+		return ring.fences[ring.frameIndex];
+	}
+
+	VkDeviceSize uploadSpace(const UploadRing &ring, VkDeviceSize alignment)
+	{
+		VkDeviceSize offset = (ring.head + alignment - 1) / alignment * alignment;
+		return offset < ring.frameSize ? ring.frameSize - offset : 0;
+	}
+
+	UploadAllocation allocateUpload(UploadRing &ring, VkDeviceSize size, VkDeviceSize alignment)
+	{
+		UploadAllocation allocation;
+		VkDeviceSize offset = (ring.head + alignment - 1) / alignment * alignment;
+		if (offset + size > ring.frameSize)
+		{
+			return allocation;
+		}
+		ring.head = offset + size;
+		allocation.offset = ring.frameIndex * ring.frameSize + offset;
+		allocation.size = size;
+		allocation.mapped = static_cast<char *>(ring.buffer.mapped) + allocation.offset;
+		return allocation;
+	}
+
+	void createStreamedBuffer(StreamedBuffer &stream, DeviceMemoryAllocator *allocator, VkBufferUsageFlags usage, VkDeviceSize elementSize, size_t elementCount)
+	{
+		stream.allocator = allocator;
+		stream.elementSize = elementSize;
+		stream.elementCount = elementCount;
+		VK_CHECK_RESULT(createBuffer(
+			*allocator,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			elementSize * elementCount,
+			stream.deviceBuffer));
+		// Nothing has been uploaded yet
+		stream.dirty.ranges.clear();
+		markDirty(stream.dirty, 0, elementCount);
+	}
+
+	void destroyStreamedBuffer(StreamedBuffer &stream)
+	{
+		destroyBuffer(*stream.allocator, stream.deviceBuffer);
+		stream.dirty.ranges.clear();
+	}
+
+	void stageStreamedBuffer(UploadRing &ring, StreamedBuffer &stream, const void *src, UploadBatch &batch)
+	{
+		const char *srcBytes = static_cast<const char *>(src);
+		VkDeviceSize elementSize = stream.elementSize;
+		stageStreamedBuffer(ring, stream, [srcBytes, elementSize](void *dst, size_t first, size_t count)
+							{ memcpy(dst, srcBytes + first * elementSize, count * elementSize); },
+							batch);
+	}
+
+	void stageStreamedBuffer(UploadRing &ring, StreamedBuffer &stream, const std::function<void(void *, size_t, size_t)> &fill, UploadBatch &batch)
+	{
+		if (stream.dirty.ranges.empty())
+		{
+			return;
+		}
+		coalesceDirtyRanges(stream.dirty);
+		batch.srcBuffer = ring.buffer.buffer;
+
+		UploadBatch::Copy copy;
+		copy.dstBuffer = stream.deviceBuffer.buffer;
+		copy.dstAccessMask = stream.dstAccessMask;
+		copy.dstStageMask = stream.dstStageMask;
+
+		size_t staged = 0;
+		for (; staged < stream.dirty.ranges.size(); staged++)
+		{
+			auto &range = stream.dirty.ranges[staged];
+			range.second = std::min(range.second, stream.elementCount);
+			if (range.first >= range.second)
+			{
+				continue;
+			}
+			// A range larger than the space left is split, the elements that fit are staged and the rest waits for the
+			// next frame. vkCmdCopyBuffer offsets only need 4 byte alignment
+			size_t elements = std::min<size_t>(range.second - range.first, uploadSpace(ring, 4) / stream.elementSize);
+			if (elements == 0)
+			{
+				break;
+			}
+			VkDeviceSize size = elements * stream.elementSize;
+			UploadAllocation allocation = allocateUpload(ring, size, 4);
+			fill(allocation.mapped, range.first, elements);
+			VkBufferCopy region = {};
+			region.srcOffset = allocation.offset;
+			region.dstOffset = range.first * stream.elementSize;
+			region.size = size;
+			copy.regions.push_back(region);
+			range.first += elements;
+			if (range.first < range.second)
+			{
+				break;
+			}
+		}
+		stream.dirty.ranges.erase(stream.dirty.ranges.begin(), stream.dirty.ranges.begin() + staged);
+
+		if (!copy.regions.empty())
+		{
+			batch.copies.push_back(std::move(copy));
+		}
+	}
+
+	void recordUploadBatch(const UploadBatch &batch, VkCommandBuffer commandBuffer)
+	{
+		if (batch.copies.empty())
+		{
+			return;
+		}
+		VkPipelineStageFlags dstStageMask = 0;
+		for (const auto &copy : batch.copies)
+		{
+			dstStageMask |= copy.dstStageMask;
+		}
+		// Earlier frames may still be reading the ranges that are overwritten
+		vkCmdPipelineBarrier(commandBuffer, dstStageMask, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 0, nullptr, 0, nullptr);
+
+		std::vector<VkBufferMemoryBarrier> barriers;
+		for (const auto &copy : batch.copies)
+		{
+			vkCmdCopyBuffer(commandBuffer, batch.srcBuffer, copy.dstBuffer, static_cast<uint32_t>(copy.regions.size()), copy.regions.data());
+
+			VkBufferMemoryBarrier barrier = initializers::bufferMemoryBarrier();
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = copy.dstAccessMask;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = copy.dstBuffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			barriers.push_back(barrier);
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0,
+							 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+	}
+}
@@ -0,0 +1,106 @@
+#ifndef UPLOAD_RING_HPP
+#define UPLOAD_RING_HPP
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <VulkanTools/Structures/VulkanDevice.hpp>
+#include "Memory_Allocator.hpp"
+
+// ----------------------------------------------------------------------------
+// Streaming uploads
+// ----------------------------------------------------------------------------
+// A single persistently mapped host-visible buffer split into one partition
+// per frame in flight. Each frame sub-allocates linearly from its partition,
+// and a partition is only reused once the fence of the submission that read
+// it has signaled. Device-local buffers track dirty element ranges, so only
+// changed instances are memcpy'd into the ring and copied on the GPU.
+
+namespace render
+{
+// Dirty [begin, end) element ranges in the order they were marked, neighboring ranges are merged on the way and the
+// set is sorted and coalesced once it grows large or is staged
+struct DirtyRangeTracker
+{
+	std::vector<std::pair<size_t, size_t>> ranges;
+	// Ranges closer than this are merged, one larger copy beats many tiny ones
+	size_t mergeGap = 64;
+};
+
+	void markDirty(DirtyRangeTracker &tracker, size_t begin, size_t end);
+	void coalesceDirtyRanges(DirtyRangeTracker &tracker);
+
+struct UploadRing
+{
+	VulkanDevice *vulkanDevice = nullptr;
+	DeviceMemoryAllocator *allocator = nullptr;
+	AllocatedBuffer buffer;
+	VkDeviceSize frameSize = 0;
+	uint32_t frameIndex = 0;
+	// Write head inside the current frame partition
+	VkDeviceSize head = 0;
+	std::vector<VkFence> fences;
+};
+
+struct UploadAllocation
+{
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// nullptr if the frame partition is exhausted
+	void *mapped = nullptr;
+};
+
+	void createUploadRing(UploadRing &ring, DeviceMemoryAllocator *allocator, VkDeviceSize frameSize, uint32_t framesInFlight);
+	void destroyUploadRing(UploadRing &ring);
+
+	// Advance to the next partition and wait until the GPU has finished reading it
+	void beginUploadFrame(UploadRing &ring);
+	// Fence the submission consuming the current partition has to signal
+	VkFence uploadFrameFence(const UploadRing &ring);
+
+	UploadAllocation allocateUpload(UploadRing &ring, VkDeviceSize size, VkDeviceSize alignment);
+	// Bytes still free in the current frame partition at the given alignment
+	VkDeviceSize uploadSpace(const UploadRing &ring, VkDeviceSize alignment);
+
+// Device-local buffer fed through the ring
+struct StreamedBuffer
+{
+	DeviceMemoryAllocator *allocator = nullptr;
+	AllocatedBuffer deviceBuffer;
+	VkDeviceSize elementSize = 0;
+	size_t elementCount = 0;
+	DirtyRangeTracker dirty;
+	// Where the copied data is consumed
+	VkAccessFlags dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+};
+
+	void createStreamedBuffer(StreamedBuffer &stream, DeviceMemoryAllocator *allocator, VkBufferUsageFlags usage, VkDeviceSize elementSize, size_t elementCount);
+	void destroyStreamedBuffer(StreamedBuffer &stream);
+
+// Copies staged for one frame, recorded into the command buffer submitted with the frame's partition
+struct UploadBatch
+{
+	struct Copy
+	{
+		VkBuffer dstBuffer = VK_NULL_HANDLE;
+		std::vector<VkBufferCopy> regions;
+		VkAccessFlags dstAccessMask = 0;
+		VkPipelineStageFlags dstStageMask = 0;
+	};
+	VkBuffer srcBuffer = VK_NULL_HANDLE;
+	std::vector<Copy> copies;
+};
+
+	// memcpy the dirty ranges of src into the ring and queue their GPU copies, what does not fit in the frame partition
+	// stays dirty and is staged by the next calls, so streams of any size reach the GPU over several frames
+	void stageStreamedBuffer(UploadRing &ring, StreamedBuffer &stream, const void *src, UploadBatch &batch);
+	// Same for streams without a host copy, fill(dst, first, count) writes elements [first, first + count) into the ring
+	void stageStreamedBuffer(UploadRing &ring, StreamedBuffer &stream, const std::function<void(void *, size_t, size_t)> &fill, UploadBatch &batch);
+
+	// Record the staged copies and the barriers to their consumers, must be called outside of a render pass
+	void recordUploadBatch(const UploadBatch &batch, VkCommandBuffer commandBuffer);
+}
+
+#endif
@@ -0,0 +1,295 @@
+#include "Ensemble.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <omp.h>
+#include <NetworkViewport/Utils/Trace.hpp>
+#include "Gillespie.hpp"
+
+namespace simulation
+{
+	static constexpr uint32_t ENSEMBLE_FILE_MAGIC = 0x4e45564e; // "NVEN"
+	static constexpr uint32_t ENSEMBLE_FILE_VERSION = 1;
+
+	// Engine and sketches of one thread
+	struct EnsembleWorker
+	{
+		EpidemicEngine stepped;
+		GillespieEngine events;
+		// Counts per sample of the current realization
+		std::vector<uint64_t> infected;
+		std::vector<uint64_t> recovered;
+		// Per sample
+		std::vector<QuantileSketch> infectedSketches;
+		std::vector<QuantileSketch> recoveredSketches;
+		QuantileSketch peakInfected;
+		QuantileSketch attackSize;
+		QuantileSketch extinctionSample;
+	};
+
+	static void resetWorkerSketches(EnsembleWorker &worker, const EnsembleParams &params, uint32_t N_nodes)
+	{
+		worker.infectedSketches.resize(params.samples);
+		worker.recoveredSketches.resize(params.samples);
+		for (uint32_t sample = 0; sample < params.samples; sample++)
+		{
+			resetQuantileSketch(worker.infectedSketches[sample], N_nodes, params.quantileBins);
+			resetQuantileSketch(worker.recoveredSketches[sample], N_nodes, params.quantileBins);
+		}
+		resetQuantileSketch(worker.peakInfected, N_nodes, params.quantileBins);
+		resetQuantileSketch(worker.attackSize, N_nodes, params.quantileBins);
+		resetQuantileSketch(worker.extinctionSample, params.samples, params.quantileBins);
+	}
+
+	static void mergeWorkerSketches(EnsembleWorker &total, const EnsembleWorker &worker)
+	{
+		for (size_t sample = 0; sample < total.infectedSketches.size(); sample++)
+		{
+			mergeSketch(total.infectedSketches[sample], worker.infectedSketches[sample]);
+			mergeSketch(total.recoveredSketches[sample], worker.recoveredSketches[sample]);
+		}
+		mergeSketch(total.peakInfected, worker.peakInfected);
+		mergeSketch(total.attackSize, worker.attackSize);
+		mergeSketch(total.extinctionSample, worker.extinctionSample);
+	}
+
+	static EnsembleSummary summarize(const QuantileSketch &sketch, const std::vector<double> &quantiles)
+	{
+		EnsembleSummary summary;
+		summary.mean = sketchMean(sketch);
+		summary.quantiles.reserve(quantiles.size());
+		for (double q : quantiles)
+		{
+			summary.quantiles.push_back(sketchQuantile(sketch, q));
+		}
+		return summary;
+	}
+
+	// Fill the per sample counts of one realization
+	static void runRealization(EnsembleWorker &worker, const EnsembleParams &params, const EpidemicParams &epidemicParams)
+	{
+		if (params.engine == ENSEMBLE_ENGINE_EVENTS)
+		{
+			GillespieEngine &engine = worker.events;
+			resetGillespie(engine, epidemicParams);
+			for (uint32_t sample = 0; sample < params.samples; sample++)
+			{
+				if (sample > 0 && gillespieActive(engine))
+				{
+					advanceGillespie(engine, sample * params.sampleInterval);
+				}
+				worker.infected[sample] = engine.counts[NODE_STATE_INFECTED];
+				worker.recovered[sample] = engine.counts[NODE_STATE_RECOVERED];
+			}
+			return;
+		}
+		EpidemicEngine &engine = worker.stepped;
+		resetEpidemic(engine, epidemicParams);
+		uint64_t stepsPerSample = static_cast<uint64_t>(std::max(1., std::round(params.sampleInterval)));
+		for (uint32_t sample = 0; sample < params.samples; sample++)
+		{
+			for (uint64_t step = 0; sample > 0 && step < stepsPerSample && epidemicActive(engine); step++)
+			{
+				stepEpidemic(engine);
+			}
+			worker.infected[sample] = engine.counts[NODE_STATE_INFECTED];
+			worker.recovered[sample] = engine.counts[NODE_STATE_RECOVERED];
+		}
+	}
+
+	static void addRealization(EnsembleWorker &worker)
+	{
+		uint32_t samples = static_cast<uint32_t>(worker.infected.size());
+		uint64_t peakInfected = 0;
+		uint32_t extinctionSample = samples;
+		for (uint32_t sample = 0; sample < samples; sample++)
+		{
+			addToSketch(worker.infectedSketches[sample], worker.infected[sample]);
+			addToSketch(worker.recoveredSketches[sample], worker.recovered[sample]);
+			peakInfected = std::max(peakInfected, worker.infected[sample]);
+			if (worker.infected[sample] == 0 && extinctionSample == samples)
+			{
+				extinctionSample = sample;
+			}
+		}
+		addToSketch(worker.peakInfected, peakInfected);
+		addToSketch(worker.attackSize, samples > 0 ? worker.infected.back() + worker.recovered.back() : 0);
+		addToSketch(worker.extinctionSample, extinctionSample);
+	}
+
+	uint64_t realizationSeed(uint64_t ensembleSeed, uint64_t point, uint64_t realization)
+	{
+		uint64_t state = ensembleSeed + point;
+		state = splitmix64(state) ^ realization;
+		return splitmix64(state);
+	}
+
+	EnsembleResult runEnsemble(const graph::CSRGraph &graph, const EnsembleParams &params)
+	{
+		NV_TRACE_ZONE("Run ensemble");
+		auto tStart = std::chrono::steady_clock::now();
+		EnsembleResult result;
+		result.params = params;
+		result.params.samples = std::max<uint32_t>(params.samples, 1);
+		const EnsembleParams &settings = result.params;
+		result.N_nodes = graph.N_nodes;
+		result.points.resize(settings.alphas.size() * settings.betas.size());
+
+		int threadCount = settings.threads > 0 ? static_cast<int>(settings.threads) : std::max(1, omp_get_max_threads());
+		std::vector<EnsembleWorker> workers(threadCount);
+		EnsembleWorker total;
+		const int64_t realizations = static_cast<int64_t>(settings.realizations);
+
+#pragma omp parallel num_threads(threadCount)
+		{
+			EnsembleWorker &worker = workers[omp_get_thread_num()];
+			worker.infected.resize(settings.samples);
+			worker.recovered.resize(settings.samples);
+			// One partition, a realization runs on the thread that owns it
+			if (settings.engine == ENSEMBLE_ENGINE_EVENTS)
+			{
+				createGillespieEngine(worker.events, graph, settings.epidemic);
+			}
+			else
+			{
+				createEpidemicEngine(worker.stepped, graph, settings.epidemic, 1);
+			}
+
+			for (size_t point = 0; point < result.points.size(); point++)
+			{
+				EpidemicParams epidemicParams = settings.epidemic;
+				epidemicParams.beta = settings.alphas[point / settings.betas.size()];
+				epidemicParams.gamma = settings.betas[point % settings.betas.size()];
+				resetWorkerSketches(worker, settings, graph.N_nodes);
+
+#pragma omp for schedule(dynamic, 1)
+				for (int64_t realization = 0; realization < realizations; realization++)
+				{
+					epidemicParams.seed = realizationSeed(settings.epidemic.seed, point, static_cast<uint64_t>(realization));
+					runRealization(worker, settings, epidemicParams);
+					addRealization(worker);
+				}
+
+				// Integer sums, the merge order does not change the result
+#pragma omp single
+				{
+					resetWorkerSketches(total, settings, graph.N_nodes);
+					for (int thread = 0; thread < omp_get_num_threads(); thread++)
+					{
+						mergeWorkerSketches(total, workers[thread]);
+					}
+					EnsemblePoint &summary = result.points[point];
+					summary.alpha = epidemicParams.beta;
+					summary.beta = epidemicParams.gamma;
+					summary.infected.clear();
+					summary.recovered.clear();
+					for (uint32_t sample = 0; sample < settings.samples; sample++)
+					{
+						summary.infected.push_back(summarize(total.infectedSketches[sample], settings.quantiles));
+						summary.recovered.push_back(summarize(total.recoveredSketches[sample], settings.quantiles));
+					}
+					summary.peakInfected = summarize(total.peakInfected, settings.quantiles);
+					summary.attackSize = summarize(total.attackSize, settings.quantiles);
+					summary.extinctionSample = summarize(total.extinctionSample, settings.quantiles);
+				}
+			}
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+		return result;
+	}
+
+	static void writeCsvRow(std::ofstream &file, const EnsemblePoint &point, const char *quantity, const std::string &time, const EnsembleSummary &summary)
+	{
+		file << point.alpha << ',' << point.beta << ',' << quantity << ',' << time << ',' << summary.mean;
+		for (double value : summary.quantiles)
+		{
+			file << ',' << value;
+		}
+		file << '\n';
+	}
+
+	bool writeEnsembleCsv(const EnsembleResult &result, const std::string &path)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		// Node counts up to 2^32 without rounding
+		file.precision(12);
+		file << "alpha,beta,quantity,time,mean";
+		for (double q : result.params.quantiles)
+		{
+			file << ",q" << q;
+		}
+		file << '\n';
+		for (const EnsemblePoint &point : result.points)
+		{
+			for (size_t sample = 0; sample < point.infected.size(); sample++)
+			{
+				std::string time = std::to_string(sample * result.params.sampleInterval);
+				writeCsvRow(file, point, "infected", time, point.infected[sample]);
+				writeCsvRow(file, point, "recovered", time, point.recovered[sample]);
+			}
+			writeCsvRow(file, point, "peak_infected", "", point.peakInfected);
+			writeCsvRow(file, point, "attack_size", "", point.attackSize);
+			writeCsvRow(file, point, "extinction_sample", "", point.extinctionSample);
+		}
+		return file.good();
+	}
+
+	template <typename T>
+	static void writeValue(std::ofstream &out, T value)
+	{
+		out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	static void writeSummary(std::ofstream &out, const EnsembleSummary &summary)
+	{
+		writeValue(out, summary.mean);
+		out.write(reinterpret_cast<const char *>(summary.quantiles.data()), static_cast<std::streamsize>(summary.quantiles.size() * sizeof(double)));
+	}
+
+	bool writeEnsembleBinary(const EnsembleResult &result, const std::string &path)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+		const EnsembleParams &params = result.params;
+		writeValue<uint32_t>(out, ENSEMBLE_FILE_MAGIC);
+		writeValue<uint32_t>(out, ENSEMBLE_FILE_VERSION);
+		writeValue<uint32_t>(out, result.N_nodes);
+		writeValue<uint32_t>(out, static_cast<uint32_t>(params.alphas.size()));
+		writeValue<uint32_t>(out, static_cast<uint32_t>(params.betas.size()));
+		writeValue<uint32_t>(out, params.samples);
+		writeValue<uint32_t>(out, static_cast<uint32_t>(params.quantiles.size()));
+		writeValue<uint32_t>(out, params.realizations);
+		writeValue<uint32_t>(out, static_cast<uint32_t>(params.epidemic.model));
+		writeValue<uint32_t>(out, static_cast<uint32_t>(params.engine));
+		writeValue<double>(out, params.sampleInterval);
+		for (double q : params.quantiles)
+		{
+			writeValue<double>(out, q);
+		}
+		for (const EnsemblePoint &point : result.points)
+		{
+			writeValue<float>(out, point.alpha);
+			writeValue<float>(out, point.beta);
+			for (const EnsembleSummary &summary : point.infected)
+			{
+				writeSummary(out, summary);
+			}
+			for (const EnsembleSummary &summary : point.recovered)
+			{
+				writeSummary(out, summary);
+			}
+			writeSummary(out, point.peakInfected);
+			writeSummary(out, point.attackSize);
+			writeSummary(out, point.extinctionSample);
+		}
+		return out.good();
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include "Epidemic.hpp"
+#include "Quantile_Sketch.hpp"
+
+// ----------------------------------------------------------------------------
+// Monte Carlo epidemic ensembles
+// ----------------------------------------------------------------------------
+// Many independent realizations for every point of an (alpha, beta) grid,
+// alpha being the transmission and beta the recovery parameter. All OpenMP
+// threads share the read-only CSR graph and each owns one engine that is reset
+// per realization, so memory grows with the thread count and not with the
+// number of realizations. Realization r of grid point g is seeded from the
+// ensemble seed, g and r alone, which makes a sweep repeat for the same seed
+// whichever thread runs what.
+//
+// Outbreak curves are sampled at fixed times and every sample goes into a
+// per-thread quantile sketch, merged per grid point into mean and quantiles.
+
+namespace simulation
+{
+enum EnsembleEngineKind
+{
+	// Discrete steps, sampleInterval is rounded to whole steps
+	ENSEMBLE_ENGINE_STEPPED,
+	// Continuous time, alpha and beta are rates
+	ENSEMBLE_ENGINE_EVENTS
+};
+
+struct EnsembleParams
+{
+	// Model, initialInfected and the ensemble seed, beta and gamma are taken from the grid
+	EpidemicParams epidemic;
+	EnsembleEngineKind engine = ENSEMBLE_ENGINE_STEPPED;
+	std::vector<float> alphas = {.05f};
+	std::vector<float> betas = {.1f};
+	uint32_t realizations = 1000;
+	// Curve samples at 0, sampleInterval, ..., (samples - 1) * sampleInterval
+	uint32_t samples = 101;
+	double sampleInterval = 1.;
+	std::vector<double> quantiles = {.05, .25, .5, .75, .95};
+	uint32_t quantileBins = 1024;
+	// 0 for the OpenMP default
+	uint32_t threads = 0;
+};
+
+// Mean and the requested quantiles of one quantity over the realizations
+struct EnsembleSummary
+{
+	double mean = 0.;
+	std::vector<double> quantiles;
+};
+
+struct EnsemblePoint
+{
+	float alpha = 0.f;
+	float beta = 0.f;
+	// Node counts per sample
+	std::vector<EnsembleSummary> infected;
+	std::vector<EnsembleSummary> recovered;
+	// Largest infected count among the samples
+	EnsembleSummary peakInfected;
+	// Nodes not susceptible at the last sample, the outbreak size for SIR
+	EnsembleSummary attackSize;
+	// First sample without infected nodes, samples if the outbreak outlasts them
+	EnsembleSummary extinctionSample;
+};
+
+struct EnsembleResult
+{
+	EnsembleParams params;
+	uint32_t N_nodes = 0;
+	// Alpha-major, alphas.size() * betas.size() points
+	std::vector<EnsemblePoint> points;
+	double seconds = 0.;
+};
+
+	// Seed of one realization, independent of thread and order
+	uint64_t realizationSeed(uint64_t ensembleSeed, uint64_t point, uint64_t realization);
+	EnsembleResult runEnsemble(const graph::CSRGraph &graph, const EnsembleParams &params);
+
+	// One row per grid point, quantity and sample, scalar quantities leave the time empty
+	bool writeEnsembleCsv(const EnsembleResult &result, const std::string &path);
+	// Little-endian header of uint32 magic "NVEN", version, N_nodes, alpha count, beta count, samples,
+	// quantile count, realizations, model and engine, then double sampleInterval and the quantiles.
+	// Per grid point float alpha and beta, then [mean, quantiles...] doubles per sample of infected,
+	// per sample of recovered, and for peakInfected, attackSize and extinctionSample
+	bool writeEnsembleBinary(const EnsembleResult &result, const std::string &path);
+}
+
+#endif
@@ -0,0 +1,336 @@
+#include "Epidemic.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <omp.h>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace simulation
+{
+	// Infected neighbor counts with a precomputed infection probability
+	static constexpr uint32_t INFECTION_TABLE_SIZE = 64;
+	// Push while the arcs of the infected nodes are below this fraction of nodes plus arcs,
+	// it also sorts its candidates, so it only pays off well below a full pass
+	static constexpr uint64_t PUSH_WORK_FRACTION = 16;
+
+	static double infectionProbability(const EpidemicEngine &engine, uint32_t infectedNeighbors)
+	{
+		if (infectedNeighbors < engine.infectionProbability.size())
+		{
+			return engine.infectionProbability[infectedNeighbors];
+		}
+		return 1. - std::pow(1. - engine.params.beta, static_cast<double>(infectedNeighbors));
+	}
+
+	// First node of a partition, so that every partition covers about the same number of nodes plus arcs
+	static uint32_t partitionBegin(const graph::CSRGraph &graph, size_t partition, size_t partitionCount)
+	{
+		uint64_t work = graph.N_nodes + graph::arc_count(graph);
+		uint64_t target = work * partition / partitionCount;
+		uint32_t lo = 0;
+		uint32_t hi = graph.N_nodes;
+		while (lo < hi)
+		{
+			uint32_t mid = lo + (hi - lo) / 2;
+			if (graph.offsets[mid] + mid < target)
+			{
+				lo = mid + 1;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	// Range [begin, end) of partition in a list of count items
+	static void listPartition(size_t count, size_t partition, size_t partitionCount, size_t &begin, size_t &end)
+	{
+		begin = count * partition / partitionCount;
+		end = count * (partition + 1) / partitionCount;
+	}
+
+	static void concatenatePartitions(const std::vector<std::vector<uint32_t>> &partitions, std::vector<uint32_t> &out)
+	{
+		out.clear();
+		for (const std::vector<uint32_t> &nodes : partitions)
+		{
+			out.insert(out.end(), nodes.begin(), nodes.end());
+		}
+	}
+
+	static bool infectedBy(EpidemicEngine &engine, RandomStream &stream, const uint8_t *state, uint32_t node)
+	{
+		const graph::CSRGraph &graph = *engine.graph;
+		uint32_t infectedNeighbors = 0;
+		for (uint64_t arc = graph.offsets[node]; arc < graph.offsets[node + 1]; arc++)
+		{
+			infectedNeighbors += state[graph.neighbors[arc]] == NODE_STATE_INFECTED;
+		}
+		return infectedNeighbors > 0 && nextUniform(stream) < infectionProbability(engine, infectedNeighbors);
+	}
+
+	void createEpidemicEngine(EpidemicEngine &engine, const graph::CSRGraph &graph, const EpidemicParams &params, uint32_t partitionCount)
+	{
+		engine.graph = &graph;
+		engine.state.assign(graph.N_nodes, NODE_STATE_SUSCEPTIBLE);
+		engine.nextState.assign(graph.N_nodes, NODE_STATE_SUSCEPTIBLE);
+		// The partitioning is fixed here, so results do not depend on how many threads a step actually gets
+		if (partitionCount == 0)
+		{
+			partitionCount = static_cast<uint32_t>(std::max(1, omp_get_max_threads()));
+		}
+		engine.streams.resize(partitionCount);
+		engine.partitionNodes.assign(partitionCount, std::vector<uint32_t>());
+		engine.partitionChanges.assign(partitionCount, std::vector<uint32_t>());
+		resetEpidemic(engine, params);
+	}
+
+	std::vector<uint32_t> sampleInitialInfected(uint32_t N_nodes, const EpidemicParams &params, uint64_t streamIndex)
+	{
+		uint32_t initialInfected = std::min(params.initialInfected, N_nodes);
+		RandomStream seeding = createRandomStream(params.seed, streamIndex);
+		std::vector<bool> taken(N_nodes, false);
+		std::vector<uint32_t> nodes;
+		nodes.reserve(initialInfected);
+		while (nodes.size() < initialInfected)
+		{
+			uint32_t node = nextBounded(seeding, N_nodes);
+			if (!taken[node])
+			{
+				taken[node] = true;
+				nodes.push_back(node);
+			}
+		}
+		std::sort(nodes.begin(), nodes.end());
+		return nodes;
+	}
+
+	void resetEpidemic(EpidemicEngine &engine)
+	{
+		resetEpidemic(engine, engine.params);
+	}
+
+	void resetEpidemic(EpidemicEngine &engine, const EpidemicParams &params)
+	{
+		engine.params = params;
+		engine.infectionProbability.resize(INFECTION_TABLE_SIZE);
+		for (uint32_t k = 0; k < INFECTION_TABLE_SIZE; k++)
+		{
+			engine.infectionProbability[k] = 1. - std::pow(1. - params.beta, static_cast<double>(k));
+		}
+		for (size_t partition = 0; partition < engine.streams.size(); partition++)
+		{
+			engine.streams[partition] = createRandomStream(params.seed, partition);
+		}
+
+		uint32_t N_nodes = engine.graph->N_nodes;
+		std::fill(engine.state.begin(), engine.state.end(), NODE_STATE_SUSCEPTIBLE);
+		engine.infected = sampleInitialInfected(N_nodes, params, engine.streams.size());
+		uint32_t initialInfected = static_cast<uint32_t>(engine.infected.size());
+		for (uint32_t node : engine.infected)
+		{
+			engine.state[node] = NODE_STATE_INFECTED;
+		}
+		engine.counts[NODE_STATE_SUSCEPTIBLE] = N_nodes - initialInfected;
+		engine.counts[NODE_STATE_INFECTED] = initialInfected;
+		engine.counts[NODE_STATE_RECOVERED] = 0;
+		engine.step = 0;
+		engine.pushSteps = 0;
+
+		engine.changed.resize(N_nodes);
+		for (uint32_t node = 0; node < N_nodes; node++)
+		{
+			engine.changed[node] = node;
+		}
+	}
+
+	// Visit every node, reading state and writing nextState
+	static void pullStep(EpidemicEngine &engine, uint8_t recovered)
+	{
+		const graph::CSRGraph &graph = *engine.graph;
+		const uint8_t *state = engine.state.data();
+		uint8_t *nextState = engine.nextState.data();
+		const double gamma = engine.params.gamma;
+		const int partitionCount = static_cast<int>(engine.streams.size());
+		std::vector<uint64_t> partitionCounts(partitionCount * NODE_STATE_COUNT, 0);
+
+#pragma omp parallel num_threads(partitionCount)
+		{
+			for (int partition = omp_get_thread_num(); partition < partitionCount; partition += omp_get_num_threads())
+			{
+				RandomStream &stream = engine.streams[partition];
+				std::vector<uint32_t> &changes = engine.partitionChanges[partition];
+				std::vector<uint32_t> &infected = engine.partitionNodes[partition];
+				uint64_t *counts = &partitionCounts[partition * NODE_STATE_COUNT];
+				changes.clear();
+				infected.clear();
+
+				uint32_t end = partitionBegin(graph, partition + 1, partitionCount);
+				for (uint32_t node = partitionBegin(graph, partition, partitionCount); node < end; node++)
+				{
+					uint8_t current = state[node];
+					uint8_t next = current;
+					if (current == NODE_STATE_SUSCEPTIBLE)
+					{
+						if (infectedBy(engine, stream, state, node))
+						{
+							next = NODE_STATE_INFECTED;
+						}
+					}
+					else if (current == NODE_STATE_INFECTED && nextUniform(stream) < gamma)
+					{
+						next = recovered;
+					}
+					nextState[node] = next;
+					counts[next]++;
+					if (next != current)
+					{
+						changes.push_back(node);
+					}
+					if (next == NODE_STATE_INFECTED)
+					{
+						infected.push_back(node);
+					}
+				}
+			}
+		}
+
+		// Partitions are ascending node ranges, so the concatenations stay sorted
+		concatenatePartitions(engine.partitionChanges, engine.changed);
+		concatenatePartitions(engine.partitionNodes, engine.infected);
+		for (uint32_t nodeState = 0; nodeState < NODE_STATE_COUNT; nodeState++)
+		{
+			engine.counts[nodeState] = 0;
+			for (int partition = 0; partition < partitionCount; partition++)
+			{
+				engine.counts[nodeState] += partitionCounts[partition * NODE_STATE_COUNT + nodeState];
+			}
+		}
+		engine.state.swap(engine.nextState);
+	}
+
+	// Visit the infected nodes and their susceptible neighbors, decide first and then update state in place
+	static void pushStep(EpidemicEngine &engine, uint8_t recovered)
+	{
+		const graph::CSRGraph &graph = *engine.graph;
+		const uint8_t *state = engine.state.data();
+		const double gamma = engine.params.gamma;
+		const int partitionCount = static_cast<int>(engine.streams.size());
+
+		// Susceptible neighbors of the infected nodes
+#pragma omp parallel num_threads(partitionCount)
+		{
+			for (int partition = omp_get_thread_num(); partition < partitionCount; partition += omp_get_num_threads())
+			{
+				std::vector<uint32_t> &candidates = engine.partitionNodes[partition];
+				candidates.clear();
+				size_t begin, end;
+				listPartition(engine.infected.size(), partition, partitionCount, begin, end);
+				for (size_t i = begin; i < end; i++)
+				{
+					uint32_t node = engine.infected[i];
+					for (uint64_t arc = graph.offsets[node]; arc < graph.offsets[node + 1]; arc++)
+					{
+						uint32_t neighbor = graph.neighbors[arc];
+						if (state[neighbor] == NODE_STATE_SUSCEPTIBLE)
+						{
+							candidates.push_back(neighbor);
+						}
+					}
+				}
+			}
+		}
+		concatenatePartitions(engine.partitionNodes, engine.candidates);
+		std::sort(engine.candidates.begin(), engine.candidates.end());
+		engine.candidates.erase(std::unique(engine.candidates.begin(), engine.candidates.end()), engine.candidates.end());
+
+		// Infections among the candidates and recoveries among the infected
+#pragma omp parallel num_threads(partitionCount)
+		{
+			for (int partition = omp_get_thread_num(); partition < partitionCount; partition += omp_get_num_threads())
+			{
+				RandomStream &stream = engine.streams[partition];
+				std::vector<uint32_t> &infections = engine.partitionNodes[partition];
+				std::vector<uint32_t> &recoveries = engine.partitionChanges[partition];
+				infections.clear();
+				recoveries.clear();
+				size_t begin, end;
+				listPartition(engine.candidates.size(), partition, partitionCount, begin, end);
+				for (size_t i = begin; i < end; i++)
+				{
+					if (infectedBy(engine, stream, state, engine.candidates[i]))
+					{
+						infections.push_back(engine.candidates[i]);
+					}
+				}
+				listPartition(engine.infected.size(), partition, partitionCount, begin, end);
+				for (size_t i = begin; i < end; i++)
+				{
+					if (nextUniform(stream) < gamma)
+					{
+						recoveries.push_back(engine.infected[i]);
+					}
+				}
+			}
+		}
+		concatenatePartitions(engine.partitionNodes, engine.infections);
+		concatenatePartitions(engine.partitionChanges, engine.recoveries);
+
+		for (uint32_t node : engine.infections)
+		{
+			engine.state[node] = NODE_STATE_INFECTED;
+		}
+		for (uint32_t node : engine.recoveries)
+		{
+			engine.state[node] = recovered;
+		}
+
+		// Both lists are sorted and disjoint
+		engine.changed.resize(engine.infections.size() + engine.recoveries.size());
+		std::merge(engine.infections.begin(), engine.infections.end(), engine.recoveries.begin(), engine.recoveries.end(), engine.changed.begin());
+		engine.candidates.clear();
+		std::set_difference(engine.infected.begin(), engine.infected.end(), engine.recoveries.begin(), engine.recoveries.end(),
+							std::back_inserter(engine.candidates));
+		engine.infected.resize(engine.candidates.size() + engine.infections.size());
+		std::merge(engine.candidates.begin(), engine.candidates.end(), engine.infections.begin(), engine.infections.end(), engine.infected.begin());
+
+		engine.counts[NODE_STATE_SUSCEPTIBLE] -= engine.infections.size();
+		engine.counts[recovered] += engine.recoveries.size();
+		engine.counts[NODE_STATE_INFECTED] = engine.infected.size();
+	}
+
+	void stepEpidemic(EpidemicEngine &engine)
+	{
+		NV_TRACE_ZONE("Epidemic step");
+		engine.changed.clear();
+		if (!epidemicActive(engine))
+		{
+			return;
+		}
+
+		const graph::CSRGraph &graph = *engine.graph;
+		const uint8_t recovered = engine.params.model == EPIDEMIC_MODEL_SIS ? NODE_STATE_SUSCEPTIBLE : NODE_STATE_RECOVERED;
+		uint64_t frontierArcs = 0;
+		for (uint32_t node : engine.infected)
+		{
+			frontierArcs += graph::degree(graph, node);
+		}
+		if (frontierArcs * PUSH_WORK_FRACTION < graph.N_nodes + graph::arc_count(graph))
+		{
+			pushStep(engine, recovered);
+			engine.pushSteps++;
+		}
+		else
+		{
+			pullStep(engine, recovered);
+		}
+		engine.step++;
+	}
+
+	bool epidemicActive(const EpidemicEngine &engine)
+	{
+		return engine.counts[NODE_STATE_INFECTED] > 0;
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef EPIDEMIC_HPP
+#define EPIDEMIC_HPP
+#include <cstdint>
+#include <vector>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include "Random.hpp"
+
+// ----------------------------------------------------------------------------
+// Discrete-time network epidemics
+// ----------------------------------------------------------------------------
+// SIR and SIS dynamics on the CSR adjacency. In every step a susceptible node
+// with k infected neighbors becomes infected with probability
+// 1 - (1 - beta)^k, an infected node recovers with probability gamma, to
+// recovered (SIR) or back to susceptible (SIS). Node states are uint8 and
+// double-buffered, a step reads the current array and writes the next one,
+// so nodes are updated in parallel without synchronization.
+//
+// While the arcs of the infected nodes are a small part of the graph, a step
+// only visits their susceptible neighbors (push) instead of every node
+// (pull), which keeps early and late outbreak phases on large graphs cheap.
+// Work is split into a fixed number of partitions, one per OpenMP thread,
+// each drawing from its own random stream, so a run repeats for the same
+// seed and partition count. The nodes that changed state in the last step
+// are kept in ascending order for incremental color updates.
+
+namespace simulation
+{
+// Indices into UISettings::nodeStateColors
+enum NodeState : uint8_t
+{
+	NODE_STATE_SUSCEPTIBLE,
+	NODE_STATE_INFECTED,
+	NODE_STATE_RECOVERED,
+	NODE_STATE_COUNT
+};
+
+enum EpidemicModel
+{
+	EPIDEMIC_MODEL_SIR,
+	EPIDEMIC_MODEL_SIS
+};
+
+struct EpidemicParams
+{
+	EpidemicModel model = EPIDEMIC_MODEL_SIR;
+	// Per step transmission probability along one edge
+	float beta = .05f;
+	// Per step recovery probability
+	float gamma = .1f;
+	uint32_t initialInfected = 10;
+	uint64_t seed = 1;
+};
+
+struct EpidemicEngine
+{
+	const graph::CSRGraph *graph = nullptr;
+	EpidemicParams params;
+	std::vector<uint8_t> state;
+	std::vector<uint8_t> nextState;
+	// Infected nodes, ascending
+	std::vector<uint32_t> infected;
+	// 1 - (1 - beta)^k for small k, larger counts are computed on demand
+	std::vector<double> infectionProbability;
+	// One per partition, reseeded on reset
+	std::vector<RandomStream> streams;
+	// Per partition scratch lists
+	std::vector<std::vector<uint32_t>> partitionNodes;
+	std::vector<std::vector<uint32_t>> partitionChanges;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> infections;
+	std::vector<uint32_t> recoveries;
+	// Nodes whose state changed in the last step or reset, ascending
+	std::vector<uint32_t> changed;
+	uint64_t counts[NODE_STATE_COUNT] = {};
+	uint64_t step = 0;
+	// Steps taken in push mode
+	uint64_t pushSteps = 0;
+};
+
+	// initialInfected distinct nodes drawn from the given stream of the seed, ascending
+	std::vector<uint32_t> sampleInitialInfected(uint32_t N_nodes, const EpidemicParams &params, uint64_t streamIndex);
+
+	// The graph has to outlive the engine. One partition per OpenMP thread by default, a fixed count
+	// makes runs repeat independent of the thread count, e.g. one for engines stepped inside a parallel region
+	void createEpidemicEngine(EpidemicEngine &engine, const graph::CSRGraph &graph, const EpidemicParams &params, uint32_t partitionCount = 0);
+	// Everyone susceptible except initialInfected random nodes, all nodes are reported as changed
+	void resetEpidemic(EpidemicEngine &engine);
+	void resetEpidemic(EpidemicEngine &engine, const EpidemicParams &params);
+	void stepEpidemic(EpidemicEngine &engine);
+	// False once no node is infected, SIR outbreaks stop there
+	bool epidemicActive(const EpidemicEngine &engine);
+}
+
+#endif
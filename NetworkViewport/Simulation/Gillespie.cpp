@@ -0,0 +1,142 @@
+#include "Gillespie.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace simulation
+{
+	static constexpr double NEVER = std::numeric_limits<double>::infinity();
+
+	// Exponential waiting time, never for a zero rate
+	static double waitingTime(RandomStream &random, double rate)
+	{
+		if (rate <= 0.)
+		{
+			return NEVER;
+		}
+		// 1 - u is in (0, 1], so the logarithm stays finite
+		return -std::log(1. - nextUniform(random)) / rate;
+	}
+
+	static void queueNextEvent(GillespieEngine &engine, uint32_t node)
+	{
+		heapSet(engine.events, node, std::min(engine.attemptTime[node], engine.recoveryTime[node]));
+	}
+
+	static void infect(GillespieEngine &engine, uint32_t node, double time)
+	{
+		engine.counts[engine.state[node]]--;
+		engine.state[node] = NODE_STATE_INFECTED;
+		engine.counts[NODE_STATE_INFECTED]++;
+		engine.changed.push_back(node);
+
+		uint32_t degree = graph::degree(*engine.graph, node);
+		engine.recoveryTime[node] = time + waitingTime(engine.random, engine.params.gamma);
+		engine.attemptTime[node] = time + waitingTime(engine.random, static_cast<double>(engine.params.beta) * degree);
+		queueNextEvent(engine, node);
+	}
+
+	static void recover(GillespieEngine &engine, uint32_t node)
+	{
+		uint8_t recovered = engine.params.model == EPIDEMIC_MODEL_SIS ? NODE_STATE_SUSCEPTIBLE : NODE_STATE_RECOVERED;
+		engine.state[node] = recovered;
+		engine.counts[NODE_STATE_INFECTED]--;
+		engine.counts[recovered]++;
+		engine.changed.push_back(node);
+	}
+
+	// A transmission attempt of node at time, towards a uniformly chosen neighbor
+	static void attempt(GillespieEngine &engine, uint32_t node, double time)
+	{
+		const graph::CSRGraph &graph = *engine.graph;
+		uint32_t degree = graph::degree(graph, node);
+		uint32_t neighbor = graph.neighbors[graph.offsets[node] + nextBounded(engine.random, degree)];
+		engine.transmissionCount++;
+		if (engine.state[neighbor] == NODE_STATE_SUSCEPTIBLE)
+		{
+			infect(engine, neighbor, time);
+		}
+		engine.attemptTime[node] = time + waitingTime(engine.random, static_cast<double>(engine.params.beta) * degree);
+		queueNextEvent(engine, node);
+	}
+
+	void createGillespieEngine(GillespieEngine &engine, const graph::CSRGraph &graph, const EpidemicParams &params)
+	{
+		engine.graph = &graph;
+		engine.state.assign(graph.N_nodes, NODE_STATE_SUSCEPTIBLE);
+		engine.recoveryTime.assign(graph.N_nodes, NEVER);
+		engine.attemptTime.assign(graph.N_nodes, NEVER);
+		resetGillespie(engine, params);
+	}
+
+	void resetGillespie(GillespieEngine &engine)
+	{
+		resetGillespie(engine, engine.params);
+	}
+
+	void resetGillespie(GillespieEngine &engine, const EpidemicParams &params)
+	{
+		engine.params = params;
+		uint32_t N_nodes = engine.graph->N_nodes;
+		// Stream 0 seeds as the compute shader engine does, events draw from stream 1
+		engine.random = createRandomStream(params.seed, 1);
+		resetHeap(engine.events, N_nodes);
+		std::fill(engine.state.begin(), engine.state.end(), NODE_STATE_SUSCEPTIBLE);
+		engine.counts[NODE_STATE_SUSCEPTIBLE] = N_nodes;
+		engine.counts[NODE_STATE_INFECTED] = 0;
+		engine.counts[NODE_STATE_RECOVERED] = 0;
+		engine.time = 0.;
+		engine.eventCount = 0;
+		engine.transmissionCount = 0;
+
+		for (uint32_t node : sampleInitialInfected(N_nodes, params, 0))
+		{
+			infect(engine, node, 0.);
+		}
+		engine.changed.resize(N_nodes);
+		for (uint32_t node = 0; node < N_nodes; node++)
+		{
+			engine.changed[node] = node;
+		}
+	}
+
+	uint64_t advanceGillespie(GillespieEngine &engine, double until, uint64_t maxEvents)
+	{
+		NV_TRACE_ZONE("Gillespie advance");
+		engine.changed.clear();
+		uint64_t processed = 0;
+		while (processed < maxEvents && !heapEmpty(engine.events) && heapTopKey(engine.events) <= until)
+		{
+			uint32_t node = heapTop(engine.events);
+			double time = heapTopKey(engine.events);
+			engine.time = time;
+			if (engine.recoveryTime[node] <= engine.attemptTime[node])
+			{
+				heapRemove(engine.events, node);
+				recover(engine, node);
+			}
+			else
+			{
+				attempt(engine, node, time);
+			}
+			processed++;
+		}
+		// Otherwise the budget ran out and the next advance continues from the last event
+		if (heapEmpty(engine.events) || heapTopKey(engine.events) > until)
+		{
+			engine.time = std::max(engine.time, until);
+		}
+		engine.eventCount += processed;
+
+		// A node can change more than once per advance
+		std::sort(engine.changed.begin(), engine.changed.end());
+		engine.changed.erase(std::unique(engine.changed.begin(), engine.changed.end()), engine.changed.end());
+		return processed;
+	}
+
+	bool gillespieActive(const GillespieEngine &engine)
+	{
+		return engine.counts[NODE_STATE_INFECTED] > 0;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef GILLESPIE_HPP
+#define GILLESPIE_HPP
+#include <cstdint>
+#include <vector>
+#include <NetworkViewport/Graph/Graph_CSR.hpp>
+#include "Epidemic.hpp"
+#include "Indexed_Heap.hpp"
+#include "Random.hpp"
+
+// ----------------------------------------------------------------------------
+// Event-driven network epidemics
+// ----------------------------------------------------------------------------
+// Continuous-time SIR and SIS. Every infected node transmits along each of its
+// edges as a Poisson process of rate beta and recovers at rate gamma, so the
+// EpidemicParams probabilities are read as rates per unit of time here.
+//
+// Only infected nodes are queued, keyed by their next event: a recovery, or a
+// transmission attempt at total rate beta * degree towards a uniformly chosen
+// neighbor, which infects it if it is susceptible at that moment. This is
+// exact for both models and the work per event is one heap update, so a run
+// costs O(events * log(infected)) independent of the node count, and quiet
+// stretches of an outbreak are skipped instead of stepped through.
+//
+// Node states, counts and the ascending list of changed nodes match
+// EpidemicEngine, so the same color path shows either engine.
+
+namespace simulation
+{
+struct GillespieEngine
+{
+	const graph::CSRGraph *graph = nullptr;
+	EpidemicParams params;
+	std::vector<uint8_t> state;
+	// Infected nodes only
+	std::vector<double> recoveryTime;
+	std::vector<double> attemptTime;
+	// Infected nodes keyed by min(attemptTime, recoveryTime)
+	IndexedHeap events;
+	RandomStream random;
+	// Nodes whose state changed in the last advance or reset, ascending
+	std::vector<uint32_t> changed;
+	uint64_t counts[NODE_STATE_COUNT] = {};
+	double time = 0.;
+	// Processed since the last reset
+	uint64_t eventCount = 0;
+	uint64_t transmissionCount = 0;
+};
+
+	// The graph has to outlive the engine
+	void createGillespieEngine(GillespieEngine &engine, const graph::CSRGraph &graph, const EpidemicParams &params);
+	// Everyone susceptible except initialInfected random nodes at time 0, all nodes are reported as changed
+	void resetGillespie(GillespieEngine &engine);
+	void resetGillespie(GillespieEngine &engine, const EpidemicParams &params);
+	// Process the events up to time until, or at most maxEvents of them. Returns the number processed,
+	// time is until afterwards unless the event budget ran out
+	uint64_t advanceGillespie(GillespieEngine &engine, double until, uint64_t maxEvents = UINT64_MAX);
+	// False once no node is infected, nothing happens from there on
+	bool gillespieActive(const GillespieEngine &engine);
+}
+
+#endif
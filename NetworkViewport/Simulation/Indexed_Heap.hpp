@@ -0,0 +1,164 @@
+#ifndef INDEXED_HEAP_HPP
+#define INDEXED_HEAP_HPP
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Indexed d-ary min-heap
+// ----------------------------------------------------------------------------
+// Items are the integers [0, itemCount), each in the heap at most once with a
+// double key. The position of every item is tracked, so the key of a queued
+// item is changed in place instead of queuing a second entry that would have
+// to be skipped as stale later. Four children per node keep the tree shallow
+// and the children of a node in one cache line.
+
+namespace simulation
+{
+constexpr uint32_t HEAP_ARITY = 4;
+constexpr uint32_t HEAP_ABSENT = std::numeric_limits<uint32_t>::max();
+
+struct IndexedHeap
+{
+	// Items in heap order
+	std::vector<uint32_t> items;
+	// Indexed by item
+	std::vector<double> keys;
+	// Index into items, HEAP_ABSENT when not queued
+	std::vector<uint32_t> positions;
+};
+
+	inline void resetHeap(IndexedHeap &heap, uint32_t itemCount)
+	{
+		heap.items.clear();
+		heap.keys.assign(itemCount, 0.);
+		heap.positions.assign(itemCount, HEAP_ABSENT);
+	}
+
+	inline bool heapEmpty(const IndexedHeap &heap)
+	{
+		return heap.items.empty();
+	}
+
+	inline bool heapContains(const IndexedHeap &heap, uint32_t item)
+	{
+		return heap.positions[item] != HEAP_ABSENT;
+	}
+
+	inline void heapPlace(IndexedHeap &heap, uint32_t position, uint32_t item)
+	{
+		heap.items[position] = item;
+		heap.positions[item] = position;
+	}
+
+	inline void heapSiftUp(IndexedHeap &heap, uint32_t position)
+	{
+		uint32_t item = heap.items[position];
+		double key = heap.keys[item];
+		while (position > 0)
+		{
+			uint32_t parent = (position - 1) / HEAP_ARITY;
+			if (heap.keys[heap.items[parent]] <= key)
+			{
+				break;
+			}
+			heapPlace(heap, position, heap.items[parent]);
+			position = parent;
+		}
+		heapPlace(heap, position, item);
+	}
+
+	inline void heapSiftDown(IndexedHeap &heap, uint32_t position)
+	{
+		uint32_t item = heap.items[position];
+		double key = heap.keys[item];
+		uint32_t size = static_cast<uint32_t>(heap.items.size());
+		while (true)
+		{
+			uint32_t first = position * HEAP_ARITY + 1;
+			if (first >= size)
+			{
+				break;
+			}
+			uint32_t last = first + HEAP_ARITY < size ? first + HEAP_ARITY : size;
+			uint32_t smallest = first;
+			for (uint32_t child = first + 1; child < last; child++)
+			{
+				if (heap.keys[heap.items[child]] < heap.keys[heap.items[smallest]])
+				{
+					smallest = child;
+				}
+			}
+			if (key <= heap.keys[heap.items[smallest]])
+			{
+				break;
+			}
+			heapPlace(heap, position, heap.items[smallest]);
+			position = smallest;
+		}
+		heapPlace(heap, position, item);
+	}
+
+	// Queue an item or move a queued one to its new key
+	inline void heapSet(IndexedHeap &heap, uint32_t item, double key)
+	{
+		uint32_t position = heap.positions[item];
+		if (position == HEAP_ABSENT)
+		{
+			heap.keys[item] = key;
+			heap.items.push_back(item);
+			heapSiftUp(heap, static_cast<uint32_t>(heap.items.size() - 1));
+			return;
+		}
+		double previous = heap.keys[item];
+		heap.keys[item] = key;
+		if (key < previous)
+		{
+			heapSiftUp(heap, position);
+		}
+		else
+		{
+			heapSiftDown(heap, position);
+		}
+	}
+
+	inline uint32_t heapTop(const IndexedHeap &heap)
+	{
+		return heap.items.front();
+	}
+
+	inline double heapTopKey(const IndexedHeap &heap)
+	{
+		return heap.keys[heap.items.front()];
+	}
+
+	inline void heapRemove(IndexedHeap &heap, uint32_t item)
+	{
+		uint32_t position = heap.positions[item];
+		if (position == HEAP_ABSENT)
+		{
+			return;
+		}
+		heap.positions[item] = HEAP_ABSENT;
+		uint32_t last = heap.items.back();
+		heap.items.pop_back();
+		if (last == item)
+		{
+			return;
+		}
+		heap.items[position] = last;
+		heap.positions[last] = position;
+		// The moved item can belong above or below its new place
+		heapSiftUp(heap, position);
+		heapSiftDown(heap, heap.positions[last]);
+	}
+
+	inline uint32_t heapPop(IndexedHeap &heap)
+	{
+		uint32_t item = heap.items.front();
+		heapRemove(heap, item);
+		return item;
+	}
+}
+
+#endif
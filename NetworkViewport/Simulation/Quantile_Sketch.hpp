@@ -0,0 +1,99 @@
+#ifndef QUANTILE_SKETCH_HPP
+#define QUANTILE_SKETCH_HPP
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Streaming quantile summaries
+// ----------------------------------------------------------------------------
+// Fixed-width histogram over the integers [0, maxValue]. Memory is one counter
+// per bin however many values are added, quantiles are exact up to the bin
+// width, interpolated within a bin and kept inside the exact range of the
+// added values. Merging adds the counters, so sketches filled by different
+// threads combine to the same result in any order, and the mean is kept
+// exactly as an integer sum.
+
+namespace simulation
+{
+struct QuantileSketch
+{
+	uint64_t maxValue = 0;
+	// Values per bin, the last bin may be narrower
+	uint64_t binWidth = 1;
+	std::vector<uint64_t> bins;
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t minimum = UINT64_MAX;
+	uint64_t maximum = 0;
+};
+
+	// At most binCount bins, fewer when maxValue is small
+	inline void resetQuantileSketch(QuantileSketch &sketch, uint64_t maxValue, uint32_t binCount)
+	{
+		binCount = std::max<uint32_t>(binCount, 1);
+		sketch.maxValue = maxValue;
+		sketch.binWidth = (maxValue + binCount) / binCount;
+		sketch.bins.assign(maxValue / sketch.binWidth + 1, 0);
+		sketch.count = 0;
+		sketch.sum = 0;
+		sketch.minimum = UINT64_MAX;
+		sketch.maximum = 0;
+	}
+
+	// Values above maxValue count as maxValue
+	inline void addToSketch(QuantileSketch &sketch, uint64_t value)
+	{
+		value = std::min(value, sketch.maxValue);
+		sketch.bins[value / sketch.binWidth]++;
+		sketch.count++;
+		sketch.sum += value;
+		sketch.minimum = std::min(sketch.minimum, value);
+		sketch.maximum = std::max(sketch.maximum, value);
+	}
+
+	// Both sketches have to be reset with the same range and bin count
+	inline void mergeSketch(QuantileSketch &sketch, const QuantileSketch &other)
+	{
+		for (size_t bin = 0; bin < sketch.bins.size(); bin++)
+		{
+			sketch.bins[bin] += other.bins[bin];
+		}
+		sketch.count += other.count;
+		sketch.sum += other.sum;
+		sketch.minimum = std::min(sketch.minimum, other.minimum);
+		sketch.maximum = std::max(sketch.maximum, other.maximum);
+	}
+
+	inline double sketchMean(const QuantileSketch &sketch)
+	{
+		return sketch.count > 0 ? static_cast<double>(sketch.sum) / sketch.count : 0.;
+	}
+
+	// q in [0, 1], zero for an empty sketch
+	inline double sketchQuantile(const QuantileSketch &sketch, double q)
+	{
+		if (sketch.count == 0)
+		{
+			return 0.;
+		}
+		double rank = std::clamp(q, 0., 1.) * sketch.count;
+		uint64_t below = 0;
+		for (size_t bin = 0; bin < sketch.bins.size(); bin++)
+		{
+			uint64_t inBin = sketch.bins[bin];
+			if (inBin > 0 && below + inBin >= rank)
+			{
+				uint64_t first = std::max<uint64_t>(bin * sketch.binWidth, sketch.minimum);
+				uint64_t last = std::min(bin * sketch.binWidth + sketch.binWidth - 1, sketch.maximum);
+				// The values of a bin are taken as spread evenly over it
+				double fraction = (rank - below) / inBin;
+				return first + fraction * (last - first);
+			}
+			below += inBin;
+		}
+		return static_cast<double>(sketch.maximum);
+	}
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SIMULATION_RANDOM_HPP
+#define SIMULATION_RANDOM_HPP
+#include <cstdint>
+
+// ----------------------------------------------------------------------------
+// Random streams
+// ----------------------------------------------------------------------------
+// xoshiro256+ generators seeded through splitmix64. Every worker thread owns
+// a stream derived from the simulation seed and its stream index, so threads
+// never share generator state and a run repeats for the same seed and thread
+// count.
+
+namespace simulation
+{
+struct RandomStream
+{
+	uint64_t s[4];
+};
+
+	inline uint64_t splitmix64(uint64_t &state)
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	inline RandomStream createRandomStream(uint64_t seed, uint64_t streamIndex)
+	{
+		uint64_t state = seed ^ (0xd1b54a32d192ed03ull * (streamIndex + 1));
+		RandomStream stream;
+		for (uint64_t &word : stream.s)
+		{
+			word = splitmix64(state);
+		}
+		return stream;
+	}
+
+	inline uint64_t nextRandom(RandomStream &stream)
+	{
+		uint64_t *s = stream.s;
+		uint64_t result = s[0] + s[3];
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = (s[3] << 45) | (s[3] >> 19);
+		return result;
+	}
+
+	// Uniform in [0, 1) from the upper 53 bits, the low bits of xoshiro256+ are weak
+	inline double nextUniform(RandomStream &stream)
+	{
+		return (nextRandom(stream) >> 11) * 0x1.0p-53;
+	}
+
+	// Uniform in [0, bound) by multiply-shift, the bias is negligible for bounds far below 2^32
+	inline uint32_t nextBounded(RandomStream &stream, uint32_t bound)
+	{
+		return static_cast<uint32_t>(((nextRandom(stream) >> 32) * bound) >> 32);
+	}
+}
+
+#endif
@@ -0,0 +1,428 @@
+#include "State_Recording.hpp"
+#include <algorithm>
+#include <cstring>
+#include <NetworkViewport/Utils/Trace.hpp>
+
+namespace simulation
+{
+	static constexpr uint32_t RECORDING_MAGIC = 0x5253564e;		  // "NVSR"
+	static constexpr uint32_t RECORDING_INDEX_MAGIC = 0x4953564e; // "NVSI"
+	static constexpr uint32_t RECORDING_VERSION = 1;
+	static constexpr uint64_t RECORDING_HEADER_BYTES = 4 * sizeof(uint32_t);
+	// Kind and payload size
+	static constexpr uint64_t FRAME_HEADER_BYTES = 1 + sizeof(uint32_t);
+	static constexpr uint64_t FOOTER_BYTES = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+	static void putVarint(std::vector<uint8_t> &out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value) | 0x80);
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	static bool getVarint(const uint8_t *&data, const uint8_t *end, uint64_t &value)
+	{
+		value = 0;
+		for (uint32_t shift = 0; data < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *data++;
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <typename T>
+	static void writeValue(std::ofstream &out, T value)
+	{
+		out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	static bool readValue(std::ifstream &in, T &value)
+	{
+		in.read(reinterpret_cast<char *>(&value), sizeof(T));
+		return in.good();
+	}
+
+	static void writerLoop(StateRecorder &recorder)
+	{
+		NV_TRACE_THREAD("State recorder");
+		// Frames are only handed to playback once flushed
+		uint64_t unflushedFrames = 0;
+		std::unique_lock<std::mutex> lock(recorder.mutex);
+		while (true)
+		{
+			recorder.condition.wait(lock, [&recorder]
+									{ return recorder.stopWriter || !recorder.writeQueue.empty(); });
+			if (recorder.writeQueue.empty())
+			{
+				return;
+			}
+			std::vector<uint8_t> block = std::move(recorder.writeQueue.front());
+			recorder.writeQueue.pop_front();
+			recorder.queuedBytes -= block.size();
+			bool idle = recorder.writeQueue.empty();
+			lock.unlock();
+			recorder.condition.notify_all();
+
+			recorder.file.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size()));
+			unflushedFrames++;
+			if (idle)
+			{
+				recorder.file.flush();
+				if (recorder.file.good())
+				{
+					recorder.framesWritten += unflushedFrames;
+				}
+				else
+				{
+					recorder.writeFailures++;
+				}
+				unflushedFrames = 0;
+			}
+			lock.lock();
+		}
+	}
+
+	bool startStateRecorder(StateRecorder &recorder, const std::string &path, uint32_t N_nodes, uint32_t keyframeInterval)
+	{
+		recorder.file.open(path, std::ios::binary | std::ios::trunc);
+		if (!recorder.file)
+		{
+			return false;
+		}
+		recorder.path = path;
+		recorder.N_nodes = N_nodes;
+		recorder.keyframeInterval = std::max<uint32_t>(keyframeInterval, 1);
+		recorder.frameOffsets.clear();
+		recorder.frameKinds.clear();
+		recorder.framesSinceKeyframe = 0;
+		recorder.keyframePending = true;
+		recorder.queuedBytes = 0;
+		recorder.stopWriter = false;
+		recorder.framesWritten = 0;
+		recorder.writeFailures = 0;
+
+		writeValue<uint32_t>(recorder.file, RECORDING_MAGIC);
+		writeValue<uint32_t>(recorder.file, RECORDING_VERSION);
+		writeValue<uint32_t>(recorder.file, N_nodes);
+		writeValue<uint32_t>(recorder.file, recorder.keyframeInterval);
+		recorder.fileBytes = RECORDING_HEADER_BYTES;
+		recorder.writer = std::thread(writerLoop, std::ref(recorder));
+		recorder.active = true;
+		return true;
+	}
+
+	void recordStateFrame(StateRecorder &recorder, const uint8_t *states, const std::vector<uint32_t> &changed, bool keyframe)
+	{
+		NV_TRACE_ZONE("Record state frame");
+		keyframe |= recorder.frameOffsets.empty() || recorder.framesSinceKeyframe + 1 >= recorder.keyframeInterval;
+		std::vector<uint8_t> block(FRAME_HEADER_BYTES);
+		if (keyframe)
+		{
+			block[0] = RECORDED_FRAME_KEY;
+			uint32_t runStart = 0;
+			for (uint32_t node = 1; node <= recorder.N_nodes; node++)
+			{
+				if (node == recorder.N_nodes || states[node] != states[runStart])
+				{
+					putVarint(block, node - runStart);
+					block.push_back(states[runStart]);
+					runStart = node;
+				}
+			}
+			recorder.framesSinceKeyframe = 0;
+		}
+		else
+		{
+			block[0] = RECORDED_FRAME_DELTA;
+			putVarint(block, changed.size());
+			uint32_t previous = 0;
+			for (uint32_t node : changed)
+			{
+				putVarint(block, node - previous);
+				block.push_back(states[node]);
+				previous = node;
+			}
+			recorder.framesSinceKeyframe++;
+		}
+		uint32_t payloadBytes = static_cast<uint32_t>(block.size() - FRAME_HEADER_BYTES);
+		std::memcpy(block.data() + 1, &payloadBytes, sizeof(payloadBytes));
+		recorder.frameOffsets.push_back(recorder.fileBytes);
+		recorder.frameKinds.push_back(block[0]);
+		recorder.fileBytes += block.size();
+
+		uint64_t blockBytes = block.size();
+		{
+			std::unique_lock<std::mutex> lock(recorder.mutex);
+			recorder.condition.wait(lock, [&recorder]
+									{ return recorder.queuedBytes <= RECORDING_QUEUE_BYTES_MAX || recorder.writeQueue.empty(); });
+			recorder.queuedBytes += blockBytes;
+			recorder.writeQueue.push_back(std::move(block));
+		}
+		recorder.condition.notify_all();
+	}
+
+	void recordSimulationFrame(StateRecorder &recorder, uint32_t source, const uint8_t *states, const std::vector<uint32_t> &changed)
+	{
+		if (!recorder.active)
+		{
+			return;
+		}
+		recordStateFrame(recorder, states, changed, recorder.keyframePending || source != recorder.source);
+		recorder.keyframePending = false;
+		recorder.source = source;
+	}
+
+	void stopStateRecorder(StateRecorder &recorder)
+	{
+		if (!recorder.active)
+		{
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(recorder.mutex);
+			recorder.stopWriter = true;
+		}
+		recorder.condition.notify_all();
+		recorder.writer.join();
+
+		uint64_t frameCount = recorder.frameOffsets.size();
+		recorder.file.write(reinterpret_cast<const char *>(recorder.frameOffsets.data()), static_cast<std::streamsize>(frameCount * sizeof(uint64_t)));
+		recorder.file.write(reinterpret_cast<const char *>(recorder.frameKinds.data()), static_cast<std::streamsize>(frameCount));
+		writeValue<uint64_t>(recorder.file, frameCount);
+		writeValue<uint64_t>(recorder.file, recorder.fileBytes);
+		writeValue<uint32_t>(recorder.file, RECORDING_INDEX_MAGIC);
+		recorder.file.close();
+		if (recorder.file.fail())
+		{
+			recorder.writeFailures++;
+		}
+		recorder.active = false;
+	}
+
+	uint64_t recordedFrameCount(const StateRecorder &recorder)
+	{
+		return recorder.frameOffsets.size();
+	}
+
+	static bool readHeader(StatePlayback &playback, const std::string &path)
+	{
+		closeStatePlayback(playback);
+		playback.file.open(path, std::ios::binary);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		if (!readValue(playback.file, magic) || !readValue(playback.file, version) || magic != RECORDING_MAGIC || version != RECORDING_VERSION ||
+			!readValue(playback.file, playback.N_nodes) || !readValue(playback.file, playback.keyframeInterval))
+		{
+			playback.file.close();
+			return false;
+		}
+		playback.state.assign(playback.N_nodes, 0);
+		return true;
+	}
+
+	// Index from the footer of a closed recording
+	static bool readIndex(StatePlayback &playback, uint64_t fileBytes)
+	{
+		if (fileBytes < RECORDING_HEADER_BYTES + FOOTER_BYTES)
+		{
+			return false;
+		}
+		uint64_t frameCount = 0;
+		uint64_t indexOffset = 0;
+		uint32_t magic = 0;
+		playback.file.seekg(static_cast<std::streamoff>(fileBytes - FOOTER_BYTES));
+		if (!readValue(playback.file, frameCount) || !readValue(playback.file, indexOffset) || !readValue(playback.file, magic) ||
+			magic != RECORDING_INDEX_MAGIC || indexOffset + frameCount * (sizeof(uint64_t) + 1) + FOOTER_BYTES != fileBytes)
+		{
+			return false;
+		}
+		playback.frameOffsets.resize(frameCount);
+		playback.frameKinds.resize(frameCount);
+		playback.file.seekg(static_cast<std::streamoff>(indexOffset));
+		playback.file.read(reinterpret_cast<char *>(playback.frameOffsets.data()), static_cast<std::streamsize>(frameCount * sizeof(uint64_t)));
+		playback.file.read(reinterpret_cast<char *>(playback.frameKinds.data()), static_cast<std::streamsize>(frameCount));
+		return playback.file.good();
+	}
+
+	// Index of a recording that was not stopped, up to the last complete frame
+	static void scanIndex(StatePlayback &playback, uint64_t fileBytes)
+	{
+		playback.frameOffsets.clear();
+		playback.frameKinds.clear();
+		uint64_t offset = RECORDING_HEADER_BYTES;
+		while (offset + FRAME_HEADER_BYTES <= fileBytes)
+		{
+			uint8_t kind = 0;
+			uint32_t payloadBytes = 0;
+			playback.file.seekg(static_cast<std::streamoff>(offset));
+			if (!readValue(playback.file, kind) || !readValue(playback.file, payloadBytes) || offset + FRAME_HEADER_BYTES + payloadBytes > fileBytes)
+			{
+				break;
+			}
+			playback.frameOffsets.push_back(offset);
+			playback.frameKinds.push_back(kind);
+			offset += FRAME_HEADER_BYTES + payloadBytes;
+		}
+		playback.file.clear();
+	}
+
+	bool openStatePlayback(StatePlayback &playback, const std::string &path)
+	{
+		if (!readHeader(playback, path))
+		{
+			return false;
+		}
+		playback.file.seekg(0, std::ios::end);
+		uint64_t fileBytes = static_cast<uint64_t>(playback.file.tellg());
+		if (!readIndex(playback, fileBytes))
+		{
+			playback.file.clear();
+			scanIndex(playback, fileBytes);
+		}
+		return !playback.frameKinds.empty() && playback.frameKinds.front() == RECORDED_FRAME_KEY;
+	}
+
+	bool attachStatePlayback(StatePlayback &playback, const StateRecorder &recorder)
+	{
+		// The header is flushed with the first frame
+		if (recorder.framesWritten == 0 || !readHeader(playback, recorder.path))
+		{
+			return false;
+		}
+		refreshStatePlayback(playback, recorder);
+		return true;
+	}
+
+	void refreshStatePlayback(StatePlayback &playback, const StateRecorder &recorder)
+	{
+		size_t written = static_cast<size_t>(std::min<uint64_t>(recorder.framesWritten, recorder.frameOffsets.size()));
+		if (written > playback.frameOffsets.size())
+		{
+			playback.frameOffsets.assign(recorder.frameOffsets.begin(), recorder.frameOffsets.begin() + written);
+			playback.frameKinds.assign(recorder.frameKinds.begin(), recorder.frameKinds.begin() + written);
+		}
+	}
+
+	void closeStatePlayback(StatePlayback &playback)
+	{
+		if (playback.file.is_open())
+		{
+			playback.file.close();
+		}
+		playback.file.clear();
+		playback.frameOffsets.clear();
+		playback.frameKinds.clear();
+		playback.frame = -1;
+		playback.changed.clear();
+	}
+
+	uint64_t playbackFrameCount(const StatePlayback &playback)
+	{
+		return playback.frameOffsets.size();
+	}
+
+	// Apply one frame to state, collecting the nodes that change
+	static bool applyFrame(StatePlayback &playback, uint64_t frame)
+	{
+		uint8_t kind = 0;
+		uint32_t payloadBytes = 0;
+		playback.file.clear();
+		playback.file.seekg(static_cast<std::streamoff>(playback.frameOffsets[frame]));
+		if (!readValue(playback.file, kind) || !readValue(playback.file, payloadBytes))
+		{
+			return false;
+		}
+		playback.payload.resize(payloadBytes);
+		playback.file.read(reinterpret_cast<char *>(playback.payload.data()), payloadBytes);
+		if (!playback.file.good())
+		{
+			return false;
+		}
+
+		const uint8_t *data = playback.payload.data();
+		const uint8_t *end = data + payloadBytes;
+		uint8_t *state = playback.state.data();
+		if (kind == RECORDED_FRAME_KEY)
+		{
+			uint64_t node = 0;
+			while (data < end)
+			{
+				uint64_t runLength = 0;
+				if (!getVarint(data, end, runLength) || data == end || node + runLength > playback.N_nodes)
+				{
+					return false;
+				}
+				uint8_t value = *data++;
+				for (uint64_t runEnd = node + runLength; node < runEnd; node++)
+				{
+					if (state[node] != value)
+					{
+						state[node] = value;
+						playback.changed.push_back(static_cast<uint32_t>(node));
+					}
+				}
+			}
+			return node == playback.N_nodes;
+		}
+		uint64_t changeCount = 0;
+		if (!getVarint(data, end, changeCount))
+		{
+			return false;
+		}
+		uint64_t node = 0;
+		for (uint64_t change = 0; change < changeCount; change++)
+		{
+			uint64_t gap = 0;
+			if (!getVarint(data, end, gap) || data == end || node + gap >= playback.N_nodes)
+			{
+				return false;
+			}
+			node += gap;
+			state[node] = *data++;
+			playback.changed.push_back(static_cast<uint32_t>(node));
+		}
+		return true;
+	}
+
+	bool seekStatePlayback(StatePlayback &playback, uint64_t frame)
+	{
+		NV_TRACE_ZONE("Seek state playback");
+		if (frame >= playback.frameOffsets.size())
+		{
+			return false;
+		}
+		uint64_t keyframe = frame;
+		while (keyframe > 0 && playback.frameKinds[keyframe] != RECORDED_FRAME_KEY)
+		{
+			keyframe--;
+		}
+		playback.changed.clear();
+		uint64_t first = keyframe;
+		if (playback.frame >= static_cast<int64_t>(keyframe) && playback.frame <= static_cast<int64_t>(frame))
+		{
+			first = static_cast<uint64_t>(playback.frame) + 1;
+		}
+		for (uint64_t next = first; next <= frame; next++)
+		{
+			if (!applyFrame(playback, next))
+			{
+				// The state is partly decoded, the next seek starts from a keyframe
+				playback.frame = -1;
+				return false;
+			}
+		}
+		playback.frame = static_cast<int64_t>(frame);
+		std::sort(playback.changed.begin(), playback.changed.end());
+		playback.changed.erase(std::unique(playback.changed.begin(), playback.changed.end()), playback.changed.end());
+		return true;
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef STATE_RECORDING_HPP
+#define STATE_RECORDING_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Node state recordings
+// ----------------------------------------------------------------------------
+// Per-node uint8 states over time, one frame per simulation step. A keyframe
+// stores all states run-length encoded, every other frame only the changed
+// nodes as varint gaps plus their new state, so a frame costs bytes in
+// proportion to its changes. Keyframes are at most keyframeInterval frames
+// apart, which bounds a seek to one keyframe and fewer than keyframeInterval
+// deltas.
+//
+// Frames are encoded on the simulation thread and appended to the file by a
+// writer thread. The simulation only blocks when more than
+// RECORDING_QUEUE_BYTES_MAX are waiting. The frame index stays in memory
+// while recording, so a playback attached to the recorder can seek into every
+// frame that has reached the file, and is written as a footer on stop.
+//
+// File layout, little-endian: uint32 magic "NVSR", version, N_nodes and
+// keyframeInterval, then per frame uint8 kind and uint32 payload size followed
+// by the payload. Closed files end with the uint64 frame offsets, one uint8
+// kind per frame, uint64 frame count, uint64 index offset and uint32 "NVSI".
+
+namespace simulation
+{
+enum RecordedFrameKind : uint8_t
+{
+	// (varint run length, state) pairs covering all nodes
+	RECORDED_FRAME_KEY,
+	// varint change count, then (varint gap to the previous changed node, state) pairs
+	RECORDED_FRAME_DELTA
+};
+
+constexpr uint64_t RECORDING_QUEUE_BYTES_MAX = 64ull << 20;
+
+struct StateRecorder
+{
+	std::string path;
+	uint32_t N_nodes = 0;
+	uint32_t keyframeInterval = 0;
+	bool active = false;
+	// Frame index, filled by the simulation thread as frames are queued
+	std::vector<uint64_t> frameOffsets;
+	std::vector<uint8_t> frameKinds;
+	uint64_t framesSinceKeyframe = 0;
+	uint64_t fileBytes = 0;
+	// The next frame of recordSimulationFrame is stored whole, set on start and e.g. when the simulation is reset
+	bool keyframePending = false;
+	// Simulation the last frame of recordSimulationFrame came from
+	uint32_t source = 0;
+
+	std::ofstream file;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::vector<uint8_t>> writeQueue;
+	uint64_t queuedBytes = 0;
+	bool stopWriter = false;
+	// Frames flushed to the file, readable by a playback
+	std::atomic<uint64_t> framesWritten{0};
+	std::atomic<uint64_t> writeFailures{0};
+};
+
+struct StatePlayback
+{
+	std::ifstream file;
+	uint32_t N_nodes = 0;
+	uint32_t keyframeInterval = 0;
+	std::vector<uint64_t> frameOffsets;
+	std::vector<uint8_t> frameKinds;
+	// States of the current frame, -1 before the first seek
+	std::vector<uint8_t> state;
+	int64_t frame = -1;
+	// Nodes whose state differs from before the last seek, ascending
+	std::vector<uint32_t> changed;
+	std::vector<uint8_t> payload;
+};
+
+	// Truncates path and starts the writer, false if the file can not be created
+	bool startStateRecorder(StateRecorder &recorder, const std::string &path, uint32_t N_nodes, uint32_t keyframeInterval);
+	// Queue the frame after the given changes, stored whole when forced or keyframeInterval frames after the last keyframe
+	void recordStateFrame(StateRecorder &recorder, const uint8_t *states, const std::vector<uint32_t> &changed, bool keyframe = false);
+	// Queue the frame of one of several simulations while active. It is stored whole when keyframePending is set or the
+	// last frame came from another source, whose changes it does not follow
+	void recordSimulationFrame(StateRecorder &recorder, uint32_t source, const uint8_t *states, const std::vector<uint32_t> &changed);
+	// Writes the outstanding frames and the index and joins the writer, the in-memory index is kept
+	void stopStateRecorder(StateRecorder &recorder);
+	uint64_t recordedFrameCount(const StateRecorder &recorder);
+
+	// A closed recording, the index is rebuilt by scanning the frames if the footer is missing
+	bool openStatePlayback(StatePlayback &playback, const std::string &path);
+	// The file of a running or stopped recorder, refreshStatePlayback adopts frames as they are written
+	bool attachStatePlayback(StatePlayback &playback, const StateRecorder &recorder);
+	void refreshStatePlayback(StatePlayback &playback, const StateRecorder &recorder);
+	void closeStatePlayback(StatePlayback &playback);
+	uint64_t playbackFrameCount(const StatePlayback &playback);
+	// Decode frame into state, forward from the current frame when that is closer than the last keyframe
+	bool seekStatePlayback(StatePlayback &playback, uint64_t frame);
+}
+
+#endif
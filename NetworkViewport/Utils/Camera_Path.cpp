@@ -0,0 +1,102 @@
+#include "Camera_Path.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace utils
+{
+	bool loadCameraPath(CameraPath &path, const std::string &filePath)
+	{
+		std::ifstream file(filePath);
+		if (!file)
+		{
+			return false;
+		}
+		path.keyframes.clear();
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t first = line.find_first_not_of(" \t\r");
+			if (first == std::string::npos || line[first] == '#')
+			{
+				continue;
+			}
+			std::istringstream stream(line);
+			CameraKeyframe keyframe;
+			if (!(stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.rotation.x >> keyframe.rotation.y >> keyframe.rotation.z))
+			{
+				return false;
+			}
+			if (!path.keyframes.empty() && keyframe.time < path.keyframes.back().time)
+			{
+				return false;
+			}
+			path.keyframes.push_back(keyframe);
+		}
+		return !path.keyframes.empty();
+	}
+
+	CameraPath orbitCameraPath(float distance, float pitch, float duration, uint32_t keyframeCount)
+	{
+		CameraPath path;
+		keyframeCount = std::max(keyframeCount, 2u);
+		for (uint32_t i = 0; i < keyframeCount; i++)
+		{
+			float t = static_cast<float>(i) / (keyframeCount - 1);
+			CameraKeyframe keyframe;
+			keyframe.time = t * duration;
+			keyframe.position = glm::vec3(0.f, 0.f, -distance);
+			keyframe.rotation = glm::vec3(pitch, 360.f * t, 0.f);
+			path.keyframes.push_back(keyframe);
+		}
+		return path;
+	}
+
+	float cameraPathDuration(const CameraPath &path)
+	{
+		return path.keyframes.empty() ? 0.f : path.keyframes.back().time - path.keyframes.front().time;
+	}
+
+	static glm::vec3 catmullRom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float t)
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+		return .5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 + (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+	}
+
+	void sampleCameraPath(const CameraPath &path, float time, glm::vec3 &position, glm::vec3 &rotation)
+	{
+		const std::vector<CameraKeyframe> &keyframes = path.keyframes;
+		if (keyframes.empty())
+		{
+			return;
+		}
+		if (keyframes.size() == 1 || time <= keyframes.front().time)
+		{
+			position = keyframes.front().position;
+			rotation = keyframes.front().rotation;
+			return;
+		}
+		if (time >= keyframes.back().time)
+		{
+			position = keyframes.back().position;
+			rotation = keyframes.back().rotation;
+			return;
+		}
+
+		// First keyframe after time, the segment is [next - 1, next]
+		size_t next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float value, const CameraKeyframe &keyframe)
+									   { return value < keyframe.time; }) -
+					  keyframes.begin();
+		const CameraKeyframe &a = keyframes[next - 1];
+		const CameraKeyframe &b = keyframes[next];
+		float span = b.time - a.time;
+		float t = span > 0.f ? (time - a.time) / span : 0.f;
+
+		// End tangents repeat the end points
+		const glm::vec3 &before = next >= 2 ? keyframes[next - 2].position : a.position;
+		const glm::vec3 &after = next + 1 < keyframes.size() ? keyframes[next + 1].position : b.position;
+		position = catmullRom(before, a.position, b.position, after, t);
+		rotation = a.rotation + (b.rotation - a.rotation) * t;
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// ----------------------------------------------------------------------------
+// Scripted camera paths
+// ----------------------------------------------------------------------------
+// Keyframes of camera position and rotation (degrees) at increasing times in
+// seconds, in the convention of the lookat Camera: the scene is rotated about
+// the origin, then translated by the position. Positions are interpolated
+// with a Catmull-Rom spline through the keyframes, rotations linearly. Path
+// files hold one keyframe per line:
+//   time px py pz rx ry rz
+// Empty lines and lines starting with # are ignored.
+
+namespace utils
+{
+struct CameraKeyframe
+{
+	float time = 0.f;
+	glm::vec3 position = glm::vec3(0.f);
+	glm::vec3 rotation = glm::vec3(0.f);
+};
+
+struct CameraPath
+{
+	std::vector<CameraKeyframe> keyframes;
+};
+
+	bool loadCameraPath(CameraPath &path, const std::string &filePath);
+	// Orbit around the origin at the given distance and pitch, one revolution over duration
+	CameraPath orbitCameraPath(float distance, float pitch, float duration, uint32_t keyframeCount = 16);
+	float cameraPathDuration(const CameraPath &path);
+	// Times outside the path clamp to its first or last keyframe
+	void sampleCameraPath(const CameraPath &path, float time, glm::vec3 &position, glm::vec3 &rotation);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#include "Frame_Stats.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace utils
+{
+	constexpr uint32_t SUB_BUCKETS = 1u << FRAME_HISTOGRAM_SUB_BITS;
+	constexpr uint32_t HALF_BUCKETS = SUB_BUCKETS / 2;
+	constexpr uint32_t BUCKET_COUNT = SUB_BUCKETS + (FRAME_HISTOGRAM_MAX_BITS - FRAME_HISTOGRAM_SUB_BITS) * HALF_BUCKETS;
+	constexpr uint32_t MAX_VALUE = (1u << FRAME_HISTOGRAM_MAX_BITS) - 1;
+
+	static uint32_t highestBit(uint32_t value)
+	{
+		uint32_t bit = 0;
+		while (value >>= 1)
+		{
+			bit++;
+		}
+		return bit;
+	}
+
+	// Values below SUB_BUCKETS map to themselves, above each power of two gets HALF_BUCKETS buckets
+	static uint32_t bucketIndex(uint32_t value)
+	{
+		value = std::min(value, MAX_VALUE);
+		if (value < SUB_BUCKETS)
+		{
+			return value;
+		}
+		uint32_t shift = highestBit(value) - (FRAME_HISTOGRAM_SUB_BITS - 1);
+		return SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + ((value >> shift) - HALF_BUCKETS);
+	}
+
+	// Middle of the value range of a bucket
+	static double bucketValue(uint32_t index)
+	{
+		if (index < SUB_BUCKETS)
+		{
+			return index;
+		}
+		uint32_t shift = (index - SUB_BUCKETS) / HALF_BUCKETS + 1;
+		uint32_t mantissa = (index - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+		double low = static_cast<double>(mantissa << shift);
+		double high = static_cast<double>(((mantissa + 1) << shift) - 1);
+		return .5 * (low + high);
+	}
+
+	void addFrameHistogramValue(FrameHistogram &histogram, uint32_t microseconds)
+	{
+		if (histogram.counts.empty())
+		{
+			histogram.counts.resize(BUCKET_COUNT, 0);
+		}
+		histogram.counts[bucketIndex(microseconds)]++;
+		histogram.total++;
+		histogram.sum += microseconds;
+	}
+
+	void removeFrameHistogramValue(FrameHistogram &histogram, uint32_t microseconds)
+	{
+		uint64_t &count = histogram.counts[bucketIndex(microseconds)];
+		if (count > 0)
+		{
+			count--;
+			histogram.total--;
+			histogram.sum -= microseconds;
+		}
+	}
+
+	double frameHistogramQuantile(const FrameHistogram &histogram, double q)
+	{
+		if (histogram.total == 0)
+		{
+			return 0.;
+		}
+		uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0., 1.) * histogram.total));
+		rank = std::max<uint64_t>(rank, 1);
+		uint64_t seen = 0;
+		for (uint32_t index = 0; index < histogram.counts.size(); index++)
+		{
+			seen += histogram.counts[index];
+			if (seen >= rank)
+			{
+				return bucketValue(index);
+			}
+		}
+		return bucketValue(BUCKET_COUNT - 1);
+	}
+
+	void resetFrameStats(FrameStats &stats)
+	{
+		stats.windows.assign(stats.windowFrames.size(), FrameStatsWindow());
+		for (size_t window = 0; window < stats.windows.size(); window++)
+		{
+			stats.windows[window].frames = std::max(stats.windowFrames[window], 1u);
+		}
+		stats.allTime = FrameHistogram();
+		stats.allTimeMin = 0.f;
+		stats.allTimeMax = 0.f;
+		stats.lastFrame = 0.f;
+		stats.frame = 0;
+		stats.overBudgetFrames = 0;
+		stats.hitchCount = 0;
+		stats.hitches.clear();
+	}
+
+	void recordFrameTime(FrameStats &stats, float milliseconds)
+	{
+		if (stats.windows.size() != stats.windowFrames.size())
+		{
+			resetFrameStats(stats);
+		}
+		uint32_t microseconds = static_cast<uint32_t>(std::min(std::max(milliseconds, 0.f) * 1000.f, static_cast<float>(MAX_VALUE)));
+		for (FrameStatsWindow &window : stats.windows)
+		{
+			addFrameHistogramValue(window.histogram, microseconds);
+			window.values.push_back(microseconds);
+			if (window.values.size() > window.frames)
+			{
+				removeFrameHistogramValue(window.histogram, window.values.front());
+				window.values.pop_front();
+			}
+		}
+		addFrameHistogramValue(stats.allTime, microseconds);
+		stats.allTimeMin = stats.frame == 0 ? milliseconds : std::min(stats.allTimeMin, milliseconds);
+		stats.allTimeMax = std::max(stats.allTimeMax, milliseconds);
+		stats.lastFrame = milliseconds;
+
+		if (milliseconds > stats.budget)
+		{
+			stats.overBudgetFrames++;
+		}
+		if (milliseconds > stats.budget * stats.hitchFactor)
+		{
+			stats.hitchCount++;
+			stats.hitches.push_back({stats.frame, milliseconds});
+			if (stats.hitches.size() > stats.hitchHistory)
+			{
+				stats.hitches.pop_front();
+			}
+		}
+		stats.frame++;
+	}
+
+	static FrameTimePercentiles histogramPercentiles(const FrameHistogram &histogram)
+	{
+		FrameTimePercentiles percentiles;
+		percentiles.frames = histogram.total;
+		if (histogram.total == 0)
+		{
+			return percentiles;
+		}
+		percentiles.mean = 1e-3 * histogram.sum / histogram.total;
+		percentiles.min = 1e-3 * frameHistogramQuantile(histogram, 0.);
+		percentiles.max = 1e-3 * frameHistogramQuantile(histogram, 1.);
+		percentiles.p50 = 1e-3 * frameHistogramQuantile(histogram, .5);
+		percentiles.p95 = 1e-3 * frameHistogramQuantile(histogram, .95);
+		percentiles.p99 = 1e-3 * frameHistogramQuantile(histogram, .99);
+		percentiles.p999 = 1e-3 * frameHistogramQuantile(histogram, .999);
+		return percentiles;
+	}
+
+	FrameTimePercentiles frameTimePercentiles(const FrameStats &stats, size_t window)
+	{
+		if (window >= stats.windows.size())
+		{
+			return allTimePercentiles(stats);
+		}
+		return histogramPercentiles(stats.windows[window].histogram);
+	}
+
+	FrameTimePercentiles allTimePercentiles(const FrameStats &stats)
+	{
+		FrameTimePercentiles percentiles = histogramPercentiles(stats.allTime);
+		if (percentiles.frames > 0)
+		{
+			// Exact extremes instead of bucket values
+			percentiles.min = stats.allTimeMin;
+			percentiles.max = stats.allTimeMax;
+		}
+		return percentiles;
+	}
+
+	float lastFrameTime(const FrameStats &stats)
+	{
+		return stats.lastFrame;
+	}
+}
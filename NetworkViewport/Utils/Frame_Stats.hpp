@@ -0,0 +1,99 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Frame time statistics
+// ----------------------------------------------------------------------------
+// Frame times are counted in log-bucketed histograms in the style of HDR
+// histograms: values below 64 us get a bucket each, above that every power of
+// two is split into 32 buckets, so a percentile is off by at most ~3%.
+// Recording and sliding a window are O(1), percentiles are a scan over the
+// ~700 buckets. Each sliding window holds the last N frames, the all-time
+// histogram only resets on resetFrameStats.
+//
+// Frames slower than the budget are counted as over budget, frames slower
+// than hitchFactor times the budget as hitches.
+
+namespace utils
+{
+// Values are microseconds, clamped to about 67 s
+constexpr uint32_t FRAME_HISTOGRAM_SUB_BITS = 6;
+constexpr uint32_t FRAME_HISTOGRAM_MAX_BITS = 26;
+
+struct FrameHistogram
+{
+	std::vector<uint64_t> counts;
+	uint64_t total = 0;
+	// Sum of the recorded values in microseconds, for the mean
+	uint64_t sum = 0;
+};
+
+	void addFrameHistogramValue(FrameHistogram &histogram, uint32_t microseconds);
+	void removeFrameHistogramValue(FrameHistogram &histogram, uint32_t microseconds);
+	// Value below which a fraction q in [0, 1] of the recorded values lie, in microseconds
+	double frameHistogramQuantile(const FrameHistogram &histogram, double q);
+
+struct FrameTimePercentiles
+{
+	uint64_t frames = 0;
+	// Milliseconds
+	double mean = 0.;
+	double min = 0.;
+	double max = 0.;
+	double p50 = 0.;
+	double p95 = 0.;
+	double p99 = 0.;
+	double p999 = 0.;
+};
+
+struct FrameHitch
+{
+	uint64_t frame = 0;
+	float milliseconds = 0.f;
+};
+
+struct FrameStatsWindow
+{
+	uint32_t frames = 0;
+	FrameHistogram histogram;
+	// Recorded values of the window, oldest first
+	std::deque<uint32_t> values;
+};
+
+struct FrameStats
+{
+	// Frame time budget in milliseconds, 60 Hz by default
+	float budget = 1000.f / 60.f;
+	float hitchFactor = 2.f;
+	// Frame counts of the sliding windows
+	std::vector<uint32_t> windowFrames = {120, 1200};
+	// Hitches kept for display
+	size_t hitchHistory = 32;
+
+	std::vector<FrameStatsWindow> windows;
+	FrameHistogram allTime;
+	float allTimeMin = 0.f;
+	float allTimeMax = 0.f;
+	float lastFrame = 0.f;
+	uint64_t frame = 0;
+	uint64_t overBudgetFrames = 0;
+	uint64_t hitchCount = 0;
+	std::deque<FrameHitch> hitches;
+};
+
+	// Clear all histograms, picks up changed window sizes
+	void resetFrameStats(FrameStats &stats);
+	void recordFrameTime(FrameStats &stats, float milliseconds);
+
+	// Percentiles of a sliding window, or all time for window == windows.size()
+	FrameTimePercentiles frameTimePercentiles(const FrameStats &stats, size_t window);
+	FrameTimePercentiles allTimePercentiles(const FrameStats &stats);
+	// Most recent frame time in milliseconds
+	float lastFrameTime(const FrameStats &stats);
+}
+
+#endif
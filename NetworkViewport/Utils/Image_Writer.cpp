@@ -0,0 +1,142 @@
+#include "Image_Writer.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <vector>
+#include "Trace.hpp"
+
+namespace utils
+{
+	// Largest payload of a stored deflate block
+	static constexpr size_t DEFLATE_STORED_BLOCK_SIZE = 65535;
+
+	static const std::array<uint32_t, 256> &crcTable()
+	{
+		static const std::array<uint32_t, 256> table = []
+		{
+			std::array<uint32_t, 256> t{};
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				t[n] = c;
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	static uint32_t updateCrc(uint32_t crc, const uint8_t *data, size_t size)
+	{
+		const auto &table = crcTable();
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	static void appendBigEndian(std::vector<uint8_t> &out, uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	static void writeChunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+	{
+		std::vector<uint8_t> header;
+		appendBigEndian(header, static_cast<uint32_t>(data.size()));
+		header.insert(header.end(), type, type + 4);
+		uint32_t crc = updateCrc(0xFFFFFFFFu, header.data() + 4, 4);
+		crc = updateCrc(crc, data.data(), data.size()) ^ 0xFFFFFFFFu;
+
+		std::vector<uint8_t> trailer;
+		appendBigEndian(trailer, crc);
+		file.write(reinterpret_cast<const char *>(header.data()), header.size());
+		file.write(reinterpret_cast<const char *>(data.data()), data.size());
+		file.write(reinterpret_cast<const char *>(trailer.data()), trailer.size());
+	}
+
+	bool writePNG(const std::string &path, uint32_t width, uint32_t height, const uint8_t *rgba, size_t rowPitch)
+	{
+		NV_TRACE_ZONE("Write PNG");
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+		file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+		std::vector<uint8_t> ihdr;
+		appendBigEndian(ihdr, width);
+		appendBigEndian(ihdr, height);
+		ihdr.push_back(8); // bit depth
+		ihdr.push_back(6); // RGBA
+		ihdr.push_back(0); // deflate
+		ihdr.push_back(0); // adaptive filtering
+		ihdr.push_back(0); // no interlace
+		writeChunk(file, "IHDR", ihdr);
+
+		// Scanlines with filter type 0 (none)
+		const size_t rowSize = 4 * static_cast<size_t>(width);
+		std::vector<uint8_t> scanlines;
+		scanlines.reserve((rowSize + 1) * height);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			scanlines.push_back(0);
+			scanlines.insert(scanlines.end(), rgba + y * rowPitch, rgba + y * rowPitch + rowSize);
+		}
+
+		// zlib stream of stored deflate blocks
+		std::vector<uint8_t> idat;
+		idat.reserve(scanlines.size() + scanlines.size() / DEFLATE_STORED_BLOCK_SIZE * 5 + 16);
+		idat.push_back(0x78);
+		idat.push_back(0x01);
+		size_t offset = 0;
+		do
+		{
+			size_t blockSize = std::min(DEFLATE_STORED_BLOCK_SIZE, scanlines.size() - offset);
+			bool last = offset + blockSize == scanlines.size();
+			idat.push_back(last ? 1 : 0);
+			idat.push_back(static_cast<uint8_t>(blockSize));
+			idat.push_back(static_cast<uint8_t>(blockSize >> 8));
+			idat.push_back(static_cast<uint8_t>(~blockSize));
+			idat.push_back(static_cast<uint8_t>(~blockSize >> 8));
+			idat.insert(idat.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+			offset += blockSize;
+		} while (offset < scanlines.size());
+
+		uint32_t a = 1, b = 0;
+		for (uint8_t byte : scanlines)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		appendBigEndian(idat, (b << 16) | a);
+		writeChunk(file, "IDAT", idat);
+		writeChunk(file, "IEND", {});
+		return static_cast<bool>(file);
+	}
+
+	bool writeRaw(const std::string &path, uint32_t width, uint32_t height, const uint8_t *rgba, size_t rowPitch)
+	{
+		NV_TRACE_ZONE("Write raw");
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		const size_t rowSize = 4 * static_cast<size_t>(width);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			file.write(reinterpret_cast<const char *>(rgba + y * rowPitch), rowSize);
+		}
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef IMAGE_WRITER_HPP
+#define IMAGE_WRITER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ----------------------------------------------------------------------------
+// Frame image output
+// ----------------------------------------------------------------------------
+// PNG files are written with stored (uncompressed) deflate blocks: encoding
+// costs little more than a memcpy and a CRC, which keeps a writer thread
+// ahead of the renderer. Raw frames are the tightly packed RGBA8 rows.
+
+namespace utils
+{
+	// rowPitch is the byte distance between rows of rgba, at least 4 * width
+	bool writePNG(const std::string &path, uint32_t width, uint32_t height, const uint8_t *rgba, size_t rowPitch);
+	bool writeRaw(const std::string &path, uint32_t width, uint32_t height, const uint8_t *rgba, size_t rowPitch);
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "Mapped_File.hpp"
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+#ifdef WIN32
+	bool mapFile(MappedFile &file, const std::string &path)
+	{
+		HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+		HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+		void *data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr)
+		{
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			return false;
+		}
+		file.data = static_cast<const uint8_t *>(data);
+		file.size = static_cast<size_t>(fileSize.QuadPart);
+		file.fileHandle = fileHandle;
+		file.mappingHandle = mappingHandle;
+		return true;
+	}
+
+	void unmapFile(MappedFile &file)
+	{
+		if (file.data != nullptr)
+		{
+			UnmapViewOfFile(file.data);
+			CloseHandle(file.mappingHandle);
+			CloseHandle(file.fileHandle);
+		}
+		file = MappedFile();
+	}
+
+	void prefetchMappedRange(const MappedFile &file, size_t offset, size_t size)
+	{
+		if (offset >= file.size)
+		{
+			return;
+		}
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<uint8_t *>(file.data + offset);
+		range.NumberOfBytes = size < file.size - offset ? size : file.size - offset;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	bool mapFile(MappedFile &file, const std::string &path)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+		void *data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+		// Chunks are read in no particular order
+		madvise(data, static_cast<size_t>(fileStat.st_size), MADV_RANDOM);
+		file.data = static_cast<const uint8_t *>(data);
+		file.size = static_cast<size_t>(fileStat.st_size);
+		file.fd = fd;
+		return true;
+	}
+
+	void unmapFile(MappedFile &file)
+	{
+		if (file.data != nullptr)
+		{
+			munmap(const_cast<uint8_t *>(file.data), file.size);
+			close(file.fd);
+		}
+		file = MappedFile();
+	}
+
+	void prefetchMappedRange(const MappedFile &file, size_t offset, size_t size)
+	{
+		if (offset >= file.size)
+		{
+			return;
+		}
+		// madvise needs a page aligned start
+		size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size_t alignedOffset = offset - offset % pageSize;
+		size_t end = offset + size < file.size ? offset + size : file.size;
+		madvise(const_cast<uint8_t *>(file.data + alignedOffset), end - alignedOffset, MADV_WILLNEED);
+	}
+#endif
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ----------------------------------------------------------------------------
+// Read-only memory mapped files
+// ----------------------------------------------------------------------------
+// The file is mapped once and read through the returned pointer, pages are
+// faulted in by the OS on first access and dropped again under memory
+// pressure. Large data sets can be larger than system memory this way.
+
+namespace utils
+{
+struct MappedFile
+{
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+#ifdef WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+	bool mapFile(MappedFile &file, const std::string &path);
+	void unmapFile(MappedFile &file);
+
+	// Hint that a range will be read soon so the OS can start reading it ahead
+	void prefetchMappedRange(const MappedFile &file, size_t offset, size_t size);
+}
+
+#endif
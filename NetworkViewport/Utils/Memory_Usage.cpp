@@ -0,0 +1,63 @@
+#include "Memory_Usage.hpp"
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+#ifdef WIN32
+	size_t peakResidentBytes()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return 0;
+		}
+		return counters.PeakWorkingSetSize;
+	}
+
+	size_t currentResidentBytes()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return 0;
+		}
+		return counters.WorkingSetSize;
+	}
+#else
+	size_t peakResidentBytes()
+	{
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return 0;
+		}
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss);
+#else
+		// Kilobytes on Linux
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+
+	size_t currentResidentBytes()
+	{
+		FILE *statm = fopen("/proc/self/statm", "r");
+		if (!statm)
+		{
+			return 0;
+		}
+		unsigned long long pages = 0, residentPages = 0;
+		int read = fscanf(statm, "%llu %llu", &pages, &residentPages);
+		fclose(statm);
+		return read == 2 ? static_cast<size_t>(residentPages) * sysconf(_SC_PAGESIZE) : 0;
+	}
+#endif
+}
@@ -0,0 +1,17 @@
+#ifndef MEMORY_USAGE_HPP
+#define MEMORY_USAGE_HPP
+#include <cstddef>
+
+// ----------------------------------------------------------------------------
+// Process memory usage
+// ----------------------------------------------------------------------------
+// Resident set sizes as reported by the OS, 0 where they are not available.
+
+namespace utils
+{
+	// Highest resident set size of the process so far
+	size_t peakResidentBytes();
+	size_t currentResidentBytes();
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "Trace.hpp"
+
+#ifdef NV_ENABLE_TRACING
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace utils
+{
+	struct TraceEvent
+	{
+		const char *name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// Written by its thread only, the count is published after the event
+	struct TraceRing
+	{
+		std::vector<TraceEvent> events = std::vector<TraceEvent>(TRACE_RING_SIZE);
+		std::atomic<uint64_t> count{0};
+		uint32_t threadId = 0;
+		const char *threadName = nullptr;
+	};
+
+	// Rings outlive their threads, so a trace still shows finished workers
+	struct TraceRegistry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<TraceRing>> rings;
+		uint64_t startTimestamp = traceTimestamp();
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	};
+
+	static TraceRegistry &traceRegistry()
+	{
+		static TraceRegistry registry;
+		return registry;
+	}
+
+	static TraceRing &threadRing()
+	{
+		thread_local TraceRing *ring = nullptr;
+		if (!ring)
+		{
+			TraceRegistry &registry = traceRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.rings.push_back(std::make_unique<TraceRing>());
+			ring = registry.rings.back().get();
+			ring->threadId = static_cast<uint32_t>(registry.rings.size());
+		}
+		return *ring;
+	}
+
+	uint64_t traceTimestamp()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	void recordTraceEvent(const char *name, uint64_t begin, uint64_t end)
+	{
+		TraceRing &ring = threadRing();
+		uint64_t count = ring.count.load(std::memory_order_relaxed);
+		ring.events[count % TRACE_RING_SIZE] = {name, begin, end};
+		ring.count.store(count + 1, std::memory_order_release);
+	}
+
+	void setTraceThreadName(const char *name)
+	{
+		threadRing().threadName = name;
+	}
+
+	static void writeJsonString(std::ofstream &file, const char *text)
+	{
+		file << '"';
+		for (const char *c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				file << '\\';
+			}
+			file << *c;
+		}
+		file << '"';
+	}
+
+	bool writeChromeTrace(const std::string &path)
+	{
+		TraceRegistry &registry = traceRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		// Calibrate the timestamp clock against the steady clock over the lifetime of the trace
+		uint64_t ticks = traceTimestamp() - registry.startTimestamp;
+		double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - registry.startTime).count();
+		double ticksPerMicrosecond = microseconds > 0. && ticks > 0 ? ticks / microseconds : 1.;
+
+		std::ofstream file(path, std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		for (const auto &ring : registry.rings)
+		{
+			if (ring->threadName)
+			{
+				file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId << ",\"args\":{\"name\":";
+				writeJsonString(file, ring->threadName);
+				file << "}}";
+				first = false;
+			}
+			// Events written while the trace is dumped may be skipped
+			uint64_t count = ring->count.load(std::memory_order_acquire);
+			uint64_t begin = count > TRACE_RING_SIZE ? count - TRACE_RING_SIZE : 0;
+			for (uint64_t i = begin; i < count; i++)
+			{
+				const TraceEvent &event = ring->events[i % TRACE_RING_SIZE];
+				// Events from before the registry existed have no meaningful time
+				if (event.begin < registry.startTimestamp)
+				{
+					continue;
+				}
+				file << (first ? "" : ",\n") << "{\"name\":";
+				writeJsonString(file, event.name);
+				file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+					 << ",\"ts\":" << (event.begin - registry.startTimestamp) / ticksPerMicrosecond
+					 << ",\"dur\":" << (event.end - event.begin) / ticksPerMicrosecond << "}";
+				first = false;
+			}
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+}
+
+#else
+
+namespace utils
+{
+	uint64_t traceTimestamp()
+	{
+		return 0;
+	}
+
+	void recordTraceEvent(const char *, uint64_t, uint64_t)
+	{
+	}
+
+	void setTraceThreadName(const char *)
+	{
+	}
+
+	bool writeChromeTrace(const std::string &)
+	{
+		return false;
+	}
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <cstdint>
+#include <string>
+
+// ----------------------------------------------------------------------------
+// CPU trace zones
+// ----------------------------------------------------------------------------
+// NV_TRACE_ZONE("name") records the time from its line to the end of the
+// enclosing scope. Each thread appends to its own fixed-size ring, so a zone
+// costs two timestamp reads and one store, older events are overwritten once
+// the ring is full. Timestamps come from rdtsc on x86 and are converted to
+// microseconds when the trace is written in the Chrome trace event format,
+// which chrome://tracing and ui.perfetto.dev open directly.
+//
+// Only compiled with NV_ENABLE_TRACING, otherwise the macros expand to nothing
+// and writeChromeTrace fails. Zone and thread names must outlive the trace,
+// string literals are.
+
+#ifdef NV_ENABLE_TRACING
+#define NV_TRACE_CONCAT_IMPL(a, b) a##b
+#define NV_TRACE_CONCAT(a, b) NV_TRACE_CONCAT_IMPL(a, b)
+#define NV_TRACE_ZONE(name) utils::TraceZone NV_TRACE_CONCAT(traceZone, __LINE__)(name)
+#define NV_TRACE_THREAD(name) utils::setTraceThreadName(name)
+#else
+#define NV_TRACE_ZONE(name)
+#define NV_TRACE_THREAD(name)
+#endif
+
+namespace utils
+{
+// Events kept per thread
+constexpr size_t TRACE_RING_SIZE = 1 << 16;
+
+	uint64_t traceTimestamp();
+	void recordTraceEvent(const char *name, uint64_t begin, uint64_t end);
+	void setTraceThreadName(const char *name);
+
+	// Write the events of all threads, returns false if tracing is compiled out or the file can not be written
+	bool writeChromeTrace(const std::string &path);
+
+struct TraceZone
+{
+	TraceZone(const char *_name) : name(_name), begin(traceTimestamp()) {}
+	~TraceZone() { recordTraceEvent(name, begin, traceTimestamp()); }
+	TraceZone(const TraceZone &) = delete;
+	TraceZone &operator=(const TraceZone &) = delete;
+
+	const char *name;
+	uint64_t begin;
+};
+}
+
+#endif
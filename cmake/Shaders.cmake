@@ -0,0 +1,44 @@
+# SPIR-V for the GLSL sources under data/, compiled into the matching build
+# directory where the executables load it from (NV_SHADER_DIR and
+# NV_COMPUTE_SHADER_DIR), so the binaries are rebuilt whenever a source
+# changes. Without glslc the .spv files checked in next to the sources are
+# copied instead; compile.sh and compile.bat refresh those by hand.
+if(Vulkan_GLSLC_EXECUTABLE)
+  set(NV_GLSLC "${Vulkan_GLSLC_EXECUTABLE}")
+else()
+  find_program(NV_GLSLC glslc HINTS "$ENV{VULKAN_SDK}/bin" "$ENV{VULKAN_SDK}/Bin")
+endif()
+if(NOT NV_GLSLC)
+  message(STATUS "glslc not found, using the checked-in SPIR-V")
+endif()
+
+# nv_compile_shader(<source> <output> [<define>...]) compiles a shader of the
+# current source directory with the given preprocessor defines
+function(nv_compile_shader source output)
+  set(defines)
+  foreach(define ${ARGN})
+    list(APPEND defines "-D${define}")
+  endforeach()
+  set(sourcePath "${CMAKE_CURRENT_SOURCE_DIR}/${source}")
+  set(checkedInPath "${CMAKE_CURRENT_SOURCE_DIR}/${output}")
+  set(outputPath "${CMAKE_CURRENT_BINARY_DIR}/${output}")
+  if(NV_GLSLC)
+    add_custom_command(
+      OUTPUT "${outputPath}"
+      COMMAND "${NV_GLSLC}" ${defines} "${sourcePath}" -o "${outputPath}"
+      DEPENDS "${sourcePath}"
+      COMMENT "Compiling ${output}"
+      VERBATIM)
+  elseif(EXISTS "${checkedInPath}")
+    add_custom_command(
+      OUTPUT "${outputPath}"
+      COMMAND "${CMAKE_COMMAND}" -E copy "${checkedInPath}" "${outputPath}"
+      DEPENDS "${checkedInPath}"
+      COMMENT "Copying ${output}"
+      VERBATIM)
+  else()
+    message(WARNING "${output} is not checked in and glslc was not found, install the Vulkan SDK or run compile.sh")
+    return()
+  endif()
+  set(NV_SHADER_OUTPUTS ${NV_SHADER_OUTPUTS} "${outputPath}" PARENT_SCOPE)
+endfunction()
@@ -1 +1 @@
-glslc test.comp -o test.comp.spv
\ No newline at end of file
+glslc epidemic.comp -o epidemic.comp.spv
\ No newline at end of file
@@ -0,0 +1 @@
+glslc epidemic.comp -o epidemic.comp.spv
@@ -1,4 +1,11 @@
 glslc node.vert -o node.vert.spv
+glslc -DPACKED_INSTANCES node.vert -o node_packed.vert.spv
+glslc -DNODE_STATE_BUFFER node.vert -o node_state.vert.spv
+glslc -DPACKED_INSTANCES -DNODE_STATE_BUFFER node.vert -o node_packed_state.vert.spv
+glslc -DNODE_STATE_BUFFER -DNODE_FILTER node.vert -o node_state_filter.vert.spv
+glslc -DPACKED_INSTANCES -DNODE_STATE_BUFFER -DNODE_FILTER node.vert -o node_packed_state_filter.vert.spv
+glslc -DNODE_STATE_BUFFER -DNODE_FILTER -DNODE_HIGHLIGHT node.vert -o node_state_filter_highlight.vert.spv
+glslc -DPACKED_INSTANCES -DNODE_STATE_BUFFER -DNODE_FILTER -DNODE_HIGHLIGHT node.vert -o node_packed_state_filter_highlight.vert.spv
 glslc node.frag -o node.frag.spv
 
 glslc scene.vert -o scene.vert.spv
@@ -8,4 +15,24 @@ glslc ui.vert -o ui.vert.spv
 glslc ui.frag -o ui.frag.spv
 
 glslc edge.vert -o edge.vert.spv
+glslc -DPACKED_INSTANCES edge.vert -o edge_packed.vert.spv
+glslc -DNODE_FILTER edge.vert -o edge_filter.vert.spv
+glslc -DPACKED_INSTANCES -DNODE_FILTER edge.vert -o edge_packed_filter.vert.spv
+glslc -DNODE_FILTER -DNODE_HIGHLIGHT edge.vert -o edge_filter_highlight.vert.spv
+glslc -DPACKED_INSTANCES -DNODE_FILTER -DNODE_HIGHLIGHT edge.vert -o edge_packed_filter_highlight.vert.spv
 glslc edge.frag -o edge.frag.spv
+
+glslc line.vert -o line.vert.spv
+glslc -DPACKED_INSTANCES line.vert -o line_packed.vert.spv
+glslc line.frag -o line.frag.spv
+
+glslc splat_node.vert -o splat_node.vert.spv
+glslc -DPACKED_INSTANCES splat_node.vert -o splat_node_packed.vert.spv
+glslc splat_node.frag -o splat_node.frag.spv
+
+glslc splat_edge.vert -o splat_edge.vert.spv
+glslc -DPACKED_INSTANCES splat_edge.vert -o splat_edge_packed.vert.spv
+glslc splat_edge.frag -o splat_edge.frag.spv
+
+glslc heatmap.vert -o heatmap.vert.spv
+glslc heatmap.frag -o heatmap.frag.spv
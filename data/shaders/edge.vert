@@ -7,12 +7,38 @@ layout (location = 2) in vec2 inUV;
 layout (location = 3) in vec3 inColor;
 
 // Instanced attributes
+#ifdef PACKED_INSTANCES
+// xyz: end points quantized to the chunk bounds, start.w: 8-bit uniform scale
+layout (location = 4) in uvec4 startPacked;
+layout (location = 5) in uvec4 endPacked;
+#else
 layout (location = 4) in vec3 startNodePos;
 // layout (location = 5) in vec3 instanceRot;
 layout (location = 5) in vec3 endNodePos;
 layout(location = 6) in vec3 scale;
+#endif
 // layout (location = 7) in int instanceTexIndex;
 
+layout (push_constant) uniform PushConstants {
+	vec4 boundsOrigin;
+	vec4 boundsExtent;
+#ifdef NODE_FILTER
+	// x: nonzero hides the edges with an end failing the filter, y: smallest core number shown, z: component shown,
+	// 0xFFFFFFFF for all
+	uvec4 nodeFilter;
+#endif
+#ifdef NODE_HIGHLIGHT
+	// Color of the edges with both ends flagged, the selected color is unused
+	vec4 highlightMarked;
+	vec4 highlightSelected;
+	// Nonzero applies the flags, the color factor of the other edges and the width factor of the flagged ones
+	uint highlightEnabled;
+	float highlightDim;
+	float highlightScale;
+	float highlightPadding;
+#endif
+} chunk;
+
 layout (binding = 0) uniform UBO 
 {
 	mat4 projection;
@@ -21,6 +47,38 @@ layout (binding = 0) uniform UBO
 	float EdgeRenderThreshold;
 } ubo;
 
+#if defined(NODE_FILTER) || defined(NODE_HIGHLIGHT)
+// Start and end node of every edge instance
+layout (std430, binding = 4) readonly buffer EdgeEnds {
+	uvec2 edgeEnds[];
+};
+#endif
+
+#ifdef NODE_FILTER
+// Core number in the low and component in the high 16 bits of every node
+layout (std430, binding = 3) readonly buffer NodeFilterKeys {
+	uint nodeFilterKeys[];
+};
+
+bool nodeVisible(uint node)
+{
+	uint key = nodeFilterKeys[node];
+	return (key & 0xFFFFu) >= chunk.nodeFilter.y && (chunk.nodeFilter.z == 0xFFFFFFFFu || (key >> 16) == chunk.nodeFilter.z);
+}
+#endif
+
+#ifdef NODE_HIGHLIGHT
+// Two flag bits per node, sixteen to a word, 1: marked, 2: selected
+layout (std430, binding = 5) readonly buffer NodeHighlights {
+	uint nodeHighlights[];
+};
+
+uint nodeHighlight(uint node)
+{
+	return (nodeHighlights[node >> 4] >> ((node & 15u) * 2u)) & 3u;
+}
+#endif
+
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec3 outUV;
@@ -42,8 +100,40 @@ mat3 rotationMatrix(vec3 axis, float angle)
 
 void main() 
 {
+#if defined(NODE_FILTER) || defined(NODE_HIGHLIGHT)
+	uvec2 ends = edgeEnds[gl_InstanceIndex];
+#endif
+#ifdef NODE_FILTER
+	// Hidden edges collapse to a point outside the view volume
+	if (chunk.nodeFilter.x != 0u && !(nodeVisible(ends.x) && nodeVisible(ends.y)))
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+#endif
+#ifdef PACKED_INSTANCES
+	vec3 startNodePos = chunk.boundsOrigin.xyz + vec3(startPacked.xyz) / 65535.0 * chunk.boundsExtent.xyz;
+	vec3 endNodePos = chunk.boundsOrigin.xyz + vec3(endPacked.xyz) / 65535.0 * chunk.boundsExtent.xyz;
+	vec3 scale = vec3(float(startPacked.w & 0xFFu) / 32.0);
+#endif
 	outColor = inColor;
 	outUV = vec3(inUV, .0);
+	float edgeWidth = .01;
+#ifdef NODE_HIGHLIGHT
+	// Edges between two flagged nodes are highlighted, along a shortest path exactly the path edges
+	if (chunk.highlightEnabled != 0u)
+	{
+		if (nodeHighlight(ends.x) != 0u && nodeHighlight(ends.y) != 0u)
+		{
+			outColor = inColor * chunk.highlightMarked.rgb;
+			edgeWidth *= chunk.highlightScale;
+		}
+		else
+		{
+			outColor *= chunk.highlightDim;
+		}
+	}
+#endif
 
 
 	vec3 edgeDirection = endNodePos - startNodePos;
@@ -56,8 +146,8 @@ void main()
 	
 	vec4 locPos = vec4(inPos.xyz*scale, 1.0);
 	locPos.z = locPos.z*abs(distance(startNodePos, endNodePos))/2;
-	locPos.x *=.01;
-	locPos.y *=.01;
+	locPos.x *= edgeWidth;
+	locPos.y *= edgeWidth;
 	vec4 pos = ubo.modelview*vec4(rotMat*locPos.xyz + centerPos.xyz, 1.0);
 	gl_Position = ubo.projection * pos;
 	outNormal = mat3(ubo.modelview) * inNormal;
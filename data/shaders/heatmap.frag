@@ -0,0 +1,38 @@
+#version 450
+
+layout (binding = 0) uniform sampler2D densitySampler;
+
+layout (push_constant) uniform PushConstants {
+	float exposure;
+	float opacity;
+} pushConstants;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+// Black body style ramp: transparent -> purple -> red -> orange -> yellow -> white
+vec3 heat(float t)
+{
+	const vec3 stops[5] = vec3[](
+		vec3(0.23, 0.05, 0.42),
+		vec3(0.80, 0.10, 0.25),
+		vec3(0.98, 0.45, 0.05),
+		vec3(0.99, 0.85, 0.20),
+		vec3(1.00, 1.00, 0.95));
+	float x = clamp(t, 0.0, 1.0) * 4.0;
+	int i = min(int(x), 3);
+	return mix(stops[i], stops[i + 1], x - float(i));
+}
+
+void main() 
+{
+	float density = texture(densitySampler, inUV).r;
+	if (density <= 0.0)
+	{
+		discard;
+	}
+	// Saturating tone map, the average covered pixel maps to ~0.63
+	float t = 1.0 - exp(-density * pushConstants.exposure);
+	outFragColor = vec4(heat(t), pushConstants.opacity * clamp(4.0 * t, 0.0, 1.0));
+}
@@ -0,0 +1,16 @@
+#version 450
+
+layout (location = 0) noperspective in float inDistance;
+layout (location = 1) flat in float inHalfWidth;
+layout (location = 2) flat in vec4 inColor;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	// Box-filtered coverage of a line of width 2*inHalfWidth over a one pixel footprint,
+	// sub-pixel lines keep a one pixel footprint and fade with their width instead
+	float halfWidth = max(inHalfWidth, 0.5);
+	float coverage = clamp(halfWidth + 0.5 - abs(inDistance), 0.0, 1.0) * min(2.0 * inHalfWidth, 1.0);
+	outFragColor = vec4(inColor.rgb, inColor.a * coverage);
+}
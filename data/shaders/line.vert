@@ -0,0 +1,90 @@
+#version 450
+
+// Instanced attributes
+#ifdef PACKED_INSTANCES
+// xyz: end points quantized to the bounds
+layout (location = 0) in uvec4 startPacked;
+layout (location = 1) in uvec4 endPacked;
+#else
+layout (location = 0) in vec3 startNodePos;
+layout (location = 1) in vec3 endNodePos;
+#endif
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 modelview;
+	vec4 lightPos;
+} ubo;
+
+layout (push_constant) uniform PushConstants {
+	vec4 boundsOrigin;
+	vec4 boundsExtent;
+	vec4 color;
+	vec2 viewport;
+	float lineWidth;
+	float alpha;
+} pushConstants;
+
+// Signed pixel distance from the line center, interpolated in screen space
+layout (location = 0) noperspective out float outDistance;
+layout (location = 1) flat out float outHalfWidth;
+layout (location = 2) flat out vec4 outColor;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+// x: position along the edge, y: side of the line
+const vec2 corners[6] = vec2[](
+	vec2(0.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(0.0, -1.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+const float nearW = 1e-4;
+
+void main() 
+{
+#ifdef PACKED_INSTANCES
+	vec3 startNodePos = pushConstants.boundsOrigin.xyz + vec3(startPacked.xyz) / 65535.0 * pushConstants.boundsExtent.xyz;
+	vec3 endNodePos = pushConstants.boundsOrigin.xyz + vec3(endPacked.xyz) / 65535.0 * pushConstants.boundsExtent.xyz;
+#endif
+	vec2 corner = corners[gl_VertexIndex];
+	mat4 mvp = ubo.projection * ubo.modelview;
+	vec4 clipStart = mvp * vec4(startNodePos, 1.0);
+	vec4 clipEnd = mvp * vec4(endNodePos, 1.0);
+
+	// Clip the segment against the near plane, drop it if it is entirely behind the camera
+	if (clipStart.w < nearW && clipEnd.w < nearW)
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+	if (clipStart.w < nearW)
+	{
+		clipStart = mix(clipStart, clipEnd, (nearW - clipStart.w) / (clipEnd.w - clipStart.w));
+	}
+	else if (clipEnd.w < nearW)
+	{
+		clipEnd = mix(clipEnd, clipStart, (nearW - clipEnd.w) / (clipStart.w - clipEnd.w));
+	}
+
+	vec2 screenStart = (clipStart.xy / clipStart.w) * 0.5 * pushConstants.viewport;
+	vec2 screenEnd = (clipEnd.xy / clipEnd.w) * 0.5 * pushConstants.viewport;
+	vec2 direction = screenEnd - screenStart;
+	float len = length(direction);
+	direction = len > 1e-6 ? direction / len : vec2(1.0, 0.0);
+	vec2 normal = vec2(-direction.y, direction.x);
+
+	// Widen by one pixel so the analytic falloff has room on both sides
+	float halfWidth = 0.5 * max(pushConstants.lineWidth, 1.0) + 1.0;
+	vec2 offsetPx = normal * corner.y * halfWidth + direction * (corner.x * 2.0 - 1.0) * halfWidth;
+
+	vec4 clip = mix(clipStart, clipEnd, corner.x);
+	clip.xy += offsetPx / (0.5 * pushConstants.viewport) * clip.w;
+	gl_Position = clip;
+
+	outDistance = corner.y * halfWidth;
+	outHalfWidth = 0.5 * pushConstants.lineWidth;
+	outColor = vec4(pushConstants.color.rgb, pushConstants.color.a * pushConstants.alpha);
+}
@@ -7,11 +7,40 @@ layout (location = 2) in vec2 inUV;
 layout (location = 3) in vec3 inColor;
 
 // Instanced attributes
+#ifdef PACKED_INSTANCES
+// xyz: position quantized to the chunk bounds, w: 8-bit scale
+layout (location = 4) in uvec4 instancePacked;
+#else
 layout (location = 4) in vec3 instancePos;
 // layout (location = 5) in vec3 instanceRot;
 layout (location = 5) in float instanceScale;
+#endif
+layout (location = 6) in vec4 instanceColor;
 // layout (location = 7) in int instanceTexIndex;
 
+layout (push_constant) uniform PushConstants {
+	vec4 boundsOrigin;
+	vec4 boundsExtent;
+#ifdef NODE_STATE_BUFFER
+	// Nonzero x colors by the node state palette in place of the instance colors
+	uvec4 stateColorsEnabled;
+#endif
+#ifdef NODE_FILTER
+	// x: nonzero hides the nodes failing the filter, y: smallest core number shown, z: component shown, 0xFFFFFFFF for all
+	uvec4 nodeFilter;
+#endif
+#ifdef NODE_HIGHLIGHT
+	// Colors of the marked and of the selected nodes
+	vec4 highlightMarked;
+	vec4 highlightSelected;
+	// Nonzero applies the flags, the color factor of the other nodes and the size factor of the flagged ones
+	uint highlightEnabled;
+	float highlightDim;
+	float highlightScale;
+	float highlightPadding;
+#endif
+} chunk;
+
 layout (binding = 0) uniform UBO 
 {
 	mat4 projection;
@@ -19,6 +48,44 @@ layout (binding = 0) uniform UBO
 	vec4 lightPos;
 } ubo;
 
+#ifdef NODE_STATE_BUFFER
+#define NODE_PALETTE_SIZE 16u
+
+// One uint8 state per node, four to a word, lowest byte first
+layout (std430, binding = 1) readonly buffer NodeStates {
+	uint nodeStates[];
+};
+
+layout (binding = 2) uniform NodePalette {
+	vec4 colors[NODE_PALETTE_SIZE];
+} palette;
+#endif
+
+#ifdef NODE_FILTER
+// Core number in the low and component in the high 16 bits of every node
+layout (std430, binding = 3) readonly buffer NodeFilterKeys {
+	uint nodeFilterKeys[];
+};
+
+bool nodeVisible(uint node)
+{
+	uint key = nodeFilterKeys[node];
+	return (key & 0xFFFFu) >= chunk.nodeFilter.y && (chunk.nodeFilter.z == 0xFFFFFFFFu || (key >> 16) == chunk.nodeFilter.z);
+}
+#endif
+
+#ifdef NODE_HIGHLIGHT
+// Two flag bits per node, sixteen to a word, 1: marked, 2: selected
+layout (std430, binding = 5) readonly buffer NodeHighlights {
+	uint nodeHighlights[];
+};
+
+uint nodeHighlight(uint node)
+{
+	return (nodeHighlights[node >> 4] >> ((node & 15u) * 2u)) & 3u;
+}
+#endif
+
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec3 outUV;
@@ -27,16 +94,52 @@ layout (location = 4) out vec3 outLightVec;
 
 void main() 
 {
-	outColor = inColor;
+#ifdef NODE_FILTER
+	// Hidden nodes collapse to a point outside the view volume
+	if (chunk.nodeFilter.x != 0u && !nodeVisible(uint(gl_InstanceIndex)))
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+#endif
+#ifdef PACKED_INSTANCES
+	vec3 instancePos = chunk.boundsOrigin.xyz + vec3(instancePacked.xyz) / 65535.0 * chunk.boundsExtent.xyz;
+	float instanceScale = float(instancePacked.w & 0xFFu) / 32.0;
+#endif
+	vec4 nodeColor = instanceColor;
+	float nodeScale = instanceScale;
+#ifdef NODE_STATE_BUFFER
+	if (chunk.stateColorsEnabled.x != 0u)
+	{
+		uint state = (nodeStates[gl_InstanceIndex >> 2] >> ((gl_InstanceIndex & 3) * 8)) & 0xFFu;
+		nodeColor = palette.colors[min(state, NODE_PALETTE_SIZE - 1u)];
+	}
+#endif
+#ifdef NODE_HIGHLIGHT
+	if (chunk.highlightEnabled != 0u)
+	{
+		uint flags = nodeHighlight(uint(gl_InstanceIndex));
+		if (flags != 0u)
+		{
+			nodeColor = (flags & 2u) != 0u ? chunk.highlightSelected : chunk.highlightMarked;
+			nodeScale *= chunk.highlightScale;
+		}
+		else
+		{
+			nodeColor.rgb *= chunk.highlightDim;
+		}
+	}
+#endif
+	outColor = inColor * nodeColor.rgb;
 	outUV = vec3(inUV, .0);
 	
-	vec4 locPos = vec4(inPos.xyz, 1.0);
+	vec4 locPos = vec4(inPos.xyz * nodeScale, 1.0);
 	vec4 pos = vec4((locPos.xyz) + instancePos, 1.0);
 
 	gl_Position = ubo.projection * ubo.modelview * pos;// * gRotMat * pos;
 	outNormal = mat3(ubo.modelview) * inNormal;
 
-	pos = ubo.modelview * vec4(inPos.xyz + instancePos, 1.0);
+	pos = ubo.modelview * pos;
 	vec3 lPos = mat3(ubo.modelview) * ubo.lightPos.xyz;
 	outLightVec = lPos - pos.xyz;
 	outViewVec = -pos.xyz;		
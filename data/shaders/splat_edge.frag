@@ -0,0 +1,10 @@
+#version 450
+
+layout (location = 0) in float inWeight;
+
+layout (location = 0) out float outDensity;
+
+void main() 
+{
+	outDensity = inWeight;
+}
@@ -0,0 +1,43 @@
+#version 450
+
+// Instanced attributes
+#ifdef PACKED_INSTANCES
+// xyz: end points quantized to the bounds
+layout (location = 0) in uvec4 startPacked;
+layout (location = 1) in uvec4 endPacked;
+#else
+layout (location = 0) in vec3 startNodePos;
+layout (location = 1) in vec3 endNodePos;
+#endif
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 modelview;
+	vec4 lightPos;
+} ubo;
+
+layout (push_constant) uniform PushConstants {
+	vec4 boundsOrigin;
+	vec4 boundsExtent;
+	float pointSize;
+	float weight;
+} pushConstants;
+
+layout (location = 0) out float outWeight;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	outWeight = pushConstants.weight;
+#ifdef PACKED_INSTANCES
+	vec3 startNodePos = pushConstants.boundsOrigin.xyz + vec3(startPacked.xyz) / 65535.0 * pushConstants.boundsExtent.xyz;
+	vec3 endNodePos = pushConstants.boundsOrigin.xyz + vec3(endPacked.xyz) / 65535.0 * pushConstants.boundsExtent.xyz;
+#endif
+	vec3 pos = gl_VertexIndex == 0 ? startNodePos : endNodePos;
+	gl_Position = ubo.projection * ubo.modelview * vec4(pos, 1.0);
+}
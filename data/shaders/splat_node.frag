@@ -0,0 +1,17 @@
+#version 450
+
+layout (location = 0) in float inWeight;
+
+layout (location = 0) out float outDensity;
+
+void main() 
+{
+	// Gaussian footprint over the point sprite
+	vec2 d = gl_PointCoord * 2.0 - 1.0;
+	float r2 = dot(d, d);
+	if (r2 > 1.0)
+	{
+		discard;
+	}
+	outDensity = inWeight * exp(-4.0 * r2);
+}
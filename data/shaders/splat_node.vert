@@ -0,0 +1,40 @@
+#version 450
+
+#ifdef PACKED_INSTANCES
+// xyz: position quantized to the bounds
+layout (location = 0) in uvec4 inPacked;
+#else
+layout (location = 0) in vec3 inPos;
+#endif
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 modelview;
+	vec4 lightPos;
+} ubo;
+
+layout (push_constant) uniform PushConstants {
+	vec4 boundsOrigin;
+	vec4 boundsExtent;
+	float pointSize;
+	float weight;
+} pushConstants;
+
+layout (location = 0) out float outWeight;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+	float gl_PointSize;
+};
+
+void main() 
+{
+#ifdef PACKED_INSTANCES
+	vec3 inPos = pushConstants.boundsOrigin.xyz + vec3(inPacked.xyz) / 65535.0 * pushConstants.boundsExtent.xyz;
+#endif
+	outWeight = pushConstants.weight;
+	gl_PointSize = pushConstants.pointSize;
+	gl_Position = ubo.projection * ubo.modelview * vec4(inPos, 1.0);
+}